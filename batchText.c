@@ -0,0 +1,522 @@
+/**
+*
+* batchText.c Copyright (C) 2018  Valentinos Pariza 
+*
+*
+* This program is free software: you can redistribute it and/or modify it under 
+* the terms of the GNU General Public License as published by the Free Software
+* Foundation, either version 3 of the License, or at your option) any later version. 
+*
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT 
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details. 
+*
+* Υou should have received a copy of the GNU General Public License along with 
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*
+* This file contains the implementation of the encodeTextBatch method ,which
+* hides one payload in many soundtracks. The payload ,its symbols and ,for
+* every different shape of soundtrack (size of data and bits per sample) ,the
+* bytes of the file to change are computed once and shared by all the workers.
+* Every soundtrack is copied with copy_file_range and only the bytes which
+* hide the payload are changed in the copy.
+*
+*/
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utilities.h"
+#include "cryptoUtilities.h"
+#include "workerPool.h"
+#include "wavelib.h"
+
+// The number of bytes of the payload read at a time
+#define PAYLOAD_BLOCK_BYTES 4096
+
+// The size of the buffer used for copying when copy_file_range can't be used
+#define COPY_BUFFER_BYTES (1 << 20)
+
+/**
+ * A change of a single byte of a soundtrack file : the bits kept from the
+ * original byte and the bits of the payload merged in
+ */
+typedef struct {
+	long offset;
+	byte keep;
+	byte value;
+} PATCH;
+
+/**
+ * The payload to hide ,shared by all the soundtracks
+ */
+typedef struct {
+	byte header[PAYLOAD_HEADER_BYTES];
+	byte* symbols;
+	long numberOfSymbols;
+	int bitsPerSample;
+} PAYLOAD;
+
+/**
+ * A shape of soundtrack (where its data starts ,their size and the bits per
+ * sample) and the changes of its file ,shared by all the
+ * soundtracks of that shape
+ */
+typedef struct {
+	long dataOffset;
+	dword dataSize;
+	word bitsPerSample;
+	const PAYLOAD* payload;
+	PATCH* patches;
+	long numberOfPatches;
+} SHAPE;
+
+/**
+ * A soundtrack of the batch
+ */
+typedef struct {
+	char* fileName;
+	SHAPE* shape;
+	int result;
+} CARRIER;
+
+
+/**
+ * @brief This method reads a whole file in memory
+ *
+ * The file is read block by block in a buffer which doubles its size when it
+ * is full ,so any sequence of bytes is read in linear time.
+ *
+ * @param the name of the file
+ *
+ * @param a pointer to a variable where the address of the bytes is placed
+ *
+ * @param a pointer to a variable where the number of the bytes is placed
+ *
+ * @return EXIT_SUCCESS if the reading was executed succesfully or EXIT_FAILURE
+ *         if there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE int readPayloadFile(char* fileName, byte** payload, long* length);
+
+
+/**
+ * @brief This method computes the changes of the file of a shape of soundtrack
+ *
+ * It finds the positions of the samples where the header and the symbols of
+ * the payload are hidden and it creates a change for each one ,sorted by
+ * their offsets in the file so a soundtrack is patched from its start to its
+ * end. It is a job of the worker pool ,its argument is a SHAPE.
+ *
+ * @param a pointer to a struct of type SHAPE
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE void buildPatches(void* argument);
+
+
+/**
+ * @brief This method creates the encoded copy of a soundtrack
+ *
+ * It copies the file of the soundtrack to new-<filename>.wav and changes in
+ * place only the bytes of the copy which hide the payload. It is a job of the
+ * worker pool ,its argument is a CARRIER.
+ *
+ * @param a pointer to a struct of type CARRIER
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE void patchCarrier(void* argument);
+
+
+PRIVATE int readPayloadFile(char* fileName, byte** payload, long* length) {
+	if (fileName == NULL || payload == NULL || length == NULL)
+		return EXIT_FAILURE;
+
+	FILE* filePointer = fopen(fileName, "rb");
+
+	if (filePointer == NULL)
+		return EXIT_FAILURE;
+
+	long maxSize = PAYLOAD_BLOCK_BYTES;
+	size_t bytesRead = 0;
+	byte* temp = NULL;
+
+	*length = 0;
+	*payload = (byte*) malloc(maxSize);
+
+	if (*payload == NULL) {
+		fclose(filePointer);
+		return EXIT_FAILURE;
+	}
+
+	while ((bytesRead = fread(*payload + *length, sizeof(byte),
+			maxSize - *length, filePointer)) > 0) {
+		*length += (long) bytesRead;
+
+		if (*length == maxSize) {
+			maxSize <<= 1;
+			temp = (byte*) realloc(*payload, maxSize);
+
+			if (temp == NULL) {
+				free(*payload);
+				*payload = NULL;
+				fclose(filePointer);
+				return EXIT_FAILURE;
+			}
+
+			*payload = temp;
+		}
+	}
+
+	if (ferror(filePointer) || *length > 0xFFFFFFFFL) {
+		free(*payload);
+		*payload = NULL;
+		fclose(filePointer);
+		return EXIT_FAILURE;
+	}
+
+	fclose(filePointer);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Compares two changes by their offsets (for qsort)
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE int comparePatches(const void* a, const void* b) {
+	long first = ((const PATCH*) a)->offset;
+	long second = ((const PATCH*) b)->offset;
+
+	return (first > second) - (first < second);
+}
+
+PRIVATE void buildPatches(void* argument) {
+	SHAPE* shape = (SHAPE*) argument;
+	const PAYLOAD* payload = shape->payload;
+
+	int bytesPerSample = shape->bitsPerSample >> 3;
+	long domain = shape->dataSize / bytesPerSample;
+	long total = PAYLOAD_HEADER_BITS + payload->numberOfSymbols;
+
+	shape->patches = NULL;
+	shape->numberOfPatches = 0;
+
+	// the payload doesn't fit in this shape of soundtrack
+	if (total > domain || payload->bitsPerSample > shape->bitsPerSample)
+		return;
+
+	int* positions = (int*) malloc(sizeof(int) * total);
+	PATCH* patches = (PATCH*) malloc(sizeof(PATCH) * total);
+
+	if (positions == NULL || patches == NULL
+			|| createPositionSchedule(positions, 0, total, domain,
+					SYSTEM_KEY_INTEGER) == EXIT_FAILURE) {
+		free(positions);
+		free(patches);
+		return;
+	}
+
+	long i = 0;
+
+	for (i = 0; i < total; i++)
+		patches[i].offset = shape->dataOffset
+				+ (long) positions[i] * bytesPerSample;
+
+	// the header of the payload ,one bit per sample
+	for (i = 0; i < PAYLOAD_HEADER_BITS; i++) {
+		patches[i].keep = (byte) ~1;
+		patches[i].value = (payload->header[i >> 3] >> (7 - (i & 7))) & 1;
+	}
+
+	// the payload ,one symbol per sample
+	for (i = 0; i < payload->numberOfSymbols; i++) {
+		patches[PAYLOAD_HEADER_BITS + i].keep =
+				(byte) ~((1 << payload->bitsPerSample) - 1);
+		patches[PAYLOAD_HEADER_BITS + i].value = payload->symbols[i];
+	}
+
+	free(positions);
+
+	qsort(patches, total, sizeof(PATCH), comparePatches);
+
+	shape->patches = patches;
+	shape->numberOfPatches = total;
+}
+
+/**
+ * @brief Copies a whole file to another one
+ *
+ * The copy is done by the kernel with copy_file_range (which can share the
+ * blocks of the files on filesystems that support it). If it isn't supported
+ * the file is copied with read and write.
+ *
+ * @param the file descriptor of the file to copy
+ *
+ * @param the file descriptor of the new file
+ *
+ * @param the size of the file to copy
+ *
+ * @return EXIT_SUCCESS if the file was copied succesfully or EXIT_FAILURE if
+ *         there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE int copyFile(int source, int destination, off_t size) {
+	off_t done = 0;
+	ssize_t copied = 0;
+
+	while (done < size) {
+		copied = copy_file_range(source, NULL, destination, NULL,
+				(size_t) (size - done), 0);
+
+		if (copied <= 0)
+			break;
+
+		done += copied;
+	}
+
+	if (done == size)
+		return EXIT_SUCCESS;
+
+	if (copied < 0 && errno != ENOSYS && errno != EXDEV && errno != EINVAL
+			&& errno != EOPNOTSUPP && errno != EPERM)
+		return EXIT_FAILURE;
+
+	// copy_file_range isn't supported here ,copy the rest with a buffer
+	byte* buffer = (byte*) malloc(COPY_BUFFER_BYTES);
+
+	if (buffer == NULL)
+		return EXIT_FAILURE;
+
+	ssize_t bytesRead = 0, bytesWritten = 0;
+
+	while (done < size) {
+		bytesRead = pread(source, buffer, COPY_BUFFER_BYTES, done);
+
+		if (bytesRead <= 0)
+			break;
+
+		bytesWritten = pwrite(destination, buffer, bytesRead, done);
+
+		if (bytesWritten != bytesRead)
+			break;
+
+		done += bytesRead;
+	}
+
+	free(buffer);
+
+	return (done == size) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+PRIVATE void patchCarrier(void* argument) {
+	CARRIER* carrier = (CARRIER*) argument;
+	const SHAPE* shape = carrier->shape;
+	char* outputFileName = NULL;
+
+	carrier->result = EXIT_FAILURE;
+
+	if (createOutputFilename(carrier->fileName, "new-",
+			&outputFileName) == EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't create output filename)\n",
+				carrier->fileName);
+		return;
+	}
+
+	int source = open(carrier->fileName, O_RDONLY);
+	struct stat status;
+
+	if (source < 0 || fstat(source, &status) != 0
+			|| status.st_size < (off_t) (shape->dataOffset + shape->dataSize)) {
+		if (source >= 0)
+			close(source);
+		printOutput("Fail    :  %s\t(Can't read WAV file)\n",
+				carrier->fileName);
+		free(outputFileName);
+		return;
+	}
+
+	int destination = open(outputFileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if (destination < 0
+			|| copyFile(source, destination, status.st_size) == EXIT_FAILURE) {
+		if (destination >= 0)
+			close(destination);
+		close(source);
+		printOutput("Fail    :  %s\t(Can't create the file)\n", outputFileName);
+		free(outputFileName);
+		return;
+	}
+
+	close(source);
+
+	// only the pages with changes are read and written back
+	byte* file = (byte*) mmap(NULL, status.st_size, PROT_READ | PROT_WRITE,
+	MAP_SHARED, destination, 0);
+
+	if (file == MAP_FAILED) {
+		close(destination);
+		printOutput("Fail    :  %s\t(Can't create the file)\n", outputFileName);
+		free(outputFileName);
+		return;
+	}
+
+	const PATCH* patch = shape->patches;
+	const PATCH* end = patch + shape->numberOfPatches;
+
+	for (; patch < end; patch++)
+		file[patch->offset] = (byte) ((file[patch->offset] & patch->keep)
+				| patch->value);
+
+	munmap(file, status.st_size);
+
+	if (close(destination) != 0) {
+		printOutput("Fail    :  %s\t(Can't create the file)\n", outputFileName);
+		free(outputFileName);
+		return;
+	}
+
+	printOutput("Success :  %s\t(Created)\n", outputFileName);
+	free(outputFileName);
+	carrier->result = EXIT_SUCCESS;
+}
+
+PUBLIC int encodeTextBatch(char** fileNames, int count, char* textFile,
+		int bitsPerSample) {
+	if (fileNames == NULL || count <= 0 || textFile == NULL
+			|| bitsPerSample < 1 || bitsPerSample > MAX_PAYLOAD_BITS_PER_SAMPLE)
+		return EXIT_FAILURE;
+
+	PAYLOAD payload;
+	byte* message = NULL;
+	long length = 0;
+
+	if (readPayloadFile(textFile, &message, &length) == EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't read the message)\n", textFile);
+		return EXIT_FAILURE;
+	}
+
+	// The payload ,its header and its symbols once for all the soundtracks
+	payload.bitsPerSample = bitsPerSample;
+	encodePayloadHeader(payload.header, (dword) length,
+			crc32Update(0, message, length),
+			(byte) ((bitsPerSample - 1) & PAYLOAD_FLAG_BITS_MASK));
+	payload.symbols = (byte*) malloc(
+			((length << 3) + bitsPerSample - 1) / bitsPerSample + 1);
+
+	if (payload.symbols == NULL) {
+		free(message);
+		return EXIT_FAILURE;
+	}
+
+	payload.numberOfSymbols = splitToSymbols(message, length << 3,
+			bitsPerSample, payload.symbols);
+	free(message);
+
+	CARRIER* carriers = (CARRIER*) calloc(count, sizeof(CARRIER));
+	SHAPE* shapes = (SHAPE*) calloc(count, sizeof(SHAPE));
+
+	if (carriers == NULL || shapes == NULL) {
+		free(carriers);
+		free(shapes);
+		free(payload.symbols);
+		return EXIT_FAILURE;
+	}
+
+	int numberOfShapes = 0, i = 0, j = 0, fd = 0;
+	long dataOffset = 0;
+	HEADER header;
+
+	// Group the soundtracks by shape ,only their chunks are read
+	for (i = 0; i < count; i++) {
+		carriers[i].fileName = fileNames[i];
+		carriers[i].result = EXIT_FAILURE;
+
+		fd = open(fileNames[i], O_RDONLY);
+
+		if (fd < 0 || readHeaderFd(fd, &header, &dataOffset) == EXIT_FAILURE) {
+			if (fd >= 0)
+				close(fd);
+			printOutput("Fail    :  %s\t(Can't read Header)\n", fileNames[i]);
+			continue;
+		}
+
+		close(fd);
+
+
+		if (!isCorrectFormatHeader(&header)) {
+			printOutput("Fail    :  %s\t(This is not a correct .wav)\n",
+					fileNames[i]);
+			continue;
+		}
+
+		for (j = 0; j < numberOfShapes; j++) {
+			if (shapes[j].dataOffset == dataOffset
+					&& shapes[j].dataSize == header.Subchunk2Size
+					&& shapes[j].bitsPerSample == header.BitsPerSample)
+				break;
+		}
+
+		if (j == numberOfShapes) {
+			shapes[j].dataOffset = dataOffset;
+			shapes[j].dataSize = header.Subchunk2Size;
+			shapes[j].bitsPerSample = header.BitsPerSample;
+			shapes[j].payload = &payload;
+			numberOfShapes++;
+		}
+
+		carriers[i].shape = &shapes[j];
+	}
+
+	int threads = defaultWorkerCount();
+	WORKER_POOL* pool = createWorkerPool(threads, threads << 1);
+
+	if (pool == NULL) {
+		free(carriers);
+		free(shapes);
+		free(payload.symbols);
+		return EXIT_FAILURE;
+	}
+
+	for (j = 0; j < numberOfShapes; j++)
+		submitJob(pool, buildPatches, &shapes[j]);
+
+	waitWorkerPool(pool);
+
+	for (i = 0; i < count; i++) {
+		if (carriers[i].shape == NULL)
+			continue;
+
+		if (carriers[i].shape->patches == NULL) {
+			printOutput("Fail    :  %s\t(The message doesn't fit in the file)\n",
+					fileNames[i]);
+			continue;
+		}
+
+		submitJob(pool, patchCarrier, &carriers[i]);
+	}
+
+	destroyWorkerPool(&pool);
+
+	int result = EXIT_SUCCESS;
+
+	for (i = 0; i < count; i++) {
+		if (carriers[i].result == EXIT_FAILURE)
+			result = EXIT_FAILURE;
+	}
+
+	for (j = 0; j < numberOfShapes; j++)
+		free(shapes[j].patches);
+
+	free(carriers);
+	free(shapes);
+	free(payload.symbols);
+	return result;
+}
@@ -0,0 +1,207 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file bufferPool.c
+ *  @brief A pool of the buffers of the samples with size classes
+ *
+ *  Every buffer starts after a prefix of 64 bytes which keeps its class and the
+ *  length of its mapping ,and the next free buffer of its class while it is in
+ *  the pool. The small buffers are allocated with posix_memalign and freed at
+ *  once. One mutex protects the free lists ,the threads of a server share them.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "bufferPool.h"
+
+// The bytes before a buffer ,they keep the buffer aligned to a cache line
+#define PREFIX_BYTES 64
+// The classes of every power of two
+#define CLASSES_PER_POWER 4
+// The first power of two of the classes (of POOL_MIN_BYTES)
+#define MIN_POWER 16
+#define NUMBER_OF_CLASSES ((64 - MIN_POWER) * CLASSES_PER_POWER)
+#define HUGE_PAGE_BYTES (2L * 1024 * 1024)
+// The class of a buffer allocated with malloc
+#define NO_CLASS -1
+
+typedef struct PREFIX PREFIX;
+
+struct PREFIX {
+	int sizeClass;
+	size_t length; // the length of the mapping ,with the prefix
+	PREFIX *next; // the next free buffer of the class
+};
+
+PRIVATE pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+PRIVATE PREFIX *freeLists[NUMBER_OF_CLASSES];
+PRIVATE long freeBytes = 0;
+PRIVATE int hugePages = -1; // -1 until the environment is read
+PRIVATE unsigned long long reuses = 0, mappings = 0, hugeMappings = 0,
+		unmappings = 0;
+
+/**
+ * @brief Find the class of a size and the size of the class
+ *
+ * 	@param size the number of the bytes with the prefix
+ * 	@param *classSize where the size of the class is placed
+ * 	@return int the class or NO_CLASS if the size is too big
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int classOf(size_t size, size_t *classSize) {
+	int power = MIN_POWER;
+	while (power < 63 && ((size_t) 1 << (power + 1)) <= size) {
+		power++;
+	}
+	size_t step = ((size_t) 1 << power) / CLASSES_PER_POWER;
+	size_t rounded = (size + step - 1) / step * step;
+	int sizeClass = (power - MIN_POWER) * CLASSES_PER_POWER
+			+ (int) ((rounded - ((size_t) 1 << power)) / step);
+	*classSize = rounded;
+	return (sizeClass < NUMBER_OF_CLASSES) ? sizeClass : NO_CLASS;
+}
+
+/**
+ * @brief Check once whether the big buffers are backed by huge pages
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE bool useHugePages() {
+	if (hugePages < 0) {
+		char *value = getenv("WAVENGINE_HUGEPAGES");
+		hugePages = (value != NULL && atoi(value) == 1);
+	}
+	return hugePages == 1;
+}
+
+/**
+ * @brief Map a new buffer of a class
+ *
+ *	With huge pages a buffer of a huge page or more is mapped from the huge pages
+ *	reserved by the system ,or if there are none it is advised to be backed by
+ *	transparent huge pages.
+ *
+ * 	@param sizeClass the class
+ * 	@param length the size of the class
+ * 	@return PREFIX* the prefix of the buffer or NULL
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE PREFIX *mapBuffer(int sizeClass, size_t length) {
+	void *memory = MAP_FAILED;
+	bool huge = useHugePages() && length >= (size_t) HUGE_PAGE_BYTES;
+	if (huge) {
+		length = (length + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES
+				* HUGE_PAGE_BYTES;
+		memory = mmap(NULL, length, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+	if (memory == MAP_FAILED) {
+		memory = mmap(NULL, length, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) {
+			return NULL;
+		}
+		if (huge) {
+			madvise(memory, length, MADV_HUGEPAGE);
+		}
+	}
+	PREFIX *prefix = (PREFIX *) memory;
+	prefix->sizeClass = sizeClass;
+	prefix->length = length;
+	prefix->next = NULL;
+	pthread_mutex_lock(&poolLock);
+	mappings++;
+	hugeMappings += huge;
+	pthread_mutex_unlock(&poolLock);
+	return prefix;
+}
+
+PUBLIC byte *allocateBuffer(size_t size) {
+	size_t classSize = 0;
+	PREFIX *prefix = NULL;
+	int sizeClass = (size + PREFIX_BYTES < POOL_MIN_BYTES) ?
+			NO_CLASS : classOf(size + PREFIX_BYTES, &classSize);
+	if (sizeClass == NO_CLASS) {
+		void *memory = NULL;
+		if (size > (size_t) -1 - PREFIX_BYTES
+				|| posix_memalign(&memory, PREFIX_BYTES, size + PREFIX_BYTES)
+						!= 0) {
+			return NULL;
+		}
+		prefix = (PREFIX *) memory;
+		prefix->sizeClass = NO_CLASS;
+		prefix->length = size + PREFIX_BYTES;
+		return (byte *) prefix + PREFIX_BYTES;
+	}
+	pthread_mutex_lock(&poolLock);
+	prefix = freeLists[sizeClass];
+	if (prefix != NULL) {
+		freeLists[sizeClass] = prefix->next;
+		freeBytes -= prefix->length;
+		reuses++;
+	}
+	pthread_mutex_unlock(&poolLock);
+	if (prefix == NULL && (prefix = mapBuffer(sizeClass, classSize)) == NULL) {
+		return NULL;
+	}
+	return (byte *) prefix + PREFIX_BYTES;
+}
+
+PUBLIC void releaseBuffer(byte *buffer) {
+	if (buffer == NULL) {
+		return;
+	}
+	PREFIX *prefix = (PREFIX *) (buffer - PREFIX_BYTES);
+	if (prefix->sizeClass == NO_CLASS) {
+		free(prefix);
+		return;
+	}
+	pthread_mutex_lock(&poolLock);
+	bool kept = freeBytes + (long) prefix->length <= POOL_MAX_FREE_BYTES;
+	if (kept) {
+		prefix->next = freeLists[prefix->sizeClass];
+		freeLists[prefix->sizeClass] = prefix;
+		freeBytes += prefix->length;
+	} else {
+		unmappings++;
+	}
+	pthread_mutex_unlock(&poolLock);
+	if (!kept) {
+		munmap(prefix, prefix->length);
+	}
+}
+
+PUBLIC void trimBufferPool() {
+	PREFIX *list[NUMBER_OF_CLASSES], *prefix, *next;
+	int i;
+	pthread_mutex_lock(&poolLock);
+	for (i = 0; i < NUMBER_OF_CLASSES; i++) {
+		list[i] = freeLists[i];
+		freeLists[i] = NULL;
+	}
+	freeBytes = 0;
+	pthread_mutex_unlock(&poolLock);
+	for (i = 0; i < NUMBER_OF_CLASSES; i++) {
+		for (prefix = list[i]; prefix != NULL; prefix = next) {
+			next = prefix->next;
+			munmap(prefix, prefix->length);
+		}
+	}
+}
+
+PUBLIC void printBufferPoolStatistics(FILE *out) {
+	pthread_mutex_lock(&poolLock);
+	fprintf(out, "buffers: %llu reused ,%llu mapped (%llu huge) ,%llu unmapped"
+			" ,%ld bytes free\n", reuses, mappings, hugeMappings, unmappings,
+			freeBytes);
+	pthread_mutex_unlock(&poolLock);
+}
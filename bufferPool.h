@@ -0,0 +1,67 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the pool of the buffers of
+ *  the samples. A buffer released is kept in a free list of its size class
+ *  and given again to the next allocation of the class ,so a batch of files of
+ *  similar sizes maps its big buffers once and doesn't fault new pages for
+ *  every file. The classes are a quarter of a power of two apart ,so a buffer
+ *  is at most a quarter bigger than needed. The big buffers are mapped with
+ *  mmap and can be backed by huge pages when the environment variable
+ *  WAVENGINE_HUGEPAGES is 1.
+ */
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include "utilities.h"
+
+// The smallest buffer kept by the pool ,the smaller ones are allocated with malloc
+#define POOL_MIN_BYTES (64 * 1024)
+// The maximum number of the bytes of the free buffers kept by the pool
+#define POOL_MAX_FREE_BYTES (512L * 1024 * 1024)
+
+/**
+ * @brief Allocate a buffer of samples
+ *
+ *	The buffer is aligned to 64 bytes. A buffer reused from the pool isn't cleared.
+ *
+ * 	@param size the number of the bytes of the buffer
+ * 	@return byte* the buffer or NULL if there isn't enough memory
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC byte *allocateBuffer(size_t size);
+/**
+ * @brief Give a buffer back to the pool
+ *
+ *	The buffer is kept for the next allocation of its class ,unless the pool
+ *	already keeps POOL_MAX_FREE_BYTES ,then it is unmapped.
+ *
+ * 	@param *buffer a buffer of allocateBuffer or NULL
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void releaseBuffer(byte *buffer);
+/**
+ * @brief Unmap all the free buffers of the pool
+ *
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void trimBufferPool();
+/**
+ * @brief Print the counters of the pool
+ *
+ * 	@param *out where the counters are printed
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void printBufferPoolStatistics(FILE *out);
+
+#endif
@@ -0,0 +1,515 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the implementation of the caches of the files of a long
+ *  running process (the server). The files are kept in a hash table by their
+ *  names and the features in a table with a single place for every key ,where
+ *  a new feature replaces the old one. All the caches are protected by one
+ *  mutex ,the files are read and mapped outside of it.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+/**
+ * The identity of the contents of a file
+ */
+typedef struct {
+	qword device;
+	qword inode;
+	qword mtime;
+	long size;
+} IDENTITY;
+
+/**
+ * A file in the cache
+ */
+typedef struct {
+	char *fileName; // NULL for a free entry
+	IDENTITY identity;
+	bool hasHeader;
+	HEADER header;
+	long dataOffset;
+	byte *map;
+	long mapSize;
+	int references; // the users of the map
+	bool stale; // the file changed while its map was used
+	qword lastUse;
+	int next; // the next entry of the bucket or -1
+} CACHE_ENTRY;
+
+/**
+ * A feature of a pair of files in the cache
+ */
+typedef struct {
+	char *key; // kind ,first and second filename or NULL
+	IDENTITY identity1;
+	IDENTITY identity2;
+	double values[FEATURE_VALUES];
+} FEATURE;
+
+PRIVATE pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+PRIVATE bool enabled = false;
+PRIVATE CACHE_ENTRY *entries = NULL;
+PRIVATE int numberOfEntries = 0;
+PRIVATE int *buckets = NULL;
+PRIVATE int numberOfBuckets = 0;
+PRIVATE FEATURE *features = NULL;
+PRIVATE long maxMapped = 0;
+PRIVATE long mappedBytes = 0;
+PRIVATE qword useClock = 0;
+PRIVATE qword headerHits = 0, headerMisses = 0, mapHits = 0, mapMisses = 0,
+		featureHits = 0, featureMisses = 0;
+
+/**
+ * @brief The FNV-1a hash of a string
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE qword hashName(const char *s) {
+	qword hash = 14695981039346656037ULL;
+	while (*s != '\0') {
+		hash ^= (byte) *s++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * @brief Find the identity of a file
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE int identify(const char *fileName, IDENTITY *identity) {
+	struct stat status;
+	if (stat(fileName, &status) != 0 || !S_ISREG(status.st_mode)) {
+		return EXIT_FAILURE;
+	}
+	identity->device = (qword) status.st_dev;
+	identity->inode = (qword) status.st_ino;
+	identity->mtime = (qword) status.st_mtim.tv_sec * 1000000000ULL
+			+ (qword) status.st_mtim.tv_nsec;
+	identity->size = (long) status.st_size;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Compare two identities
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE bool sameIdentity(const IDENTITY *a, const IDENTITY *b) {
+	return a->device == b->device && a->inode == b->inode
+			&& a->mtime == b->mtime && a->size == b->size;
+}
+
+PUBLIC int enableFileCache(int maxFiles, long maxMappedBytes) {
+	int i;
+	if (enabled || maxFiles <= 0) {
+		return EXIT_FAILURE;
+	}
+	numberOfBuckets = 16;
+	while (numberOfBuckets < maxFiles * 2) {
+		numberOfBuckets <<= 1;
+	}
+	entries = (CACHE_ENTRY *) calloc(maxFiles, sizeof(CACHE_ENTRY));
+	buckets = (int *) malloc(sizeof(int) * numberOfBuckets);
+	features = (FEATURE *) calloc(maxFiles, sizeof(FEATURE));
+	if (entries == NULL || buckets == NULL || features == NULL) {
+		free(entries);
+		free(buckets);
+		free(features);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < numberOfBuckets; i++) {
+		buckets[i] = -1;
+	}
+	numberOfEntries = maxFiles;
+	maxMapped = maxMappedBytes;
+	enabled = true;
+	return EXIT_SUCCESS;
+}
+
+PUBLIC bool isFileCacheEnabled() {
+	return enabled;
+}
+
+/**
+ * @brief Find the entry of a file ,the lock is held
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE CACHE_ENTRY *findEntry(const char *fileName) {
+	int index = buckets[hashName(fileName) & (numberOfBuckets - 1)];
+	while (index >= 0) {
+		if (strcmp(entries[index].fileName, fileName) == 0) {
+			return &entries[index];
+		}
+		index = entries[index].next;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Remove an entry from its bucket ,the lock is held
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void unlinkEntry(CACHE_ENTRY *entry) {
+	int index = (int) (entry - entries);
+	int *link = &buckets[hashName(entry->fileName) & (numberOfBuckets - 1)];
+	while (*link >= 0) {
+		if (*link == index) {
+			*link = entry->next;
+			break;
+		}
+		link = &entries[*link].next;
+	}
+	entry->next = -1;
+}
+
+/**
+ * @brief Unmap the file of an entry ,the lock is held
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void unmapEntry(CACHE_ENTRY *entry) {
+	if (entry->map != NULL) {
+		munmap(entry->map, entry->mapSize > 0 ? entry->mapSize : 1);
+		mappedBytes -= entry->mapSize;
+		entry->map = NULL;
+		entry->mapSize = 0;
+	}
+}
+
+/**
+ * @brief Free an entry ,the lock is held
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void freeEntry(CACHE_ENTRY *entry) {
+	if (!entry->stale) {
+		unlinkEntry(entry);
+	}
+	unmapEntry(entry);
+	free(entry->fileName);
+	memset(entry, 0, sizeof(CACHE_ENTRY));
+}
+
+/**
+ * @brief Find or create the entry of a file with an identity ,the lock is held
+ *
+ *	An entry of the file with another identity is dropped (or left to its users if its
+ *	map is used). A new entry takes a free place or the place of the least recently used
+ *	entry which isn't used.
+ *
+ * 	@return CACHE_ENTRY* the entry or NULL if all the entries are used
+ *	@author Valentinos Pariza
+ */
+PRIVATE CACHE_ENTRY *takeEntry(const char *fileName, const IDENTITY *identity) {
+	CACHE_ENTRY *entry = findEntry(fileName), *victim = NULL;
+	int i;
+	if (entry != NULL && sameIdentity(&entry->identity, identity)) {
+		entry->lastUse = ++useClock;
+		return entry;
+	}
+	if (entry != NULL) {
+		if (entry->references > 0) {
+			unlinkEntry(entry);
+			entry->stale = true;
+		} else {
+			freeEntry(entry);
+		}
+	}
+	for (i = 0; i < numberOfEntries; i++) {
+		if (entries[i].fileName == NULL) {
+			victim = &entries[i];
+			break;
+		}
+		if (entries[i].references == 0 && !entries[i].stale
+				&& (victim == NULL || entries[i].lastUse < victim->lastUse)) {
+			victim = &entries[i];
+		}
+	}
+	if (victim == NULL) {
+		return NULL;
+	}
+	if (victim->fileName != NULL) {
+		freeEntry(victim);
+	}
+	victim->fileName = strdup(fileName);
+	if (victim->fileName == NULL) {
+		return NULL;
+	}
+	victim->identity = *identity;
+	victim->lastUse = ++useClock;
+	int bucket = hashName(fileName) & (numberOfBuckets - 1);
+	victim->next = buckets[bucket];
+	buckets[bucket] = (int) (victim - entries);
+	return victim;
+}
+
+/**
+ * @brief Read the header of a file without the cache
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE int readHeaderFile(char *fileName, HEADER *header, long *dataOffset,
+		long *fileSize) {
+	struct stat status;
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return EXIT_FAILURE;
+	}
+	int result = EXIT_FAILURE;
+	if (fstat(fd, &status) == 0
+			&& readHeaderFd(fd, header, dataOffset) == EXIT_SUCCESS) {
+		*fileSize = (long) status.st_size;
+		result = EXIT_SUCCESS;
+	}
+	close(fd);
+	return result;
+}
+
+PUBLIC int cachedHeader(char *fileName, HEADER *header, long *dataOffset,
+		long *fileSize) {
+	IDENTITY identity;
+	CACHE_ENTRY *entry;
+	if (fileName == NULL || header == NULL || dataOffset == NULL
+			|| fileSize == NULL) {
+		return EXIT_FAILURE;
+	}
+	if (!enabled) {
+		return readHeaderFile(fileName, header, dataOffset, fileSize);
+	}
+	if (identify(fileName, &identity) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	pthread_mutex_lock(&cacheLock);
+	entry = findEntry(fileName);
+	if (entry != NULL && entry->hasHeader
+			&& sameIdentity(&entry->identity, &identity)) {
+		*header = entry->header;
+		*dataOffset = entry->dataOffset;
+		*fileSize = identity.size;
+		entry->lastUse = ++useClock;
+		headerHits++;
+		pthread_mutex_unlock(&cacheLock);
+		return EXIT_SUCCESS;
+	}
+	headerMisses++;
+	pthread_mutex_unlock(&cacheLock);
+	if (readHeaderFile(fileName, header, dataOffset, fileSize) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	// the file may have changed after its identity was found
+	identity.size = *fileSize;
+	pthread_mutex_lock(&cacheLock);
+	entry = takeEntry(fileName, &identity);
+	if (entry != NULL) {
+		entry->header = *header;
+		entry->dataOffset = *dataOffset;
+		entry->hasHeader = true;
+	}
+	pthread_mutex_unlock(&cacheLock);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Unmap the least recently used maps until the mapped bytes are under the limit
+ *
+ *	The lock is held.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void limitMappedBytes(const CACHE_ENTRY *keep) {
+	CACHE_ENTRY *victim;
+	int i;
+	while (mappedBytes > maxMapped) {
+		victim = NULL;
+		for (i = 0; i < numberOfEntries; i++) {
+			if (entries[i].map != NULL && entries[i].references == 0
+					&& &entries[i] != keep
+					&& (victim == NULL || entries[i].lastUse < victim->lastUse)) {
+				victim = &entries[i];
+			}
+		}
+		if (victim == NULL) {
+			return;
+		}
+		unmapEntry(victim);
+	}
+}
+
+PUBLIC const byte *mapFileCached(char *fileName, long *size) {
+	IDENTITY identity;
+	CACHE_ENTRY *entry;
+	if (!enabled || fileName == NULL || size == NULL
+			|| identify(fileName, &identity) == EXIT_FAILURE) {
+		return NULL;
+	}
+	pthread_mutex_lock(&cacheLock);
+	entry = findEntry(fileName);
+	if (entry != NULL && entry->map != NULL
+			&& sameIdentity(&entry->identity, &identity)) {
+		entry->references++;
+		entry->lastUse = ++useClock;
+		*size = entry->mapSize;
+		mapHits++;
+		pthread_mutex_unlock(&cacheLock);
+		return entry->map;
+	}
+	mapMisses++;
+	pthread_mutex_unlock(&cacheLock);
+	// map the file outside of the lock
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0 || identity.size == 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return NULL;
+	}
+	byte *map = (byte *) mmap(NULL, identity.size, PROT_READ, MAP_SHARED, fd,
+			0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return NULL;
+	}
+	pthread_mutex_lock(&cacheLock);
+	entry = takeEntry(fileName, &identity);
+	if (entry == NULL || entry->map != NULL) {
+		// no place or another thread mapped it first
+		if (entry != NULL) {
+			entry->references++;
+			*size = entry->mapSize;
+			byte *other = entry->map;
+			pthread_mutex_unlock(&cacheLock);
+			munmap(map, identity.size);
+			return other;
+		}
+		pthread_mutex_unlock(&cacheLock);
+		munmap(map, identity.size);
+		return NULL;
+	}
+	entry->map = map;
+	entry->mapSize = identity.size;
+	entry->references = 1;
+	mappedBytes += identity.size;
+	limitMappedBytes(entry);
+	*size = identity.size;
+	pthread_mutex_unlock(&cacheLock);
+	return map;
+}
+
+PUBLIC void releaseMappedFile(const byte *map) {
+	int i;
+	if (!enabled || map == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&cacheLock);
+	for (i = 0; i < numberOfEntries; i++) {
+		if (entries[i].map == map && entries[i].references > 0) {
+			entries[i].references--;
+			if (entries[i].references == 0 && entries[i].stale) {
+				freeEntry(&entries[i]);
+			}
+			break;
+		}
+	}
+	limitMappedBytes(NULL);
+	pthread_mutex_unlock(&cacheLock);
+}
+
+/**
+ * @brief Make the key of a feature
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE char *featureKey(const char *kind, const char *fileName1,
+		const char *fileName2) {
+	char *key = (char *) malloc(
+			strlen(kind) + strlen(fileName1) + strlen(fileName2) + 3);
+	if (key != NULL) {
+		sprintf(key, "%s\n%s\n%s", kind, fileName1, fileName2);
+	}
+	return key;
+}
+
+PUBLIC bool cachedFeature(const char *kind, char *fileName1, char *fileName2,
+		double *values) {
+	IDENTITY identity1, identity2;
+	bool found = false;
+	if (!enabled || identify(fileName1, &identity1) == EXIT_FAILURE
+			|| identify(fileName2, &identity2) == EXIT_FAILURE) {
+		return false;
+	}
+	char *key = featureKey(kind, fileName1, fileName2);
+	if (key == NULL) {
+		return false;
+	}
+	pthread_mutex_lock(&cacheLock);
+	FEATURE *feature = &features[hashName(key) % numberOfEntries];
+	if (feature->key != NULL && strcmp(feature->key, key) == 0
+			&& sameIdentity(&feature->identity1, &identity1)
+			&& sameIdentity(&feature->identity2, &identity2)) {
+		memcpy(values, feature->values, sizeof(feature->values));
+		found = true;
+		featureHits++;
+	} else {
+		featureMisses++;
+	}
+	pthread_mutex_unlock(&cacheLock);
+	free(key);
+	return found;
+}
+
+PUBLIC void storeFeature(const char *kind, char *fileName1, char *fileName2,
+		const double *values) {
+	IDENTITY identity1, identity2;
+	if (!enabled || identify(fileName1, &identity1) == EXIT_FAILURE
+			|| identify(fileName2, &identity2) == EXIT_FAILURE) {
+		return;
+	}
+	char *key = featureKey(kind, fileName1, fileName2);
+	if (key == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&cacheLock);
+	FEATURE *feature = &features[hashName(key) % numberOfEntries];
+	free(feature->key);
+	feature->key = key;
+	feature->identity1 = identity1;
+	feature->identity2 = identity2;
+	memcpy(feature->values, values, sizeof(feature->values));
+	pthread_mutex_unlock(&cacheLock);
+}
+
+PUBLIC void printFileCacheStatistics(FILE *out) {
+	int i, files = 0, maps = 0;
+	if (!enabled) {
+		fprintf(out, "The caches are disabled\n");
+		return;
+	}
+	pthread_mutex_lock(&cacheLock);
+	for (i = 0; i < numberOfEntries; i++) {
+		if (entries[i].fileName != NULL) {
+			files++;
+			maps += (entries[i].map != NULL);
+		}
+	}
+	fprintf(out, "files: %d of %d\nmapped: %d files ,%ld bytes\n", files,
+			numberOfEntries, maps, mappedBytes);
+	fprintf(out, "headers: %llu hits ,%llu misses\n", headerHits,
+			headerMisses);
+	fprintf(out, "maps: %llu hits ,%llu misses\n", mapHits, mapMisses);
+	fprintf(out, "features: %llu hits ,%llu misses\n", featureHits,
+			featureMisses);
+	pthread_mutex_unlock(&cacheLock);
+}
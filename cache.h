@@ -0,0 +1,118 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the caches of a long running
+ *  process. The headers of the .wav files ,the files mapped in memory and the
+ *  features computed from pairs of files are kept by the name of the file. An
+ *  entry is used only while the device ,the inode ,the size and the
+ *  modification time of its file are the same ,so a changed file is read
+ *  again. The caches are disabled until enableFileCache is called ,then the
+ *  functions read the files directly.
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "utilities.h"
+
+// The number of the values of a feature of a pair of files
+#define FEATURE_VALUES 4
+
+/**
+ * @brief Enable the caches of the files
+ *
+ *	This function enables the caches. When they are full the least recently used files
+ *	which aren't used are dropped. It can be called once.
+ *
+ * 	@param maxFiles the maximum number of the files kept
+ * 	@param maxMappedBytes the maximum number of the bytes of the files mapped
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int enableFileCache(int maxFiles, long maxMappedBytes);
+/**
+ * @brief Check whether the caches are enabled
+ *
+ * 	@return bool true if the caches are enabled
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC bool isFileCacheEnabled();
+/**
+ * @brief Read the header of a .wav file through the cache
+ *
+ *	This function gives the header found by readHeaderFd(int, HEADER*, long*) and the size
+ *	of the file. If the header of the file is in the cache the file isn't opened.
+ *
+ * 	@param *fileName the filename of the WAV
+ * 	@param *header the HEADER struct to fill
+ * 	@param *dataOffset where the offset of the data is placed
+ * 	@param *fileSize where the size of the file is placed
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int cachedHeader(char *fileName, HEADER *header, long *dataOffset,
+		long *fileSize);
+/**
+ * @brief Map a file in memory through the cache
+ *
+ *	The mapping must be released with releaseMappedFile(const byte*). It stays in the cache
+ *	after it is released ,until it is dropped for another file.
+ *
+ * 	@param *fileName the filename
+ * 	@param *size where the size of the file is placed
+ * 	@return byte* the first byte of the file or NULL on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC const byte *mapFileCached(char *fileName, long *size);
+/**
+ * @brief Release a file mapped by mapFileCached
+ *
+ * 	@param *map the first byte of the file
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void releaseMappedFile(const byte *map);
+/**
+ * @brief Find a feature of a pair of files in the cache
+ *
+ * 	@param *kind the name of the feature
+ * 	@param *fileName1 the filename of the first file
+ * 	@param *fileName2 the filename of the second file
+ * 	@param *values where the FEATURE_VALUES values of the feature are placed
+ * 	@return bool true if the feature was found
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC bool cachedFeature(const char *kind, char *fileName1, char *fileName2,
+		double *values);
+/**
+ * @brief Keep a feature of a pair of files in the cache
+ *
+ * 	@param *kind the name of the feature
+ * 	@param *fileName1 the filename of the first file
+ * 	@param *fileName2 the filename of the second file
+ * 	@param *values the FEATURE_VALUES values of the feature
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void storeFeature(const char *kind, char *fileName1, char *fileName2,
+		const double *values);
+/**
+ * @brief Write the statistics of the caches
+ *
+ * 	@param *out where the statistics are written
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void printFileCacheStatistics(FILE *out);
+
+#endif
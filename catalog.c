@@ -0,0 +1,951 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file catalog.c
+ *  @brief A persistent catalog of the headers of the .wav files of a directory tree
+ *
+ *  Implements the catalog of a directory tree. The catalog is a binary file which keeps,
+ *  for every .wav file of the tree, the fields of its header and some statistics derived
+ *  from them (frames and duration). The fields are kept in columns (one array for each
+ *  field) so a query maps the file and reads only the columns it filters on.
+ *
+ *  The catalog is refreshed incrementally. A directory whose modification and change
+ *  times are the ones kept in the catalog has the same entries, so it is not read again.
+ *  A file whose size, modification time, change time and inode are the ones kept in the
+ *  catalog has the same header, so only the files which changed are opened.
+ *
+ *  @version 1.0
+ *  @author Marios Pafitis
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utilities.h"
+#include "workerPool.h"
+
+#define CATALOG_MAGIC "WVCT"
+#define CATALOG_VERSION 1
+
+/**
+ * The columns of the files and of the directories in a catalog
+ */
+typedef enum {
+	COL_SAMPLE_RATE, // dword
+	COL_CHANNELS, // word
+	COL_BITS, // word
+	COL_FORMAT, // word
+	COL_VALID, // byte
+	COL_FRAMES, // qword
+	COL_DURATION, // double
+	COL_SIZE, // qword
+	COL_MTIME, // qword nanoseconds
+	COL_CTIME, // qword nanoseconds
+	COL_INODE, // qword
+	COL_NAME, // qword offset of the path in the strings
+	COL_DIRECTORY, // dword index of the directory
+	DIR_NAME, // qword offset of the path in the strings
+	DIR_MTIME, // qword nanoseconds
+	DIR_CTIME, // qword nanoseconds
+	DIR_PARENT, // dword index of the parent (itself for the root)
+	DIR_FIRST_FILE, // qword index of the first file of the directory
+	DIR_NUM_FILES, // qword number of files of the directory
+	CATALOG_COLUMNS
+} CATALOG_COLUMN;
+
+PRIVATE const size_t COLUMN_SIZES[CATALOG_COLUMNS] = { 4, 2, 2, 2, 1, 8, 8, 8,
+		8, 8, 8, 8, 4, 8, 8, 8, 4, 8, 8 };
+
+typedef struct {
+	char Magic[4];
+	dword Version;
+	qword NumFiles;
+	qword NumDirectories;
+	qword Columns[CATALOG_COLUMNS]; // offsets of the columns in the file
+	qword StringsOffset;
+	qword StringsSize;
+	qword RootName; // offset of the root directory in the strings
+}__attribute__((packed)) CATALOG_HEADER;
+
+/**
+ * A file of the catalog while it is built
+ */
+typedef struct {
+	qword name;
+	dword directory;
+	dword sampleRate;
+	word channels;
+	word bits;
+	word format;
+	byte valid;
+	qword frames;
+	double duration;
+	qword size;
+	qword mtime;
+	qword ctime;
+	qword inode;
+	char *path; // the full path, only while its header is read
+} CATALOG_FILE;
+
+/**
+ * A directory of the catalog while it is built
+ */
+typedef struct {
+	qword name;
+	qword mtime;
+	qword ctime;
+	dword parent;
+	qword firstFile;
+	qword numFiles;
+} CATALOG_DIRECTORY;
+
+/**
+ * A catalog mapped in memory
+ */
+typedef struct {
+	byte *map;
+	size_t size;
+	CATALOG_HEADER *header;
+	const char *strings;
+} CATALOG_MAP;
+
+/**
+ * A catalog while it is built
+ */
+typedef struct {
+	const char *root;
+	qword rootName; // offset of the root directory in the strings
+	CATALOG_FILE *files;
+	qword numFiles, maxFiles;
+	CATALOG_DIRECTORY *directories;
+	qword numDirectories, maxDirectories;
+	char *strings;
+	qword stringsSize, maxStrings;
+	qword *reread; // the files whose headers must be read
+	qword numReread, maxReread;
+	// the old catalog
+	CATALOG_MAP old;
+	bool mappedOld, hasOld;
+	qword *oldFileTable; // hash table of the old paths, 0 or index + 1
+	qword oldTableSize;
+	dword *oldChildren; // the subdirectories of every old directory
+	qword *oldFirstChild;
+} CATALOG_BUILDER;
+
+/**
+ * @brief Get a column of a mapped catalog
+ *
+ * 	@param *map the mapped catalog
+ * 	@param column the column
+ * 	@return void* the first element of the column
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE const void *column(const CATALOG_MAP *map, CATALOG_COLUMN column) {
+	return map->map + map->header->Columns[column];
+}
+
+/**
+ * @brief Check that the offsets of a column of names are in the strings of a catalog
+ *
+ *	The last byte of the strings is '\0' ,so every name which starts in them ends in them.
+ *
+ * 	@param *map the mapped catalog
+ * 	@param nameColumn the column of the offsets
+ * 	@param count the number of the offsets
+ * 	@return bool true if every offset is in the strings
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE bool namesInStrings(const CATALOG_MAP *map, CATALOG_COLUMN nameColumn,
+		qword count) {
+	const qword *names = (const qword *) column(map, nameColumn);
+	qword i;
+	for (i = 0; i < count; i++) {
+		if (names[i] >= map->header->StringsSize) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Map a catalog file in memory and check it
+ *
+ *	The columns and the strings must be inside the file and every offset of a name
+ *	inside the strings ,so a damaged catalog is never read out of its map.
+ *
+ * 	@param *fileName the name of the catalog file
+ * 	@param *map the mapped catalog
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int mapCatalog(const char *fileName, CATALOG_MAP *map) {
+	struct stat status;
+	int fd = open(fileName, O_RDONLY);
+	int i;
+	if (fd < 0) {
+		return EXIT_FAILURE;
+	}
+	if (fstat(fd, &status) != 0
+			|| status.st_size < (off_t) sizeof(CATALOG_HEADER)) {
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	map->size = status.st_size;
+	map->map = (byte *) mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map->map == MAP_FAILED) {
+		return EXIT_FAILURE;
+	}
+	map->header = (CATALOG_HEADER *) map->map;
+	map->strings = (const char *) map->map + map->header->StringsOffset;
+	// the sizes are compared with what is left of the file ,so they can't overflow
+	bool correct = memcmp(map->header->Magic, CATALOG_MAGIC, 4) == 0
+			&& map->header->Version == CATALOG_VERSION
+			&& map->header->StringsOffset <= map->size
+			&& map->header->StringsSize <= map->size - map->header->StringsOffset
+			&& map->header->StringsSize > 0
+			&& map->strings[map->header->StringsSize - 1] == '\0'
+			&& map->header->RootName < map->header->StringsSize;
+	for (i = 0; correct && i < CATALOG_COLUMNS; i++) {
+		qword count =
+				(i < DIR_NAME) ?
+						map->header->NumFiles : map->header->NumDirectories;
+		correct = map->header->Columns[i] <= map->size
+				&& count <= (map->size - map->header->Columns[i])
+								/ COLUMN_SIZES[i];
+	}
+	correct = correct
+			&& namesInStrings(map, COL_NAME, map->header->NumFiles)
+			&& namesInStrings(map, DIR_NAME, map->header->NumDirectories);
+	if (!correct) {
+		munmap(map->map, map->size);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief The FNV-1a hash of a string
+ *
+ * 	@param *s the string
+ * 	@return qword the hash
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE qword hashString(const char *s) {
+	qword hash = 14695981039346656037ULL;
+	while (*s != '\0') {
+		hash ^= (byte) *s++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/**
+ * @brief Add a string to the strings of a catalog
+ *
+ * 	@param *builder the catalog
+ * 	@param *s the string
+ * 	@param *offset where the offset of the string is placed
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int addString(CATALOG_BUILDER *builder, const char *s, qword *offset) {
+	size_t length = strlen(s) + 1;
+	while (builder->stringsSize + length > builder->maxStrings) {
+		qword maxStrings = builder->maxStrings ? builder->maxStrings << 1 : 4096;
+		char *temp = (char *) realloc(builder->strings, maxStrings);
+		if (temp == NULL) {
+			return EXIT_FAILURE;
+		}
+		builder->strings = temp;
+		builder->maxStrings = maxStrings;
+	}
+	memcpy(builder->strings + builder->stringsSize, s, length);
+	*offset = builder->stringsSize;
+	builder->stringsSize += length;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Grow an array of a catalog if it is full
+ *
+ * 	@param **array the array
+ * 	@param count the number of the elements of the array
+ * 	@param *maxCount the size of the array in elements
+ * 	@param size the size of an element
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int growArray(void **array, qword count, qword *maxCount, size_t size) {
+	if (count < *maxCount) {
+		return EXIT_SUCCESS;
+	}
+	qword maxNew = *maxCount ? *maxCount << 1 : 256;
+	void *temp = realloc(*array, maxNew * size);
+	if (temp == NULL) {
+		return EXIT_FAILURE;
+	}
+	*array = temp;
+	*maxCount = maxNew;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief The time of a stat struct in nanoseconds
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE qword nanoseconds(const struct timespec *t) {
+	return (qword) t->tv_sec * 1000000000ULL + (qword) t->tv_nsec;
+}
+
+/**
+ * @brief Index the paths of the files and the subdirectories of the old catalog
+ *
+ * 	@param *builder the catalog
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int indexOldCatalog(CATALOG_BUILDER *builder) {
+	const CATALOG_MAP *old = &builder->old;
+	qword numFiles = old->header->NumFiles;
+	qword numDirectories = old->header->NumDirectories;
+	const qword *names = (const qword *) column(old, COL_NAME);
+	const dword *parents = (const dword *) column(old, DIR_PARENT);
+	qword i, slot;
+	builder->oldTableSize = 16;
+	while (builder->oldTableSize < numFiles * 2) {
+		builder->oldTableSize <<= 1;
+	}
+	builder->oldFileTable = (qword *) calloc(builder->oldTableSize,
+			sizeof(qword));
+	builder->oldFirstChild = (qword *) calloc(numDirectories + 1,
+			sizeof(qword));
+	builder->oldChildren = (dword *) malloc(
+			sizeof(dword) * (numDirectories + 1));
+	if (builder->oldFileTable == NULL || builder->oldFirstChild == NULL
+			|| builder->oldChildren == NULL) {
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < numFiles; i++) {
+		slot = hashString(old->strings + names[i])
+				& (builder->oldTableSize - 1);
+		while (builder->oldFileTable[slot] != 0) {
+			slot = (slot + 1) & (builder->oldTableSize - 1);
+		}
+		builder->oldFileTable[slot] = i + 1;
+	}
+	// the subdirectories of every directory, counting sort by parent
+	for (i = 1; i < numDirectories; i++) {
+		if (parents[i] < numDirectories) {
+			builder->oldFirstChild[parents[i] + 1]++;
+		}
+	}
+	for (i = 0; i < numDirectories; i++) {
+		builder->oldFirstChild[i + 1] += builder->oldFirstChild[i];
+	}
+	qword *next = (qword *) malloc(sizeof(qword) * (numDirectories + 1));
+	if (next == NULL) {
+		return EXIT_FAILURE;
+	}
+	memcpy(next, builder->oldFirstChild, sizeof(qword) * (numDirectories + 1));
+	for (i = 1; i < numDirectories; i++) {
+		if (parents[i] < numDirectories) {
+			builder->oldChildren[next[parents[i]]++] = (dword) i;
+		}
+	}
+	free(next);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Find a file in the old catalog
+ *
+ * 	@param *builder the catalog
+ * 	@param *name the path of the file in the tree
+ * 	@return long the index of the file or -1
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE long findOldFile(const CATALOG_BUILDER *builder, const char *name) {
+	if (!builder->hasOld) {
+		return -1;
+	}
+	const qword *names = (const qword *) column(&builder->old, COL_NAME);
+	qword slot = hashString(name) & (builder->oldTableSize - 1);
+	while (builder->oldFileTable[slot] != 0) {
+		qword index = builder->oldFileTable[slot] - 1;
+		if (strcmp(builder->old.strings + names[index], name) == 0) {
+			return (long) index;
+		}
+		slot = (slot + 1) & (builder->oldTableSize - 1);
+	}
+	return -1;
+}
+
+/**
+ * @brief Add a file to a catalog
+ *
+ *	If the file has the same size, times and inode as in the old catalog its fields
+ *	are copied from there, otherwise it is marked for reading its header.
+ *
+ * 	@param *builder the catalog
+ * 	@param *name the path of the file in the tree
+ * 	@param *path the full path of the file
+ * 	@param *status the status of the file
+ * 	@param directory the index of the directory of the file
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int addFile(CATALOG_BUILDER *builder, const char *name,
+		const char *path, const struct stat *status, dword directory) {
+	if (growArray((void **) &builder->files, builder->numFiles,
+			&builder->maxFiles, sizeof(CATALOG_FILE)) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	CATALOG_FILE *file = &builder->files[builder->numFiles];
+	memset(file, 0, sizeof(CATALOG_FILE));
+	if (addString(builder, name, &file->name) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	file->directory = directory;
+	file->size = (qword) status->st_size;
+	file->mtime = nanoseconds(&status->st_mtim);
+	file->ctime = nanoseconds(&status->st_ctim);
+	file->inode = (qword) status->st_ino;
+	long old = findOldFile(builder, name);
+	const CATALOG_MAP *map = &builder->old;
+	if (old >= 0 && ((const qword *) column(map, COL_SIZE))[old] == file->size
+			&& ((const qword *) column(map, COL_MTIME))[old] == file->mtime
+			&& ((const qword *) column(map, COL_CTIME))[old] == file->ctime
+			&& ((const qword *) column(map, COL_INODE))[old] == file->inode) {
+		file->sampleRate = ((const dword *) column(map, COL_SAMPLE_RATE))[old];
+		file->channels = ((const word *) column(map, COL_CHANNELS))[old];
+		file->bits = ((const word *) column(map, COL_BITS))[old];
+		file->format = ((const word *) column(map, COL_FORMAT))[old];
+		file->valid = ((const byte *) column(map, COL_VALID))[old];
+		file->frames = ((const qword *) column(map, COL_FRAMES))[old];
+		file->duration = ((const double *) column(map, COL_DURATION))[old];
+	} else {
+		file->path = strdup(path);
+		if (file->path == NULL
+				|| growArray((void **) &builder->reread, builder->numReread,
+						&builder->maxReread, sizeof(qword)) == EXIT_FAILURE) {
+			return EXIT_FAILURE;
+		}
+		builder->reread[builder->numReread++] = builder->numFiles;
+	}
+	builder->numFiles++;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Check whether a name is the name of a .wav file
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE bool isWavName(const char *name) {
+	size_t length = strlen(name);
+	return length >= 4 && strcmp(name + length - 4, ".wav") == 0;
+}
+
+/**
+ * @brief Join a directory and a name to a path
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE char *joinPath(const char *directory, const char *name) {
+	char *path = (char *) malloc(strlen(directory) + strlen(name) + 2);
+	if (path != NULL) {
+		if (directory[0] == '\0') {
+			strcpy(path, name);
+		} else {
+			sprintf(path, "%s%c%s", directory, PATHSEPERATOR, name);
+		}
+	}
+	return path;
+}
+
+/**
+ * @brief Add a directory of the tree and everything under it to a catalog
+ *
+ * 	@param *builder the catalog
+ * 	@param *name the path of the directory in the tree ("" for the root)
+ * 	@param parent the index of the parent directory
+ * 	@param oldIndex the index of the directory in the old catalog or -1
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int addDirectory(CATALOG_BUILDER *builder, const char *name,
+		dword parent, long oldIndex) {
+	char *path = joinPath(builder->root, name);
+	struct stat status;
+	if (path == NULL) {
+		return EXIT_FAILURE;
+	}
+	if (stat(path, &status) != 0 || !S_ISDIR(status.st_mode)
+			|| growArray((void **) &builder->directories,
+					builder->numDirectories, &builder->maxDirectories,
+					sizeof(CATALOG_DIRECTORY)) == EXIT_FAILURE) {
+		free(path);
+		return EXIT_FAILURE;
+	}
+	dword index = (dword) builder->numDirectories++;
+	CATALOG_DIRECTORY *directory = &builder->directories[index];
+	if (addString(builder, name, &directory->name) == EXIT_FAILURE) {
+		free(path);
+		return EXIT_FAILURE;
+	}
+	directory->mtime = nanoseconds(&status.st_mtim);
+	directory->ctime = nanoseconds(&status.st_ctim);
+	directory->parent = (index == 0) ? 0 : parent;
+	directory->firstFile = builder->numFiles;
+	const CATALOG_MAP *map = &builder->old;
+	char *fullName, *filePath;
+	struct stat fileStatus;
+	qword i;
+	if (oldIndex >= 0
+			&& ((const qword *) column(map, DIR_MTIME))[oldIndex]
+					== directory->mtime
+			&& ((const qword *) column(map, DIR_CTIME))[oldIndex]
+					== directory->ctime) {
+		// The entries of the directory didn't change, take them from the catalog
+		qword first = ((const qword *) column(map, DIR_FIRST_FILE))[oldIndex];
+		qword count = ((const qword *) column(map, DIR_NUM_FILES))[oldIndex];
+		const qword *names = (const qword *) column(map, COL_NAME);
+		for (i = first; i < first + count && i < map->header->NumFiles; i++) {
+			filePath = joinPath(builder->root, map->strings + names[i]);
+			if (filePath == NULL) {
+				free(path);
+				return EXIT_FAILURE;
+			}
+			if (stat(filePath, &fileStatus) == 0
+					&& addFile(builder, map->strings + names[i], filePath,
+							&fileStatus, index) == EXIT_FAILURE) {
+				free(filePath);
+				free(path);
+				return EXIT_FAILURE;
+			}
+			free(filePath);
+		}
+		builder->directories[index].numFiles = builder->numFiles
+				- builder->directories[index].firstFile;
+		const qword *dirNames = (const qword *) column(map, DIR_NAME);
+		for (i = builder->oldFirstChild[oldIndex];
+				i < builder->oldFirstChild[oldIndex + 1]; i++) {
+			dword child = builder->oldChildren[i];
+			// fails only if the subdirectory was removed since the last refresh
+			addDirectory(builder, map->strings + dirNames[child], index,
+					(long) child);
+		}
+		free(path);
+		return EXIT_SUCCESS;
+	}
+	// Read the entries of the directory
+	DIR *dir = opendir(path);
+	struct dirent *entry;
+	char **subdirectories = NULL;
+	qword numSubdirectories = 0, maxSubdirectories = 0;
+	if (dir == NULL) {
+		free(path);
+		return EXIT_FAILURE;
+	}
+	while ((entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0
+				|| strcmp(entry->d_name, "..") == 0) {
+			continue;
+		}
+		fullName = joinPath(name, entry->d_name);
+		filePath = joinPath(path, entry->d_name);
+		if (fullName == NULL || filePath == NULL
+				|| lstat(filePath, &fileStatus) != 0) {
+			free(fullName);
+			free(filePath);
+			continue;
+		}
+		if (S_ISDIR(fileStatus.st_mode)) {
+			if (growArray((void **) &subdirectories, numSubdirectories,
+					&maxSubdirectories, sizeof(char *)) == EXIT_SUCCESS) {
+				subdirectories[numSubdirectories++] = fullName;
+				fullName = NULL;
+			}
+		} else if (S_ISREG(fileStatus.st_mode) && isWavName(entry->d_name)) {
+			if (addFile(builder, fullName, filePath, &fileStatus,
+					index) == EXIT_FAILURE) {
+				free(fullName);
+				free(filePath);
+				break;
+			}
+		}
+		free(fullName);
+		free(filePath);
+	}
+	closedir(dir);
+	builder->directories[index].numFiles = builder->numFiles
+			- builder->directories[index].firstFile;
+	const qword *dirNames =
+			builder->hasOld ? (const qword *) column(map, DIR_NAME) : NULL;
+	long oldChild;
+	for (i = 0; i < numSubdirectories; i++) {
+		// find the subdirectory in the old catalog by its path
+		oldChild = -1;
+		if (oldIndex >= 0) {
+			qword j;
+			for (j = builder->oldFirstChild[oldIndex];
+					j < builder->oldFirstChild[oldIndex + 1]; j++) {
+				if (strcmp(map->strings + dirNames[builder->oldChildren[j]],
+						subdirectories[i]) == 0) {
+					oldChild = builder->oldChildren[j];
+					break;
+				}
+			}
+		}
+		addDirectory(builder, subdirectories[i], index, oldChild);
+		free(subdirectories[i]);
+	}
+	free(subdirectories);
+	free(path);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Read the header of a changed file of a catalog
+ *
+ *	A job of the worker pool, its argument is a CATALOG_FILE.
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE void readCatalogFile(void *argument) {
+	CATALOG_FILE *file = (CATALOG_FILE *) argument;
+	HEADER header;
+	long dataOffset = 0;
+	int fd = open(file->path, O_RDONLY);
+	if (fd >= 0 && readHeaderFd(fd, &header, &dataOffset) == EXIT_SUCCESS) {
+		file->sampleRate = header.SampleRate;
+		file->channels = header.NumChannels;
+		file->bits = header.BitsPerSample;
+		file->format = header.AudioFormat;
+		file->valid = isCorrectFormatHeader(&header) && header.BlockAlign != 0
+				&& header.SampleRate != 0;
+		if (file->valid) {
+			file->frames = header.Subchunk2Size / header.BlockAlign;
+			file->duration = (double) file->frames / header.SampleRate;
+		}
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+	free(file->path);
+	file->path = NULL;
+}
+
+/**
+ * @brief Write a column of a catalog, padded to 8 bytes
+ *
+ * 	@param *fp the catalog file
+ * 	@param *data the elements of the column
+ * 	@param bytes the size of the column
+ * 	@param *offset the offset of the column, moved to the next column
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int writeColumn(FILE *fp, const void *data, qword bytes, qword *offset) {
+	static const byte zeros[8] = { 0 };
+	qword padding = (8 - (bytes & 7)) & 7;
+	if ((bytes > 0 && fwrite(data, 1, bytes, fp) != bytes)
+			|| (padding > 0 && fwrite(zeros, 1, padding, fp) != padding)) {
+		return EXIT_FAILURE;
+	}
+	*offset += bytes + padding;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Write a catalog to a file, through a temporary file which is renamed
+ *
+ * 	@param *builder the catalog
+ * 	@param *fileName the name of the catalog file
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int writeCatalog(CATALOG_BUILDER *builder, const char *fileName) {
+	CATALOG_HEADER header;
+	char *temporary = (char *) malloc(strlen(fileName) + 5);
+	qword i, count, offset = sizeof(CATALOG_HEADER);
+	int c, result = EXIT_SUCCESS;
+	if (temporary == NULL) {
+		return EXIT_FAILURE;
+	}
+	sprintf(temporary, "%s.new", fileName);
+	FILE *fp = fopen(temporary, "wb");
+	if (fp == NULL) {
+		free(temporary);
+		return EXIT_FAILURE;
+	}
+	memset(&header, 0, sizeof(CATALOG_HEADER));
+	memcpy(header.Magic, CATALOG_MAGIC, 4);
+	header.Version = CATALOG_VERSION;
+	header.NumFiles = builder->numFiles;
+	header.NumDirectories = builder->numDirectories;
+	header.RootName = builder->rootName;
+	// the header is written again when the offsets are known
+	fwrite(&header, sizeof(CATALOG_HEADER), 1, fp);
+	for (c = 0; c < CATALOG_COLUMNS && result == EXIT_SUCCESS; c++) {
+		count = (c < DIR_NAME) ? builder->numFiles : builder->numDirectories;
+		byte *data = (byte *) malloc(count * COLUMN_SIZES[c] + 1);
+		if (data == NULL) {
+			result = EXIT_FAILURE;
+			break;
+		}
+		for (i = 0; i < count; i++) {
+			const CATALOG_FILE *f = &builder->files[(c < DIR_NAME) ? i : 0];
+			const CATALOG_DIRECTORY *d = &builder->directories[
+					(c < DIR_NAME) ? 0 : i];
+			byte *e = data + i * COLUMN_SIZES[c];
+			switch ((CATALOG_COLUMN) c) {
+			case COL_SAMPLE_RATE:
+				memcpy(e, &f->sampleRate, 4);
+				break;
+			case COL_CHANNELS:
+				memcpy(e, &f->channels, 2);
+				break;
+			case COL_BITS:
+				memcpy(e, &f->bits, 2);
+				break;
+			case COL_FORMAT:
+				memcpy(e, &f->format, 2);
+				break;
+			case COL_VALID:
+				*e = f->valid;
+				break;
+			case COL_FRAMES:
+				memcpy(e, &f->frames, 8);
+				break;
+			case COL_DURATION:
+				memcpy(e, &f->duration, 8);
+				break;
+			case COL_SIZE:
+				memcpy(e, &f->size, 8);
+				break;
+			case COL_MTIME:
+				memcpy(e, &f->mtime, 8);
+				break;
+			case COL_CTIME:
+				memcpy(e, &f->ctime, 8);
+				break;
+			case COL_INODE:
+				memcpy(e, &f->inode, 8);
+				break;
+			case COL_NAME:
+				memcpy(e, &f->name, 8);
+				break;
+			case COL_DIRECTORY:
+				memcpy(e, &f->directory, 4);
+				break;
+			case DIR_NAME:
+				memcpy(e, &d->name, 8);
+				break;
+			case DIR_MTIME:
+				memcpy(e, &d->mtime, 8);
+				break;
+			case DIR_CTIME:
+				memcpy(e, &d->ctime, 8);
+				break;
+			case DIR_PARENT:
+				memcpy(e, &d->parent, 4);
+				break;
+			case DIR_FIRST_FILE:
+				memcpy(e, &d->firstFile, 8);
+				break;
+			case DIR_NUM_FILES:
+				memcpy(e, &d->numFiles, 8);
+				break;
+			default:
+				break;
+			}
+		}
+		header.Columns[c] = offset;
+		result = writeColumn(fp, data, count * COLUMN_SIZES[c], &offset);
+		free(data);
+	}
+	header.StringsOffset = offset;
+	header.StringsSize = builder->stringsSize;
+	if (result == EXIT_SUCCESS) {
+		result = writeColumn(fp, builder->strings, builder->stringsSize,
+				&offset);
+	}
+	if (result == EXIT_SUCCESS
+			&& (fseek(fp, 0, SEEK_SET) != 0
+					|| fwrite(&header, sizeof(CATALOG_HEADER), 1, fp) != 1)) {
+		result = EXIT_FAILURE;
+	}
+	if (fclose(fp) != 0) {
+		result = EXIT_FAILURE;
+	}
+	if (result == EXIT_SUCCESS && rename(temporary, fileName) != 0) {
+		result = EXIT_FAILURE;
+	}
+	if (result == EXIT_FAILURE) {
+		remove(temporary);
+	}
+	free(temporary);
+	return result;
+}
+
+PUBLIC int buildCatalog(char *directory, char *catalogFile) {
+	CATALOG_BUILDER builder;
+	qword i;
+	if (directory == NULL || catalogFile == NULL) {
+		return EXIT_FAILURE;
+	}
+	memset(&builder, 0, sizeof(CATALOG_BUILDER));
+	builder.root = directory;
+// Use the old catalog if it is a catalog of the same directory
+	if (mapCatalog(catalogFile, &builder.old) == EXIT_SUCCESS) {
+		builder.mappedOld = true;
+		builder.hasOld = strcmp(
+				builder.old.strings + builder.old.header->RootName, directory)
+				== 0 && builder.old.header->NumDirectories > 0
+				&& indexOldCatalog(&builder) == EXIT_SUCCESS;
+	}
+	int result = addString(&builder, directory, &builder.rootName);
+	if (result == EXIT_SUCCESS) {
+		result = addDirectory(&builder, "", 0, builder.hasOld ? 0 : -1);
+	}
+// Read the headers of the files which changed
+	if (result == EXIT_SUCCESS && builder.numReread > 0) {
+		int threads = defaultWorkerCount();
+		WORKER_POOL *pool = createWorkerPool(threads, threads << 2);
+		if (pool == NULL) {
+			result = EXIT_FAILURE;
+		}
+		for (i = 0; pool != NULL && i < builder.numReread; i++) {
+			submitJob(pool, readCatalogFile, &builder.files[builder.reread[i]]);
+		}
+		destroyWorkerPool(&pool);
+	}
+	if (builder.mappedOld) {
+		munmap(builder.old.map, builder.old.size);
+	}
+	if (result == EXIT_SUCCESS) {
+		result = writeCatalog(&builder, catalogFile);
+	}
+	if (result == EXIT_SUCCESS) {
+		printOutput("Success :  %s\t(%llu files, %llu read)\n", catalogFile,
+				(unsigned long long) builder.numFiles,
+				(unsigned long long) builder.numReread);
+	} else {
+		printOutput("Fail    :  %s\t(Can't build the catalog of %s)\n", catalogFile,
+				directory);
+	}
+	for (i = 0; i < builder.numFiles; i++) {
+		free(builder.files[i].path);
+	}
+	free(builder.files);
+	free(builder.directories);
+	free(builder.strings);
+	free(builder.reread);
+	free(builder.oldFileTable);
+	free(builder.oldChildren);
+	free(builder.oldFirstChild);
+	return result;
+}
+
+PUBLIC int queryCatalog(FILE *out, char *catalogFile, char *filter) {
+	CATALOG_MAP map;
+	if (out == NULL) {
+		return EXIT_FAILURE;
+	}
+	if (catalogFile == NULL || mapCatalog(catalogFile, &map) == EXIT_FAILURE) {
+		fprintf(out, "Fail    :  %s\t(This is not a catalog)\n", catalogFile);
+		return EXIT_FAILURE;
+	}
+// Parse the filter: key=value,key=value,...
+	long rate = -1, channels = -1, bits = -1, format = -1, valid = 1;
+	double minDuration = -1, maxDuration = -1;
+	char *pattern = NULL, *copy = NULL, *key, *value, *next;
+	if (filter != NULL) {
+		copy = strdup(filter);
+		for (key = copy; key != NULL && *key != '\0'; key = next) {
+			next = strchr(key, ',');
+			if (next != NULL) {
+				*next++ = '\0';
+			}
+			value = strchr(key, '=');
+			if (value == NULL) {
+				fprintf(out, "Fail    :  %s\t(Wrong filter)\n", key);
+				free(copy);
+				munmap(map.map, map.size);
+				return EXIT_FAILURE;
+			}
+			*value++ = '\0';
+			if (strcmp(key, "rate") == 0) {
+				rate = atol(value);
+			} else if (strcmp(key, "channels") == 0) {
+				channels = atol(value);
+			} else if (strcmp(key, "bits") == 0) {
+				bits = atol(value);
+			} else if (strcmp(key, "format") == 0) {
+				format = atol(value);
+			} else if (strcmp(key, "valid") == 0) {
+				valid = atol(value);
+			} else if (strcmp(key, "mindur") == 0) {
+				minDuration = atof(value);
+			} else if (strcmp(key, "maxdur") == 0) {
+				maxDuration = atof(value);
+			} else if (strcmp(key, "name") == 0) {
+				pattern = value;
+			} else {
+				fprintf(out, "Fail    :  %s\t(Unknown filter)\n", key);
+				free(copy);
+				munmap(map.map, map.size);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+// Scan only the columns of the filter
+	const dword *rates = (const dword *) column(&map, COL_SAMPLE_RATE);
+	const word *channelCounts = (const word *) column(&map, COL_CHANNELS);
+	const word *bitCounts = (const word *) column(&map, COL_BITS);
+	const word *formats = (const word *) column(&map, COL_FORMAT);
+	const byte *valids = (const byte *) column(&map, COL_VALID);
+	const double *durations = (const double *) column(&map, COL_DURATION);
+	const qword *names = (const qword *) column(&map, COL_NAME);
+	const char *root = map.strings + map.header->RootName;
+	qword i;
+	for (i = 0; i < map.header->NumFiles; i++) {
+		if ((valid >= 0 && valids[i] != valid)
+				|| (rate >= 0 && rates[i] != (dword) rate)
+				|| (channels >= 0 && channelCounts[i] != channels)
+				|| (bits >= 0 && bitCounts[i] != bits)
+				|| (format >= 0 && formats[i] != format)
+				|| (minDuration >= 0 && durations[i] < minDuration)
+				|| (maxDuration >= 0 && durations[i] > maxDuration)
+				|| (pattern != NULL
+						&& fnmatch(pattern, map.strings + names[i], 0) != 0)) {
+			continue;
+		}
+		fprintf(out, "%s%c%s\n", root, PATHSEPERATOR,
+				map.strings + names[i]);
+	}
+	free(copy);
+	munmap(map.map, map.size);
+	return EXIT_SUCCESS;
+}
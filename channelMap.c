@@ -0,0 +1,364 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file channelMap.c
+ *  @brief Extracts ,reorders ,downmixes and upmixes the channels of a sound
+ *
+ *  A channel map is a matrix of gains from the input to the output channels. The
+ *  positions of the channels are the bits of a channel mask in their order ,so the
+ *  channel of a position is the number of the bits of the mask below it.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <math.h>
+#include "channelMap.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The number of the positions of a channel mask
+#define POSITIONS 18
+// The gain of a channel which goes to both sides of a downmix (-3 dB)
+#define SIDE_GAIN 0.70710678
+
+// The names of the positions of a channel mask ,in the order of their bits
+PRIVATE const char *positionNames[POSITIONS] = { "FL", "FR", "FC", "LFE", "BL",
+		"BR", "FLC", "FRC", "BC", "SL", "SR", "TC", "TFL", "TFC", "TFR", "TBL",
+		"TBC", "TBR" };
+
+// The gains of every position in the left and the right channel of a stereo downmix
+PRIVATE const double downmixGains[POSITIONS][2] = { { 1, 0 }, { 0, 1 }, {
+		SIDE_GAIN, SIDE_GAIN }, { 0, 0 }, { SIDE_GAIN, 0 }, { 0, SIDE_GAIN }, {
+		1, 0 }, { 0, 1 }, { SIDE_GAIN, SIDE_GAIN }, { SIDE_GAIN, 0 }, { 0,
+		SIDE_GAIN }, { SIDE_GAIN, SIDE_GAIN }, { SIDE_GAIN, 0 }, { SIDE_GAIN,
+		SIDE_GAIN }, { 0, SIDE_GAIN }, { SIDE_GAIN, 0 }, { SIDE_GAIN,
+		SIDE_GAIN }, { 0, SIDE_GAIN } };
+
+/**
+ * @brief The position of a channel in a channel mask
+ *
+ * 	@param mask the channel mask
+ * 	@param channel the index of the channel
+ * 	@return int the bit of the position or -1 if the mask has no position for it
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int positionOf(dword mask, int channel) {
+	int bit;
+	for (bit = 0; bit < POSITIONS; bit++) {
+		if ((mask & (1U << bit)) != 0 && channel-- == 0) {
+			return bit;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief The channel of a position in a channel mask
+ *
+ * 	@param mask the channel mask
+ * 	@param bit the bit of the position
+ * 	@param channels the number of the channels
+ * 	@return int the index of the channel or -1 if the sound has no channel there
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int channelOf(dword mask, int bit, int channels) {
+	int channel = 0, i;
+	if ((mask & (1U << bit)) == 0) {
+		return -1;
+	}
+	for (i = 0; i < bit; i++) {
+		if ((mask & (1U << i)) != 0) {
+			channel++;
+		}
+	}
+	return (channel < channels) ? channel : -1;
+}
+
+/**
+ * @brief Parse an input channel of a term ,an index or the name of a position
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE int parseSource(const char **text, int channels, dword mask) {
+	char name[4];
+	int length = 0, bit;
+	long index;
+	char *end;
+	if (isdigit((unsigned char) **text)) {
+		index = strtol(*text, &end, 10);
+		*text = end;
+		return (index < channels) ? (int) index : -1;
+	}
+	while (isalpha((unsigned char) (*text)[length]) && length < 3) {
+		name[length] = (char) toupper((unsigned char) (*text)[length]);
+		length++;
+	}
+	name[length] = '\0';
+	*text += length;
+	for (bit = 0; bit < POSITIONS; bit++) {
+		if (length > 0 && strcmp(name, positionNames[bit]) == 0) {
+			return channelOf(mask, bit, channels);
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Parse the output channels of a map
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE int parseOutputs(const char *text, int channels, dword mask,
+		CHANNEL_MAP *map) {
+	double sign, gain;
+	int source;
+	char *end;
+	for (map->outChannels = 0; map->outChannels < MAX_CHANNELS;) {
+		float *row = map->gains[map->outChannels++];
+		do {
+			sign = (*text == '-') ? -1 : 1;
+			if (*text == '+' || *text == '-') {
+				text++;
+			}
+			gain = 1;
+			if (isdigit((unsigned char) *text) || *text == '.') {
+				gain = strtod(text, &end);
+				if (*end == '*') {
+					text = end + 1;
+				} else {
+					// a channel index ,which has no gain
+					gain = 1;
+				}
+			}
+			if ((source = parseSource(&text, channels, mask)) < 0) {
+				return EXIT_FAILURE;
+			}
+			row[source] += (float) (sign * gain);
+		} while (*text == '+' || *text == '-');
+		if (*text == '\0') {
+			return EXIT_SUCCESS;
+		}
+		if (*text++ != ',') {
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_FAILURE;
+}
+
+/**
+ * @brief Fill the downmix of a preset from the positions of the channels
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE int downmix(int channels, dword mask, bool mono, CHANNEL_MAP *map) {
+	double sums[2] = { 0, 0 }, scale;
+	int c, side, bit;
+	for (c = 0; c < channels; c++) {
+		if ((bit = positionOf(mask, c)) < 0) {
+			return EXIT_FAILURE;
+		}
+		for (side = 0; side < 2; side++) {
+			map->gains[side][c] = (float) downmixGains[bit][side];
+			sums[side] += downmixGains[bit][side];
+		}
+	}
+	if (mono) {
+		// the sum of the left and the right channel ,scaled like them
+		for (c = 0; c < channels; c++) {
+			map->gains[0][c] += map->gains[1][c];
+			map->gains[1][c] = 0;
+		}
+		sums[0] += sums[1];
+		sums[1] = 0;
+	}
+	map->outChannels = mono ? 1 : 2;
+	map->outMask = defaultChannelMask(map->outChannels);
+	// a channel of full scale inputs can't be more than full scale
+	scale = (sums[0] > sums[1]) ? sums[0] : sums[1];
+	for (side = 0; scale > 1 && side < map->outChannels; side++) {
+		for (c = 0; c < channels; c++) {
+			map->gains[side][c] = (float) (map->gains[side][c] / scale);
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Find if a map is a permutation and the positions of its output channels
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void findPermutation(CHANNEL_MAP *map, dword mask) {
+	int o, c, terms, bit, lastBit = -1;
+	dword outMask = 0;
+	map->permutation = true;
+	for (o = 0; o < map->outChannels; o++) {
+		terms = 0;
+		for (c = 0; c < map->inChannels; c++) {
+			if (map->gains[o][c] != 0) {
+				terms++;
+				map->sources[o] = c;
+			}
+		}
+		if (terms != 1 || map->gains[o][map->sources[o]] != 1) {
+			map->permutation = false;
+			continue;
+		}
+		// a mask keeps the positions in the order of the channels
+		bit = positionOf(mask, map->sources[o]);
+		if (bit > lastBit) {
+			outMask |= 1U << bit;
+			lastBit = bit;
+		} else {
+			lastBit = POSITIONS;
+		}
+	}
+	if (map->outMask == 0) {
+		map->outMask =
+				(map->permutation && lastBit < POSITIONS) ?
+						outMask : defaultChannelMask(map->outChannels);
+	}
+}
+
+PUBLIC int parseChannelMap(const char *text, int channels, dword mask,
+		CHANNEL_MAP *map) {
+	char compact[CHANNEL_MAP_LENGTH];
+	int length = 0, result;
+	if (text == NULL || map == NULL || channels < 1 || channels > MAX_CHANNELS) {
+		return EXIT_FAILURE;
+	}
+	for (; *text != '\0'; text++) {
+		if (isspace((unsigned char) *text)) {
+			continue;
+		}
+		if (length == CHANNEL_MAP_LENGTH - 1) {
+			return EXIT_FAILURE;
+		}
+		compact[length++] = *text;
+	}
+	compact[length] = '\0';
+	memset(map, 0, sizeof(CHANNEL_MAP));
+	map->inChannels = channels;
+	if (mask == 0) {
+		mask = defaultChannelMask(channels);
+	}
+	if (strcmp(compact, "stereo") == 0 || strcmp(compact, "mono") == 0) {
+		result = downmix(channels, mask, compact[0] == 'm', map);
+	} else {
+		result = parseOutputs(compact, channels, mask, map);
+	}
+	if (result == EXIT_SUCCESS) {
+		findPermutation(map, mask);
+	}
+	return result;
+}
+
+/**
+ * @brief Map planar samples and place them in the outputs or add them to the outputs
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void sumChannels(const CHANNEL_MAP *map, float *const *in, long count,
+		float *const *out, bool accumulate) {
+	int terms[MAX_CHANNELS], sources[MAX_CHANNELS][MAX_CHANNELS], o, c, t;
+	float gains[MAX_CHANNELS][MAX_CHANNELS], sum;
+	long i = 0;
+	// the terms of every output ,without the inputs of a gain of 0
+	for (o = 0; o < map->outChannels; o++) {
+		terms[o] = 0;
+		for (c = 0; c < map->inChannels; c++) {
+			if (map->gains[o][c] != 0) {
+				sources[o][terms[o]] = c;
+				gains[o][terms[o]++] = map->gains[o][c];
+			}
+		}
+	}
+#ifdef __SSE2__
+	__m128 vector;
+	for (; i + 4 <= count; i += 4) {
+		for (o = 0; o < map->outChannels; o++) {
+			vector = accumulate ? _mm_loadu_ps(out[o] + i) : _mm_setzero_ps();
+			for (t = 0; t < terms[o]; t++) {
+				vector = _mm_add_ps(vector,
+						_mm_mul_ps(_mm_set1_ps(gains[o][t]),
+								_mm_loadu_ps(in[sources[o][t]] + i)));
+			}
+			_mm_storeu_ps(out[o] + i, vector);
+		}
+	}
+#endif
+	for (; i < count; i++) {
+		for (o = 0; o < map->outChannels; o++) {
+			sum = accumulate ? out[o][i] : 0;
+			for (t = 0; t < terms[o]; t++) {
+				sum += gains[o][t] * in[sources[o][t]][i];
+			}
+			out[o][i] = sum;
+		}
+	}
+}
+
+PUBLIC void mapChannels(const CHANNEL_MAP *map, float *const *in, long count,
+		float *const *out) {
+	sumChannels(map, in, count, out, false);
+}
+
+PUBLIC void accumulateChannels(const CHANNEL_MAP *map, float *const *in,
+		long count, float *const *out) {
+	sumChannels(map, in, count, out, true);
+}
+
+PUBLIC int panChannelMap(int channels, dword mask, double decibels, double pan,
+		CHANNEL_MAP *map) {
+	double factor = pow(10, decibels / 20), angle, sides[2];
+	int side, c;
+	if (map == NULL || pan < -1 || pan > 1 || !isfinite(factor)) {
+		return EXIT_FAILURE;
+	}
+	if (channels == 1) {
+		memset(map, 0, sizeof(CHANNEL_MAP));
+		map->inChannels = 1;
+		map->outChannels = 2;
+		angle = (pan + 1) * M_PI / 4;
+		map->gains[0][0] = (float) (factor * cos(angle));
+		map->gains[1][0] = (float) (factor * sin(angle));
+		map->outMask = defaultChannelMask(2);
+		return EXIT_SUCCESS;
+	}
+	if (parseChannelMap((channels == 2) ? "0,1" : "stereo", channels, mask, map)
+			== EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	// the balance lowers only the side away from the pan
+	sides[0] = factor * ((pan > 0) ? 1 - pan : 1);
+	sides[1] = factor * ((pan < 0) ? 1 + pan : 1);
+	for (side = 0; side < 2; side++) {
+		for (c = 0; c < channels; c++) {
+			map->gains[side][c] = (float) (map->gains[side][c] * sides[side]);
+		}
+	}
+	map->permutation = false;
+	return EXIT_SUCCESS;
+}
+
+PUBLIC void mapFrames(const CHANNEL_MAP *map, const byte *in, long count,
+		int bytesPerSample, byte *out) {
+	long inAlign = (long) map->inChannels * bytesPerSample, i;
+	int o;
+	for (i = 0; i < count; i++) {
+		for (o = 0; o < map->outChannels; o++) {
+			memcpy(out, in + map->sources[o] * bytesPerSample, bytesPerSample);
+			out += bytesPerSample;
+		}
+		in += inAlign;
+	}
+}
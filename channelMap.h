@@ -0,0 +1,124 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the channel maps. A channel
+ *  map makes every output channel a sum of input channels with gains (a
+ *  matrix) ,so the same operation extracts channels ("2"), reorders them
+ *  ("1,0"), downmixes them ("0+0.707*2,1+0.707*2" or the presets "stereo" and
+ *  "mono") and upmixes them ("0,0"). The channels are given by their index
+ *  or by the name of their position in the channel mask of the sound (FL ,FR
+ *  ,FC ,LFE ,BL ,BR ,FLC ,FRC ,BC ,SL ,SR ,TC ,TFL ,TFC ,TFR ,TBL ,TBC ,TBR).
+ *
+ *  A map which only picks channels (a permutation) copies the bytes of the
+ *  samples ,so it is exact for every format. Any other map runs on planar
+ *  samples in one pass over a block: every vector of 4 samples of the input
+ *  channels gives the vectors of all the output channels with SSE2. The same
+ *  pass adds the tracks of a mixdown to its channels ,with the gain and the
+ *  pan of every track in its map.
+ */
+#ifndef CHANNEL_MAP_H
+#define CHANNEL_MAP_H
+
+#include "planar.h"
+
+// The maximum length of the text of a channel map
+#define CHANNEL_MAP_LENGTH 256
+
+/**
+ * A map of the channels of a sound to new channels
+ */
+typedef struct {
+	int inChannels;
+	int outChannels;
+	bool permutation; // true if every output channel is an input channel
+	int sources[MAX_CHANNELS]; // the input channel of every output of a permutation
+	float gains[MAX_CHANNELS][MAX_CHANNELS]; // the gain of every input in every output
+	dword outMask; // the positions of the output channels or 0
+} CHANNEL_MAP;
+
+/**
+ * @brief Parse the text of a channel map
+ *
+ *	The output channels are separated by ',' and every one is a sum of terms separated
+ *	by '+' or '-'. A term is an input channel (an index from 0 or a position) with an
+ *	optional gain before it ("0.5*FC"). The preset "stereo" downmixes the positions of
+ *	the mask to two channels (ITU-R BS.775: the center ,surround and back channels at
+ *	-3 dB ,without the LFE) and "mono" to the sum of these two ,both scaled so a
+ *	channel can't clip. The spaces are ignored.
+ *
+ * 	@param *text the text of the map
+ * 	@param channels the number of the input channels
+ * 	@param mask the channel mask of the input or 0 for the usual layout
+ * 	@param *map the map to fill
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int parseChannelMap(const char *text, int channels, dword mask,
+		CHANNEL_MAP *map);
+/**
+ * @brief Map the planar samples of the input channels to the output channels
+ *
+ * 	@param *map the channel map
+ * 	@param **in the array of every input channel
+ * 	@param count the number of the frames
+ * 	@param **out the array of every output channel ,not one of the inputs
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void mapChannels(const CHANNEL_MAP *map, float *const *in, long count,
+		float *const *out);
+/**
+ * @brief Add the mapped planar samples of the input channels to the output channels
+ *
+ *	Like mapChannels but the samples are summed to the samples already in the
+ *	outputs ,so many inputs are mixed to the same outputs.
+ *
+ * 	@param *map the channel map
+ * 	@param **in the array of every input channel
+ * 	@param count the number of the frames
+ * 	@param **out the array of every output channel ,not one of the inputs
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void accumulateChannels(const CHANNEL_MAP *map, float *const *in,
+		long count, float *const *out);
+/**
+ * @brief Fill the map of a track to the two channels of a stereo mix
+ *
+ *	A mono track is panned with the constant power law (-3 dB in both channels at
+ *	the center) ,a stereo track is balanced and a track of more channels is
+ *	downmixed like the preset "stereo" and balanced.
+ *
+ * 	@param channels the number of the channels of the track
+ * 	@param mask the channel mask of the track or 0 for the usual layout
+ * 	@param decibels the gain of the track
+ * 	@param pan the position of the track from -1 (left) to 1 (right)
+ * 	@param *map the map to fill
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int panChannelMap(int channels, dword mask, double decibels, double pan,
+		CHANNEL_MAP *map);
+/**
+ * @brief Pick the samples of the output channels of a permutation from frames
+ *
+ * 	@param *map the channel map ,a permutation
+ * 	@param *in the interleaved input frames
+ * 	@param count the number of the frames
+ * 	@param bytesPerSample the bytes of a sample
+ * 	@param *out where the interleaved output frames are placed
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void mapFrames(const CHANNEL_MAP *map, const byte *in, long count,
+		int bytesPerSample, byte *out);
+
+#endif
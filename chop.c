@@ -19,73 +19,50 @@
  *  @bugs No known bugs
  */
 #include "utilities.h"
+#include "wavelib.h"
+#include "wavbuffer.h"
 
 PUBLIC int chop(char *inFilename, int l, int r) {
 	if (r <= l || r < 0 || l < 0) {
-		printf("Fail   :  %s   (Invalid time input)\n", inFilename);
+		printOutput("Fail   :  %s   (Invalid time input)\n", inFilename);
 		return EXIT_FAILURE;
 	}
+// The standard input is streamed to the standard output
+	if (strcmp(inFilename, "-") == 0) {
+		char operation[32];
+		sprintf(operation, "chop %d %d", l, r);
+		return pipeline(inFilename, operation, "-");
+	}
 // Create output filename
 	char *outFilename = NULL;
 	if (createOutputFilename(inFilename, "chopped-",
 			&outFilename) == EXIT_FAILURE) {
-		printf("Fail    :  %s\t(Can't create output filename)\n", inFilename);
+		printOutput("Fail    :  %s\t(Can't create output filename)\n",
+				inFilename);
 		return EXIT_FAILURE;
 	}
 // Read Wav
 	WAV *wav_old = NULL;
 	if (readWAV(inFilename, &wav_old) == EXIT_FAILURE) {
 		free(outFilename);
-		printf("Fail    :  %s\t(Can't read WAV file)\n", inFilename);
+		printOutput("Fail    :  %s\t(Can't read WAV file)\n", inFilename);
 		return EXIT_FAILURE;
 	}
-	long left = l * wav_old->header->SampleRate * wav_old->header->BlockAlign
-			* wav_old->header->NumChannels
-			/ (wav_old->header->BitsPerSample / 8);
-	long right = r * wav_old->header->SampleRate * wav_old->header->BlockAlign
-			* wav_old->header->NumChannels
-			/ (wav_old->header->BitsPerSample / 8);
-// Check if left and right are correct
-#ifdef DEBUG
-	printf("left:%lu\nright:%lu\nsize:%lu\n", left, right,
-			wav_old->header->Subchunk2Size);
-#endif
-	if (right > wav_old->header->Subchunk2Size
-			|| left > wav_old->header->Subchunk2Size) {
-		printf("Fail    :  %s\t(Invalid time input)\n", inFilename);
+// Keep the part between the times
+	WAV wav_new;
+	WAV_STATUS status = wav_chop(wav_old, l, r, &wav_new);
+	deleteWAV(&wav_old);
+	if (status != WAV_OK) {
+		printOutput("Fail    :  %s\t(%s)\n", inFilename, wav_strerror(status));
 		free(outFilename);
-		deleteWAV(&wav_old);
 		return EXIT_FAILURE;
 	}
-// Create new Wav and copy data
-	WAV *wav_new = (WAV*) malloc(sizeof(WAV));
-	wav_new->header = (HEADER*) malloc(sizeof(HEADER));
-	wav_new->data = (DATA*) malloc(sizeof(DATA));
-	wav_new->data->channel = (byte*) malloc(right - left);
-	memcpy(&wav_new->data->channel[0], &wav_old->data->channel[left],
-			right - left);
-	strcpy((char *) wav_new->header->ChunkID,
-			(char *) wav_old->header->ChunkID);
-	strcpy((char *) wav_new->header->Format, (char *) wav_old->header->Format);
-	strcpy((char *) wav_new->header->Subchunk2ID,
-			(char *) wav_old->header->Subchunk2ID);
-	wav_new->header->ChunkSize = wav_old->header->ChunkSize
-			- (wav_old->header->Subchunk2Size - (right - left));
-	wav_new->header->Subchunk1Size = wav_old->header->Subchunk1Size;
-	wav_new->header->AudioFormat = wav_old->header->AudioFormat;
-	wav_new->header->NumChannels = wav_old->header->NumChannels;
-	wav_new->header->SampleRate = wav_old->header->SampleRate;
-	wav_new->header->ByteRate = wav_old->header->ByteRate;
-	wav_new->header->BlockAlign = wav_old->header->BlockAlign;
-	wav_new->header->BitsPerSample = wav_old->header->BitsPerSample;
-	wav_new->header->Subchunk2Size = right - left;
 // Write data
-	writeWAV(outFilename, wav_new);
-	printf("Success :  %s\t(Created)\n", outFilename);
+	writeWAV(outFilename, &wav_new);
+	printOutput("Success :  %s\t(Created)\n", outFilename);
 // Free mallocs
 	free(outFilename);
-	deleteWAV(&wav_old);
-	deleteWAV(&wav_new);
+	wav_free(&wav_new);
 	return EXIT_SUCCESS;
 }
 #ifdef DEBUG_CHOP
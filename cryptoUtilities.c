@@ -23,25 +23,94 @@
 */
 #include "cryptoUtilities.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The number of rounds of the Feistel network of the keyed permutation
+#define FEISTEL_ROUNDS 4
+
+// The table of the CRC-32 for every value of a byte (polynomial 0xEDB88320)
+PRIVATE const dword CRC32_TABLE[256] = {
+		0x00000000U, 0x77073096U, 0xEE0E612CU, 0x990951BAU,
+		0x076DC419U, 0x706AF48FU, 0xE963A535U, 0x9E6495A3U,
+		0x0EDB8832U, 0x79DCB8A4U, 0xE0D5E91EU, 0x97D2D988U,
+		0x09B64C2BU, 0x7EB17CBDU, 0xE7B82D07U, 0x90BF1D91U,
+		0x1DB71064U, 0x6AB020F2U, 0xF3B97148U, 0x84BE41DEU,
+		0x1ADAD47DU, 0x6DDDE4EBU, 0xF4D4B551U, 0x83D385C7U,
+		0x136C9856U, 0x646BA8C0U, 0xFD62F97AU, 0x8A65C9ECU,
+		0x14015C4FU, 0x63066CD9U, 0xFA0F3D63U, 0x8D080DF5U,
+		0x3B6E20C8U, 0x4C69105EU, 0xD56041E4U, 0xA2677172U,
+		0x3C03E4D1U, 0x4B04D447U, 0xD20D85FDU, 0xA50AB56BU,
+		0x35B5A8FAU, 0x42B2986CU, 0xDBBBC9D6U, 0xACBCF940U,
+		0x32D86CE3U, 0x45DF5C75U, 0xDCD60DCFU, 0xABD13D59U,
+		0x26D930ACU, 0x51DE003AU, 0xC8D75180U, 0xBFD06116U,
+		0x21B4F4B5U, 0x56B3C423U, 0xCFBA9599U, 0xB8BDA50FU,
+		0x2802B89EU, 0x5F058808U, 0xC60CD9B2U, 0xB10BE924U,
+		0x2F6F7C87U, 0x58684C11U, 0xC1611DABU, 0xB6662D3DU,
+		0x76DC4190U, 0x01DB7106U, 0x98D220BCU, 0xEFD5102AU,
+		0x71B18589U, 0x06B6B51FU, 0x9FBFE4A5U, 0xE8B8D433U,
+		0x7807C9A2U, 0x0F00F934U, 0x9609A88EU, 0xE10E9818U,
+		0x7F6A0DBBU, 0x086D3D2DU, 0x91646C97U, 0xE6635C01U,
+		0x6B6B51F4U, 0x1C6C6162U, 0x856530D8U, 0xF262004EU,
+		0x6C0695EDU, 0x1B01A57BU, 0x8208F4C1U, 0xF50FC457U,
+		0x65B0D9C6U, 0x12B7E950U, 0x8BBEB8EAU, 0xFCB9887CU,
+		0x62DD1DDFU, 0x15DA2D49U, 0x8CD37CF3U, 0xFBD44C65U,
+		0x4DB26158U, 0x3AB551CEU, 0xA3BC0074U, 0xD4BB30E2U,
+		0x4ADFA541U, 0x3DD895D7U, 0xA4D1C46DU, 0xD3D6F4FBU,
+		0x4369E96AU, 0x346ED9FCU, 0xAD678846U, 0xDA60B8D0U,
+		0x44042D73U, 0x33031DE5U, 0xAA0A4C5FU, 0xDD0D7CC9U,
+		0x5005713CU, 0x270241AAU, 0xBE0B1010U, 0xC90C2086U,
+		0x5768B525U, 0x206F85B3U, 0xB966D409U, 0xCE61E49FU,
+		0x5EDEF90EU, 0x29D9C998U, 0xB0D09822U, 0xC7D7A8B4U,
+		0x59B33D17U, 0x2EB40D81U, 0xB7BD5C3BU, 0xC0BA6CADU,
+		0xEDB88320U, 0x9ABFB3B6U, 0x03B6E20CU, 0x74B1D29AU,
+		0xEAD54739U, 0x9DD277AFU, 0x04DB2615U, 0x73DC1683U,
+		0xE3630B12U, 0x94643B84U, 0x0D6D6A3EU, 0x7A6A5AA8U,
+		0xE40ECF0BU, 0x9309FF9DU, 0x0A00AE27U, 0x7D079EB1U,
+		0xF00F9344U, 0x8708A3D2U, 0x1E01F268U, 0x6906C2FEU,
+		0xF762575DU, 0x806567CBU, 0x196C3671U, 0x6E6B06E7U,
+		0xFED41B76U, 0x89D32BE0U, 0x10DA7A5AU, 0x67DD4ACCU,
+		0xF9B9DF6FU, 0x8EBEEFF9U, 0x17B7BE43U, 0x60B08ED5U,
+		0xD6D6A3E8U, 0xA1D1937EU, 0x38D8C2C4U, 0x4FDFF252U,
+		0xD1BB67F1U, 0xA6BC5767U, 0x3FB506DDU, 0x48B2364BU,
+		0xD80D2BDAU, 0xAF0A1B4CU, 0x36034AF6U, 0x41047A60U,
+		0xDF60EFC3U, 0xA867DF55U, 0x316E8EEFU, 0x4669BE79U,
+		0xCB61B38CU, 0xBC66831AU, 0x256FD2A0U, 0x5268E236U,
+		0xCC0C7795U, 0xBB0B4703U, 0x220216B9U, 0x5505262FU,
+		0xC5BA3BBEU, 0xB2BD0B28U, 0x2BB45A92U, 0x5CB36A04U,
+		0xC2D7FFA7U, 0xB5D0CF31U, 0x2CD99E8BU, 0x5BDEAE1DU,
+		0x9B64C2B0U, 0xEC63F226U, 0x756AA39CU, 0x026D930AU,
+		0x9C0906A9U, 0xEB0E363FU, 0x72076785U, 0x05005713U,
+		0x95BF4A82U, 0xE2B87A14U, 0x7BB12BAEU, 0x0CB61B38U,
+		0x92D28E9BU, 0xE5D5BE0DU, 0x7CDCEFB7U, 0x0BDBDF21U,
+		0x86D3D2D4U, 0xF1D4E242U, 0x68DDB3F8U, 0x1FDA836EU,
+		0x81BE16CDU, 0xF6B9265BU, 0x6FB077E1U, 0x18B74777U,
+		0x88085AE6U, 0xFF0F6A70U, 0x66063BCAU, 0x11010B5CU,
+		0x8F659EFFU, 0xF862AE69U, 0x616BFFD3U, 0x166CCF45U,
+		0xA00AE278U, 0xD70DD2EEU, 0x4E048354U, 0x3903B3C2U,
+		0xA7672661U, 0xD06016F7U, 0x4969474DU, 0x3E6E77DBU,
+		0xAED16A4AU, 0xD9D65ADCU, 0x40DF0B66U, 0x37D83BF0U,
+		0xA9BCAE53U, 0xDEBB9EC5U, 0x47B2CF7FU, 0x30B5FFE9U,
+		0xBDBDF21CU, 0xCABAC28AU, 0x53B39330U, 0x24B4A3A6U,
+		0xBAD03605U, 0xCDD70693U, 0x54DE5729U, 0x23D967BFU,
+		0xB3667A2EU, 0xC4614AB8U, 0x5D681B02U, 0x2A6F2B94U,
+		0xB40BBE37U, 0xC30C8EA1U, 0x5A05DF1BU, 0x2D02EF8DU
+};
+
 
 PUBLIC int getBit(char* m, int n) {
 
 	if (m == NULL || n < 0)
 		return 0;
 
-	int bytes = n >> 3;
-
-	while (*m != '\0' && bytes != 0) {
-		bytes--;
-		m++;
-	}
-
-	if (bytes != 0)
-		return 0;
+	// the byte is reached directly ,the caller owns a buffer of at least
+	// (n >> 3) + 1 bytes
+	m += n >> 3;
 
-	int bits = (7 - (n - ((n >> 3) << 3)));
+	int bits = 7 - (n & 7);
 
-	return ((int) (*m)) >> bits & 1;
+	return ((unsigned char) (*m)) >> bits & 1;
 
 }
 
@@ -52,53 +121,489 @@ PUBLIC int setBit(char* m, int n, int value) {
 	if ((value != 0 && value != 1) || m == NULL || n < 0)
 		return EXIT_FAILURE;
 
-	int bytes = n >> 3;
+	// the byte is reached directly ,the caller owns a buffer of at least
+	// (n >> 3) + 1 bytes
+	m += n >> 3;
+
+	int bits = 7 - (n & 7);
 
-	while (m != '\0' && bytes != 0) {
-		bytes--;
-		m++;
+	(*m) &= ~(1 << bits);
+	(*m) |= (value << bits);
+
+	return EXIT_SUCCESS;
+
+}
+
+/**
+ * @brief Reads 8 bytes of a message as a word ,the first byte being the most
+ *        significant byte of the word
+ *
+ * @param a pointer to the first of the 8 bytes to read
+ *
+ * @return the word read
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE qword loadWord(const byte* m) {
+	return ((qword) m[0] << 56) | ((qword) m[1] << 48) | ((qword) m[2] << 40)
+			| ((qword) m[3] << 32) | ((qword) m[4] << 24) | ((qword) m[5] << 16)
+			| ((qword) m[6] << 8) | (qword) m[7];
+}
+
+/**
+ * @brief Stores a word as 8 bytes of a message ,the most significant byte of
+ *        the word being the first byte
+ *
+ * @param a pointer to the first of the 8 bytes to write
+ *
+ * @param the word to store
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE void storeWord(byte* m, qword w) {
+	int i;
+	for (i = 7; i >= 0; i--) {
+		m[i] = (byte) w;
+		w >>= 8;
 	}
+}
 
-	if (bytes != 0)
+PUBLIC int embedBits(byte* samples, int bytesPerSample, const int* positions,
+		const byte* message, long numberOfBits) {
+	if (samples == NULL || positions == NULL || message == NULL
+			|| bytesPerSample <= 0 || numberOfBits < 0)
 		return EXIT_FAILURE;
 
-	int bits = 7 - (n - ((n >> 3) << 3));
+	// the least significant byte of the first single sample-channel block ,the
+	// samples are little endian so it is the first byte of a sample
+	byte* lsb = samples;
+	byte* sample = NULL;
+	qword w = 0;
+	long i = 0;
+	int b = 0;
+
+	// whole words of the message ,64 bits scattered per block
+	for (i = 0; i + 64 <= numberOfBits; i += 64) {
+		w = loadWord(message + (i >> 3));
+
+		for (b = 0; b < 64; b++) {
+			sample = lsb + (long) positions[i + b] * bytesPerSample;
+			*sample = (byte) ((*sample & ~1) | (int) (w >> 63));
+			w <<= 1;
+		}
+	}
 
-	(*m) &= ~(1 << bits);
-	(*m) |= (value << bits);
+	// the remaining bits which do not fill a whole word
+	for (; i < numberOfBits; i++) {
+		sample = lsb + (long) positions[i] * bytesPerSample;
+		*sample = (byte) ((*sample & ~1)
+				| ((message[i >> 3] >> (7 - (i & 7))) & 1));
+	}
+
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int extractBits(const byte* samples, int bytesPerSample,
+		const int* positions, byte* message, long numberOfBits) {
+	if (samples == NULL || positions == NULL || message == NULL
+			|| bytesPerSample <= 0 || numberOfBits < 0)
+		return EXIT_FAILURE;
+
+	const byte* lsb = samples;
+	qword w = 0;
+	long i = 0;
+	int b = 0;
+
+	// whole words of the message ,64 bits gathered per block
+	for (i = 0; i + 64 <= numberOfBits; i += 64) {
+		w = 0;
+
+		for (b = 0; b < 64; b++)
+			w = (w << 1) | (lsb[(long) positions[i + b] * bytesPerSample] & 1);
+
+		storeWord(message + (i >> 3), w);
+	}
+
+	// the remaining bits which do not fill a whole word
+	for (; i < numberOfBits; i++) {
+		if ((i & 7) == 0)
+			message[i >> 3] = 0;
+
+		message[i >> 3] |= (byte) ((lsb[(long) positions[i] * bytesPerSample]
+				& 1) << (7 - (i & 7)));
+	}
 
 	return EXIT_SUCCESS;
+}
+
 
+#ifdef __SSE2__
+/**
+ * @brief Splits every byte of a vector ,which keeps a value of 2s bits ,to
+ *        two bytes of s bits (the high bits first)
+ *
+ * @param the vector to split
+ *
+ * @param the number of bits of the new values
+ *
+ * @param a pointer to two vectors where the 32 new values are placed in order
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE void unfoldVector(__m128i v, int s, __m128i* out) {
+	__m128i mask = _mm_set1_epi8((char) ((1 << s) - 1));
+	__m128i high = _mm_and_si128(_mm_srl_epi16(v, _mm_cvtsi32_si128(s)), mask);
+	__m128i low = _mm_and_si128(v, mask);
+
+	out[0] = _mm_unpacklo_epi8(high, low);
+	out[1] = _mm_unpackhi_epi8(high, low);
+}
+
+/**
+ * @brief Joins every two bytes of two vectors ,which keep values of s bits ,to
+ *        one byte of 2s bits (the first byte giving the high bits)
+ *
+ * @param the vector with the first 16 values
+ *
+ * @param the vector with the next 16 values
+ *
+ * @param the number of bits of the values
+ *
+ * @return a vector with the 16 joined values in order
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE __m128i foldVectors(__m128i a, __m128i b, int s) {
+	__m128i lowByte = _mm_set1_epi16(0x00FF);
+	__m128i count = _mm_cvtsi32_si128(s);
+	__m128i eight = _mm_cvtsi32_si128(8);
+
+	a = _mm_or_si128(_mm_sll_epi16(_mm_and_si128(a, lowByte), count),
+			_mm_srl_epi16(a, eight));
+	b = _mm_or_si128(_mm_sll_epi16(_mm_and_si128(b, lowByte), count),
+			_mm_srl_epi16(b, eight));
+
+	return _mm_packus_epi16(a, b);
 }
+#endif
+
+PUBLIC long splitToSymbols(const byte* message, long numberOfBits, int k,
+		byte* symbols) {
+	if (message == NULL || symbols == NULL || numberOfBits < 0 || k < 1
+			|| k > MAX_PAYLOAD_BITS_PER_SAMPLE)
+		return -1;
+
+	long count = (numberOfBits + k - 1) / k;
+	long done = 0;
+	long bit = 0;
+	int mask = (1 << k) - 1;
+	int i = 0;
+
+#ifdef __SSE2__
+	// 16 bytes of the message give 128 / k symbols ,when k divides 8
+	if (k != 3) {
+		__m128i level[8];
+		int n = 0, s = 0;
+
+		for (; bit + 128 <= numberOfBits; bit += 128) {
+			level[0] = _mm_loadu_si128((const __m128i *) (message + (bit >> 3)));
+			n = 1;
 
-PUBLIC int* createPermutationFunction(int N, unsigned int systemkey) {
-	if (N <= 0)
-		return NULL;
+			for (s = 4; s >= k; s >>= 1) {
+				for (i = n - 1; i >= 0; i--)
+					unfoldVector(level[i], s, &level[i << 1]);
+				n <<= 1;
+			}
 
-	int* permutation = (int*) malloc(sizeof(int) * N);
+			for (i = 0; i < n; i++)
+				_mm_storeu_si128((__m128i *) (symbols + done + (i << 4)),
+						level[i]);
 
-	if (permutation == NULL)
-		return NULL;
+			done += 128 / k;
+		}
+	}
+#endif
+
+	// k bytes of the message give 8 symbols
+	for (; bit + (k << 3) <= numberOfBits; bit += k << 3) {
+		const byte* m = message + (bit >> 3);
+		dword w = 0;
+
+		for (i = 0; i < k; i++)
+			w = (w << 8) | m[i];
+
+		for (i = 0; i < 8; i++)
+			symbols[done++] = (byte) ((w >> (k * (7 - i))) & mask);
+	}
+
+	// the remaining bits ,the last symbol padded with zeros
+	for (; done < count; done++) {
+		int symbol = 0;
+
+		for (i = 0; i < k; i++, bit++) {
+			symbol <<= 1;
+
+			if (bit < numberOfBits)
+				symbol |= (message[bit >> 3] >> (7 - (bit & 7))) & 1;
+		}
+
+		symbols[done] = (byte) symbol;
+	}
+
+	return count;
+}
+
+PUBLIC int joinSymbols(const byte* symbols, long count, int k, byte* message) {
+	if (message == NULL || symbols == NULL || count < 0 || k < 1
+			|| k > MAX_PAYLOAD_BITS_PER_SAMPLE)
+		return EXIT_FAILURE;
 
+	long done = 0;
+	long bit = 0;
 	int i = 0;
 
-	for (i = 0; i < N; i++)
-		permutation[i] = i;
+#ifdef __SSE2__
+	// 128 / k symbols give 16 bytes of the message ,when k divides 8
+	if (k != 3) {
+		__m128i level[8];
+		int n = 0, s = 0;
+		long perVector = 128 / k;
+
+		for (; done + perVector <= count; done += perVector, bit += 128) {
+			n = 8 / k;
+
+			for (i = 0; i < n; i++)
+				level[i] = _mm_loadu_si128(
+						(const __m128i *) (symbols + done + (i << 4)));
+
+			for (s = k; s <= 4; s <<= 1) {
+				for (i = 0; i < (n >> 1); i++)
+					level[i] = foldVectors(level[i << 1], level[(i << 1) + 1],
+							s);
+				n >>= 1;
+			}
+
+			_mm_storeu_si128((__m128i *) (message + (bit >> 3)), level[0]);
+		}
+	}
+#endif
 
-	srand(systemkey);
+	// 8 symbols give k bytes of the message
+	for (; done + 8 <= count; done += 8, bit += k << 3) {
+		byte* m = message + (bit >> 3);
+		dword w = 0;
 
-	int a = 0, b = 0, temp = 0;
+		for (i = 0; i < 8; i++)
+			w = (w << k) | (symbols[done + i] & ((1 << k) - 1));
 
-	for (i = 0; i < N; i++) {
-		a = rand() % N;
-		b = rand() % N;
+		for (i = k - 1; i >= 0; i--) {
+			m[i] = (byte) w;
+			w >>= 8;
+		}
+	}
 
-		temp = permutation[a];
-		permutation[a] = permutation[b];
-		permutation[b] = temp;
+	// the remaining symbols
+	if (done < count)
+		memset(message + (bit >> 3), 0, (((count - done) * k) + 7) >> 3);
 
+	for (; done < count; done++) {
+		for (i = k - 1; i >= 0; i--, bit++)
+			message[bit >> 3] |= (byte) (((symbols[done] >> i) & 1)
+					<< (7 - (bit & 7)));
 	}
 
-	return permutation;
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int embedSymbols(byte* samples, int bytesPerSample, const int* positions,
+		const byte* symbols, long count, int k) {
+	if (samples == NULL || positions == NULL || symbols == NULL
+			|| bytesPerSample <= 0 || count < 0 || k < 1
+			|| k > MAX_PAYLOAD_BITS_PER_SAMPLE)
+		return EXIT_FAILURE;
+
+	byte* lsb = samples;
+	byte* sample = NULL;
+	byte keep = (byte) ~((1 << k) - 1);
+	long i = 0;
+
+	// mask out the k least significant bits and merge the symbol in
+	for (i = 0; i < count; i++) {
+		sample = lsb + (long) positions[i] * bytesPerSample;
+		*sample = (byte) ((*sample & keep) | symbols[i]);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int extractSymbols(const byte* samples, int bytesPerSample,
+		const int* positions, byte* symbols, long count, int k) {
+	if (samples == NULL || positions == NULL || symbols == NULL
+			|| bytesPerSample <= 0 || count < 0 || k < 1
+			|| k > MAX_PAYLOAD_BITS_PER_SAMPLE)
+		return EXIT_FAILURE;
+
+	const byte* lsb = samples;
+	byte mask = (byte) ((1 << k) - 1);
+	long i = 0;
+
+	for (i = 0; i < count; i++)
+		symbols[i] = lsb[(long) positions[i] * bytesPerSample] & mask;
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Mixes the bits of an integer (the finalizer of MurmurHash3)
+ *
+ * @param the integer to mix
+ *
+ * @return the mixed integer
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE dword mixBits(dword x) {
+	x ^= x >> 16;
+	x *= 0x85EBCA6BU;
+	x ^= x >> 13;
+	x *= 0xC2B2AE35U;
+	x ^= x >> 16;
+	return x;
+}
+
+/**
+ * @brief Finds the number of bits of a half of the Feistel network which
+ *        covers a domain
+ *
+ * @param the domain of the permutation
+ *
+ * @return the smallest number of bits h for which 2^(2h) >= domain
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE int feistelHalfBits(long domain) {
+	int halfBits = 1;
+
+	while (((qword) 1 << (halfBits << 1)) < (qword) domain)
+		halfBits++;
+
+	return halfBits;
+}
+
+/**
+ * @brief Maps an index of the domain to a position of the domain with a
+ *        keyed Feistel network ,walking the cycle until the result falls
+ *        inside the domain
+ *
+ * @param the index to map (0 <= index < domain)
+ *
+ * @param the domain of the permutation
+ *
+ * @param the number of bits of a half of the network
+ *
+ * @param the secret key of the permutation
+ *
+ * @return the position in the domain
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE long feistelPermute(long index, long domain, int halfBits,
+		unsigned int systemkey) {
+	dword mask = (dword) (((qword) 1 << halfBits) - 1);
+	dword roundKey = systemkey * 0x9E3779B9U;
+	dword left = 0, right = 0, temp = 0;
+	qword x = (qword) index;
+	int r = 0;
+
+	do {
+		left = (dword) (x >> halfBits) & mask;
+		right = (dword) x & mask;
+
+		for (r = 0; r < FEISTEL_ROUNDS; r++) {
+			temp = right;
+			right = left
+					^ (mixBits(right ^ roundKey ^ ((dword) (r + 1) * 0x632BE5ABU))
+							& mask);
+			left = temp;
+		}
+
+		x = ((qword) left << halfBits) | right;
+	} while (x >= (qword) domain);
+
+	return (long) x;
+}
+
+PUBLIC long keyedPosition(long index, long domain, unsigned int systemkey) {
+	if (domain <= 0 || index < 0 || index >= domain)
+		return -1;
+
+	return feistelPermute(index, domain, feistelHalfBits(domain), systemkey);
+}
+
+PUBLIC int createPositionSchedule(int* positions, long first, long count,
+		long domain, unsigned int systemkey) {
+	if (positions == NULL || first < 0 || count < 0 || domain <= 0
+			|| first + count > domain)
+		return EXIT_FAILURE;
+
+	int halfBits = feistelHalfBits(domain);
+	long i = 0;
+
+	for (i = 0; i < count; i++)
+		positions[i] = (int) feistelPermute(first + i, domain, halfBits,
+				systemkey);
+
+	return EXIT_SUCCESS;
 }
 
+PUBLIC dword crc32Update(dword crc, const byte* data, size_t length) {
+	if (data == NULL)
+		return crc;
+
+	crc = ~crc;
+
+	while (length-- > 0)
+		crc = CRC32_TABLE[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+PUBLIC void encodePayloadHeader(byte* buffer, dword length, dword crc,
+		byte flags) {
+	if (buffer == NULL)
+		return;
+
+	buffer[0] = (byte) PAYLOAD_MAGIC[0];
+	buffer[1] = (byte) PAYLOAD_MAGIC[1];
+	buffer[2] = PAYLOAD_VERSION;
+	buffer[3] = flags;
+
+	int i = 0;
+	for (i = 0; i < 4; i++) {
+		buffer[4 + i] = (byte) (length >> (24 - (i << 3)));
+		buffer[8 + i] = (byte) (crc >> (24 - (i << 3)));
+	}
+}
+
+PUBLIC int decodePayloadHeader(const byte* buffer, dword* length, dword* crc,
+		byte* flags) {
+	if (buffer == NULL || length == NULL || crc == NULL || flags == NULL)
+		return EXIT_FAILURE;
+
+	if (buffer[0] != (byte) PAYLOAD_MAGIC[0]
+			|| buffer[1] != (byte) PAYLOAD_MAGIC[1]
+			|| buffer[2] != PAYLOAD_VERSION)
+		return EXIT_FAILURE;
+
+	*flags = buffer[3];
+	*length = 0;
+	*crc = 0;
+
+	int i = 0;
+	for (i = 0; i < 4; i++) {
+		*length = (*length << 8) | buffer[4 + i];
+		*crc = (*crc << 8) | buffer[8 + i];
+	}
+
+	return EXIT_SUCCESS;
+}
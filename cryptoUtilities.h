@@ -25,6 +25,23 @@
 #define CRYPTO_UTILITIES_H
 #include "utilities.h"
 
+// The secret system key of the encoding
+#define SYSTEM_KEY_INTEGER 8U
+
+// The header hidden in front of every payload : a magic number ,a version ,a
+// byte of flags ,the length of the payload and its CRC-32 (big endian fields)
+#define PAYLOAD_MAGIC "WE"
+// (version 2 hides the bits in the first ,least significant ,byte of a sample)
+#define PAYLOAD_VERSION 2
+#define PAYLOAD_HEADER_BYTES 12
+#define PAYLOAD_HEADER_BITS (PAYLOAD_HEADER_BYTES << 3)
+
+// The low bits of the flags of the header keep the number of least significant
+// bits per sample used for the payload minus one (the header itself always
+// uses one bit per sample)
+#define PAYLOAD_FLAG_BITS_MASK 0x03
+#define MAX_PAYLOAD_BITS_PER_SAMPLE 4
+
 
 /**
  * @brief Returns the n-th bit of a sequence of bytes-characters
@@ -49,29 +66,6 @@
 PUBLIC int getBit(char* m,int n);
 
 
-/**
- * @brief Returns a pointer to a sequence of integers which indicate randomly 
- *       places to put the bits of a message
- *
- * This method takes an integer number for sum bits to hide and a system key
- * for encoding and creates a random array ,which contains for N different 
- *  bits(as indicated by parameter N) the he positions of single sample-channel
- *  blocks where the bits of a message will be hidden in
- * @param an integer number indicating the number of bits to place in a WAV file
- * 
- * @param an integer number which can be recognised as the secret key , on which
- *       the array given will be build based with
- *
- *
- * @return a pointer to a sequence of integers which are the positions of 
- *        single sample-channel blocks where the bits of a message will be 
- *        hidden in , or a NULL if the array hasn't been created
- *
- * @author Valentinos Pariza
- */
-PUBLIC int* createPermutationFunction(int N,unsigned int systemkey);
-
-
 /**
  * @brief Sets the n-th bit of a sequence of bytes-characters
  *
@@ -95,4 +89,292 @@ PUBLIC int* createPermutationFunction(int N,unsigned int systemkey);
  */
 PUBLIC int setBit(char* m,int n,int value);
 
+
+/**
+ * @brief Hides a sequence of bits of a message in the least significant bits
+ *        of the samples indicated by an array of positions
+ *
+ * This method takes a sequence of bytes (a message) and hides its first
+ * numberOfBits bits ,starting from the most significant bit of the first byte,
+ * in the least significant bit of the least significant byte of the single
+ * sample-channel blocks indicated by the array of positions. The i-th bit of
+ * the message is hidden in the sample positions[i]. The message is read a word
+ * (8 bytes) at a time and the bits of every word are scattered in a block to
+ * the samples ,so the cost is linear to the number of bits to hide.
+ *
+ * @param a pointer to the data of a soundtrack (sequence of samples)
+ *
+ * @param an integer which is the number of bytes of a single sample-channel block
+ *
+ * @param a pointer to a sequence of integers which are the positions of the
+ *        single sample-channel blocks where the bits will be hidden in
+ *
+ * @param a pointer to a sequence of bytes which is the message to hide
+ *
+ * @param the number of bits of the message to hide
+ *
+ * @return EXIT_SUCCESS if the bits were hidden succesfully or EXIT_FAILURE
+ *         if there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC int embedBits(byte* samples, int bytesPerSample, const int* positions,
+		const byte* message, long numberOfBits);
+
+
+/**
+ * @brief Gathers a sequence of bits of a message from the least significant
+ *        bits of the samples indicated by an array of positions
+ *
+ * This method is the reverse of @see embedBits(byte*, int, const int*,
+ * const byte*, long). It takes the least significant bit of the least
+ * significant byte of every single sample-channel block indicated by the array
+ * of positions and places it as the i-th bit of the message ,starting from the
+ * most significant bit of the first byte. The bits are gathered in a word (8
+ * bytes) which is stored to the message at once.
+ *
+ * @param a pointer to the data of a soundtrack (sequence of samples)
+ *
+ * @param an integer which is the number of bytes of a single sample-channel block
+ *
+ * @param a pointer to a sequence of integers which are the positions of the
+ *        single sample-channel blocks where the bits are hidden in
+ *
+ * @param a pointer to a sequence of bytes ,big enough to store numberOfBits
+ *        bits ,where the message will be placed
+ *
+ * @param the number of bits of the message to gather
+ *
+ * @return EXIT_SUCCESS if the bits were gathered succesfully or EXIT_FAILURE
+ *         if there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC int extractBits(const byte* samples, int bytesPerSample,
+		const int* positions, byte* message, long numberOfBits);
+
+
+/**
+ * @brief Splits the bits of a message to symbols of k bits
+ *
+ * This method takes a sequence of bytes (a message) and splits its first
+ * numberOfBits bits ,starting from the most significant bit of the first byte,
+ * to symbols of k bits ,one symbol per byte. The first bit of a symbol is its
+ * most significant bit .If the number of bits is not a multiple of k the last
+ * symbol is padded with zeros. For k equal to 1 ,2 or 4 the splitting is done
+ * 16 bytes at a time with SSE2 when it is available.
+ *
+ * @param a pointer to a sequence of bytes which is the message
+ *
+ * @param the number of bits of the message to split
+ *
+ * @param the number of bits of a symbol (1 to MAX_PAYLOAD_BITS_PER_SAMPLE)
+ *
+ * @param a pointer to a sequence of bytes where the symbols are placed. It must
+ *        be big enough for (numberOfBits + k - 1) / k symbols
+ *
+ * @return the number of symbols created or -1 if there was a problem
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC long splitToSymbols(const byte* message, long numberOfBits, int k,
+		byte* symbols);
+
+
+/**
+ * @brief Joins symbols of k bits to the bits of a message
+ *
+ * This method is the reverse of @see splitToSymbols(const byte*,long,int,byte*)
+ * .It places the k low bits of every symbol one after the other in the message
+ * ,starting from the most significant bit of the first byte. The bits of the
+ * last byte which are not covered by a symbol are zero.
+ *
+ * @param a pointer to a sequence of symbols ,one per byte
+ *
+ * @param the number of symbols
+ *
+ * @param the number of bits of a symbol (1 to MAX_PAYLOAD_BITS_PER_SAMPLE)
+ *
+ * @param a pointer to a sequence of bytes ,big enough for count * k bits
+ *        ,where the message is placed
+ *
+ * @return EXIT_SUCCESS if the symbols were joined succesfully or EXIT_FAILURE
+ *         if there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC int joinSymbols(const byte* symbols, long count, int k, byte* message);
+
+
+/**
+ * @brief Hides symbols of k bits in the k least significant bits of the
+ *        samples indicated by an array of positions
+ *
+ * The i-th symbol replaces the k least significant bits of the least
+ * significant byte of the single sample-channel block positions[i] ,by
+ * masking out these bits and merging the symbol in.
+ *
+ * @param a pointer to the data of a soundtrack (sequence of samples)
+ *
+ * @param an integer which is the number of bytes of a single sample-channel block
+ *
+ * @param a pointer to a sequence of integers which are the positions of the
+ *        single sample-channel blocks where the symbols will be hidden in
+ *
+ * @param a pointer to a sequence of symbols ,one per byte
+ *
+ * @param the number of symbols
+ *
+ * @param the number of bits of a symbol (1 to MAX_PAYLOAD_BITS_PER_SAMPLE)
+ *
+ * @return EXIT_SUCCESS if the symbols were hidden succesfully or EXIT_FAILURE
+ *         if there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC int embedSymbols(byte* samples, int bytesPerSample, const int* positions,
+		const byte* symbols, long count, int k);
+
+
+/**
+ * @brief Gathers symbols of k bits from the k least significant bits of the
+ *        samples indicated by an array of positions
+ *
+ * This method is the reverse of @see embedSymbols(byte*,int,const int*,
+ * const byte*,long,int).
+ *
+ * @param a pointer to the data of a soundtrack (sequence of samples)
+ *
+ * @param an integer which is the number of bytes of a single sample-channel block
+ *
+ * @param a pointer to a sequence of integers which are the positions of the
+ *        single sample-channel blocks where the symbols are hidden in
+ *
+ * @param a pointer to a sequence of bytes where the symbols are placed
+ *
+ * @param the number of symbols
+ *
+ * @param the number of bits of a symbol (1 to MAX_PAYLOAD_BITS_PER_SAMPLE)
+ *
+ * @return EXIT_SUCCESS if the symbols were gathered succesfully or EXIT_FAILURE
+ *         if there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC int extractSymbols(const byte* samples, int bytesPerSample,
+		const int* positions, byte* symbols, long count, int k);
+
+
+/**
+ * @brief Returns the position of the sample-channel block where the n-th bit
+ *        of a message is hidden
+ *
+ * This method is a keyed permutation of the numbers [0, domain) .It maps the
+ * index of a bit of a message to the position of a single sample-channel block
+ * of a soundtrack with domain blocks. Different indexes are mapped to
+ * different positions and the position of a bit doesn't depend on the length
+ * of the message, so a reader can locate the header of a message without
+ * knowing its length.
+ * The permutation is a Feistel network over the smallest even power of two
+ * which covers the domain ,walking the cycle until a position inside the
+ * domain is found.
+ *
+ * @param the index of the bit of the message (0 <= index < domain)
+ *
+ * @param the number of single sample-channel blocks of the soundtrack
+ *
+ * @param the secret key of the permutation
+ *
+ * @return the position of the sample-channel block or -1 if the index is out
+ *         of the domain
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC long keyedPosition(long index, long domain, unsigned int systemkey);
+
+
+/**
+ * @brief Fills an array with the positions of a range of bits of a message
+ *
+ * This method places in positions[i] the position returned by
+ * @see keyedPosition(long,long,unsigned int) for the bit first + i of a
+ * message ,for every i in [0, count). It is used for building the positions
+ * of a message block by block.
+ *
+ * @param a pointer to a sequence of at least count integers
+ *
+ * @param the index of the first bit of the range
+ *
+ * @param the number of bits of the range
+ *
+ * @param the number of single sample-channel blocks of the soundtrack
+ *
+ * @param the secret key of the permutation
+ *
+ * @return EXIT_SUCCESS if the positions were created succesfully or
+ *         EXIT_FAILURE if the range doesn't fit in the domain
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC int createPositionSchedule(int* positions, long first, long count,
+		long domain, unsigned int systemkey);
+
+
+/**
+ * @brief Updates the CRC-32 of a sequence of bytes with some more bytes
+ *
+ * The CRC is the one of zlib and PNG (polynomial 0xEDB88320) .Start with a
+ * crc equal to 0 and pass the result of every call to the next one.
+ *
+ * @param the CRC-32 of the bytes processed until now
+ *
+ * @param a pointer to the new bytes
+ *
+ * @param the number of the new bytes
+ *
+ * @return the CRC-32 of all the bytes processed
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC dword crc32Update(dword crc, const byte* data, size_t length);
+
+
+/**
+ * @brief Writes the header of a payload in a sequence of PAYLOAD_HEADER_BYTES
+ *        bytes
+ *
+ * @param a pointer to a sequence of PAYLOAD_HEADER_BYTES bytes
+ *
+ * @param the length of the payload in bytes
+ *
+ * @param the CRC-32 of the payload
+ *
+ * @param the flags of the payload
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC void encodePayloadHeader(byte* buffer, dword length, dword crc,
+		byte flags);
+
+
+/**
+ * @brief Reads the header of a payload from a sequence of PAYLOAD_HEADER_BYTES
+ *        bytes
+ *
+ * @param a pointer to a sequence of PAYLOAD_HEADER_BYTES bytes
+ *
+ * @param a pointer to a variable where the length of the payload is placed
+ *
+ * @param a pointer to a variable where the CRC-32 of the payload is placed
+ *
+ * @param a pointer to a variable where the flags of the payload are placed
+ *
+ * @return EXIT_SUCCESS if the bytes are a header of a payload or EXIT_FAILURE
+ *         if the magic number or the version are not the expected ones
+ *
+ * @author Valentinos Pariza
+ */
+PUBLIC int decodePayloadHeader(const byte* buffer, dword* length, dword* crc,
+		byte* flags);
+
 #endif
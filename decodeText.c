@@ -21,153 +21,146 @@
 #include "utilities.h"
 #include "cryptoUtilities.h"
 
-// The secret system key of the encoding
-PRIVATE const unsigned int SYSTEM_KEY_INTEGER = 8;
-
-
-PRIVATE int writeMessageToTextFile(char* filename, char* message);
+// The number of bytes of the payload extracted and written at a time (a
+// multiple of 3 so that every block is made of whole symbols)
+#define PAYLOAD_BLOCK_BYTES (3 * 4096)
 
 /**
- * @brief This method decodes a message from a soundtrack 
- *
- * This method takes an integer which is the length of the string to
- * decode ,a pointer struct of type WAV from where to derive the encoded message
- * and also a pointer to a variable where the method places the decoded message
- * .It takes the struct WAV and derives the message from it ,with an algorithm
- * for decoding ,based on a secret key (which is encapsulated inside the code).
+ * @brief This method decodes a payload from a soundtrack and writes it to a file
  *
+ * This method takes a pointer to a struct of type WAV from where to derive the
+ * encoded payload and an opened file where the payload is written .It first
+ * extracts the header hidden by encodeText ,which contains the length of the
+ * payload ,its CRC-32 and the number of bits per sample used ,and then
+ * extracts ,block by block ,exactly length bytes ,writing every block to the
+ * file. The positions of the bits are found
+ * with a keyed permutation based on a secret key (which is encapsulated inside
+ * the code).
  *
- * @param a pointer to a struct of type WAV ,which contains the encode message
  *
- * @param an integer which is the length of the string to be decoded from the
- *        sound tract ,without including the NUL (='\0') character
+ * @param a pointer to a struct of type WAV ,which contains the encoded payload
  *
- * @param a pointer a variable which variable can store a pointer to characters
- *        in memory. There the address of the decocded message will be placed.
+ * @param a pointer to the opened file where the payload is written
  *
  * @return EXIT_SUCCESS if the decoding was executed successfully or EXIT_FAILURE if
- *         there was a problem during the execution of the method
+ *         there was a problem during the execution of the method (no header
+ *         was found or the CRC-32 of the payload is not the one of the header)
  *
  * @author Valentinos Pariza
  */
-PRIVATE int decodeTextFromWav(WAV* track, int length, char** decodedText);
+PRIVATE int decodePayloadFromWav(WAV* track, FILE* output);
 
 
-PUBLIC int decodeText(char* fileName, int length,char* outputFile) {
-	if (fileName == NULL || length < 0 || outputFile==NULL)
+PUBLIC int decodeText(char* fileName, char* outputFile) {
+	if (fileName == NULL || outputFile==NULL)
 		return EXIT_FAILURE;
 
-	char* decodedText = NULL;
 	WAV* wav = NULL;
 
 	if (readWAV(fileName, &wav) == EXIT_FAILURE)
 		return EXIT_FAILURE;
 
-	// Plus one for the NUL character
-	if (decodeTextFromWav(wav, length, &decodedText) == EXIT_FAILURE) {
-		deleteWAV(&wav);
-
-		return EXIT_FAILURE;
-	}
-
-
-	if (writeMessageToTextFile(outputFile, decodedText) == EXIT_FAILURE) {
-
-      if(decodedText!=NULL)
-         free(decodedText);
+	FILE* output = fopen(outputFile, "wb");
 
+	if (output == NULL) {
 		deleteWAV(&wav);
 		return EXIT_FAILURE;
 	}
 
-	deleteWAV(&wav);
+	int result = decodePayloadFromWav(wav, output);
 
-   if(decodedText!=NULL)
-     free(decodedText);
-
-	return EXIT_SUCCESS;
-}
+	if (fclose(output) != 0)
+		result = EXIT_FAILURE;
 
+	// the blocks are written before the CRC-32 is checked ,so a corrupted
+	// message must not stay behind
+	if (result == EXIT_FAILURE)
+		remove(outputFile);
 
-/**
- * @brief This method writes a message/text to a text file
- *
- * This method takes the file name of a text file and a text/message (pointer
- * to a sequence of characters) and writes this text to the file given.
- *
- *
- * @param a pointer to characters which is the name of a text file
- *
- * @param a pointer to characters which is the message to write in a text file
- *
- *
- * @return EXIT_SUCCESS if the writing was executed successfully or EXIT_FAILURE 
- *         if there was a problem during the execution of the method
- *
- * @author Valentinos Pariza
- */
-PRIVATE int writeMessageToTextFile(char* fileName, char* message) {
-	if (fileName == NULL || message == NULL)
-		return EXIT_FAILURE;
-
-	FILE* filePointer = fopen(fileName, "w");
-
-	if (filePointer == NULL)
-		return EXIT_FAILURE;
-
-	fprintf(filePointer, "%s", message);
-
-	fclose(filePointer);
+	deleteWAV(&wav);
 
-	return EXIT_SUCCESS;
+	return result;
 }
 
 
-PRIVATE int decodeTextFromWav(WAV* track, int length, char** decodedText) 
+PRIVATE int decodePayloadFromWav(WAV* track, FILE* output)
 {
-	if (length < 0 || decodedText == NULL)
+	if (output == NULL)
 		return EXIT_FAILURE;
 
 	if (!isCorrectFormatWAV(track))
 		return EXIT_FAILURE;
 
-   length+=2;
-
-	if ((unsigned int)length> ((track->header->Subchunk2Size) << 3)/ (track->header->BitsPerSample))
-		return EXIT_FAILURE;
-
-
-	int bits = length << 3;
+	int bytesPerSample = ((track->header->BitsPerSample) >> 3);
 
-	int* permutation = createPermutationFunction(bits, SYSTEM_KEY_INTEGER);
+	// the number of single channel blocks-samples ,one bit hidden in each
+	long domain = (track->header->Subchunk2Size) / bytesPerSample;
 
-	if (permutation == NULL)
+	if (domain < PAYLOAD_HEADER_BITS)
 		return EXIT_FAILURE;
 
-	*decodedText = (char*) malloc(sizeof(char) * (length));
+	// one more byte for the padding of the last symbol
+	byte* block = (byte*) malloc(PAYLOAD_BLOCK_BYTES + 1);
+	byte* symbols = (byte*) malloc(PAYLOAD_BLOCK_BYTES << 3);
+	int* positions = (int*) malloc(sizeof(int) * (PAYLOAD_BLOCK_BYTES << 3));
 
-	if (*decodedText == NULL) {
-		free(permutation);
+	if (block == NULL || symbols == NULL || positions == NULL) {
+		free(block);
+		free(symbols);
+		free(positions);
 		return EXIT_FAILURE;
+	}
 
+	dword length = 0, crc = 0;
+	byte flags = 0;
+	int k = 0;
+
+	// The header first ,which tells where the payload ends
+	if (createPositionSchedule(positions, 0, PAYLOAD_HEADER_BITS, domain,
+			SYSTEM_KEY_INTEGER) == EXIT_FAILURE
+			|| extractBits(track->data->channel, bytesPerSample, positions,
+					block, PAYLOAD_HEADER_BITS) == EXIT_FAILURE
+			|| decodePayloadHeader(block, &length, &crc, &flags) == EXIT_FAILURE
+			|| (k = (flags & PAYLOAD_FLAG_BITS_MASK) + 1) > (bytesPerSample << 3)
+			|| PAYLOAD_HEADER_BITS + (((long) length << 3) + k - 1) / k > domain) {
+		free(block);
+		free(symbols);
+		free(positions);
+		return EXIT_FAILURE;
 	}
 
-	int bytesPerSample = ((track->header->BitsPerSample) >> 3);
-	int value = 0;
-   int i=0;
+	long done = 0, bytes = 0, count = 0;
+	dword actualCrc = 0;
+	int result = EXIT_SUCCESS;
+
+	while (result == EXIT_SUCCESS && done < (long) length) {
+		bytes = (long) length - done;
 
-	for (i = 0; i < bits; i++) {
+		if (bytes > PAYLOAD_BLOCK_BYTES)
+			bytes = PAYLOAD_BLOCK_BYTES;
 
-		// Find the LSB of the single smaple(left or right)
-		value = track->data->channel[(permutation[i] + 1) * bytesPerSample - 1]& 1;
-		// value=track->data->channel[permutation[i]]&1;
+		count = ((bytes << 3) + k - 1) / k;
 
-		setBit(*decodedText, i, value);
+		if (createPositionSchedule(positions,
+		PAYLOAD_HEADER_BITS + (done << 3) / k, count, domain,
+				SYSTEM_KEY_INTEGER) == EXIT_FAILURE
+				|| extractSymbols(track->data->channel, bytesPerSample,
+						positions, symbols, count, k) == EXIT_FAILURE
+				|| joinSymbols(symbols, count, k, block) == EXIT_FAILURE
+				|| fwrite(block, sizeof(byte), bytes, output) != (size_t) bytes)
+			result = EXIT_FAILURE;
 
+		actualCrc = crc32Update(actualCrc, block, bytes);
+		done += bytes;
 	}
 
-   free(permutation);
-	return EXIT_SUCCESS;
+	if (actualCrc != crc)
+		result = EXIT_FAILURE;
+
+	free(block);
+	free(symbols);
+	free(positions);
+	return result;
 
 }
 
@@ -219,7 +212,6 @@ int main(int argc,char* argv[])
    char*line=NULL;
    char* fileName=NULL;
    char* textFileName=NULL;  
-   int length=0;   
 
    
 
@@ -232,14 +224,6 @@ int main(int argc,char* argv[])
 
 
 
-   printf("Give the length of the message to read : \n");
-   do{      
-      getline(&textFileName,&bytes,stdin);
-      cutStringAtFirstNewLineCharacter(textFileName);
-      length=atoi(textFileName);
-     }
-    while(length<=0);
-   
 	 printf("Give the name of the textfile ,to write there the decoded message : \n");
      do{
          getline(&textFileName,&bytes,stdin);
@@ -248,7 +232,7 @@ int main(int argc,char* argv[])
       }while(bytes<=0);
 	
    
-   if(decodeText(fileName,length,textFileName)==EXIT_FAILURE)	
+   if(decodeText(fileName,textFileName)==EXIT_FAILURE)	
    {
       printf("One of the files couldn't be opened or there was a problem during" 
       " decoding of the message ! \n");
@@ -24,144 +24,75 @@
 #include "cryptoUtilities.h"
 #include "wavelib.h"
 
-static const unsigned int SYSTEM_KEY_INTEGER = 8;
+// The number of bytes of the payload read and hidden at a time (a multiple of
+// 3 so that every block is split to whole symbols for any bits per sample)
+#define PAYLOAD_BLOCK_BYTES (3 * 4096)
 
 /**
- * @brief This method encodes a message in soundtrack(struct of type WAV)
+ * @brief This method encodes a payload in soundtrack(struct of type WAV)
  *
- * This method takes a pointer to a struct of type WAV and a pointer to a 
- * sequence of characters(pointer to characters) which indicates the content 
- * of the message.After these the message is encrypted inside the soundtrack 
- * based on an algorithm and also on a secret key ,which key is encapsulated 
- * inside the file encodedText.c . 
+ * This method takes a pointer to a struct of type WAV and a file from where
+ * the payload (any sequence of bytes) is read. The payload is read and hidden
+ * block by block ,so it is never stored whole in memory. Every bit of the
+ * payload is split to symbols of k bits and every symbol is hidden in the k
+ * least significant bits of a sample chosen by a keyed permutation based on a
+ * secret key. In front of the payload a header with its length ,its CRC-32 and
+ * the number k is hidden (one bit per sample) ,which is written after the whole
+ * payload has been read .A decoder finds the length and k from the header and
+ * doesn't need to know them in advance.
  *
  * @param a pointer to a struct of type WAV which is used to hide-encode inside
- *        a message
+ *        a payload
  *
- * @param a pointer to a sequence of characters that is the message to encode in
- *        the data of the struct of type WAV
+ * @param a pointer to the opened file from where the payload is read
  *
+ * @param the number of least significant bits of a sample used for the payload
+ *        (1 to MAX_PAYLOAD_BITS_PER_SAMPLE)
  *
- * @return EXIT_SUCCESSif the encoding was executed succesfully or EXIT_FAILURE if
- *         there was a problem during the execution of the method
- *
- * @author Valentinos Pariza
- */
-PRIVATE int encodeTextWav(WAV* track, char* text);
-
-
-/**
- * @brief This method reads a text from a text file
- *
- * This method takes the name of a text file and reads from it the text that is
- * contained in that text file. It places the text read to a place in memory
- * which address is passed as an argument.
  *
- * @param a name of a text file from it the message will be read
- * 
- * @param a pointer to a variable which stores a pointer to a sequence of
- *         characters that is the message to be read from a text(placed there
- *         after reading it from the file )
- *
- *
- * @return EXIT_SUCCESS if the reading was executed succesfully or EXIT_FAILURE 
- *         if there was a problem during the execution of the method
+ * @return EXIT_SUCCESSif the encoding was executed succesfully or EXIT_FAILURE if
+ *         there was a problem during the execution of the method (for example
+ *         the payload doesn't fit in the soundtrack)
  *
  * @author Valentinos Pariza
  */
-PRIVATE int readText(char* fileName, char** message);
-
-PRIVATE int readText(char* fileName, char** message) {
-
-	if (fileName == NULL || message == NULL)
-		return EXIT_FAILURE;
-
-	FILE* filePointer = fopen(fileName, "r");
-
-	if (filePointer == NULL)
-		return EXIT_FAILURE;
-
-	char line[CHARACTERS_PER_LINE];
-	(*message) = (char*) malloc(sizeof(char) * CHARACTERS_PER_LINE);
-
-	if ((*message) == NULL)
-		return EXIT_FAILURE;
-
-	int size = 1;
-
-	int maxSize = CHARACTERS_PER_LINE;
-	char* temp = NULL;
-
-	strcpy(*message, "\0");
-
-	while (fgets(line, CHARACTERS_PER_LINE, filePointer) != NULL) {
-
-		int length = strlen(line);
-
-		if (size + length >= maxSize) {
-
-			maxSize *= 2;
-			temp = realloc((*message), maxSize * sizeof(char));
-
-			if (temp == NULL) {
-				free((*message));
-				(*message) = NULL;
-				return EXIT_FAILURE;
-			}
-
-			(*message) = temp;
-
-		}
-
-		strcat(*message, line);
-		size += length;
-	}
-
-	temp = realloc(*message, size);
-
-	if (temp == NULL) {
-		free((*message));
-		(*message) = NULL;
-		return EXIT_FAILURE;
-	}
-
-	(*message) = temp;
-
-	fclose(filePointer);
-
-	return EXIT_SUCCESS;
+PRIVATE int encodePayloadWav(WAV* track, FILE* payload, int bitsPerSample);
 
+PUBLIC int encodeText(char* fileName, char* textFile) {
+	return encodeTextBits(fileName, textFile, 1);
 }
 
-PUBLIC int encodeText(char* fileName, char* textFile) {
-	if (fileName == NULL || textFile == NULL)
+PUBLIC int encodeTextBits(char* fileName, char* textFile, int bitsPerSample) {
+	if (fileName == NULL || textFile == NULL || bitsPerSample < 1
+			|| bitsPerSample > MAX_PAYLOAD_BITS_PER_SAMPLE)
 		return EXIT_FAILURE;
 
-	char* message = NULL;
+	FILE* payload = fopen(textFile, "rb");
 
-	if (readText(textFile, &message) == EXIT_FAILURE)
+	if (payload == NULL)
 		return EXIT_FAILURE;
 
 	WAV* wav = NULL;
 
 	if (readWAV(fileName, &wav) == EXIT_FAILURE) {
-		free(message);
+		fclose(payload);
 		return EXIT_FAILURE;
 	}
 
-	if (encodeTextWav(wav, message) == EXIT_FAILURE) {
+	if (encodePayloadWav(wav, payload, bitsPerSample) == EXIT_FAILURE) {
 		deleteWAV(&wav);
-		free(message);
+		fclose(payload);
 
 		return EXIT_FAILURE;
 	}
 
+	fclose(payload);
+
 	char* encryptedFileName = NULL;
 
 	if (createOutputFilename(fileName, "new-",
 			&encryptedFileName)==EXIT_FAILURE) {
 		deleteWAV(&wav);
-		free(message);
 
 		return EXIT_FAILURE;
 	}
@@ -169,59 +100,97 @@ PUBLIC int encodeText(char* fileName, char* textFile) {
 	if (writeWAV(encryptedFileName, wav) == EXIT_FAILURE) {
 		free(encryptedFileName);
 		deleteWAV(&wav);
-		free(message);
 
 		return EXIT_FAILURE;
 	}
 
+	printOutput("Success :  %s\t(Created)\n", encryptedFileName);
+
 	free(encryptedFileName);
 	deleteWAV(&wav);
-	free(message);
 
-	printf("Success :  %s\t(Created)\n", encryptedFileName);
 	return EXIT_SUCCESS;
 
 }
 
-PRIVATE int encodeTextWav(WAV* track, char* text) {
-	if (track == NULL || text == NULL || track->header == NULL
+PRIVATE int encodePayloadWav(WAV* track, FILE* payload, int bitsPerSample) {
+	if (track == NULL || payload == NULL || track->header == NULL
 			|| track->data == NULL)
 		return EXIT_FAILURE;
 
 	if (!isCorrectFormatWAV(track))
 		return EXIT_FAILURE;
 
-	int numberOfBitsText = (strlen(text) + 1) << 3;
-
 	int bytesPerSample = ((track->header->BitsPerSample) >> 3);
 
-	if ((unsigned int)numberOfBitsText > ((track->header->Subchunk2Size) / (unsigned int)bytesPerSample))
+	// the number of single channel blocks-samples ,one symbol hidden in each
+	long domain = (track->header->Subchunk2Size) / bytesPerSample;
+
+	if (domain < PAYLOAD_HEADER_BITS)
 		return EXIT_FAILURE;
 
-	int* permutation = createPermutationFunction(numberOfBitsText,
-			SYSTEM_KEY_INTEGER);
+	byte* block = (byte*) malloc(PAYLOAD_BLOCK_BYTES);
+	byte* symbols = (byte*) malloc(PAYLOAD_BLOCK_BYTES << 3);
+	int* positions = (int*) malloc(sizeof(int) * (PAYLOAD_BLOCK_BYTES << 3));
 
-	if (permutation == NULL)
+	if (block == NULL || symbols == NULL || positions == NULL) {
+		free(block);
+		free(symbols);
+		free(positions);
 		return EXIT_FAILURE;
+	}
+
+	long length = 0;
+	long count = 0;
+	dword crc = 0;
+	size_t bytesRead = 0;
+	int result = EXIT_SUCCESS;
+
+	// the payload is placed right after the header
+	while (result == EXIT_SUCCESS && (bytesRead = fread(block, sizeof(byte),
+	PAYLOAD_BLOCK_BYTES, payload)) > 0) {
 
-	int i = 0;
-	for (i = 0; i < numberOfBitsText; i++) 
-   {
-   
-      // it takes the least significant bit of the least significant byte
-      // of the signle channel block-sample (left or right respectevely)
- 
-      // zero the least significant bit
-		track->data->channel[(permutation[i] + 1) * (bytesPerSample) - 1] &=(~1);
-
-      // set the value of the least significant bit as indicated by the bit
-      // taken from message
-		track->data->channel[(permutation[i] + 1) * (bytesPerSample) - 1] |=
-				getBit(text, i);
+		// the index of the first symbol of the block
+		long first = PAYLOAD_HEADER_BITS + (length << 3) / bitsPerSample;
+
+		count = splitToSymbols(block, (long) bytesRead << 3, bitsPerSample,
+				symbols);
+
+		if (count < 0 || first + count > domain
+				|| length + (long) bytesRead > 0xFFFFFFFFL) {
+			result = EXIT_FAILURE;
+			break;
+		}
+
+		if (createPositionSchedule(positions, first, count, domain,
+				SYSTEM_KEY_INTEGER) == EXIT_FAILURE
+				|| embedSymbols(track->data->channel, bytesPerSample, positions,
+						symbols, count, bitsPerSample) == EXIT_FAILURE)
+			result = EXIT_FAILURE;
+
+		crc = crc32Update(crc, block, bytesRead);
+		length += (long) bytesRead;
 	}
 
-	free(permutation);
-	return EXIT_SUCCESS;
+	if (ferror(payload))
+		result = EXIT_FAILURE;
+
+	// now that the length and the CRC are known hide the header in front
+	if (result == EXIT_SUCCESS) {
+		encodePayloadHeader(block, (dword) length, crc,
+				(byte) ((bitsPerSample - 1) & PAYLOAD_FLAG_BITS_MASK));
+
+		if (createPositionSchedule(positions, 0, PAYLOAD_HEADER_BITS, domain,
+				SYSTEM_KEY_INTEGER) == EXIT_FAILURE
+				|| embedBits(track->data->channel, bytesPerSample, positions,
+						block, PAYLOAD_HEADER_BITS) == EXIT_FAILURE)
+			result = EXIT_FAILURE;
+	}
+
+	free(block);
+	free(symbols);
+	free(positions);
+	return result;
 }
 
 #ifdef DEBUG_ENCODE_TEXT
@@ -10,68 +10,227 @@
  *  .wav and presents a list of the file's characteristics in the display. Basically the
  *  output is the Header of the .wav file.
  *
+ *  It also implements the survey of many .wav files ,which reads the headers of the files
+ *  with a pool of worker threads and writes one compact record for each file in CSV, JSON
+ *  or NDJSON.
+ *
  *  @version 1.0
  *  @author Marios Pafitis
  *  @bugs No known bugs
  */
+#include <fcntl.h>
+#include <unistd.h>
 #include "utilities.h"
+#include "workerPool.h"
+#include "cache.h"
+
+/**
+ * The formats of the records of a survey
+ */
+typedef enum {
+	SURVEY_CSV, SURVEY_JSON, SURVEY_NDJSON
+} SURVEY_FORMAT;
+
+/**
+ * The record of a file of a survey
+ */
+typedef struct {
+	char *fileName;
+	bool readable;
+	bool valid;
+	HEADER header;
+} SURVEY_RECORD;
 
 /* @brief Add the NUL character at the 5th position of a string
  *
- * A function that adds the NUL character at the 5th position of a string
+ * A function that copies the first 4 characters of a string to a buffer of the
+ * caller and adds the NUL character at the 5th position ,so the threads which
+ * list files don't share a buffer.
  *
  * @param in the input string
+ * @param str the buffer of the output string ,of 5 characters
  * @return char * the output string
  * @author Marios Pafitis
  *
  */
-PRIVATE char * printStr(char *);
+PRIVATE char * printStr(char *, char *);
 
 PUBLIC int list(char *filename) {
 // Read Data
-	HEADER *header = NULL;
-	if (readHeader(filename, &header) == EXIT_FAILURE) {
-		printf("Fail    :  %s\t(Can't read Header)\n", filename);
+	HEADER fields, *header = &fields;
+	FORMAT_EXTENSION extension;
+	long dataOffset = 0;
+	char id[5];
+	int fd = (filename == NULL) ? -1 : open(filename, O_RDONLY);
+	if (fd < 0
+			|| readHeaderExtensionFd(fd, header, &extension, &dataOffset)
+					== EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't read Header)\n", filename);
+		if (fd >= 0) {
+			close(fd);
+		}
 		return EXIT_FAILURE;
 	}
+	close(fd);
 // Display Data
-	printf("**********************************\n");
-	printf("RIFF_CHUNK_HEADER\n");
-	printf("==================\n");
-	printf("chunkID: %s\n", printStr((char *) header->ChunkID));
-	printf("chunkSize: %d\n", header->ChunkSize);
-	printf("format: %s\n", printStr((char *) header->Format));
-	printf("\nFMT_SUBCHUNK_HEADER\n");
-	printf("==================\n");
-	printf("subchunk1ID: %s\n", printStr((char *) header->Subchunk1ID));
-	printf("subchunk1Size: %d\n", header->Subchunk1Size);
-	printf("audioFormat: %hu\n", header->AudioFormat);
-	printf("numChannels: %hu\n", header->NumChannels);
-	printf("sampleRate: %d\n", header->SampleRate);
-	printf("byteRate: %d\n", header->ByteRate);
-	printf("blockAlign: %hu\n", header->BlockAlign);
-	printf("bitsPerSample: %hu\n", header->BitsPerSample);
-	printf("\nDATA_SUBCHUNK_HEADER\n");
-	printf("==================\n");
-	printf("subchunk2ID: %s\n", printStr((char *) header->Subchunk2ID));
-	printf("subchunk2Size: %d\n", header->Subchunk2Size);
-	printf("\n");
-// Free mallocs
-	free(header);
+	printOutput("**********************************\n");
+	printOutput("RIFF_CHUNK_HEADER\n");
+	printOutput("==================\n");
+	printOutput("chunkID: %s\n", printStr((char *) header->ChunkID, id));
+	printOutput("chunkSize: %d\n", header->ChunkSize);
+	printOutput("format: %s\n", printStr((char *) header->Format, id));
+	printOutput("\nFMT_SUBCHUNK_HEADER\n");
+	printOutput("==================\n");
+	printOutput("subchunk1ID: %s\n",
+			printStr((char *) header->Subchunk1ID, id));
+	printOutput("subchunk1Size: %d\n", header->Subchunk1Size);
+	printOutput("audioFormat: %hu\n", header->AudioFormat);
+	printOutput("numChannels: %hu\n", header->NumChannels);
+	printOutput("sampleRate: %d\n", header->SampleRate);
+	printOutput("byteRate: %d\n", header->ByteRate);
+	printOutput("blockAlign: %hu\n", header->BlockAlign);
+	printOutput("bitsPerSample: %hu\n", header->BitsPerSample);
+	printOutput("validBitsPerSample: %hu\n", extension.ValidBitsPerSample);
+	printOutput("channelMask: 0x%X\n", extension.ChannelMask);
+	printOutput("\nDATA_SUBCHUNK_HEADER\n");
+	printOutput("==================\n");
+	printOutput("subchunk2ID: %s\n", printStr((char *) header->Subchunk2ID, id));
+	printOutput("subchunk2Size: %d\n", header->Subchunk2Size);
+	printOutput("\n");
 	return EXIT_SUCCESS;
 }
 
-PRIVATE char * printStr(char *in) {
-	static char str[4];
-	strcpy(str, in);
+PRIVATE char * printStr(char *in, char *str) {
+	memcpy(str, in, 4);
 	str[4] = '\0';
 	return str;
 }
 
+/* @brief Read the header of a file of a survey
+ *
+ * A job of the worker pool. It reads the chunks of the file with pread (or takes
+ * them from the caches of the files) and checks the header. Its argument is a SURVEY_RECORD.
+ *
+ * @param *argument the SURVEY_RECORD of the file
+ * @return void
+ * @author Marios Pafitis
+ *
+ */
+PRIVATE void surveyFile(void *argument) {
+	SURVEY_RECORD *record = (SURVEY_RECORD *) argument;
+	long dataOffset = 0, fileSize = 0;
+	record->readable = false;
+	record->valid = false;
+	if (cachedHeader(record->fileName, &record->header, &dataOffset,
+			&fileSize) == EXIT_SUCCESS) {
+		record->readable = true;
+		record->valid = isCorrectFormatHeader(&record->header)
+				&& record->header.BlockAlign != 0
+				&& record->header.SampleRate != 0;
+	}
+}
+
+/* @brief Write the record of a file of a survey
+ *
+ * @param *out where the record is written
+ * @param *record the record of the file
+ * @param format the format of the record
+ * @return void
+ * @author Marios Pafitis
+ *
+ */
+PRIVATE void printRecord(FILE *out, SURVEY_RECORD *record,
+		SURVEY_FORMAT format) {
+	HEADER *h = &record->header;
+	unsigned long frames = 0;
+	double duration = 0;
+	if (record->valid) {
+		frames = h->Subchunk2Size / h->BlockAlign;
+		duration = (double) frames / h->SampleRate;
+	}
+	if (format == SURVEY_CSV) {
+		printQuotedName(out, record->fileName, false);
+		if (record->readable) {
+			fprintf(out, ",%d,%hu,%hu,%u,%hu,%lu,%.3f\n",
+					record->valid ? 1 : 0, h->AudioFormat, h->NumChannels,
+					h->SampleRate, h->BitsPerSample, frames, duration);
+		} else {
+			fprintf(out, ",0,,,,,,\n");
+		}
+		return;
+	}
+	fprintf(out, "{\"file\":");
+	printQuotedName(out, record->fileName, true);
+	if (record->readable) {
+		fprintf(out, ",\"valid\":%s,\"format\":%hu,\"channels\":%hu,"
+				"\"sample_rate\":%u,\"bits_per_sample\":%hu,\"frames\":%lu,"
+				"\"duration\":%.3f}", record->valid ? "true" : "false",
+				h->AudioFormat, h->NumChannels, h->SampleRate, h->BitsPerSample,
+				frames, duration);
+	} else {
+		fprintf(out, ",\"valid\":false,\"readable\":false}");
+	}
+}
+
+PUBLIC int survey(FILE *out, char **fileNames, int count, char *format) {
+	SURVEY_FORMAT surveyFormat;
+	int i;
+	if (out == NULL || fileNames == NULL || count < 0 || format == NULL) {
+		return EXIT_FAILURE;
+	}
+	if (strcmp(format, "csv") == 0) {
+		surveyFormat = SURVEY_CSV;
+	} else if (strcmp(format, "json") == 0) {
+		surveyFormat = SURVEY_JSON;
+	} else if (strcmp(format, "ndjson") == 0) {
+		surveyFormat = SURVEY_NDJSON;
+	} else {
+		fprintf(out, "Fail    :  %s\t(Unknown format)\n", format);
+		return EXIT_FAILURE;
+	}
+	SURVEY_RECORD *records = (SURVEY_RECORD *) calloc(count + 1,
+			sizeof(SURVEY_RECORD));
+	int threads = workerCountFor(count);
+	WORKER_POOL *pool = createWorkerPool(threads, threads << 2);
+	if (records == NULL || pool == NULL) {
+		free(records);
+		destroyWorkerPool(&pool);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < count; i++) {
+		records[i].fileName = fileNames[i];
+		submitJob(pool, surveyFile, &records[i]);
+	}
+	destroyWorkerPool(&pool);
+// Write the records in the order of the files
+	if (surveyFormat == SURVEY_CSV) {
+		fprintf(out, "file,valid,format,channels,sample_rate,bits_per_sample,"
+				"frames,duration\n");
+	} else if (surveyFormat == SURVEY_JSON) {
+		fprintf(out, "[");
+	}
+	for (i = 0; i < count; i++) {
+		if (surveyFormat == SURVEY_JSON && i > 0) {
+			fprintf(out, ",\n");
+		}
+		printRecord(out, &records[i], surveyFormat);
+		if (surveyFormat == SURVEY_NDJSON) {
+			fprintf(out, "\n");
+		}
+	}
+	if (surveyFormat == SURVEY_JSON) {
+		fprintf(out, "]\n");
+	}
+	fflush(out);
+	free(records);
+	return EXIT_SUCCESS;
+}
+
 #ifdef DEBUG_LIST
 // Test list
 int main(int argc,char* argv[]) {
-	printf("Test printStr: %s\n\n",printStr("HELLO12345"));
+	char id[5];
+	printf("Test printStr: %s\n\n",printStr("HELLO12345", id));
 	if (strcmp(argv[1], "-list") == 0) {
 		for (i = 2; i < argc; i++) {
 			if (list(argv[i]) == EXIT_FAILURE) {
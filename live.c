@@ -0,0 +1,391 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file live.c
+ *  @brief Runs mono ,gain and a watermark on a live sound in fixed periods
+ *
+ *  The live mode reads a streaming .wav (or raw PCM of a given format) from the standard
+ *  input a period at a time ,runs the operations on the period in place and writes it to
+ *  the standard output before it reads the next period. All the buffers are allocated
+ *  before the first period ,so a period only reads ,computes and writes. The output is
+ *  never more than a period and the processing of the period behind the input.
+ *
+ *  A period whose processing and write take longer than the sound of the period is an
+ *  xrun: the output fell behind the real time. The periods ,the xruns and the processing
+ *  times are written to the standard error at the end of the input or at SIGINT or
+ *  SIGTERM.
+ *
+ *  @version 1.0
+ *  @author Marios Pafitis
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "bufferPool.h"
+#include "cryptoUtilities.h"
+#include "stream.h"
+
+// The maximum number of operations of a live chain
+#define MAX_LIVE_OPERATIONS 16
+// The maximum length of the name of an operation
+#define OPERATION_NAME_LENGTH 16
+
+/**
+ * The operations of the live mode
+ */
+typedef enum {
+	LIVE_MONO, LIVE_GAIN, LIVE_MARK
+} LIVE_KIND;
+
+/**
+ * An operation of a live chain with everything it needs for a period
+ */
+typedef struct {
+	LIVE_KIND kind;
+	int channels; // the channels of the frames given to the operation
+	double factor; // the factor of a gain
+	int *positions; // the first sample of every frame ,for a mark
+	byte *message; // the bits of the text of a mark repeated over a period
+} LIVE_OPERATION;
+
+/**
+ * A chain of live operations
+ */
+typedef struct {
+	LIVE_OPERATION operations[MAX_LIVE_OPERATIONS];
+	int count;
+	int bytesPerSample;
+	SAMPLE_FORMAT format;
+	int channels; // the channels of the output
+} LIVE_CHAIN;
+
+PRIVATE volatile sig_atomic_t stopped = 0;
+
+/**
+ * @brief Stop the live mode at the end of the current period
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE void stopLive(int signal) {
+	(void) signal;
+	stopped = 1;
+}
+
+/**
+ * @brief Add an operation to a live chain
+ *
+ *	A mark hides the bits of its text in the lowest bit of the first channel of every
+ *	frame ,like encodeText ,from the first bit of the text in every period.
+ *
+ * 	@param *chain the chain
+ * 	@param *operation the operation and its arguments
+ * 	@param periodFrames the frames of a period
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int addLiveOperation(LIVE_CHAIN *chain, char *operation,
+		long periodFrames) {
+	char name[OPERATION_NAME_LENGTH];
+	int length = 0;
+	double decibels = 0;
+	long i, bits;
+	if (chain->count == MAX_LIVE_OPERATIONS
+			|| sscanf(operation, " %15s %n", name, &length) != 1) {
+		return EXIT_FAILURE;
+	}
+	LIVE_OPERATION *next = &chain->operations[chain->count];
+	next->channels = chain->channels;
+	if (strcmp(name, "mono") == 0 && chain->channels >= 2) {
+		next->kind = LIVE_MONO;
+		chain->channels = 1;
+	} else if (strcmp(name, "gain") == 0
+			&& sscanf(operation + length, "%lf", &decibels) == 1) {
+		next->kind = LIVE_GAIN;
+		next->factor = pow(10, decibels / 20);
+	} else if (strcmp(name, "mark") == 0) {
+		char *text = operation + length;
+		bits = (long) strlen(text);
+		while (bits > 0 && (text[bits - 1] == ' ' || text[bits - 1] == '\t')) {
+			bits--;
+		}
+		bits <<= 3;
+		if (bits == 0) {
+			return EXIT_FAILURE;
+		}
+		next->kind = LIVE_MARK;
+		next->positions = (int *) malloc(sizeof(int) * periodFrames);
+		next->message = (byte *) calloc((periodFrames + 7) >> 3, 1);
+		if (next->positions == NULL || next->message == NULL) {
+			free(next->positions);
+			free(next->message);
+			return EXIT_FAILURE;
+		}
+		for (i = 0; i < periodFrames; i++) {
+			next->positions[i] = (int) (i * chain->channels);
+			if ((text[(i % bits) >> 3] >> (7 - (i % bits & 7))) & 1) {
+				next->message[i >> 3] |= (byte) (0x80 >> (i & 7));
+			}
+		}
+	} else {
+		return EXIT_FAILURE;
+	}
+	chain->count++;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run the operations of a live chain on a period in place
+ *
+ * 	@param *chain the chain
+ * 	@param *frames the frames of the period
+ * 	@param count the number of the frames
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE void processPeriod(LIVE_CHAIN *chain, byte *frames, long count) {
+	int bytesPerSample = chain->bytesPerSample, i;
+	LIVE_OPERATION *operation;
+	long j;
+	for (i = 0; i < chain->count; i++) {
+		operation = &chain->operations[i];
+		if (operation->kind == LIVE_MONO) {
+			for (j = 1; j < count; j++) {
+				memcpy(frames + j * bytesPerSample,
+						frames + j * operation->channels * bytesPerSample,
+						bytesPerSample);
+			}
+		} else if (operation->kind == LIVE_GAIN) {
+			gainSamples(frames, count * operation->channels, chain->format,
+					operation->factor);
+		} else {
+			embedBits(frames, bytesPerSample, operation->positions,
+					operation->message, count);
+		}
+	}
+}
+
+/**
+ * @brief Read a period from a file descriptor
+ *
+ *	The bytes are read until the period is full ,the input ends or the mode is stopped.
+ *
+ * 	@param fd the file descriptor
+ * 	@param *bytes where the bytes are placed
+ * 	@param count the number of the bytes of the period
+ * 	@return long the number of the bytes read or -1 on an error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE long readPeriod(int fd, byte *bytes, long count) {
+	long total = 0;
+	ssize_t bytesRead;
+	while (total < count && !stopped) {
+		bytesRead = read(fd, bytes + total, count - total);
+		if (bytesRead < 0 && errno == EINTR) {
+			continue;
+		}
+		if (bytesRead < 0) {
+			return -1;
+		}
+		if (bytesRead == 0) {
+			break;
+		}
+		total += bytesRead;
+	}
+	return total;
+}
+
+/**
+ * @brief Write all the bytes of a period to a file descriptor
+ *
+ * 	@param fd the file descriptor
+ * 	@param *bytes the bytes
+ * 	@param count the number of the bytes
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int writePeriod(int fd, const void *bytes, long count) {
+	long total = 0;
+	ssize_t written;
+	while (total < count) {
+		written = write(fd, (const byte *) bytes + total, count - total);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return EXIT_FAILURE;
+		}
+		total += written;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief The seconds from a time to another
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE double secondsBetween(struct timespec *start, struct timespec *end) {
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+PUBLIC int live(char *operations, int periodFrames, int rate, int channels,
+		int bits) {
+	LIVE_CHAIN chain;
+	HEADER in, out;
+	FORMAT_EXTENSION extension = { 0, 0 };
+	byte outHeader[EXTENSIBLE_HEADER_SIZE];
+	size_t outHeaderSize;
+	struct sigaction action, oldInterrupt, oldTerminate;
+	struct timespec start, end;
+	long remaining = -1, count, bytes, periods = 0, xruns = 0, frames = 0;
+	double seconds, minimum = 0, maximum = 0, total = 0;
+	int result = EXIT_SUCCESS, i;
+	if (operations == NULL || periodFrames <= 0) {
+		return EXIT_FAILURE;
+	}
+	memset(&chain, 0, sizeof(LIVE_CHAIN));
+// Read the format of the input
+	if (rate == 0) {
+		if (readHeaderPipe(STDIN_FILENO, &in, &extension) == EXIT_FAILURE) {
+			fprintf(stderr, "Fail    :  -\t(Can't read WAV stream)\n");
+			return EXIT_FAILURE;
+		}
+		if (in.Subchunk2Size != STREAMING_SIZE && in.Subchunk2Size != 0
+				&& in.ChunkSize != STREAMING_SIZE) {
+			remaining = (long) in.Subchunk2Size;
+		}
+		word audioFormat = in.AudioFormat;
+		initHeader(&in, in.NumChannels, in.SampleRate, in.BitsPerSample, 0);
+		in.AudioFormat = audioFormat;
+	} else {
+		initHeader(&in, (word) channels, (dword) rate, (word) bits, 0);
+	}
+	if (!isCorrectFormatHeader(&in) || in.SampleRate == 0) {
+		fprintf(stderr, "Fail    :  -\t(This is not a supported format)\n");
+		return EXIT_FAILURE;
+	}
+// Prepare the operations and the period before the first frame
+	chain.bytesPerSample = in.BitsPerSample / 8;
+	chain.format = sampleFormatOf(&in);
+	chain.channels = in.NumChannels;
+	char *copy = strdup(operations), *operation, *next;
+	result = (copy == NULL) ? EXIT_FAILURE : EXIT_SUCCESS;
+	for (operation = copy; result == EXIT_SUCCESS && operation != NULL;
+			operation = next) {
+		next = strchr(operation, '|');
+		if (next != NULL) {
+			*next++ = '\0';
+		}
+		if (addLiveOperation(&chain, operation, periodFrames) == EXIT_FAILURE) {
+			fprintf(stderr, "Fail    :  -\t(Invalid live operation %s)\n",
+					operation);
+			result = EXIT_FAILURE;
+		}
+	}
+	free(copy);
+	byte *period = allocateBuffer((size_t) periodFrames * in.BlockAlign);
+	if (period == NULL) {
+		result = EXIT_FAILURE;
+	}
+	initHeader(&out, (word) chain.channels, in.SampleRate, in.BitsPerSample, 0);
+	out.AudioFormat = in.AudioFormat;
+	out.ChunkSize = STREAMING_SIZE;
+	out.Subchunk2Size = STREAMING_SIZE;
+	// the positions of the channels stay ,the mono sound is at the position of the
+	// left channel
+	if (rate != 0) {
+		extension.ChannelMask = defaultChannelMask(chain.channels);
+	} else if (chain.channels != in.NumChannels) {
+		extension.ChannelMask &= ~extension.ChannelMask + 1;
+	}
+	extension.ValidBitsPerSample = out.BitsPerSample;
+	outHeaderSize = formatHeader(&out, &extension, outHeader);
+	fflush(stdout);
+	off_t headerOffset = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+	if (result == EXIT_SUCCESS && rate == 0
+			&& writePeriod(STDOUT_FILENO, outHeader, outHeaderSize)
+					== EXIT_FAILURE) {
+		result = EXIT_FAILURE;
+	}
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopLive;
+	sigemptyset(&action.sa_mask);
+	stopped = 0;
+	sigaction(SIGINT, &action, &oldInterrupt);
+	sigaction(SIGTERM, &action, &oldTerminate);
+// Read ,process and write every period
+	double periodSeconds = (double) periodFrames / in.SampleRate;
+	while (result == EXIT_SUCCESS && !stopped && remaining != 0) {
+		bytes = (long) periodFrames * in.BlockAlign;
+		if (remaining >= 0 && bytes > remaining) {
+			bytes = remaining;
+		}
+		bytes = readPeriod(STDIN_FILENO, period, bytes);
+		if (bytes < 0) {
+			result = EXIT_FAILURE;
+			break;
+		}
+		count = bytes / in.BlockAlign;
+		if (count == 0) {
+			break;
+		}
+		if (remaining >= 0) {
+			remaining -= bytes;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		processPeriod(&chain, period, count);
+		if (writePeriod(STDOUT_FILENO, period, count * out.BlockAlign)
+				== EXIT_FAILURE) {
+			result = EXIT_FAILURE;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		seconds = secondsBetween(&start, &end);
+		minimum = (periods == 0 || seconds < minimum) ? seconds : minimum;
+		maximum = (seconds > maximum) ? seconds : maximum;
+		total += seconds;
+		xruns += (seconds > (double) count / in.SampleRate);
+		periods++;
+		frames += count;
+		if (count < periodFrames && remaining < 0) {
+			break; // the end of the input or a stop in the middle of a period
+		}
+	}
+	sigaction(SIGINT, &oldInterrupt, NULL);
+	sigaction(SIGTERM, &oldTerminate, NULL);
+	// the sizes of the header are written if the output can be seeked
+	if (result == EXIT_SUCCESS && rate == 0 && headerOffset >= 0) {
+		initHeader(&out, (word) chain.channels, in.SampleRate, in.BitsPerSample,
+				(dword) (frames * out.BlockAlign));
+		out.AudioFormat = in.AudioFormat;
+		formatHeader(&out, &extension, outHeader);
+		if (pwrite(STDOUT_FILENO, outHeader, outHeaderSize, headerOffset)
+				!= (ssize_t) outHeaderSize) {
+			result = EXIT_FAILURE;
+		}
+	}
+	if (result == EXIT_SUCCESS || periods > 0) {
+		fprintf(stderr,
+				"Live    :  %ld periods of %d frames (%.3f ms) ,%ld xruns\n",
+				periods, periodFrames, periodSeconds * 1000, xruns);
+		fprintf(stderr, "Live    :  processing min %.3f ms ,mean %.3f ms ,max %.3f"
+				" ms ,added latency at most %.3f ms\n", minimum * 1000,
+				(periods == 0) ? 0 : total / periods * 1000, maximum * 1000,
+				(periodSeconds + maximum) * 1000);
+	}
+	for (i = 0; i < chain.count; i++) {
+		free(chain.operations[i].positions);
+		free(chain.operations[i].message);
+	}
+	releaseBuffer(period);
+	return result;
+}
@@ -22,60 +22,30 @@
 */
 
 #include "utilities.h"
+#include "stream.h"
+#include "wavbuffer.h"
 
-#define min(a,b) ((a<b) ? (a) : (b))
-
-
-
-/**
- * @brief Checks if the two structs of type WAV are compatile for mixing
- *
- * This method checks whether two structs of type WAV are compatible for mixing
- * by checking their headers.
- *
- *
- * @param a pointer to a struct of type WAV which indicates the first sound track
- *        
- * @param a pointer to a struct of type WAV which indicates the second sound track
- *         
- *@return true if the two structs of type WAV are compatible for mixing ,otherwise
- *        false indicating that the two WAV structs are not compatible for mixing
- *
- *@author Valentinos Pariza
- */
-PRIVATE bool areCompatible(WAV* track1, WAV* track2);
 
 
 /**
-* @brief Mixes two soundtracks indicated by two pointers of WAV structs ,creating a new WAV struct
+* @brief This method mixes two soundtracks as streams to the standard output
 *
-* This method takes two pointers to structs of type WAV,that contain inforamtion in 
-* a header section and data in a data section about the soundtrack. . By saying 
-* "mix the two soundtracks " ,it means to take the two soundtracks and put the
-* first one to the right channel and the second one to the left channel. More
-* specific it takes the left channel of the second soundtrack,if it is stereo, 
-* and places it to the left channel of the new soundtrack(if it is mono it takes
-* its single channel) and if the first one is stereo,it takes the right channel
-* of it and places it to the right channel of the new soundtrack (if it is mono
-* it takes the single channel of it and places it to the right channel of the 
-* new soundtrack ). The new soundtrack created is placed in a place in memory
-* which address is passed as an argument.
-
-* 
-* @param a pointer to a struct of type WAV which indicates the first sound track
-*         to be mixed
-* @param a pointer to a struct of type WAV which indicates the second sound track
-*         to be mixed
+* This method mixes the soundtracks like wav_mix(const WAV*,const WAV*,WAV*) but a block of
+* samples at a time ,so one of them can be the standard input ("-") and it
+* doesn't need to be kept in memory. The new soundtrack is written to the
+* standard output.
 *
-* @param a pointer to a variable which points to a struct of type WAV which 
-*         indicates the final mixed soundtract (struct of type WAV)
+* @param a pointer to a sequence of characters that is the name of the first
+*        soundtrack or "-"
+* @param a pointer to a sequence of characters that is the name of the second
+*        soundtrack or "-"
 *
-* @return EXIT_SUCCESSif the mix was executed succesfully or EXIT_FAILURE if
-*         there was a problem during the execution of the method 
-*         
-* @author Valentinos Pariza 
+* @return EXIT_SUCCESS if the mix was written succesfully or EXIT_FAILURE if
+*         there was a problem during the execution of the method
+*
+* @author Valentinos Pariza
 */
-PRIVATE int mixWav(WAV* track1, WAV* track2, WAV** newTrack) ;
+PRIVATE int mixStreams(char* fileName1, char* fileName2);
 
 
 
@@ -84,6 +54,9 @@ PUBLIC int mix(char* fileName1, char* fileName2) {
 	if (fileName1 == NULL || fileName2 == NULL)
 		return EXIT_FAILURE;
 
+	if (strcmp(fileName1, "-") == 0 || strcmp(fileName2, "-") == 0)
+		return mixStreams(fileName1, fileName2);
+
 	WAV* wav1 = NULL;
 	WAV* wav2 = NULL;
 
@@ -96,204 +69,99 @@ PUBLIC int mix(char* fileName1, char* fileName2) {
 		return EXIT_FAILURE;
 	}
 
-	WAV* newSoundTrack = NULL;
+	WAV newSoundTrack;
+	WAV_STATUS status = wav_mix(wav1, wav2, &newSoundTrack);
 
-	if (mixWav(wav1, wav2, &newSoundTrack) == EXIT_FAILURE) {
-		deleteWAV(&wav1);
-		deleteWAV(&wav2);
+	deleteWAV(&wav1);
+	deleteWAV(&wav2);
+
+	if (status != WAV_OK)
 		return EXIT_FAILURE;
-	}
 
 	char* newFileName = NULL;
 
 	if (createOutputFilenameTwoFiles(fileName1, fileName2, "mix-",
 			&newFileName)==EXIT_FAILURE) {
 
-		deleteWAV(&wav1);
-		deleteWAV(&wav2);
-		deleteWAV(&newSoundTrack);
+		wav_free(&newSoundTrack);
 		return EXIT_FAILURE;
 	}
 
-	if (writeWAV(newFileName, newSoundTrack) == EXIT_FAILURE) {
+	if (writeWAV(newFileName, &newSoundTrack) == EXIT_FAILURE) {
 
 		free(newFileName);
-		deleteWAV(&wav1);
-		deleteWAV(&wav2);
-		deleteWAV(&newSoundTrack);
+		wav_free(&newSoundTrack);
 
 		return EXIT_FAILURE;
 	}
 
-	printf(
+	printOutput(
 			"\n\nThe mixed soundtrack takeen from filrs %s and %s was saved in file"
 					" with name : %s.\n", fileName1, fileName2, newFileName);
 
 	free(newFileName);
 
-	// free(newSoundTrack);
-	deleteWAV(&newSoundTrack);
-
-	deleteWAV(&wav1);
-
-	deleteWAV(&wav2);
+	wav_free(&newSoundTrack);
 
 	return EXIT_SUCCESS;
 
 }
 
 
-PRIVATE bool areCompatible(WAV* track1, WAV* track2) {
-	if (track1 == NULL || track2 == NULL || track1->header == NULL
-			|| track2->header == NULL)
-		return false;
-
-	if (track1->header->BitsPerSample != track2->header->BitsPerSample
-			|| track1->header->SampleRate != track2->header->SampleRate
-			|| track1->header->BitsPerSample != track2->header->BitsPerSample)
-		return false;
-
-	return true;
-}
-
-
-
-
-PRIVATE int mixWav(WAV* track1, WAV* track2, WAV** newTrack) {
-
-	// Check for actual pointers,which were given
-	if (track1 == NULL || track2 == NULL || track1->header == NULL
-			|| newTrack == NULL || track2->header == NULL
-			|| track1->data == NULL || track2->data == NULL)
-		return EXIT_FAILURE;
-
-	// Check of the type of the track-wav to be sure that the format of the
-	// file is correct
-	if (!isCorrectFormatWAV(track1) || !isCorrectFormatWAV(track2))
-		return EXIT_FAILURE;
-
-	// check for compatibility of the two tracks given
-	if (!areCompatible(track1, track2))
+PRIVATE int mixStreams(char* fileName1, char* fileName2) {
+	// the standard input can't be read twice
+	if (strcmp(fileName1, fileName2) == 0)
 		return EXIT_FAILURE;
 
-	// Find the needed bytes for each block of samples with channels(including the
-	// extra samples for the added channels)
-	int bytesPerSampleForTrack1 = ((track1->header->BitsPerSample) >> 3)
-			* (track1->header->NumChannels);
-	int bytesPerSampleForTrack2 = ((track2->header->BitsPerSample) >> 3)
-			* (track2->header->NumChannels);
+	STREAM* stream1 = openFileStream(fileName1);
+	STREAM* stream2 = openFileStream(fileName2);
 
-	long int minNumberOfSamples = 0;
+	// a soundtrack of a narrower sample format is converted while it is mixed
+	if (stream1 != NULL && stream2 != NULL) {
+		SAMPLE_FORMAT format1 = sampleFormatOf(&stream1->header);
+		SAMPLE_FORMAT format2 = sampleFormatOf(&stream2->header);
+		SAMPLE_FORMAT format = widerSampleFormat(format1, format2);
+		STREAM* converted;
 
-	{
-		int numSamples1 = (track1->header->Subchunk2Size)
-				/ bytesPerSampleForTrack1;
-
-		int numSamples2 = (track2->header->Subchunk2Size)
-				/ bytesPerSampleForTrack2;
-
-		minNumberOfSamples = min((numSamples1), (numSamples2));
+		if (format1 != format
+				&& (converted = convertStream(stream1, format, false)) != NULL)
+			stream1 = converted;
 
+		if (format2 != format
+				&& (converted = convertStream(stream2, format, false)) != NULL)
+			stream2 = converted;
 	}
 
-	// The number of bytes for a single unit of sample
-	size_t bytesSingleUnitSample = ((track1->header->BitsPerSample) >> 3);
-
-	*newTrack = (WAV*) malloc(sizeof(WAV));
-
-	if ((*newTrack) == NULL)
-		return EXIT_FAILURE;
-
-	(*newTrack)->header = (HEADER*) malloc(sizeof(HEADER));
-
-	if ((*newTrack)->header == NULL) {
-		free(*newTrack);
-		*newTrack = NULL;
-
-		return EXIT_FAILURE;
+	// a soundtrack of a lower sample rate is resampled while it is mixed
+	if (stream1 != NULL && stream2 != NULL
+			&& stream1->header.SampleRate != stream2->header.SampleRate) {
+		STREAM* resampled;
+
+		if (stream1->header.SampleRate < stream2->header.SampleRate) {
+			if ((resampled = resampleStream(stream1,
+					stream2->header.SampleRate)) != NULL)
+				stream1 = resampled;
+		} else if ((resampled = resampleStream(stream2,
+				stream1->header.SampleRate)) != NULL)
+			stream2 = resampled;
 	}
 
-	memcpy((*newTrack)->header, track1->header, sizeof(HEADER));
-
-	// update the number of channels on the new track
-	(*newTrack)->header->NumChannels = 2;
-
-	// Update the field ChunkSize of the header of teh new track of type WAV
-	(*newTrack)->header->ChunkSize = sizeof(HEADER) - 8
-			+ minNumberOfSamples * (*newTrack)->header->NumChannels
-					* bytesSingleUnitSample;
-
-	// update the ByteRate field of the header of the new track struct of type WAV
-	(*newTrack)->header->ByteRate = (track1->header->ByteRate
-			/ track1->header->NumChannels) * (*newTrack)->header->NumChannels;
-
-	// update the BlockAlign field of the header of the new track struct of type WAV
-	(*newTrack)->header->BlockAlign = (track1->header->BlockAlign
-			/ track1->header->NumChannels) * (*newTrack)->header->NumChannels;
-
-	// update the size in bytes of all the data of the new track struct of type WAV
-	(*newTrack)->header->Subchunk2Size = minNumberOfSamples
-			* (*newTrack)->header->NumChannels * bytesSingleUnitSample;
+	STREAM* mixed = mixStream(stream1, stream2);
 
-	(*newTrack)->data = (DATA*) malloc(sizeof(DATA));
-
-	if ((*newTrack)->data == NULL) {
-		free((*newTrack)->header);
-		free(*newTrack);
-		*newTrack = NULL;
+	if (mixed == NULL) {
+		fprintf(stderr, "Fail    :  %s\t(Can't mix with %s)\n", fileName1,
+				fileName2);
+		closeStream(&stream1);
+		closeStream(&stream2);
 		return EXIT_FAILURE;
 	}
 
-	// Allocate memory for the data field of the new track struct of type WAV
-	(*newTrack)->data->channel = (byte*) malloc(
-			sizeof(byte) * (*newTrack)->header->Subchunk2Size);
-
-	if ((*newTrack)->data == NULL) {
-		free((*newTrack)->header);
-		free((*newTrack)->data);
-		free(*newTrack);
-		*newTrack = NULL;
-
-		return EXIT_FAILURE;
-	}
-
-	// if the file track1 is stereo take the right channel to start ,else take the
-	// single unit
-	byte* pter1 =
-			((track1->header->NumChannels) == 2) ?
-					((track1->data->channel) + bytesSingleUnitSample) :
-					(track1->data->channel);
-
-	// if the file track2 is stereo take the left channel to start ,else take the
-	// single unit, which is aso the left channel
-	byte* pter2 = (track2->data->channel);
+	int result = writeStream(mixed, "-");
 
-	byte* pointerToNewData = (*newTrack)->data->channel;
-	int i;
-	for (i = 0; i < minNumberOfSamples; i++) {
-		// Copy the first single sample unit from track2 (it will be placed left)
-		memcpy(pointerToNewData, pter2, bytesSingleUnitSample);
+	// the mixed stream closes the two streams too
+	closeStream(&mixed);
 
-		// increase the position of the newTrack pointer to data by a number of
-		// bytes indicated by the variable bytesSingleUnitSample.Moving a single
-		// unit .In order to move to the right channel of the sample
-		pointerToNewData += bytesSingleUnitSample;
-
-		memcpy(pointerToNewData, pter1, bytesSingleUnitSample);
-
-		// increase the position of the newTrack pointer to data by a number of
-		// bytes indicated by the variable bytesSingleUnitSample.Moving a single
-		// unit .In order to move to the left channel of the next sample
-		pointerToNewData += bytesSingleUnitSample;
-
-		// increase pointer of the two tracks in order to point to the next
-		// segement of their sample
-		pter1 += bytesPerSampleForTrack1;
-		pter2 += bytesPerSampleForTrack2;
-
-	}
-
-	return EXIT_SUCCESS;
+	return result;
 }
 
 
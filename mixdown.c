@@ -0,0 +1,172 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file mixdown.c
+ *  @brief Mixes many .wav files down to a stereo .wav file
+ *
+ *  Implements the mixdown of many tracks. Every track is given as filename[:gain[:pan]]
+ *  ,with the gain in dB and the pan from -1 (left) to 1 (right). The tracks are opened as
+ *  streams and summed a block at a time ,so the memory doesn't depend on the length of
+ *  the tracks. A track of a lower sample rate is resampled to the highest rate of the
+ *  tracks while it is mixed.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#include "utilities.h"
+#include "wavelib.h"
+#include "stream.h"
+
+/**
+ * @brief Split a track of a mixdown to its filename ,gain and pan
+ *
+ *	The gain and the pan are taken from the end of the argument only if they are numbers
+ *	,so a filename with a ':' is kept.
+ *
+ * 	@param *argument the track
+ * 	@param *filename where the filename is placed ,as long as the argument
+ * 	@param *decibels where the gain is placed
+ * 	@param *pan where the pan is placed
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void parseTrack(const char *argument, char *filename, double *decibels,
+		double *pan) {
+	double values[2];
+	int found = 0;
+	char *colon, *end;
+	strcpy(filename, argument);
+	*decibels = 0;
+	*pan = 0;
+	while (found < 2 && (colon = strrchr(filename, ':')) != NULL) {
+		values[found] = strtod(colon + 1, &end);
+		if (end == colon + 1 || *end != '\0') {
+			break;
+		}
+		*colon = '\0';
+		found++;
+	}
+	if (found == 1) {
+		*decibels = values[0];
+	} else if (found == 2) {
+		*decibels = values[1];
+		*pan = values[0];
+	}
+}
+
+/**
+ * @brief Close the streams of the tracks of a mixdown
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void closeTracks(STREAM **streams, int count) {
+	int t;
+	for (t = 0; t < count; t++) {
+		closeStream(&streams[t]);
+	}
+}
+
+PUBLIC int mixdown(char **tracks, int count) {
+	if (tracks == NULL || count < 1) {
+		return EXIT_FAILURE;
+	}
+	STREAM **streams = (STREAM **) calloc(count, sizeof(STREAM *));
+	CHANNEL_MAP *maps = (CHANNEL_MAP *) malloc(sizeof(CHANNEL_MAP) * count);
+	char *filename = NULL, *outFilename = NULL;
+	double decibels, pan;
+	dword rate = 0;
+	int t, inputs = 0, result = EXIT_FAILURE;
+	FILE *messages = commandOutput();
+	if (streams == NULL || maps == NULL) {
+		free(streams);
+		free(maps);
+		return EXIT_FAILURE;
+	}
+// Open the tracks
+	for (t = 0; t < count; t++) {
+		free(filename);
+		if ((filename = (char *) malloc(strlen(tracks[t]) + 1)) == NULL) {
+			break;
+		}
+		parseTrack(tracks[t], filename, &decibels, &pan);
+		if (strcmp(filename, "-") == 0) {
+			// the mixdown of the standard input goes to the standard output
+			messages = stderr;
+			if (inputs++ > 0) {
+				fprintf(messages,
+						"Fail    :  %s\t(The standard input is read once)\n",
+						tracks[t]);
+				break;
+			}
+		}
+		if ((streams[t] = openFileStream(filename)) == NULL) {
+			fprintf(messages, "Fail    :  %s\t(Can't read WAV file)\n", filename);
+			break;
+		}
+		if (panChannelMap(streams[t]->header.NumChannels,
+				streams[t]->channelMask, decibels, pan, &maps[t])
+				== EXIT_FAILURE) {
+			fprintf(messages, "Fail    :  %s\t(Invalid gain ,pan or channels)\n",
+					tracks[t]);
+			break;
+		}
+		if (streams[t]->header.SampleRate > rate) {
+			rate = streams[t]->header.SampleRate;
+		}
+	}
+// Resample the tracks of a lower sample rate
+	bool opened = (t == count);
+	for (t = 0; opened && t < count; t++) {
+		STREAM *resampled;
+		if (streams[t]->header.SampleRate != rate) {
+			if ((resampled = resampleStream(streams[t], rate)) == NULL) {
+				fprintf(messages, "Fail    :  %s\t(Can't resample)\n", tracks[t]);
+				opened = false;
+				break;
+			}
+			streams[t] = resampled;
+		}
+	}
+	STREAM *mixed = opened ? mixdownStream(streams, maps, count) : NULL;
+	if (mixed == NULL) {
+		if (opened) {
+			fprintf(messages, "Fail    :  %s\t(Can't mix down the tracks)\n",
+					tracks[0]);
+		}
+		closeTracks(streams, count);
+		free(streams);
+		free(maps);
+		free(filename);
+		return EXIT_FAILURE;
+	}
+// Write the mixdown
+	if (messages == stderr) {
+		result = writeStream(mixed, "-");
+	} else {
+		free(filename);
+		if ((filename = (char *) malloc(strlen(tracks[0]) + 1)) != NULL) {
+			parseTrack(tracks[0], filename, &decibels, &pan);
+		}
+		if (filename == NULL
+				|| createOutputFilename(filename, "mixdown-", &outFilename)
+						== EXIT_FAILURE) {
+			printOutput("Fail    :  %s\t(Can't create output filename)\n",
+					tracks[0]);
+		} else if ((result = writeStream(mixed, outFilename)) == EXIT_FAILURE) {
+			printOutput("Fail    :  %s\t(Can't write WAV file)\n", outFilename);
+		} else {
+			printOutput("Success :  %s\t(Created)\n", outFilename);
+		}
+	}
+// The mixed stream closes the tracks too
+	closeStream(&mixed);
+	free(streams);
+	free(maps);
+	free(filename);
+	free(outFilename);
+	return result;
+}
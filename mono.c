@@ -17,74 +17,48 @@
  *  @bugs No known bugs
  */
 #include "utilities.h"
+#include "wavelib.h"
+#include "wavbuffer.h"
 
 PUBLIC int mono(char *inFilename) {
+// The standard input is streamed to the standard output
+	if (inFilename != NULL && strcmp(inFilename, "-") == 0) {
+		return pipeline(inFilename, "mono", "-");
+	}
 // Create output filename
 	char *outFilename = NULL;
 	if (createOutputFilename(inFilename, "new-", &outFilename) == EXIT_FAILURE) {
 		if (outFilename != NULL) {
 			free(outFilename);
 		}
-		printf("Fail    :  %s\t(Can't create output filename)\n", inFilename);
+		printOutput("Fail    :  %s\t(Can't create output filename)\n",
+				inFilename);
 		return EXIT_FAILURE;
 	}
 // Read Wav
 	WAV *wav_old = NULL;
 	if (readWAV(inFilename, &wav_old) == EXIT_FAILURE) {
 		free(outFilename);
-		printf("Fail    :  %s\t(Can't read WAV file)\n", inFilename);
-		return EXIT_FAILURE;
-	}
-// Check the format of the file
-	if (!isCorrectFormatWAV(wav_old)) {
-		deleteWAV(&wav_old);
-		free(outFilename);
-		printf("Fail    :  %s\t(This is not a correct .wav)\n", inFilename);
+		printOutput("Fail    :  %s\t(Can't read WAV file)\n", inFilename);
 		return EXIT_FAILURE;
 	}
-	if (wav_old->header->NumChannels == 1) {
-		printf("Fail    :  %s\t(This is not a stereo .wav)\n", inFilename);
-		deleteWAV(&wav_old);
+// Keep the left channel
+	WAV wav_new;
+	WAV_STATUS status = wav_mono(wav_old, &wav_new);
+	deleteWAV(&wav_old);
+	if (status != WAV_OK) {
+		printOutput("Fail    :  %s\t(%s)\n", inFilename,
+				(status == WAV_ERROR_CHANNELS) ?
+						"This is not a stereo .wav" : wav_strerror(status));
 		free(outFilename);
 		return EXIT_FAILURE;
 	}
-// Create new Wav and copy data
-	WAV *wav_new = (WAV*) malloc(sizeof(WAV));
-	wav_new->header = (HEADER*) malloc(sizeof(HEADER));
-	wav_new->data = (DATA*) malloc(sizeof(DATA));
-	wav_new->data->channel = (byte*) malloc(wav_old->header->Subchunk2Size);
-	unsigned int i;
-	for (i = 0; i < wav_old->header->Subchunk2Size;
-			i += 2 * (wav_old->header->BitsPerSample / 8)) {
-		memcpy(
-				&wav_new->data->channel[i / (wav_old->header->BitsPerSample / 8)],
-				&wav_old->data->channel[i], wav_old->header->BitsPerSample);
-	}
-	strcpy((char *) wav_new->header->ChunkID,
-			(char *) wav_old->header->ChunkID);
-	strcpy((char *) wav_new->header->Format, (char *) wav_old->header->Format);
-	strcpy((char *) wav_new->header->Subchunk2ID,
-			(char *) wav_old->header->Subchunk2ID);
-	wav_new->header->ChunkSize = wav_old->header->ChunkSize
-			- wav_old->header->Subchunk2Size / 2;
-	wav_new->header->Subchunk1Size = wav_old->header->Subchunk1Size;
-	wav_new->header->AudioFormat = wav_old->header->AudioFormat;
-	wav_new->header->NumChannels = 1;
-	wav_new->header->SampleRate = wav_old->header->SampleRate;
-	wav_new->header->ByteRate = wav_old->header->SampleRate
-			* wav_old->header->NumChannels
-			* (wav_old->header->BitsPerSample / 8);
-	wav_new->header->BlockAlign = wav_old->header->NumChannels
-			* (wav_old->header->BitsPerSample / 8);
-	wav_new->header->BitsPerSample = wav_old->header->BitsPerSample;
-	wav_new->header->Subchunk2Size = wav_old->header->Subchunk2Size / 2;
 // Write data
-	writeWAV(outFilename, wav_new);
-	printf("Success :  %s\t(Created)\n", outFilename);
+	writeWAV(outFilename, &wav_new);
+	printOutput("Success :  %s\t(Created)\n", outFilename);
 // Free mallocs
 	free(outFilename);
-	deleteWAV(&wav_old);
-	deleteWAV(&wav_new);
+	wav_free(&wav_new);
 	return EXIT_SUCCESS;
 }
 #ifdef DEBUG_VOLUME
@@ -0,0 +1,328 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file pipeline.c
+ *  @brief Runs a chain of operations on a .wav file in a single pass
+ *
+ *  Implements the pipelines of operations. A pipeline is written like a pipeline of the
+ *  shell ,for example "chop 10 70 | mono | reverse". Every operation of the pipeline is
+ *  a stream after the stream of the operation before it ,so the frames go through all
+ *  the operations a block at a time and only the output of the last operation is
+ *  written.
+ *
+ *  Nothing is read until the output is written. The output reads the ranges of the last
+ *  stream and every stream reads only the range of its upstream which gives its range,
+ *  so for "reverse | chop 0 30" only the last 30 seconds of the file are read.
+ *
+ *  @version 1.0
+ *  @author Marios Pafitis
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <unistd.h>
+#include "resample.h"
+#include "stream.h"
+
+// The maximum length of the name of an operation
+#define OPERATION_NAME_LENGTH 16
+// The least size of a sound whose operations run in stages of their own
+#define STAGE_MIN_BYTES (4L * 1024 * 1024)
+
+/**
+ * @brief Add an operation to a chain of streams
+ *
+ * 	@param *operation the operation and its arguments
+ * 	@param **stream the last stream of the chain ,replaced by the stream of the operation
+ * 	@param *inFilename the input filename for the messages
+ * 	@param *messages where the messages are written
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int addOperation(char *operation, STREAM **stream, char *inFilename,
+		FILE *messages) {
+	char name[OPERATION_NAME_LENGTH], format[OPERATION_NAME_LENGTH];
+	char option[OPERATION_NAME_LENGTH] = "";
+	int length = 0, arguments;
+	double l = 0, r = 0;
+	STREAM *next = NULL;
+	if (sscanf(operation, " %15s %n", name, &length) != 1) {
+		fprintf(messages, "Fail    :  %s\t(Empty operation)\n", inFilename);
+		return EXIT_FAILURE;
+	}
+	if (strcmp(name, "chop") == 0) {
+		if (sscanf(operation + length, "%lf %lf", &l, &r) != 2 || l < 0
+				|| r <= l) {
+			fprintf(messages, "Fail    :  %s\t(Invalid time input)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+		next = chopStream(*stream, (long) (l * (*stream)->header.SampleRate),
+				(long) (r * (*stream)->header.SampleRate));
+		if (next == NULL) {
+			fprintf(messages, "Fail    :  %s\t(Invalid time input)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+	} else if (strcmp(name, "mono") == 0) {
+		next = monoStream(*stream);
+		if (next == NULL) {
+			fprintf(messages, "Fail    :  %s\t(This is not a stereo .wav)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+	} else if (strcmp(name, "gain") == 0) {
+		if (sscanf(operation + length, "%lf", &l) != 1) {
+			fprintf(messages, "Fail    :  %s\t(Invalid gain input)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+		next = gainStream(*stream, l);
+	} else if (strcmp(name, "reverse") == 0) {
+		next = reverseStream(*stream);
+	} else if (strcmp(name, "convert") == 0) {
+		arguments = sscanf(operation + length, "%15s %15s", format, option);
+		if (arguments < 1 || parseSampleFormat(format) == SAMPLE_UNKNOWN
+				|| (arguments == 2 && strcmp(option, "dither") != 0)) {
+			fprintf(messages, "Fail    :  %s\t(Invalid sample format)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+		next = convertStream(*stream, parseSampleFormat(format),
+				arguments == 2);
+	} else if (strcmp(name, "channels") == 0) {
+		CHANNEL_MAP map;
+		if (parseChannelMap(operation + length, (*stream)->header.NumChannels,
+				(*stream)->channelMask, &map) == EXIT_FAILURE) {
+			fprintf(messages, "Fail    :  %s\t(Invalid channel map)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+		next = channelMapStream(*stream, &map);
+	} else if (strcmp(name, "resample") == 0) {
+		if (sscanf(operation + length, "%lf", &l) != 1 || l < 1
+				|| l > MAX_SAMPLE_RATE || l != (dword) l
+				|| (*stream)->header.SampleRate / (dword) l
+						>= MAX_RESAMPLE_RATIO) {
+			fprintf(messages, "Fail    :  %s\t(Invalid sample rate)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+		next = resampleStream(*stream, (dword) l);
+	} else {
+		fprintf(messages, "Fail    :  %s\t(Unknown operation %s)\n",
+				inFilename, name);
+		return EXIT_FAILURE;
+	}
+	if (next == NULL) {
+		fprintf(messages, "Fail    :  %s\t(Not enough memory)\n", inFilename);
+		return EXIT_FAILURE;
+	}
+	*stream = next;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Find how the operations of a pipeline are run in stages
+ *
+ *	The environment variable WAVENGINE_STAGES is 0 for no stages ,1 for stages and
+ *	"stats" for stages whose counters are printed. Without it a sound bigger than
+ *	STAGE_MIN_BYTES (or of unknown size) is run in stages on more than one core.
+ *
+ * 	@param *stream the stream of the input
+ * 	@return int 0 without stages ,1 with stages or 2 with stages and their counters
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int stagesOf(STREAM *stream) {
+	char *value = getenv("WAVENGINE_STAGES");
+	if (value != NULL) {
+		return (strcmp(value, "stats") == 0) ? 2 : (atoi(value) != 0);
+	}
+	return sysconf(_SC_NPROCESSORS_ONLN) > 1
+			&& (stream->frames < 0
+					|| stream->frames * stream->header.BlockAlign > STAGE_MIN_BYTES);
+}
+
+/**
+ * @brief Find the last operation of a pipeline which reads ranges of its upstream
+ *
+ *	A stage can't be placed before chop or reverse ,they read the ranges of their
+ *	upstream instead of pulling all of it.
+ *
+ * 	@param *operations the pipeline of operations
+ * 	@return int the index of the last chop or reverse or -1
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int lastRangedOperation(char *operations) {
+	char name[OPERATION_NAME_LENGTH];
+	int index, last = -1;
+	for (index = 0; operations != NULL; index++) {
+		if (sscanf(operations, " %15[^| \t\n]", name) == 1
+				&& (strcmp(name, "chop") == 0 || strcmp(name, "reverse") == 0)) {
+			last = index;
+		}
+		operations = strchr(operations, '|');
+		if (operations != NULL) {
+			operations++;
+		}
+	}
+	return last;
+}
+
+PUBLIC int pipeline(char *inFilename, char *operations, char *outFilename) {
+	if (inFilename == NULL || operations == NULL) {
+		return EXIT_FAILURE;
+	}
+// Create output filename ,the standard input goes to the standard output
+	char *newFilename = NULL;
+	if (outFilename == NULL && strcmp(inFilename, "-") == 0) {
+		outFilename = "-";
+	} else if (outFilename == NULL) {
+		if (createOutputFilename(inFilename, "pipe-",
+				&newFilename) == EXIT_FAILURE) {
+			printOutput("Fail    :  %s\t(Can't create output filename)\n",
+					inFilename);
+			return EXIT_FAILURE;
+		}
+		outFilename = newFilename;
+	}
+	// the messages must not be mixed with a .wav on the standard output
+	FILE *messages =
+			(strcmp(outFilename, "-") == 0) ? stderr : commandOutput();
+// Chain the streams of the operations after the stream of the file
+	STREAM *stream = openFileStream(inFilename);
+	if (stream == NULL) {
+		free(newFilename);
+		fprintf(messages, "Fail    :  %s\t(Can't read WAV file)\n", inFilename);
+		return EXIT_FAILURE;
+	}
+	char *copy = strdup(operations), *operation, *next;
+	char stageName[OPERATION_NAME_LENGTH] = "read";
+	int result = (copy == NULL) ? EXIT_FAILURE : EXIT_SUCCESS;
+	int stages = stagesOf(stream), ranged = lastRangedOperation(operations), i;
+	STREAM *stage;
+	for (operation = copy, i = 0; result == EXIT_SUCCESS && operation != NULL;
+			operation = next, i++) {
+		next = strchr(operation, '|');
+		if (next != NULL) {
+			*next++ = '\0';
+		}
+		// the operations after the last chop or reverse run on their own threads
+		if (stages && i > ranged) {
+			stage = stageStream(stream, stageName);
+			stream = (stage != NULL) ? stage : stream;
+		}
+		result = addOperation(operation, &stream, inFilename, messages);
+		sscanf(operation, " %15s", stageName);
+	}
+	free(copy);
+	if (result == EXIT_SUCCESS && stages) {
+		stage = stageStream(stream, stageName);
+		stream = (stage != NULL) ? stage : stream;
+	}
+// Write the last stream
+	if (result == EXIT_SUCCESS) {
+		result = writeStream(stream, outFilename);
+		if (result == EXIT_FAILURE) {
+			fprintf(messages, "Fail    :  %s\t(Can't write WAV file)\n",
+					outFilename);
+		} else if (messages != stderr) {
+			printOutput("Success :  %s\t(Created)\n", outFilename);
+		}
+		if (stages == 2) {
+			printStageStatistics(stream, messages);
+		}
+	}
+	closeStream(&stream);
+	free(newFilename);
+	return result;
+}
+
+PUBLIC int gain(char *inFilename, double decibels) {
+	char operation[OPERATION_NAME_LENGTH + 32];
+	char *outFilename = NULL;
+	if (inFilename == NULL) {
+		return EXIT_FAILURE;
+	}
+	sprintf(operation, "gain %.17g", decibels);
+	if (strcmp(inFilename, "-") == 0) {
+		return pipeline(inFilename, operation, "-");
+	}
+	if (createOutputFilename(inFilename, "gain-", &outFilename) == EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't create output filename)\n",
+				inFilename);
+		return EXIT_FAILURE;
+	}
+	int result = pipeline(inFilename, operation, outFilename);
+	free(outFilename);
+	return result;
+}
+
+PUBLIC int convert(char *inFilename, char *format, bool dither) {
+	char operation[OPERATION_NAME_LENGTH * 3];
+	char *outFilename = NULL;
+	if (inFilename == NULL || format == NULL
+			|| strlen(format) >= OPERATION_NAME_LENGTH) {
+		return EXIT_FAILURE;
+	}
+	sprintf(operation, "convert %s%s", format, dither ? " dither" : "");
+	if (strcmp(inFilename, "-") == 0) {
+		return pipeline(inFilename, operation, "-");
+	}
+	if (createOutputFilename(inFilename, "converted-", &outFilename)
+			== EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't create output filename)\n",
+				inFilename);
+		return EXIT_FAILURE;
+	}
+	int result = pipeline(inFilename, operation, outFilename);
+	free(outFilename);
+	return result;
+}
+
+PUBLIC int channelMap(char *inFilename, char *map) {
+	char operation[CHANNEL_MAP_LENGTH + 16];
+	char *outFilename = NULL;
+	if (inFilename == NULL || map == NULL || strlen(map) >= CHANNEL_MAP_LENGTH
+			|| strchr(map, '|') != NULL) {
+		return EXIT_FAILURE;
+	}
+	sprintf(operation, "channels %s", map);
+	if (strcmp(inFilename, "-") == 0) {
+		return pipeline(inFilename, operation, "-");
+	}
+	if (createOutputFilename(inFilename, "channels-", &outFilename)
+			== EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't create output filename)\n",
+				inFilename);
+		return EXIT_FAILURE;
+	}
+	int result = pipeline(inFilename, operation, outFilename);
+	free(outFilename);
+	return result;
+}
+
+PUBLIC int resample(char *inFilename, int rate) {
+	char operation[OPERATION_NAME_LENGTH + 32];
+	char *outFilename = NULL;
+	if (inFilename == NULL) {
+		return EXIT_FAILURE;
+	}
+	sprintf(operation, "resample %d", rate);
+	if (strcmp(inFilename, "-") == 0) {
+		return pipeline(inFilename, operation, "-");
+	}
+	if (createOutputFilename(inFilename, "resampled-", &outFilename)
+			== EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't create output filename)\n",
+				inFilename);
+		return EXIT_FAILURE;
+	}
+	int result = pipeline(inFilename, operation, outFilename);
+	free(outFilename);
+	return result;
+}
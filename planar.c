@@ -0,0 +1,526 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file planar.c
+ *  @brief The planar samples and the converters from and to interleaved frames
+ *
+ *  The converters of every width walk a channel at a time with a plain loop ,and the
+ *  16 bits and float mono and stereo frames are converted with SSE2 ,8 or 4 frames at a
+ *  time. The rounding of SSE2 (to the nearest ,ties to even) is the rounding of
+ *  nearbyint ,so the two paths give the same samples.
+ *
+ *  A converter decodes a block of frames to planar samples ,adds the dither and encodes
+ *  them in the other format ,so every pair of formats is converted by the same kernels.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <math.h>
+#include "bufferPool.h"
+#include "planar.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The number of the floats of the alignment of a channel
+#define ALIGN_FLOATS ((long) (PLANAR_ALIGN_BYTES / sizeof(float)))
+// The first state of the generator of the dither ,the same noise for the same input
+#define DITHER_SEED 0x9E3779B9U
+
+PUBLIC SAMPLE_FORMAT sampleFormatOf(const HEADER *header) {
+	if (header->AudioFormat == WAVE_FORMAT_IEEE_FLOAT) {
+		return (header->BitsPerSample == 32) ? SAMPLE_F32 : SAMPLE_UNKNOWN;
+	}
+	if (header->AudioFormat != WAVE_FORMAT_PCM) {
+		return SAMPLE_UNKNOWN;
+	}
+	switch (header->BitsPerSample) {
+	case 8:
+		return SAMPLE_U8;
+	case 16:
+		return SAMPLE_S16;
+	case 24:
+		return SAMPLE_S24;
+	case 32:
+		return SAMPLE_S32;
+	}
+	return SAMPLE_UNKNOWN;
+}
+
+PUBLIC SAMPLE_FORMAT parseSampleFormat(const char *name) {
+	const char *names[] = { "u8", "s16", "s24", "s32", "f32" };
+	int i;
+	for (i = 0; name != NULL && i < SAMPLE_UNKNOWN; i++) {
+		if (strcmp(name, names[i]) == 0) {
+			return (SAMPLE_FORMAT) i;
+		}
+	}
+	return SAMPLE_UNKNOWN;
+}
+
+PUBLIC int sampleFormatBytes(SAMPLE_FORMAT format) {
+	return (format == SAMPLE_UNKNOWN) ? 0 :
+			(format == SAMPLE_F32) ? 4 : (int) format + 1;
+}
+
+PUBLIC SAMPLE_FORMAT widerSampleFormat(SAMPLE_FORMAT first,
+		SAMPLE_FORMAT second) {
+	// the formats are in the order of their widths ,float last
+	return (first > second) ? first : second;
+}
+
+PUBLIC void setSampleFormat(HEADER *header, SAMPLE_FORMAT format) {
+	header->AudioFormat =
+			(format == SAMPLE_F32) ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+	header->BitsPerSample = sampleFormatBytes(format) * 8;
+	header->BlockAlign = header->NumChannels * sampleFormatBytes(format);
+	header->ByteRate = header->SampleRate * header->BlockAlign;
+}
+
+PUBLIC int createPlanar(PLANAR *planar, int channels, long frames) {
+	if (planar == NULL || channels < 1 || frames < 0) {
+		return EXIT_FAILURE;
+	}
+	planar->channels = channels;
+	planar->frames = frames;
+	// every channel starts on the alignment ,so the stride is rounded up to it
+	planar->stride = (frames + ALIGN_FLOATS - 1) / ALIGN_FLOATS * ALIGN_FLOATS;
+	if (planar->stride == 0) {
+		planar->stride = ALIGN_FLOATS;
+	}
+	planar->samples = (float *) allocateBuffer(
+			sizeof(float) * planar->stride * channels);
+	return (planar->samples == NULL) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+PUBLIC void freePlanar(PLANAR *planar) {
+	if (planar != NULL) {
+		releaseBuffer((byte *) planar->samples);
+		planar->samples = NULL;
+	}
+}
+
+PUBLIC float *planarChannel(const PLANAR *planar, int channel) {
+	return planar->samples + channel * planar->stride;
+}
+
+#ifdef __SSE2__
+/**
+ * @brief Decode the frames of 16 bits of one or two channels with SSE2
+ *
+ * 	@param *frames the interleaved frames
+ * 	@param count the number of the frames
+ * 	@param channels the number of the channels (1 or 2)
+ * 	@param **planes the array of every channel
+ * 	@return long the number of the frames decoded ,the rest are left to the loops
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long decodeVectors16(const byte *frames, long count, int channels,
+		float *const *planes) {
+	const __m128 scale = _mm_set1_ps(1.0f / 32768);
+	__m128i v, first, second;
+	long i = 0;
+	if (channels == 1) {
+		for (; i + 8 <= count; i += 8) {
+			v = _mm_loadu_si128((const __m128i *) (frames + i * 2));
+			// a sample in the high half of a 32 bits lane is sign extended by the shift
+			first = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			second = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(planes[0] + i,
+					_mm_mul_ps(_mm_cvtepi32_ps(first), scale));
+			_mm_storeu_ps(planes[0] + i + 4,
+					_mm_mul_ps(_mm_cvtepi32_ps(second), scale));
+		}
+	} else {
+		for (; i + 4 <= count; i += 4) {
+			v = _mm_loadu_si128((const __m128i *) (frames + i * 4));
+			// the left sample is the low half of every frame of 32 bits
+			first = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+			second = _mm_srai_epi32(v, 16);
+			_mm_storeu_ps(planes[0] + i,
+					_mm_mul_ps(_mm_cvtepi32_ps(first), scale));
+			_mm_storeu_ps(planes[1] + i,
+					_mm_mul_ps(_mm_cvtepi32_ps(second), scale));
+		}
+	}
+	return i;
+}
+
+/**
+ * @brief Round and clip 4 samples to integers of 16 bits with SSE2
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE __m128i quantizeVector16(const float *samples) {
+	const __m128 full = _mm_set1_ps(32768.0f);
+	const __m128 top = _mm_set1_ps(32767.0f), bottom = _mm_set1_ps(-32768.0f);
+	__m128 v = _mm_mul_ps(_mm_loadu_ps(samples), full);
+	return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, bottom), top));
+}
+
+/**
+ * @brief Encode the frames of 16 bits of one or two channels with SSE2
+ *
+ * 	@param **planes the array of every channel
+ * 	@param count the number of the frames
+ * 	@param channels the number of the channels (1 or 2)
+ * 	@param *frames where the interleaved frames are placed
+ * 	@return long the number of the frames encoded ,the rest are left to the loops
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long encodeVectors16(float *const *planes, long count, int channels,
+		byte *frames) {
+	__m128i left, right;
+	long i = 0;
+	if (channels == 1) {
+		for (; i + 8 <= count; i += 8) {
+			_mm_storeu_si128((__m128i *) (frames + i * 2),
+					_mm_packs_epi32(quantizeVector16(planes[0] + i),
+							quantizeVector16(planes[0] + i + 4)));
+		}
+	} else {
+		for (; i + 4 <= count; i += 4) {
+			left = quantizeVector16(planes[0] + i);
+			right = quantizeVector16(planes[1] + i);
+			_mm_storeu_si128((__m128i *) (frames + i * 4),
+					_mm_packs_epi32(_mm_unpacklo_epi32(left, right),
+							_mm_unpackhi_epi32(left, right)));
+		}
+	}
+	return i;
+}
+
+/**
+ * @brief Split float stereo frames to their two channels with SSE2
+ *
+ * 	@param *frames the interleaved frames
+ * 	@param count the number of the frames
+ * 	@param **planes the array of every channel
+ * 	@return long the number of the frames decoded ,the rest are left to the loops
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long decodeVectorsFloat(const byte *frames, long count,
+		float *const *planes) {
+	__m128 first, second;
+	long i = 0;
+	for (; i + 4 <= count; i += 4) {
+		first = _mm_loadu_ps((const float *) (frames + i * 8));
+		second = _mm_loadu_ps((const float *) (frames + i * 8 + 16));
+		_mm_storeu_ps(planes[0] + i,
+				_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(planes[1] + i,
+				_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	return i;
+}
+
+/**
+ * @brief Interleave two channels of float to stereo frames with SSE2
+ *
+ * 	@param **planes the array of every channel
+ * 	@param count the number of the frames
+ * 	@param *frames where the interleaved frames are placed
+ * 	@return long the number of the frames encoded ,the rest are left to the loops
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long encodeVectorsFloat(float *const *planes, long count, byte *frames) {
+	__m128 left, right;
+	long i = 0;
+	for (; i + 4 <= count; i += 4) {
+		left = _mm_loadu_ps(planes[0] + i);
+		right = _mm_loadu_ps(planes[1] + i);
+		_mm_storeu_ps((float *) (frames + i * 8), _mm_unpacklo_ps(left, right));
+		_mm_storeu_ps((float *) (frames + i * 8 + 16),
+				_mm_unpackhi_ps(left, right));
+	}
+	return i;
+}
+#endif
+
+PUBLIC void decodeSamples(const byte *frames, long count, int channels,
+		SAMPLE_FORMAT format, float *const *planes) {
+	int bytesPerSample = sampleFormatBytes(format), c;
+	long blockAlign = (long) channels * bytesPerSample, first = 0, i;
+	const double scale = 1.0 / (double) (1ULL << (bytesPerSample * 8 - 1));
+	const byte *sample;
+	float *plane;
+	if (format == SAMPLE_F32 && channels == 1) {
+		memcpy(planes[0], frames, sizeof(float) * count);
+		return;
+	}
+#ifdef __SSE2__
+	if (format == SAMPLE_S16 && (channels == 1 || channels == 2)) {
+		first = decodeVectors16(frames, count, channels, planes);
+	} else if (format == SAMPLE_F32 && channels == 2) {
+		first = decodeVectorsFloat(frames, count, planes);
+	}
+#endif
+	for (c = 0; c < channels; c++) {
+		sample = frames + first * blockAlign + c * bytesPerSample;
+		plane = planes[c];
+		if (format == SAMPLE_F32) {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				memcpy(&plane[i], sample, sizeof(float));
+			}
+		} else if (bytesPerSample == 1) {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				plane[i] = (float) (((int) sample[0] - 128) * scale);
+			}
+		} else if (bytesPerSample == 2) {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				plane[i] = (float) (((signed char) sample[1] * 256 + sample[0])
+						* scale);
+			}
+		} else if (bytesPerSample == 3) {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				plane[i] = (float) (((signed char) sample[2] * 65536
+						+ sample[1] * 256 + sample[0]) * scale);
+			}
+		} else {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				plane[i] = (float) (((signed char) sample[3] * 16777216.0
+						+ sample[2] * 65536 + sample[1] * 256 + sample[0])
+						* scale);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Round and clip a sample to an integer of a width
+ *
+ *	A NaN becomes the lowest value ,like with SSE2.
+ *
+ * 	@param sample the sample
+ * 	@param full the value of the highest bit of the width
+ * 	@return long long the integer
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long long quantize(float sample, double full) {
+	double value = nearbyint((double) sample * full);
+	value = (value > full - 1) ? full - 1 : (value >= -full) ? value : -full;
+	return (long long) value;
+}
+
+PUBLIC void encodeSamples(float *const *planes, long count, int channels,
+		SAMPLE_FORMAT format, byte *frames) {
+	int bytesPerSample = sampleFormatBytes(format), c, j;
+	long blockAlign = (long) channels * bytesPerSample, first = 0, i;
+	const double full = (double) (1ULL << (bytesPerSample * 8 - 1));
+	unsigned long long value;
+	const float *plane;
+	byte *sample;
+	if (format == SAMPLE_F32 && channels == 1) {
+		memcpy(frames, planes[0], sizeof(float) * count);
+		return;
+	}
+#ifdef __SSE2__
+	if (format == SAMPLE_S16 && (channels == 1 || channels == 2)) {
+		first = encodeVectors16(planes, count, channels, frames);
+	} else if (format == SAMPLE_F32 && channels == 2) {
+		first = encodeVectorsFloat(planes, count, frames);
+	}
+#endif
+	for (c = 0; c < channels; c++) {
+		sample = frames + first * blockAlign + c * bytesPerSample;
+		plane = planes[c];
+		if (format == SAMPLE_F32) {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				memcpy(sample, &plane[i], sizeof(float));
+			}
+		} else if (bytesPerSample == 1) {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				sample[0] = (byte) (quantize(plane[i], full) + 128);
+			}
+		} else {
+			for (i = first; i < count; i++, sample += blockAlign) {
+				value = (unsigned long long) quantize(plane[i], full);
+				for (j = 0; j < bytesPerSample; j++) {
+					sample[j] = (byte) (value >> (j * 8));
+				}
+			}
+		}
+	}
+}
+
+PUBLIC int decodePlanar(const WAV *wav, PLANAR *planar) {
+	if (wav == NULL || wav->header == NULL || wav->data == NULL
+			|| planar == NULL || wav->header->BlockAlign == 0) {
+		return EXIT_FAILURE;
+	}
+	int channels = wav->header->NumChannels, c;
+	SAMPLE_FORMAT format = sampleFormatOf(wav->header);
+	if (channels < 1 || format == SAMPLE_UNKNOWN) {
+		return EXIT_FAILURE;
+	}
+	long frames = (long) (wav->header->Subchunk2Size
+			/ ((dword) channels * sampleFormatBytes(format)));
+	if (createPlanar(planar, channels, frames) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	float *planes[channels];
+	for (c = 0; c < channels; c++) {
+		planes[c] = planarChannel(planar, c);
+	}
+	decodeSamples(wav->data->channel, frames, channels, format, planes);
+	return EXIT_SUCCESS;
+}
+
+PUBLIC double sumSquaredDifferences(const float *first, const float *second,
+		long count) {
+	double total = 0;
+	float difference;
+	long i = 0;
+#ifdef __SSE2__
+	__m128d sum = _mm_setzero_pd();
+	__m128 d;
+	double lanes[2];
+	for (; i + 4 <= count; i += 4) {
+		d = _mm_sub_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i));
+		d = _mm_mul_ps(d, d);
+		// the squares are added as doubles ,a long sum of floats loses the small ones
+		sum = _mm_add_pd(sum,
+				_mm_add_pd(_mm_cvtps_pd(d), _mm_cvtps_pd(_mm_movehl_ps(d, d))));
+	}
+	_mm_storeu_pd(lanes, sum);
+	total = lanes[0] + lanes[1];
+#endif
+	for (; i < count; i++) {
+		difference = first[i] - second[i];
+		total += (double) (difference * difference);
+	}
+	return total;
+}
+
+PUBLIC double sumSquares(const float *samples, long count) {
+	double total = 0;
+	long i = 0;
+#ifdef __SSE2__
+	__m128d sum = _mm_setzero_pd();
+	__m128 v;
+	double lanes[2];
+	for (; i + 4 <= count; i += 4) {
+		v = _mm_loadu_ps(samples + i);
+		v = _mm_mul_ps(v, v);
+		sum = _mm_add_pd(sum,
+				_mm_add_pd(_mm_cvtps_pd(v), _mm_cvtps_pd(_mm_movehl_ps(v, v))));
+	}
+	_mm_storeu_pd(lanes, sum);
+	total = lanes[0] + lanes[1];
+#endif
+	for (; i < count; i++) {
+		total += (double) (samples[i] * samples[i]);
+	}
+	return total;
+}
+
+PUBLIC void saturateSamples(float *samples, long count) {
+	long i = 0;
+#ifdef __SSE2__
+	const __m128 high = _mm_set1_ps(1), low = _mm_set1_ps(-1);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(samples + i,
+				_mm_max_ps(_mm_min_ps(_mm_loadu_ps(samples + i), high), low));
+	}
+#endif
+	for (; i < count; i++) {
+		if (samples[i] > 1) {
+			samples[i] = 1;
+		} else if (samples[i] < -1) {
+			samples[i] = -1;
+		}
+	}
+}
+
+/**
+ * @brief Add TPDF dither of one step of a format to samples
+ *
+ *	The noise is the difference of two uniform random numbers of one step ,so it is
+ *	triangular from -1 to 1 step and the error of the rounding after it doesn't follow
+ *	the signal.
+ *
+ * 	@param *samples the samples
+ * 	@param count the number of the samples
+ * 	@param format the format of the output
+ * 	@param *seed the state of the generator (xorshift)
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void ditherSamples(float *samples, long count, SAMPLE_FORMAT format,
+		unsigned *seed) {
+	const float step = 1.0f / (float) (1ULL << (sampleFormatBytes(format) * 8 - 1));
+	const float unit = step / 16777216.0f; // a random number of 24 bits in a step
+	unsigned x = *seed, first;
+	long i;
+	for (i = 0; i < count; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		first = x >> 8;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		samples[i] += (float) ((int) first - (int) (x >> 8)) * unit;
+	}
+	*seed = x;
+}
+
+PUBLIC int createConverter(CONVERTER *converter, SAMPLE_FORMAT from,
+		SAMPLE_FORMAT to, int channels, bool dither) {
+	if (converter == NULL || from == SAMPLE_UNKNOWN || to == SAMPLE_UNKNOWN) {
+		return EXIT_FAILURE;
+	}
+	converter->from = from;
+	converter->to = to;
+	converter->channels = channels;
+	converter->dither = dither && to != SAMPLE_F32
+			&& (from == SAMPLE_F32 || to < from);
+	converter->seed = DITHER_SEED;
+	converter->block.samples = NULL;
+	if (from == to) {
+		return EXIT_SUCCESS;
+	}
+	return createPlanar(&converter->block, channels, CONVERT_BLOCK_FRAMES);
+}
+
+PUBLIC void convertFrames(CONVERTER *converter, const byte *in, byte *out,
+		long count) {
+	int channels = converter->channels, c;
+	long inAlign = (long) channels * sampleFormatBytes(converter->from);
+	long outAlign = (long) channels * sampleFormatBytes(converter->to), n;
+	if (converter->from == converter->to) {
+		memmove(out, in, count * inAlign);
+		return;
+	}
+	float *planes[channels];
+	for (c = 0; c < channels; c++) {
+		planes[c] = planarChannel(&converter->block, c);
+	}
+	for (; count > 0; count -= n, in += n * inAlign, out += n * outAlign) {
+		n = (count < CONVERT_BLOCK_FRAMES) ? count : CONVERT_BLOCK_FRAMES;
+		decodeSamples(in, n, channels, converter->from, planes);
+		if (converter->dither) {
+			for (c = 0; c < channels; c++) {
+				ditherSamples(planes[c], n, converter->to, &converter->seed);
+			}
+		}
+		encodeSamples(planes, n, channels, converter->to, out);
+	}
+}
+
+PUBLIC void freeConverter(CONVERTER *converter) {
+	if (converter != NULL) {
+		freePlanar(&converter->block);
+	}
+}
@@ -0,0 +1,267 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the planar samples. The data
+ *  of a .wav keeps the samples of the channels interleaved in bytes of 1 to 4
+ *  bytes ,so every kernel would have to decode them itself. The planar samples
+ *  keep every channel in its own contiguous array of float ,from -1 to 1 ,and
+ *  the arrays start on PLANAR_ALIGN_BYTES ,so the kernels of analysis and
+ *  processing run on plain arrays which the compiler and the SSE2 code of the
+ *  kernels can vectorize. The converters of 16 bits ,the common width ,and of
+ *  float are vectorized with SSE2 in both directions.
+ *
+ *  A converter changes the format of interleaved frames (u8 ,s16 ,s24 ,s32 or
+ *  f32) through a block of planar samples ,with TPDF dither when the samples
+ *  lose bits.
+ */
+#ifndef PLANAR_H
+#define PLANAR_H
+
+#include "utilities.h"
+
+// The alignment of the array of every channel (a cache line)
+#define PLANAR_ALIGN_BYTES 64
+// The number of the frames of the block of a converter
+#define CONVERT_BLOCK_FRAMES 4096
+
+/**
+ * The formats of the samples of a .wav
+ */
+typedef enum {
+	SAMPLE_U8, // unsigned 8 bits
+	SAMPLE_S16, // signed 16 bits
+	SAMPLE_S24, // signed 24 bits in 3 bytes
+	SAMPLE_S32, // signed 32 bits
+	SAMPLE_F32, // IEEE float of 32 bits
+	SAMPLE_UNKNOWN
+} SAMPLE_FORMAT;
+
+/**
+ * The samples of a sound in one array of float for every channel
+ */
+typedef struct {
+	int channels;
+	long frames;
+	long stride; // the floats from the start of a channel to the next one
+	float *samples; // the channel c starts at samples + c * stride
+} PLANAR;
+
+/**
+ * A converter of frames from a sample format to another
+ */
+typedef struct {
+	SAMPLE_FORMAT from;
+	SAMPLE_FORMAT to;
+	int channels;
+	bool dither; // true if the samples lose bits and are dithered
+	unsigned seed; // the state of the generator of the dither
+	PLANAR block; // the samples of a block of frames being converted
+} CONVERTER;
+
+/**
+ * @brief The sample format of a header
+ *
+ * 	@param *header the header
+ * 	@return SAMPLE_FORMAT the format or SAMPLE_UNKNOWN
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC SAMPLE_FORMAT sampleFormatOf(const HEADER *header);
+/**
+ * @brief The sample format of a name
+ *
+ * 	@param *name the name: u8 ,s16 ,s24 ,s32 or f32
+ * 	@return SAMPLE_FORMAT the format or SAMPLE_UNKNOWN
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC SAMPLE_FORMAT parseSampleFormat(const char *name);
+/**
+ * @brief The bytes of a sample of a format
+ *
+ * 	@param format the format
+ * 	@return int the bytes or 0 for SAMPLE_UNKNOWN
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int sampleFormatBytes(SAMPLE_FORMAT format);
+/**
+ * @brief The format of two which keeps the samples of both without loss
+ *
+ *	Float keeps every width ,otherwise the wider one is kept.
+ *
+ * 	@param first the first format
+ * 	@param second the second format
+ * 	@return SAMPLE_FORMAT the wider format
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC SAMPLE_FORMAT widerSampleFormat(SAMPLE_FORMAT first,
+		SAMPLE_FORMAT second);
+/**
+ * @brief Set the sample format of a header and the fields which depend on it
+ *
+ *	The sizes of the header aren't changed.
+ *
+ * 	@param *header the header
+ * 	@param format the format
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void setSampleFormat(HEADER *header, SAMPLE_FORMAT format);
+
+/**
+ * @brief Allocate the arrays of planar samples
+ *
+ *	The samples aren't cleared.
+ *
+ * 	@param *planar the planar samples to fill
+ * 	@param channels the number of the channels
+ * 	@param frames the number of the frames
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int createPlanar(PLANAR *planar, int channels, long frames);
+/**
+ * @brief Free the arrays of planar samples
+ *
+ * 	@param *planar the planar samples
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void freePlanar(PLANAR *planar);
+/**
+ * @brief The array of a channel of planar samples
+ *
+ * 	@param *planar the planar samples
+ * 	@param channel the channel
+ * 	@return float* the first sample of the channel
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC float *planarChannel(const PLANAR *planar, int channel);
+/**
+ * @brief Decode interleaved frames to the arrays of their channels
+ *
+ *	A sample of 8 bits is unsigned ,the others are signed little endian. An integer
+ *	sample becomes its value divided by the value of the highest bit ,so it is from -1
+ *	to 1. A float sample is kept.
+ *
+ * 	@param *frames the interleaved frames
+ * 	@param count the number of the frames
+ * 	@param channels the number of the channels
+ * 	@param format the format of the samples
+ * 	@param **planes the array of every channel where the samples are placed
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void decodeSamples(const byte *frames, long count, int channels,
+		SAMPLE_FORMAT format, float *const *planes);
+/**
+ * @brief Encode the arrays of the channels to interleaved frames
+ *
+ *	The integer samples are rounded to the nearest value and clipped to the range of
+ *	the width. The float samples are kept ,over 1 too.
+ *
+ * 	@param **planes the array of every channel
+ * 	@param count the number of the frames
+ * 	@param channels the number of the channels
+ * 	@param format the format of the samples
+ * 	@param *frames where the interleaved frames are placed
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void encodeSamples(float *const *planes, long count, int channels,
+		SAMPLE_FORMAT format, byte *frames);
+/**
+ * @brief Decode the data of a WAV to planar samples
+ *
+ * 	@param *wav the WAV
+ * 	@param *planar the planar samples ,allocated by this function
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int decodePlanar(const WAV *wav, PLANAR *planar);
+/**
+ * @brief The sum of the squares of the differences of two arrays of samples
+ *
+ * 	@param *first the first array
+ * 	@param *second the second array
+ * 	@param count the number of the samples
+ * 	@return double the sum
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC double sumSquaredDifferences(const float *first, const float *second,
+		long count);
+/**
+ * @brief The sum of the squares of an array of samples
+ *
+ * 	@param *samples the array
+ * 	@param count the number of the samples
+ * 	@return double the sum
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC double sumSquares(const float *samples, long count);
+/**
+ * @brief Limit samples to full scale ,from -1 to 1
+ *
+ * 	@param *samples the samples
+ * 	@param count the number of the samples
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void saturateSamples(float *samples, long count);
+/**
+ * @brief Prepare a converter of frames
+ *
+ *	The samples are dithered with triangular noise of one step of the output
+ *	(TPDF) only if dither is asked and the output is integer and narrower than the
+ *	input or the input is float.
+ *
+ * 	@param *converter the converter to fill
+ * 	@param from the format of the input
+ * 	@param to the format of the output
+ * 	@param channels the number of the channels
+ * 	@param dither true to dither the samples which lose bits
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int createConverter(CONVERTER *converter, SAMPLE_FORMAT from,
+		SAMPLE_FORMAT to, int channels, bool dither);
+/**
+ * @brief Convert frames with a converter
+ *
+ * 	@param *converter the converter
+ * 	@param *in the frames in the format of the input
+ * 	@param *out where the frames in the format of the output are placed
+ * 	@param count the number of the frames
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void convertFrames(CONVERTER *converter, const byte *in, byte *out,
+		long count);
+/**
+ * @brief Free the block of a converter
+ *
+ * 	@param *converter the converter
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void freeConverter(CONVERTER *converter);
+
+#endif
@@ -0,0 +1,489 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file resample.c
+ *  @brief A polyphase windowed sinc resampler of planar samples
+ *
+ *  The filter of a phase p is a sinc with its cutoff below the lower of the two Nyquist
+ *  frequencies ,shifted by p/L of an input sample and shaped by a Kaiser window over
+ *  RESAMPLE_ZEROS zero crossings on each side. The taps of every phase are normalised
+ *  to a sum of 1 ,so a constant stays constant. A ratio with more than MAX_PHASES phases
+ *  (rates with a small common divisor) uses MAX_PHASES phases ,or fewer if the long
+ *  filter of a large down ratio would make the bank more than MAX_BANK_TAPS taps ,and
+ *  rounds the time of an output sample to the nearest of them.
+ *
+ *  Every channel keeps the input samples of the filter of the next output sample in a
+ *  buffer ,which starts with the zeros before the first sample ,so the first output
+ *  sample is at the time of the first input sample.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <math.h>
+#include "bufferPool.h"
+#include "resample.h"
+#include "workerPool.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The zero crossings of the sinc on each side of a filter
+#define RESAMPLE_ZEROS 24
+// The part of the lower Nyquist frequency which is kept
+#define RESAMPLE_ROLLOFF 0.95
+// The beta of the Kaiser window ,about 80 dB of attenuation
+#define KAISER_BETA 8.0
+// The maximum number of the phases of a filter bank
+#define MAX_PHASES 4096
+// The maximum number of the taps of all the phases of a filter bank
+#define MAX_BANK_TAPS (1L << 22)
+// The taps of a filter are a multiple of the floats of a vector
+#define TAP_ALIGN 4
+// The floats of the buffer of a channel are a multiple of a cache line
+#define BUFFER_ALIGN 16
+
+struct RESAMPLER {
+	int channels;
+	long up; // L ,the output rate divided by the common divisor
+	long down; // M ,the input rate divided by the common divisor
+	int phases; // the phases of the bank
+	int taps; // the taps of the filter of a phase
+	int half; // the input samples on each side of the time of an output sample
+	float *bank; // the taps of all the phases ,a phase after the other
+	float *buffers; // the buffer of every channel ,capacity floats each
+	long capacity;
+	long start; // the index of the first sample of the buffers in the padded input
+	long filled; // the number of the samples of the padded input fed
+	long fed; // the number of the input frames fed
+	long next; // the next output frame
+	long total; // the number of the output frames after the end or -1
+	WORKER_POOL *pool; // the threads of the channels or NULL
+};
+
+/**
+ * The work of a channel for a block
+ */
+typedef struct {
+	RESAMPLER *resampler;
+	int channel;
+	float *out;
+	long produced;
+} CHANNEL_JOB;
+
+/**
+ * The resampling of a channel of planar samples
+ */
+typedef struct {
+	const PLANAR *in;
+	PLANAR *out;
+	int channel;
+	dword inRate;
+	dword outRate;
+	int result;
+} PLANAR_JOB;
+
+/**
+ * @brief The modified Bessel function of order 0 ,of the Kaiser window
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE double besselI0(double x) {
+	double sum = 1, term = 1, quarter = x * x / 4;
+	int k;
+	for (k = 1; k < 64 && term > sum * 1e-12; k++) {
+		term *= quarter / ((double) k * k);
+		sum += term;
+	}
+	return sum;
+}
+
+/**
+ * @brief The greatest common divisor of two numbers
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long greatestDivisor(long a, long b) {
+	long r;
+	while (b != 0) {
+		r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+/**
+ * @brief Compute the filter bank of a resampler
+ *
+ * 	@param *resampler the resampler with its ratio ,phases and taps
+ * 	@param cutoff the cutoff in cycles of an input sample
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int computeBank(RESAMPLER *resampler, double cutoff) {
+	double t, u, sum, *value = (double *) malloc(
+			sizeof(double) * resampler->taps);
+	double window = besselI0(KAISER_BETA);
+	float *phase;
+	int p, k;
+	if (value == NULL) {
+		return EXIT_FAILURE;
+	}
+	for (p = 0; p < resampler->phases; p++) {
+		phase = resampler->bank + (long) p * resampler->taps;
+		sum = 0;
+		for (k = 0; k < resampler->taps; k++) {
+			// the distance of the tap from the time of the output sample
+			t = (double) p / resampler->phases + resampler->half - 1 - k;
+			u = t / resampler->half;
+			value[k] = 0;
+			if (u > -1 && u < 1) {
+				value[k] = 2 * cutoff * besselI0(KAISER_BETA * sqrt(1 - u * u))
+						/ window;
+				if (t != 0) {
+					value[k] *= sin(2 * M_PI * cutoff * t) / (2 * M_PI * cutoff * t);
+				}
+			}
+			sum += value[k];
+		}
+		for (k = 0; k < resampler->taps; k++) {
+			phase[k] = (float) (value[k] / sum);
+		}
+	}
+	free(value);
+	return EXIT_SUCCESS;
+}
+
+PUBLIC RESAMPLER *createResampler(int channels, dword inRate, dword outRate) {
+	if (channels < 1 || inRate == 0 || outRate == 0
+			|| inRate / outRate >= MAX_RESAMPLE_RATIO) {
+		return NULL;
+	}
+	RESAMPLER *resampler = (RESAMPLER *) calloc(1, sizeof(RESAMPLER));
+	if (resampler == NULL) {
+		return NULL;
+	}
+	long divisor = greatestDivisor(inRate, outRate);
+	resampler->channels = channels;
+	resampler->up = outRate / divisor;
+	resampler->down = inRate / divisor;
+	resampler->phases =
+			(resampler->up > MAX_PHASES) ? MAX_PHASES : (int) resampler->up;
+	// the cutoff is below the Nyquist frequency of the lower rate
+	double cutoff = 0.5 * RESAMPLE_ROLLOFF
+			* ((resampler->up < resampler->down) ?
+					(double) resampler->up / resampler->down : 1.0);
+	resampler->half = (int) ceil(RESAMPLE_ZEROS / (2 * cutoff));
+	resampler->taps = (2 * resampler->half + TAP_ALIGN - 1) / TAP_ALIGN
+			* TAP_ALIGN;
+	// a long filter keeps fewer phases and rounds the time to them
+	if ((long) resampler->phases * resampler->taps > MAX_BANK_TAPS) {
+		resampler->phases = (int) (MAX_BANK_TAPS / resampler->taps);
+	}
+	resampler->capacity = (2L * resampler->taps + RESAMPLE_BLOCK_FRAMES
+			+ BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+	resampler->bank = (float *) allocateBuffer(
+			sizeof(float) * resampler->phases * resampler->taps);
+	resampler->buffers = (float *) allocateBuffer(
+			sizeof(float) * resampler->capacity * channels);
+	if (resampler->bank == NULL || resampler->buffers == NULL
+			|| computeBank(resampler, cutoff) == EXIT_FAILURE) {
+		freeResampler(&resampler);
+		return NULL;
+	}
+	// the zeros before the first sample
+	memset(resampler->buffers, 0,
+			sizeof(float) * resampler->capacity * channels);
+	resampler->filled = resampler->half - 1;
+	resampler->total = -1;
+	int workers = defaultWorkerCount();
+	if (channels > 1 && workers > 1) {
+		resampler->pool = createWorkerPool(
+				(channels < workers) ? channels : workers, channels);
+	}
+	return resampler;
+}
+
+PUBLIC long resampledFrames(const RESAMPLER *resampler, long frames) {
+	return (frames * resampler->up + resampler->down - 1) / resampler->down;
+}
+
+PUBLIC long resampleCapacity(const RESAMPLER *resampler) {
+	return (RESAMPLE_BLOCK_FRAMES + resampler->taps) * resampler->up
+			/ resampler->down + 2;
+}
+
+/**
+ * @brief Find the first input sample and the phase of an output frame
+ *
+ * 	@param *resampler the resampler
+ * 	@param frame the output frame
+ * 	@param *first where the index of its first sample in the padded input is placed
+ * 	@return int the phase
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int phaseOf(const RESAMPLER *resampler, long frame, long *first) {
+	long position = frame * resampler->down;
+	long remainder = position % resampler->up;
+	long phase = remainder;
+	*first = position / resampler->up;
+	if (resampler->phases != resampler->up) {
+		// the time is rounded to the nearest phase of the bank
+		phase = (remainder * resampler->phases + resampler->up / 2)
+				/ resampler->up;
+		if (phase == resampler->phases) {
+			phase = 0;
+			(*first)++;
+		}
+	}
+	return (int) phase;
+}
+
+/**
+ * @brief The dot product of the taps of a phase and input samples
+ *
+ * 	@param *taps the taps ,aligned to a vector
+ * 	@param *samples the samples
+ * 	@param count the number of the taps ,a multiple of TAP_ALIGN
+ * 	@return float the dot product
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE float dotProduct(const float *taps, const float *samples, int count) {
+	int i;
+#ifdef __SSE2__
+	__m128 first = _mm_setzero_ps(), second = _mm_setzero_ps();
+	float lanes[4];
+	// two sums ,so the additions of the next taps don't wait for the last ones
+	for (i = 0; i + 8 <= count; i += 8) {
+		first = _mm_add_ps(first,
+				_mm_mul_ps(_mm_load_ps(taps + i), _mm_loadu_ps(samples + i)));
+		second = _mm_add_ps(second,
+				_mm_mul_ps(_mm_load_ps(taps + i + 4),
+						_mm_loadu_ps(samples + i + 4)));
+	}
+	if (i < count) {
+		first = _mm_add_ps(first,
+				_mm_mul_ps(_mm_load_ps(taps + i), _mm_loadu_ps(samples + i)));
+	}
+	_mm_storeu_ps(lanes, _mm_add_ps(first, second));
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+	float sum = 0;
+	for (i = 0; i < count; i++) {
+		sum += taps[i] * samples[i];
+	}
+	return sum;
+#endif
+}
+
+/**
+ * @brief Produce the output frames of a channel whose input samples were fed
+ *
+ *	A job of the pool of a resampler ,its argument is a CHANNEL_JOB. The frames start
+ *	from the next frame of the resampler ,which isn't moved.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void produceChannel(void *argument) {
+	CHANNEL_JOB *job = (CHANNEL_JOB *) argument;
+	RESAMPLER *resampler = job->resampler;
+	const float *buffer = resampler->buffers
+			+ (long) job->channel * resampler->capacity;
+	long frame = resampler->next, first;
+	int phase;
+	job->produced = 0;
+	while (resampler->total < 0 || frame < resampler->total) {
+		phase = phaseOf(resampler, frame, &first);
+		if (first + resampler->taps > resampler->filled) {
+			break;
+		}
+		job->out[job->produced++] = dotProduct(
+				resampler->bank + (long) phase * resampler->taps,
+				buffer + (first - resampler->start), resampler->taps);
+		frame++;
+	}
+}
+
+/**
+ * @brief Produce the output frames of all the channels
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long produceFrames(RESAMPLER *resampler, float *const *out) {
+	CHANNEL_JOB jobs[resampler->channels];
+	int c;
+	for (c = 0; c < resampler->channels; c++) {
+		jobs[c].resampler = resampler;
+		jobs[c].channel = c;
+		jobs[c].out = out[c];
+		if (resampler->pool == NULL
+				|| submitJob(resampler->pool, produceChannel, &jobs[c])
+						== EXIT_FAILURE) {
+			produceChannel(&jobs[c]);
+		}
+	}
+	if (resampler->pool != NULL) {
+		waitWorkerPool(resampler->pool);
+	}
+	// every channel produces the same frames
+	resampler->next += jobs[0].produced;
+	return jobs[0].produced;
+}
+
+/**
+ * @brief Drop the samples before the filter of the next output frame
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void dropUsedSamples(RESAMPLER *resampler) {
+	long first, drop, kept;
+	float *buffer;
+	int c;
+	phaseOf(resampler, resampler->next, &first);
+	drop = first - resampler->start;
+	if (drop <= 0) {
+		return;
+	}
+	if (drop > resampler->filled - resampler->start) {
+		drop = resampler->filled - resampler->start;
+	}
+	kept = resampler->filled - resampler->start - drop;
+	for (c = 0; c < resampler->channels; c++) {
+		buffer = resampler->buffers + (long) c * resampler->capacity;
+		memmove(buffer, buffer + drop, sizeof(float) * kept);
+	}
+	resampler->start += drop;
+}
+
+PUBLIC long resampleFrames(RESAMPLER *resampler, float *const *in, long count,
+		float *const *out) {
+	long used;
+	int c;
+	if (resampler == NULL || count < 0 || count > RESAMPLE_BLOCK_FRAMES
+			|| resampler->total >= 0) {
+		return -1;
+	}
+	dropUsedSamples(resampler);
+	used = resampler->filled - resampler->start;
+	for (c = 0; c < resampler->channels; c++) {
+		memcpy(resampler->buffers + (long) c * resampler->capacity + used, in[c],
+				sizeof(float) * count);
+	}
+	resampler->filled += count;
+	resampler->fed += count;
+	return produceFrames(resampler, out);
+}
+
+PUBLIC long finishResampler(RESAMPLER *resampler, float *const *out) {
+	long used;
+	int c;
+	if (resampler == NULL) {
+		return -1;
+	}
+	if (resampler->total < 0) {
+		// the silence after the end ,enough for the filter of the last frame
+		dropUsedSamples(resampler);
+		used = resampler->filled - resampler->start;
+		for (c = 0; c < resampler->channels; c++) {
+			memset(resampler->buffers + (long) c * resampler->capacity + used, 0,
+					sizeof(float) * resampler->taps);
+		}
+		resampler->filled += resampler->taps;
+		resampler->total = resampledFrames(resampler, resampler->fed);
+	}
+	return produceFrames(resampler, out);
+}
+
+PUBLIC void freeResampler(RESAMPLER **resampler) {
+	if (resampler == NULL || *resampler == NULL) {
+		return;
+	}
+	destroyWorkerPool(&(*resampler)->pool);
+	releaseBuffer((byte *) (*resampler)->bank);
+	releaseBuffer((byte *) (*resampler)->buffers);
+	free(*resampler);
+	*resampler = NULL;
+}
+
+/**
+ * @brief Resample a channel of planar samples
+ *
+ *	A job of the worker pool ,its argument is a PLANAR_JOB.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void resampleChannel(void *argument) {
+	PLANAR_JOB *job = (PLANAR_JOB *) argument;
+	RESAMPLER *resampler = createResampler(1, job->inRate, job->outRate);
+	float *in = planarChannel(job->in, job->channel);
+	float *out = planarChannel(job->out, job->channel);
+	long i, count, produced = 0;
+	if (resampler == NULL) {
+		job->result = EXIT_FAILURE;
+		return;
+	}
+	for (i = 0; i < job->in->frames; i += count) {
+		count = job->in->frames - i;
+		count = (count < RESAMPLE_BLOCK_FRAMES) ? count : RESAMPLE_BLOCK_FRAMES;
+		float *input = in + i, *output = out + produced;
+		produced += resampleFrames(resampler, &input, count, &output);
+	}
+	float *output = out + produced;
+	finishResampler(resampler, &output);
+	freeResampler(&resampler);
+	job->result = EXIT_SUCCESS;
+}
+
+PUBLIC int resamplePlanar(const PLANAR *in, dword inRate, dword outRate,
+		PLANAR *out) {
+	if (in == NULL || out == NULL || inRate == 0 || outRate == 0) {
+		return EXIT_FAILURE;
+	}
+	long divisor = greatestDivisor(inRate, outRate);
+	long frames = (in->frames * (long) (outRate / divisor)
+			+ (long) (inRate / divisor) - 1) / (long) (inRate / divisor);
+	if (createPlanar(out, in->channels, frames) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	if (inRate == outRate) {
+		memcpy(out->samples, in->samples,
+				sizeof(float) * in->stride * in->channels);
+		return EXIT_SUCCESS;
+	}
+	PLANAR_JOB jobs[in->channels];
+	int workers = defaultWorkerCount(), c, result = EXIT_SUCCESS;
+	WORKER_POOL *pool = NULL;
+	if (in->channels > 1 && workers > 1) {
+		pool = createWorkerPool((in->channels < workers) ? in->channels : workers,
+				in->channels);
+	}
+	for (c = 0; c < in->channels; c++) {
+		jobs[c].in = in;
+		jobs[c].out = out;
+		jobs[c].channel = c;
+		jobs[c].inRate = inRate;
+		jobs[c].outRate = outRate;
+		if (pool == NULL
+				|| submitJob(pool, resampleChannel, &jobs[c]) == EXIT_FAILURE) {
+			resampleChannel(&jobs[c]);
+		}
+	}
+	destroyWorkerPool(&pool);
+	for (c = 0; c < in->channels; c++) {
+		if (jobs[c].result == EXIT_FAILURE) {
+			result = EXIT_FAILURE;
+		}
+	}
+	if (result == EXIT_FAILURE) {
+		freePlanar(out);
+	}
+	return result;
+}
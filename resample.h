@@ -0,0 +1,120 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the resampler of planar
+ *  samples. A rate is changed by the ratio L/M of the two rates (divided by
+ *  their greatest common divisor): an output sample is a windowed sinc filter
+ *  of the input samples around its time ,and its time is one of L phases
+ *  between two input samples. The filters of the L phases (the filter bank)
+ *  are computed once for the ratio ,so a sample costs only a dot product of
+ *  the taps and the input ,which is vectorized with SSE2.
+ *
+ *  The resampler is fed blocks of frames and gives the frames it can produce
+ *  ,so a stream of any length is resampled with a few blocks in memory. The
+ *  channels are independent and are resampled by worker threads on more than
+ *  one core.
+ */
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include "planar.h"
+
+// The maximum number of the frames fed to a resampler at once
+#define RESAMPLE_BLOCK_FRAMES 4096
+// The highest sample rate a sound is resampled to
+#define MAX_SAMPLE_RATE 768000
+// The highest ratio of the rates a sound is resampled down by
+#define MAX_RESAMPLE_RATIO 256
+
+typedef struct RESAMPLER RESAMPLER;
+
+/**
+ * @brief Create a resampler
+ *
+ *	The input rate can be at most MAX_RESAMPLE_RATIO times the output rate.
+ *
+ * 	@param channels the number of the channels
+ * 	@param inRate the sample rate of the input
+ * 	@param outRate the sample rate of the output
+ * 	@return RESAMPLER* the resampler or NULL on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC RESAMPLER *createResampler(int channels, dword inRate, dword outRate);
+/**
+ * @brief The number of the frames of the output of a number of input frames
+ *
+ * 	@param *resampler the resampler
+ * 	@param frames the number of the input frames
+ * 	@return long the number of the output frames
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC long resampledFrames(const RESAMPLER *resampler, long frames);
+/**
+ * @brief The most frames produced by a call of resampleFrames or finishResampler
+ *
+ * 	@param *resampler the resampler
+ * 	@return long the number of the frames the output arrays must keep
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC long resampleCapacity(const RESAMPLER *resampler);
+/**
+ * @brief Feed frames to a resampler and take the frames it produces
+ *
+ *	An output frame is produced when all the input frames of its filter were fed ,so
+ *	the first calls produce fewer frames than their ratio.
+ *
+ * 	@param *resampler the resampler
+ * 	@param **in the array of every channel of the input frames
+ * 	@param count the number of the input frames (up to RESAMPLE_BLOCK_FRAMES)
+ * 	@param **out the array of every channel where the output frames are placed
+ * 	@return long the number of the output frames
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC long resampleFrames(RESAMPLER *resampler, float *const *in, long count,
+		float *const *out);
+/**
+ * @brief Take the last frames of a resampler after the end of the input
+ *
+ *	The input is taken as silence after its end.
+ *
+ * 	@param *resampler the resampler
+ * 	@param **out the array of every channel where the output frames are placed
+ * 	@return long the number of the output frames
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC long finishResampler(RESAMPLER *resampler, float *const *out);
+/**
+ * @brief Free a resampler
+ *
+ * 	@param **resampler the pointer of the variable which holds the resampler
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void freeResampler(RESAMPLER **resampler);
+/**
+ * @brief Resample all the planar samples of a sound
+ *
+ *	Every channel is resampled by a worker thread of its own on more than one core. The
+ *	samples are copied if the rates are equal.
+ *
+ * 	@param *in the planar samples
+ * 	@param inRate the sample rate of the samples
+ * 	@param outRate the new sample rate
+ * 	@param *out the resampled planar samples ,allocated by this function
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int resamplePlanar(const PLANAR *in, dword inRate, dword outRate,
+		PLANAR *out);
+
+#endif
@@ -20,27 +20,10 @@
 *
 */
 #include "utilities.h"
+#include "wavbuffer.h"
 
 
 
-/**
- * @brief This method reverses a struct of type WAV (sound track)
- *
- * This method  reverses the segment data of a struct of type WAV, so
- * the first sample to be last ,the second to be before last ,and so on. After
- * creating the reversed sound track , the struct created (of type WAV) is 
- * placed in a place in memory (variable) which address of that place is given
- * as a parameter.
- *
- * @param a pointer to a struct of type WAV which is the sound track to reverse
- *
- * @return EXIT_SUCCESSif the reverse-method was executed successfully or
- *         EXIT_FAILURE if there was a problem during the execution of the method
- * @author Valentinos Pariza
- */
-PRIVATE int reverseWav(WAV* soundtrack, WAV** reversedSoundTrack);
-
-
 PUBLIC int reverse(char* fileName) {
 	if (fileName == NULL)
 		return EXIT_FAILURE;
@@ -49,97 +32,33 @@ PUBLIC int reverse(char* fileName) {
 
 	if (readWAV(fileName, &wav) == EXIT_FAILURE)
 		return EXIT_FAILURE;
-	WAV* reversedWAV = NULL;
-	if (reverseWav(wav, &reversedWAV) == EXIT_FAILURE) {
-		deleteWAV(&wav);
-		return EXIT_SUCCESS;
-	}
+	WAV reversedWAV;
+	WAV_STATUS status = wav_reverse(wav, &reversedWAV);
+	deleteWAV(&wav);
+	if (status != WAV_OK)
+		return EXIT_FAILURE;
 	char* destinationFileName = NULL;
 
 	char index[9] = "reverse-";
 
 	if (createOutputFilename(fileName, index,
 			&destinationFileName)==EXIT_FAILURE
-			|| writeWAV(destinationFileName, reversedWAV)==EXIT_FAILURE) {
+			|| writeWAV(destinationFileName, &reversedWAV)==EXIT_FAILURE) {
 		free(destinationFileName);
-		deleteWAV(&reversedWAV);
-		deleteWAV(&wav);
+		wav_free(&reversedWAV);
 		return EXIT_FAILURE;
 	}
-	printf("The reversed soundtrack taken from file %s has been saved to"
+	printOutput("The reversed soundtrack taken from file %s has been saved to"
 			" file : %s.\n", fileName, destinationFileName);
 
 	free(destinationFileName);
-	deleteWAV(&wav);
-	deleteWAV(&reversedWAV);
+	wav_free(&reversedWAV);
 
 	return EXIT_SUCCESS;
 }
 
 
 
-PRIVATE int reverseWav(WAV* soundtrack, WAV** reversedSoundTrack) {
-	if (soundtrack == NULL || reversedSoundTrack == NULL)
-		return EXIT_FAILURE;
-	if (!isCorrectFormatWAV(soundtrack))
-		return EXIT_FAILURE;
-
-	long sampleBlockBytes = soundtrack->header->BlockAlign;
-
-	(*reversedSoundTrack) = (WAV*) malloc(sizeof(WAV));
-
-	if ((*reversedSoundTrack) == NULL)
-		return EXIT_FAILURE;
-
-	(*reversedSoundTrack)->header = (HEADER*) malloc(sizeof(HEADER));
-
-	if ((*reversedSoundTrack)->header == NULL) {
-		free((*reversedSoundTrack));
-		(*reversedSoundTrack) = NULL;
-		return EXIT_FAILURE;
-	}
-
-	(*reversedSoundTrack)->data = (DATA*) malloc(sizeof(DATA));
-
-	if ((*reversedSoundTrack)->data == NULL) {
-		free((*reversedSoundTrack)->header);
-		free((*reversedSoundTrack));
-		(*reversedSoundTrack) = NULL;
-
-		return EXIT_FAILURE;
-	}
-
-	(*reversedSoundTrack)->data->channel = (byte*) malloc(
-			soundtrack->header->Subchunk2Size);
-
-	if ((*reversedSoundTrack)->data->channel == NULL) {
-		free((*reversedSoundTrack)->header);
-		free((*reversedSoundTrack)->data);
-		free((*reversedSoundTrack));
-		(*reversedSoundTrack) = NULL;
-
-		return EXIT_FAILURE;
-	}
-
-	memcpy((*reversedSoundTrack)->header, soundtrack->header, sizeof(HEADER));
-
-	long numberOfSamples = (soundtrack->header->Subchunk2Size << 3)
-			/ (soundtrack->header->BitsPerSample
-					* soundtrack->header->NumChannels);
-
-	byte* pointerSrc = (soundtrack->data->channel)
-			+ soundtrack->header->Subchunk2Size - sampleBlockBytes;
-	byte* pointerDest = (*reversedSoundTrack)->data->channel;
-
-	for (long i = 0; i < (numberOfSamples); i++) {
-		memcpy(pointerDest, pointerSrc, sampleBlockBytes);
-		pointerSrc -= sampleBlockBytes;
-		pointerDest += sampleBlockBytes;
-	}
-
-	return EXIT_SUCCESS;
-}
-
 #ifdef DEBUG_REVERSE
 #define _GNU_SOURCE
 
@@ -0,0 +1,220 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file ringBuffer.c
+ *  @brief A ring buffer of blocks between a producer and a consumer without locks
+ *
+ *  The producer and the consumer each own a side of the ring on its own cache line:
+ *  the index of the next slot ,a signal which is changed with the index and at the
+ *  end ,and whether the side may be sleeping. A side which finds the ring full or
+ *  empty spins for a while and then sleeps on the futex of the signal of the other
+ *  side ,which wakes it only when it said it may be sleeping.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "bufferPool.h"
+#include "ringBuffer.h"
+
+#define CACHE_LINE_BYTES 64
+// The checks of the other side before a side sleeps
+#define SPIN_CHECKS 256
+
+/**
+ * A side of a ring buffer
+ */
+typedef struct {
+	unsigned index; // the tail of the producer or the head of the consumer
+	unsigned signal; // changed with the index and at the end ,the futex of the side
+	int sleeping; // 1 while the side may sleep on the signal of the other side
+	int done; // the producer finished or the consumer closed
+	unsigned long long count; // the slots written or read
+	unsigned long long waits;
+} SIDE;
+
+/**
+ * A side alone on a cache line
+ */
+typedef union {
+	SIDE side;
+	char line[CACHE_LINE_BYTES];
+} PADDED_SIDE;
+
+struct RING_BUFFER {
+	PADDED_SIDE producer;
+	PADDED_SIDE consumer;
+	unsigned slots; // a power of two
+	size_t slotBytes;
+	byte *buffer;
+	long *lengths;
+};
+
+/**
+ * @brief Check whether a side can go on
+ *
+ * 	@param *other the other side
+ * 	@param busy the index of the other side at which the side can't go on
+ * 	@return bool true if the index of the other side moved or it is done
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE bool canGoOn(SIDE *other, unsigned busy) {
+	return __atomic_load_n(&other->index, __ATOMIC_SEQ_CST) != busy
+			|| __atomic_load_n(&other->done, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Wait until the other side moves its index from a value or is done
+ *
+ * 	@param *self the side which waits
+ * 	@param *other the other side
+ * 	@param busy the index of the other side at which the side can't go on
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void waitSide(SIDE *self, SIDE *other, unsigned busy) {
+	int i;
+	if (canGoOn(other, busy)) {
+		return;
+	}
+	__atomic_add_fetch(&self->waits, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < SPIN_CHECKS; i++) {
+		if (canGoOn(other, busy)) {
+			return;
+		}
+	}
+	while (true) {
+		// the signal is read after sleeping is set ,so a change after it wakes the side
+		__atomic_store_n(&self->sleeping, 1, __ATOMIC_SEQ_CST);
+		unsigned signal = __atomic_load_n(&other->signal, __ATOMIC_SEQ_CST);
+		if (canGoOn(other, busy)) {
+			break;
+		}
+		syscall(SYS_futex, &other->signal, FUTEX_WAIT_PRIVATE, signal, NULL,
+				NULL, 0);
+	}
+	__atomic_store_n(&self->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Change the signal of a side and wake the other side if it may be sleeping
+ *
+ * 	@param *self the side which changed
+ * 	@param *other the other side
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void signalSide(SIDE *self, SIDE *other) {
+	__atomic_add_fetch(&self->signal, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&other->sleeping, __ATOMIC_SEQ_CST)) {
+		syscall(SYS_futex, &self->signal, FUTEX_WAKE_PRIVATE, INT_MAX, NULL,
+				NULL, 0);
+	}
+}
+
+PUBLIC RING_BUFFER *createRingBuffer(int slots, size_t slotBytes) {
+	void *memory = NULL;
+	unsigned count = 1;
+	if (slots < 1 || slotBytes == 0) {
+		return NULL;
+	}
+	while (count < (unsigned) slots) {
+		count <<= 1;
+	}
+	if (posix_memalign(&memory, CACHE_LINE_BYTES, sizeof(RING_BUFFER)) != 0) {
+		return NULL;
+	}
+	RING_BUFFER *ring = (RING_BUFFER *) memory;
+	memset(ring, 0, sizeof(RING_BUFFER));
+	ring->slots = count;
+	// the slots start on cache lines ,so two slots don't share a line
+	ring->slotBytes = (slotBytes + CACHE_LINE_BYTES - 1) / CACHE_LINE_BYTES
+			* CACHE_LINE_BYTES;
+	ring->buffer = allocateBuffer(ring->slotBytes * count);
+	ring->lengths = (long *) calloc(count, sizeof(long));
+	if (ring->buffer == NULL || ring->lengths == NULL) {
+		freeRingBuffer(&ring);
+		return NULL;
+	}
+	return ring;
+}
+
+PUBLIC byte *acquireWriteSlot(RING_BUFFER *ring) {
+	SIDE *producer = &ring->producer.side, *consumer = &ring->consumer.side;
+	unsigned tail = producer->index;
+	// the ring is full while the head is a whole ring behind the tail
+	waitSide(producer, consumer, tail - ring->slots);
+	if (__atomic_load_n(&consumer->done, __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+	return ring->buffer + (size_t) (tail & (ring->slots - 1)) * ring->slotBytes;
+}
+
+PUBLIC void commitWriteSlot(RING_BUFFER *ring, long length) {
+	SIDE *producer = &ring->producer.side, *consumer = &ring->consumer.side;
+	unsigned tail = producer->index;
+	ring->lengths[tail & (ring->slots - 1)] = length;
+	__atomic_store_n(&producer->index, tail + 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&producer->count, 1, __ATOMIC_RELAXED);
+	signalSide(producer, consumer);
+}
+
+PUBLIC void finishRingBuffer(RING_BUFFER *ring) {
+	__atomic_store_n(&ring->producer.side.done, 1, __ATOMIC_SEQ_CST);
+	signalSide(&ring->producer.side, &ring->consumer.side);
+}
+
+PUBLIC byte *acquireReadSlot(RING_BUFFER *ring, long *length) {
+	SIDE *producer = &ring->producer.side, *consumer = &ring->consumer.side;
+	unsigned head = consumer->index;
+	waitSide(consumer, producer, head);
+	// a finished producer may have written slots before it finished
+	if (__atomic_load_n(&producer->index, __ATOMIC_ACQUIRE) == head) {
+		return NULL;
+	}
+	*length = ring->lengths[head & (ring->slots - 1)];
+	return ring->buffer + (size_t) (head & (ring->slots - 1)) * ring->slotBytes;
+}
+
+PUBLIC void releaseReadSlot(RING_BUFFER *ring) {
+	SIDE *producer = &ring->producer.side, *consumer = &ring->consumer.side;
+	__atomic_store_n(&consumer->index, consumer->index + 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&consumer->count, 1, __ATOMIC_RELAXED);
+	signalSide(consumer, producer);
+}
+
+PUBLIC void closeRingBuffer(RING_BUFFER *ring) {
+	__atomic_store_n(&ring->consumer.side.done, 1, __ATOMIC_SEQ_CST);
+	signalSide(&ring->consumer.side, &ring->producer.side);
+}
+
+PUBLIC void getRingStatistics(RING_BUFFER *ring, RING_STATISTICS *statistics) {
+	statistics->written = __atomic_load_n(&ring->producer.side.count,
+			__ATOMIC_RELAXED);
+	statistics->read = __atomic_load_n(&ring->consumer.side.count,
+			__ATOMIC_RELAXED);
+	statistics->fullWaits = __atomic_load_n(&ring->producer.side.waits,
+			__ATOMIC_RELAXED);
+	statistics->emptyWaits = __atomic_load_n(&ring->consumer.side.waits,
+			__ATOMIC_RELAXED);
+}
+
+PUBLIC void freeRingBuffer(RING_BUFFER **ring) {
+	if (ring == NULL || *ring == NULL) {
+		return;
+	}
+	releaseBuffer((*ring)->buffer);
+	free((*ring)->lengths);
+	free(*ring);
+	*ring = NULL;
+}
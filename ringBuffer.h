@@ -0,0 +1,127 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of a ring buffer of blocks
+ *  between one producer thread and one consumer thread. The two threads share
+ *  no lock: the producer only moves the tail and the consumer only moves the
+ *  head ,each on its own cache line ,and a thread waits on a futex only when
+ *  the ring is full (the producer) or empty (the consumer). The ring keeps at
+ *  most its number of slots ,so a producer faster than its consumer is held
+ *  back (backpressure).
+ */
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include "utilities.h"
+
+typedef struct RING_BUFFER RING_BUFFER;
+
+/**
+ * The counters of a ring buffer
+ */
+typedef struct {
+	unsigned long long written; // the slots written by the producer
+	unsigned long long read; // the slots read by the consumer
+	unsigned long long fullWaits; // the times the producer waited for a slot
+	unsigned long long emptyWaits; // the times the consumer waited for a slot
+} RING_STATISTICS;
+
+/**
+ * @brief Create a ring buffer
+ *
+ * 	@param slots the number of the slots ,rounded up to a power of two
+ * 	@param slotBytes the number of the bytes of a slot
+ * 	@return RING_BUFFER* the ring or NULL if there isn't enough memory
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC RING_BUFFER *createRingBuffer(int slots, size_t slotBytes);
+/**
+ * @brief Give the producer the next free slot
+ *
+ *	This function waits while the ring is full.
+ *
+ * 	@param *ring the ring
+ * 	@return byte* the slot or NULL if the consumer closed the ring
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC byte *acquireWriteSlot(RING_BUFFER *ring);
+/**
+ * @brief Pass the slot of acquireWriteSlot to the consumer
+ *
+ * 	@param *ring the ring
+ * 	@param length a number kept with the slot (the length of its data)
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void commitWriteSlot(RING_BUFFER *ring, long length);
+/**
+ * @brief Tell the consumer that nothing more is written
+ *
+ * 	@param *ring the ring
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void finishRingBuffer(RING_BUFFER *ring);
+/**
+ * @brief Give the consumer the next written slot
+ *
+ *	This function waits while the ring is empty.
+ *
+ * 	@param *ring the ring
+ * 	@param *length where the number kept with the slot is placed
+ * 	@return byte* the slot or NULL if the producer finished and the ring is empty
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC byte *acquireReadSlot(RING_BUFFER *ring, long *length);
+/**
+ * @brief Give the slot of acquireReadSlot back to the producer
+ *
+ * 	@param *ring the ring
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void releaseReadSlot(RING_BUFFER *ring);
+/**
+ * @brief Tell the producer that nothing more is read
+ *
+ *	A producer waiting for a slot or asking for one after this gets NULL.
+ *
+ * 	@param *ring the ring
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void closeRingBuffer(RING_BUFFER *ring);
+/**
+ * @brief Read the counters of a ring buffer
+ *
+ * 	@param *ring the ring
+ * 	@param *statistics where the counters are placed
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void getRingStatistics(RING_BUFFER *ring, RING_STATISTICS *statistics);
+/**
+ * @brief Free a ring buffer
+ *
+ *	Both threads must have stopped using the ring. The variable which holds the
+ *	ring is set to NULL.
+ *
+ * 	@param **ring the pointer of the variable which holds the ring
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void freeRingBuffer(RING_BUFFER **ring);
+
+#endif
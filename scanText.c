@@ -0,0 +1,505 @@
+/**
+*
+* scanText.c Copyright (C) 2018  Valentinos Pariza 
+*
+*
+* This program is free software: you can redistribute it and/or modify it under 
+* the terms of the GNU General Public License as published by the Free Software
+* Foundation, either version 3 of the License, or at your option) any later version. 
+*
+*
+* This program is distributed in the hope that it will be useful, but WITHOUT 
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+* FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details. 
+*
+* Υou should have received a copy of the GNU General Public License along with 
+* this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*
+* This file contains the implementation of the scanText method ,which checks
+* all the soundtracks of a directory for messages hidden by encodeText. The
+* files are checked by a pool of worker threads and from every file only the
+* pages which contain the samples of the header and the message are read. The
+* rows of the report are written in order as the checks end ,so only the
+* messages of a window of files are kept in memory.
+*
+*/
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "utilities.h"
+#include "cryptoUtilities.h"
+#include "workerPool.h"
+#include "wavelib.h"
+
+// The size of a page of a file
+#define SCAN_PAGE_BYTES 4096
+
+// The maximum number of bytes read with a single pread
+#define SCAN_SPAN_BYTES (16 * SCAN_PAGE_BYTES)
+
+// The number of bytes of the message extracted at a time
+#define SCAN_BLOCK_BYTES (3 * 4096)
+
+// The number of the files checked ahead of the row written for every worker
+#define SCAN_WINDOW_PER_WORKER 8
+
+/**
+ * The result of the check of a soundtrack
+ */
+typedef enum {
+	SCAN_OK, SCAN_CRC_MISMATCH, SCAN_NO_PAYLOAD, SCAN_INVALID_WAV, SCAN_UNREADABLE
+} SCAN_STATUS;
+
+PRIVATE const char *SCAN_STATUS_NAMES[] = { "ok", "crc-mismatch", "no-payload",
+		"invalid-wav", "unreadable" };
+
+/**
+ * The lock and the condition of the results of a scan ,signalled when a check ends
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t finished;
+} SCAN_WINDOW;
+
+/**
+ * A soundtrack to check and the result of the check
+ */
+typedef struct {
+	char *fileName;
+	SCAN_STATUS status;
+	int bitsPerSample;
+	dword length;
+	dword crc;
+	byte *payload;
+	bool finished;
+	SCAN_WINDOW *window;
+} SCAN_RESULT;
+
+/**
+ * A byte of a file to read and the place where it is stored
+ */
+typedef struct {
+	long offset;
+	long index;
+} SAMPLE_BYTE;
+
+/**
+ * @brief Compares two bytes to read by their offsets (for qsort)
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE int compareSampleBytes(const void *a, const void *b) {
+	long first = ((const SAMPLE_BYTE *) a)->offset;
+	long second = ((const SAMPLE_BYTE *) b)->offset;
+	return (first > second) - (first < second);
+}
+
+/**
+ * @brief Reads the least significant bytes of some samples of a file
+ *
+ *	The bytes are sorted by their offsets and they are read with pread in spans
+ *	of nearby pages ,so every page which contains a wanted byte is read once and
+ *	the pages between far bytes are not read at all.
+ *
+ * 	@param fd the file descriptor of the soundtrack
+ * 	@param *positions the positions of the samples
+ * 	@param count the number of the samples
+ * 	@param bytesPerSample the number of bytes of a sample
+ * 	@param dataOffset the offset of the data of the soundtrack in the file
+ * 	@param *out where the count bytes are placed ,in the order of the positions
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int readSampleBytes(int fd, const int *positions, long count,
+		int bytesPerSample, long dataOffset, byte *out) {
+	SAMPLE_BYTE *wanted = (SAMPLE_BYTE *) malloc(sizeof(SAMPLE_BYTE) * count);
+	byte *span = (byte *) malloc(SCAN_SPAN_BYTES);
+	if (wanted == NULL || span == NULL) {
+		free(wanted);
+		free(span);
+		return EXIT_FAILURE;
+	}
+	long i, j;
+	for (i = 0; i < count; i++) {
+		wanted[i].offset = dataOffset + (long) positions[i] * bytesPerSample;
+		wanted[i].index = i;
+	}
+	qsort(wanted, count, sizeof(SAMPLE_BYTE), compareSampleBytes);
+	for (i = 0; i < count; i = j) {
+		long start = wanted[i].offset - wanted[i].offset % SCAN_PAGE_BYTES;
+		long end = start + SCAN_PAGE_BYTES;
+		// grow the span while the next byte is at most a page further
+		for (j = i + 1; j < count; j++) {
+			if (wanted[j].offset >= end + SCAN_PAGE_BYTES) {
+				break;
+			}
+			if (wanted[j].offset >= end) {
+				if (end + SCAN_PAGE_BYTES - start > SCAN_SPAN_BYTES) {
+					break;
+				}
+				end += SCAN_PAGE_BYTES;
+			}
+		}
+		ssize_t bytesRead = pread(fd, span, end - start, start);
+		if (bytesRead <= wanted[j - 1].offset - start) {
+			free(wanted);
+			free(span);
+			return EXIT_FAILURE;
+		}
+		long k;
+		for (k = i; k < j; k++) {
+			out[wanted[k].index] = span[wanted[k].offset - start];
+		}
+	}
+	free(wanted);
+	free(span);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Checks a soundtrack for a hidden message
+ *
+ *	It reads the chunks of the file ,then the samples of the header of the
+ *	message and then the samples of the message ,checking its CRC-32. It is run
+ *	by scanJob on a worker of the pool.
+ *
+ * 	@param *argument a pointer to a struct of type SCAN_RESULT
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void scanFile(void *argument) {
+	SCAN_RESULT *result = (SCAN_RESULT *) argument;
+	HEADER header;
+	result->status = SCAN_UNREADABLE;
+	int fd = open(result->fileName, O_RDONLY);
+	if (fd < 0) {
+		return;
+	}
+	long dataOffset = 0;
+	if (readHeaderFd(fd, &header, &dataOffset) == EXIT_FAILURE) {
+		close(fd);
+		return;
+	}
+	result->status = SCAN_INVALID_WAV;
+	if (!isCorrectFormatHeader(&header)) {
+		close(fd);
+		return;
+	}
+	int bytesPerSample = header.BitsPerSample >> 3;
+	long domain = header.Subchunk2Size / bytesPerSample;
+	result->status = SCAN_NO_PAYLOAD;
+	if (domain < PAYLOAD_HEADER_BITS) {
+		close(fd);
+		return;
+	}
+	int *positions = (int *) malloc(sizeof(int) * (SCAN_BLOCK_BYTES << 3));
+	byte *symbols = (byte *) malloc(SCAN_BLOCK_BYTES << 3);
+	byte headerBytes[PAYLOAD_HEADER_BYTES];
+	byte flags = 0;
+	int k = 0;
+	if (positions == NULL || symbols == NULL) {
+		free(positions);
+		free(symbols);
+		close(fd);
+		return;
+	}
+	result->status = SCAN_UNREADABLE;
+	if (createPositionSchedule(positions, 0, PAYLOAD_HEADER_BITS, domain,
+			SYSTEM_KEY_INTEGER) == EXIT_FAILURE
+			|| readSampleBytes(fd, positions, PAYLOAD_HEADER_BITS,
+					bytesPerSample, dataOffset, symbols) == EXIT_FAILURE) {
+		free(positions);
+		free(symbols);
+		close(fd);
+		return;
+	}
+	joinSymbols(symbols, PAYLOAD_HEADER_BITS, 1, headerBytes);
+	result->status = SCAN_NO_PAYLOAD;
+	if (decodePayloadHeader(headerBytes, &result->length, &result->crc,
+			&flags) == EXIT_FAILURE
+			|| (k = (flags & PAYLOAD_FLAG_BITS_MASK) + 1) > (bytesPerSample << 3)
+			|| PAYLOAD_HEADER_BITS + (((long) result->length << 3) + k - 1) / k
+					> domain) {
+		free(positions);
+		free(symbols);
+		close(fd);
+		return;
+	}
+	result->bitsPerSample = k;
+	// one more byte for the padding of the last symbol
+	result->payload = (byte *) malloc(result->length + 1);
+	long done = 0, bytes = 0, count = 0;
+	result->status = SCAN_UNREADABLE;
+	while (result->payload != NULL && done < (long) result->length) {
+		bytes = (long) result->length - done;
+		if (bytes > SCAN_BLOCK_BYTES) {
+			bytes = SCAN_BLOCK_BYTES;
+		}
+		count = ((bytes << 3) + k - 1) / k;
+		if (createPositionSchedule(positions,
+				PAYLOAD_HEADER_BITS + (done << 3) / k, count, domain,
+				SYSTEM_KEY_INTEGER) == EXIT_FAILURE
+				|| readSampleBytes(fd, positions, count, bytesPerSample,
+						dataOffset, symbols) == EXIT_FAILURE) {
+			break;
+		}
+		// keep only the k least significant bits of every byte
+		long i;
+		for (i = 0; i < count; i++) {
+			symbols[i] &= (byte) ((1 << k) - 1);
+		}
+		joinSymbols(symbols, count, k, result->payload + done);
+		done += bytes;
+	}
+	if (result->payload != NULL && done == (long) result->length) {
+		result->status =
+				(crc32Update(0, result->payload, result->length) == result->crc) ?
+						SCAN_OK : SCAN_CRC_MISMATCH;
+	}
+	free(positions);
+	free(symbols);
+	close(fd);
+}
+
+/**
+ * @brief Checks a soundtrack and tells the writer of the report
+ *
+ *	A job of the worker pool ,its argument is a SCAN_RESULT.
+ *
+ * 	@param *argument a pointer to a struct of type SCAN_RESULT
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void scanJob(void *argument) {
+	SCAN_RESULT *result = (SCAN_RESULT *) argument;
+	scanFile(result);
+	pthread_mutex_lock(&result->window->lock);
+	result->finished = true;
+	pthread_cond_broadcast(&result->window->finished);
+	pthread_mutex_unlock(&result->window->lock);
+}
+
+/**
+ * @brief Writes a message as a field of a CSV file
+ *
+ *	The field is quoted ,the quotes are doubled and the bytes which are not
+ *	printable are written as \xNN (a backslash as \\).
+ *
+ * 	@param *fp the CSV file
+ * 	@param *payload the message
+ * 	@param length the length of the message
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void writeCSVPayload(FILE *fp, const byte *payload, dword length) {
+	dword i;
+	fputc('"', fp);
+	for (i = 0; i < length; i++) {
+		if (payload[i] == '"') {
+			fputs("\"\"", fp);
+		} else if (payload[i] == '\\') {
+			fputs("\\\\", fp);
+		} else if (payload[i] < 0x20 || payload[i] > 0x7E) {
+			fprintf(fp, "\\x%02X", payload[i]);
+		} else {
+			fputc(payload[i], fp);
+		}
+	}
+	fputc('"', fp);
+}
+
+/**
+ * @brief Writes the row of a soundtrack to the report and frees its message
+ *
+ * 	@param *fp the CSV file
+ * 	@param *result the result of the check of the soundtrack
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void writeRow(FILE *fp, SCAN_RESULT *result) {
+	printQuotedName(fp, result->fileName, false);
+	fprintf(fp, ",%s,", SCAN_STATUS_NAMES[result->status]);
+	if (result->status == SCAN_OK || result->status == SCAN_CRC_MISMATCH) {
+		fprintf(fp, "%d,%u,%08X,", result->bitsPerSample, result->length,
+				result->crc);
+		writeCSVPayload(fp, result->payload, result->length);
+	} else {
+		fprintf(fp, ",,,");
+	}
+	fprintf(fp, "\n");
+	free(result->payload);
+	result->payload = NULL;
+}
+
+/**
+ * @brief Writes the rows of the finished checks in the order of the files
+ *
+ *	The rows are written from the next one until a check which isn't finished. If
+ *	window checks or more are not written yet ,it waits for the next one ,so at most
+ *	window messages are kept in memory.
+ *
+ * 	@param *fp the CSV file
+ * 	@param *results the results of the checks
+ * 	@param next the index of the next row
+ * 	@param submitted the number of the checks submitted
+ * 	@param window the maximum number of the checks not written
+ * 	@return int the index of the next row not written
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int writeRows(FILE *fp, SCAN_RESULT *results, int next, int submitted,
+		int window) {
+	bool finished;
+	while (next < submitted) {
+		SCAN_RESULT *result = &results[next];
+		pthread_mutex_lock(&result->window->lock);
+		while (!result->finished && submitted - next >= window) {
+			pthread_cond_wait(&result->window->finished,
+					&result->window->lock);
+		}
+		finished = result->finished;
+		pthread_mutex_unlock(&result->window->lock);
+		if (!finished) {
+			break;
+		}
+		writeRow(fp, result);
+		next++;
+	}
+	return next;
+}
+
+/**
+ * @brief Compares two names of files (for qsort)
+ *
+ * @author Valentinos Pariza
+ */
+PRIVATE int compareNames(const void *a, const void *b) {
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/**
+ * @brief Finds the .wav files of a directory
+ *
+ * 	@param *directory the name of the directory
+ * 	@param ***fileNames where the sorted paths of the files are placed
+ * 	@param *count where the number of the files is placed
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int listWavFiles(char *directory, char ***fileNames, int *count) {
+	DIR *dir = opendir(directory);
+	if (dir == NULL) {
+		return EXIT_FAILURE;
+	}
+	int maxCount = 64;
+	size_t length = 0;
+	struct dirent *entry = NULL;
+	char **temp = NULL;
+	*count = 0;
+	*fileNames = (char **) malloc(sizeof(char *) * maxCount);
+	while (*fileNames != NULL && (entry = readdir(dir)) != NULL) {
+		length = strlen(entry->d_name);
+		if (length < 4 || strcmp(entry->d_name + length - 4, ".wav") != 0) {
+			continue;
+		}
+		if (*count == maxCount) {
+			maxCount <<= 1;
+			temp = (char **) realloc(*fileNames, sizeof(char *) * maxCount);
+			if (temp == NULL) {
+				break;
+			}
+			*fileNames = temp;
+		}
+		(*fileNames)[*count] = (char *) malloc(
+				strlen(directory) + length + 2);
+		if ((*fileNames)[*count] == NULL) {
+			break;
+		}
+		sprintf((*fileNames)[*count], "%s%c%s", directory, PATHSEPERATOR,
+				entry->d_name);
+		(*count)++;
+	}
+	closedir(dir);
+	if (*fileNames == NULL || entry != NULL) {
+		while (*fileNames != NULL && *count > 0) {
+			free((*fileNames)[--(*count)]);
+		}
+		free(*fileNames);
+		*fileNames = NULL;
+		return EXIT_FAILURE;
+	}
+	qsort(*fileNames, *count, sizeof(char *), compareNames);
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int scanText(char *directory, char *outputFile) {
+	char **fileNames = NULL;
+	int count = 0, i;
+	if (directory == NULL
+			|| listWavFiles(directory, &fileNames, &count) == EXIT_FAILURE) {
+		printOutput("Fail    :  %s\t(Can't read the directory)\n", directory);
+		return EXIT_FAILURE;
+	}
+	FILE *fp = commandOutput();
+	if (outputFile != NULL && strcmp(outputFile, "-") != 0) {
+		fp = fopen(outputFile, "w");
+		if (fp == NULL) {
+			printOutput("Fail    :  %s\t(Can't create the file)\n", outputFile);
+			for (i = 0; i < count; i++) {
+				free(fileNames[i]);
+			}
+			free(fileNames);
+			return EXIT_FAILURE;
+		}
+	}
+	SCAN_RESULT *results = (SCAN_RESULT *) calloc(count + 1,
+			sizeof(SCAN_RESULT));
+	int threads = defaultWorkerCount();
+	WORKER_POOL *pool = createWorkerPool(threads, threads << 2);
+	if (results == NULL || pool == NULL) {
+		free(results);
+		destroyWorkerPool(&pool);
+		for (i = 0; i < count; i++) {
+			free(fileNames[i]);
+		}
+		free(fileNames);
+		if (fp != commandOutput()) {
+			fclose(fp);
+		}
+		return EXIT_FAILURE;
+	}
+	// the rows are written in order while the next files are checked
+	SCAN_WINDOW window = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+	int next = 0, windowSize = (threads + 1) * SCAN_WINDOW_PER_WORKER;
+	fprintf(fp, "file,status,bits,length,crc,payload\n");
+	for (i = 0; i < count; i++) {
+		results[i].fileName = fileNames[i];
+		results[i].window = &window;
+		submitJob(pool, scanJob, &results[i]);
+		next = writeRows(fp, results, next, i + 1, windowSize);
+	}
+	writeRows(fp, results, next, count, 1);
+	destroyWorkerPool(&pool);
+	pthread_mutex_destroy(&window.lock);
+	pthread_cond_destroy(&window.finished);
+	for (i = 0; i < count; i++) {
+		free(fileNames[i]);
+	}
+	free(results);
+	free(fileNames);
+	if (fp != commandOutput()) {
+		fclose(fp);
+		printOutput("Success :  %s\t(Created)\n", outputFile);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,535 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file server.c
+ *  @brief A long running server of the commands of wavengine over a Unix socket
+ *
+ *  Implements the server and its client. The server listens on a Unix domain socket and
+ *  every connection is served by a worker of a pool of threads ,so the process starts
+ *  once and the caches of the files (headers ,mapped files and features) stay warm
+ *  between the commands. A connection can send many commands one after the other.
+ *
+ *  The protocol is framed in the byte order of the machine. A command is a dword with the
+ *  number of its arguments and then every argument as a dword with its length followed by
+ *  its bytes. The answer is a list of frames ,every frame is a byte with its type ,a dword
+ *  with the length of its payload and the payload. A frame 'o' carries the output of the
+ *  command and the last frame 'x' carries its exit status as a dword.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "wavelib.h"
+#include "workerPool.h"
+#include "cache.h"
+#include "bufferPool.h"
+
+// The limits of a command
+#define MAX_ARGUMENTS 4096
+#define MAX_ARGUMENT_LENGTH 65536
+// The sizes of the caches of the server
+#define SERVER_CACHE_FILES 4096
+#define SERVER_CACHE_BYTES (1L << 30)
+// The number of the connections served at once for every processor
+#define CONNECTIONS_PER_WORKER 4
+// The types of the frames of an answer
+#define FRAME_OUTPUT 'o'
+#define FRAME_EXIT 'x'
+// The commands which use the standard input ,the signals or the process of the server
+#define NUM_LOCAL_COMMANDS 5
+
+/**
+ * A connection of a client to the server
+ */
+typedef struct {
+	int fd;
+	COMMAND_FUNCTION run;
+} CONNECTION;
+
+// The state of the server
+PRIVATE volatile sig_atomic_t stopping = 0;
+PRIVATE int listenFd = -1;
+PRIVATE pthread_mutex_t serverLock = PTHREAD_MUTEX_INITIALIZER;
+PRIVATE int *openConnections = NULL; // the fds of the open connections
+PRIVATE int numOpenConnections = 0;
+PRIVATE int maxOpenConnections = 0;
+PRIVATE unsigned long long commandsServed = 0;
+PRIVATE const char *localCommands[NUM_LOCAL_COMMANDS] = { "-live", "-watch",
+		"-serve", "-client", "-gpl" };
+
+/**
+ * @brief Write all the bytes of a buffer to a socket
+ *
+ * 	@param fd the socket
+ * 	@param *buffer the bytes
+ * 	@param length the number of the bytes
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int writeAll(int fd, const void *buffer, size_t length) {
+	const byte *bytes = (const byte *) buffer;
+	ssize_t written;
+	while (length > 0) {
+		// a closed peer must not kill the process with SIGPIPE
+		written = send(fd, bytes, length, MSG_NOSIGNAL);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return EXIT_FAILURE;
+		}
+		bytes += written;
+		length -= written;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Read exactly a number of bytes from a socket
+ *
+ * 	@param fd the socket
+ * 	@param *buffer where the bytes are placed
+ * 	@param length the number of the bytes
+ * 	@return int Success or Failure (also at the end of the connection)
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int readAll(int fd, void *buffer, size_t length) {
+	byte *bytes = (byte *) buffer;
+	ssize_t count;
+	while (length > 0) {
+		count = read(fd, bytes, length);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return EXIT_FAILURE;
+		}
+		bytes += count;
+		length -= count;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Write a frame of an answer
+ *
+ * 	@param fd the socket
+ * 	@param type the type of the frame
+ * 	@param *payload the payload
+ * 	@param length the length of the payload
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int writeFrame(int fd, byte type, const void *payload, dword length) {
+	byte head[1 + sizeof(dword)];
+	head[0] = type;
+	memcpy(head + 1, &length, sizeof(dword));
+	if (writeAll(fd, head, sizeof(head)) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	return writeAll(fd, payload, length);
+}
+
+/**
+ * @brief Free the arguments of a command
+ *
+ * 	@param **argv the arguments
+ * 	@param argc the number of the arguments
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void freeArguments(char **argv, int argc) {
+	int i;
+	if (argv == NULL) {
+		return;
+	}
+	for (i = 0; i < argc; i++) {
+		free(argv[i]);
+	}
+	free(argv);
+}
+
+/**
+ * @brief Read a command from a connection
+ *
+ *	The arguments are placed after the name of the program ,like the arguments of main.
+ *
+ * 	@param fd the socket
+ * 	@param *argc where the number of the arguments is placed
+ * 	@param ***argv where the arguments are placed
+ * 	@return int Success or Failure (also at the end of the connection)
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int readCommand(int fd, int *argc, char ***argv) {
+	dword count, length, i;
+	if (readAll(fd, &count, sizeof(dword)) == EXIT_FAILURE
+			|| count > MAX_ARGUMENTS) {
+		return EXIT_FAILURE;
+	}
+	char **arguments = (char **) calloc(count + 2, sizeof(char *));
+	if (arguments == NULL || (arguments[0] = strdup("wavengine")) == NULL) {
+		free(arguments);
+		return EXIT_FAILURE;
+	}
+	for (i = 1; i <= count; i++) {
+		if (readAll(fd, &length, sizeof(dword)) == EXIT_FAILURE
+				|| length > MAX_ARGUMENT_LENGTH
+				|| (arguments[i] = (char *) malloc(length + 1)) == NULL
+				|| readAll(fd, arguments[i], length) == EXIT_FAILURE) {
+			freeArguments(arguments, i + 1);
+			return EXIT_FAILURE;
+		}
+		arguments[i][length] = '\0';
+	}
+	*argc = count + 1;
+	*argv = arguments;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run a command of a client
+ *
+ *	The commands of the server itself (-stats and -shutdown) are run here ,all the others
+ *	by the function of the commands. The standard input and output ,the signals and the
+ *	process belong to the server ,so the filename - and the commands -live ,-watch ,-serve
+ *	,-client and -gpl can't be used.
+ *
+ * 	@param *out where the output of the command is written
+ * 	@param argc the number of the arguments
+ * 	@param **argv the arguments
+ * 	@param run the function of the commands
+ * 	@return int the exit status of the command
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int runCommand(FILE *out, int argc, char **argv, COMMAND_FUNCTION run) {
+	int i, c;
+	if (argc == 2 && strcmp(argv[1], "-stats") == 0) {
+		pthread_mutex_lock(&serverLock);
+		fprintf(out, "commands: %llu\nconnections: %d\n", commandsServed,
+				numOpenConnections);
+		pthread_mutex_unlock(&serverLock);
+		printFileCacheStatistics(out);
+		printBufferPoolStatistics(out);
+		return EXIT_SUCCESS;
+	}
+	if (argc == 2 && strcmp(argv[1], "-shutdown") == 0) {
+		stopping = 1;
+		// wake up the accept of the server
+		shutdown(listenFd, SHUT_RDWR);
+		fprintf(out, "Success :  %s\t(Stopping)\n", "server");
+		return EXIT_SUCCESS;
+	}
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-") == 0) {
+			fprintf(out, "Fail    :  -\t(The server has no standard input)\n");
+			return EXIT_FAILURE;
+		}
+		for (c = 0; c < NUM_LOCAL_COMMANDS; c++) {
+			if (strcmp(argv[i], localCommands[c]) == 0) {
+				fprintf(out, "Fail    :  %s\t(The server can't run this command)\n",
+						argv[i]);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	return run(out, argc, argv);
+}
+
+/**
+ * @brief Serve the commands of a connection
+ *
+ *	A job of the worker pool ,its argument is a CONNECTION. The output of every command
+ *	is kept in memory and sent when the command ends.
+ *
+ * 	@param *argument the CONNECTION
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void serveConnection(void *argument) {
+	CONNECTION *connection = (CONNECTION *) argument;
+	char **argv = NULL, *output = NULL;
+	size_t outputSize = 0;
+	int argc = 0, i;
+	dword status;
+	while (!stopping
+			&& readCommand(connection->fd, &argc, &argv) == EXIT_SUCCESS) {
+		FILE *out = open_memstream(&output, &outputSize);
+		if (out == NULL) {
+			freeArguments(argv, argc);
+			break;
+		}
+		status = (dword) runCommand(out, argc, argv, connection->run);
+		fclose(out);
+		freeArguments(argv, argc);
+		pthread_mutex_lock(&serverLock);
+		commandsServed++;
+		pthread_mutex_unlock(&serverLock);
+		int sent = (outputSize == 0) ? EXIT_SUCCESS : writeFrame(connection->fd,
+				FRAME_OUTPUT, output, (dword) outputSize);
+		free(output);
+		output = NULL;
+		if (sent == EXIT_FAILURE
+				|| writeFrame(connection->fd, FRAME_EXIT, &status,
+						sizeof(dword)) == EXIT_FAILURE) {
+			break;
+		}
+	}
+// Forget the connection
+	pthread_mutex_lock(&serverLock);
+	for (i = 0; i < numOpenConnections; i++) {
+		if (openConnections[i] == connection->fd) {
+			openConnections[i] = openConnections[--numOpenConnections];
+			break;
+		}
+	}
+	pthread_mutex_unlock(&serverLock);
+	close(connection->fd);
+	free(connection);
+}
+
+/**
+ * @brief Stop the server at SIGINT or SIGTERM
+ *
+ * 	@param signal the signal
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void stopServer(int signal) {
+	(void) signal;
+	stopping = 1;
+}
+
+PUBLIC int serve(char *socketPath, COMMAND_FUNCTION run) {
+	struct sockaddr_un address;
+	if (socketPath == NULL || run == NULL
+			|| strlen(socketPath) >= sizeof(address.sun_path)) {
+		printf("Fail    :  %s\t(Wrong socket path)\n", socketPath);
+		return EXIT_FAILURE;
+	}
+// Listen on the socket ,a socket left by an old server is replaced
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+	unlink(socketPath);
+	listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listenFd < 0
+			|| bind(listenFd, (struct sockaddr *) &address, sizeof(address)) != 0
+			|| listen(listenFd, SOMAXCONN) != 0) {
+		printf("Fail    :  %s\t(Can't listen on the socket)\n", socketPath);
+		if (listenFd >= 0) {
+			close(listenFd);
+		}
+		return EXIT_FAILURE;
+	}
+	enableFileCache(SERVER_CACHE_FILES, SERVER_CACHE_BYTES);
+// Only the thread of the server takes the signals which stop it
+	sigset_t signals, old;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, &old);
+	int threads = defaultWorkerCount() * CONNECTIONS_PER_WORKER;
+	WORKER_POOL *pool = createWorkerPool(threads, threads);
+	openConnections = (int *) malloc(sizeof(int) * threads * 2);
+	maxOpenConnections = threads * 2;
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (pool == NULL || openConnections == NULL) {
+		printf("Fail    :  %s\t(Not enough memory)\n", socketPath);
+		destroyWorkerPool(&pool);
+		free(openConnections);
+		close(listenFd);
+		unlink(socketPath);
+		return EXIT_FAILURE;
+	}
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopServer; // without SA_RESTART accept is interrupted
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	// the messages of the commands are the log of the server
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	printf("Success :  %s\t(Listening)\n", socketPath);
+// Accept the connections until the server is stopped
+	while (!stopping) {
+		int fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+		if (fd < 0) {
+			continue; // interrupted ,or the socket was shut down
+		}
+		CONNECTION *connection = (CONNECTION *) malloc(sizeof(CONNECTION));
+		pthread_mutex_lock(&serverLock);
+		bool full = (numOpenConnections == maxOpenConnections);
+		if (!full && connection != NULL) {
+			openConnections[numOpenConnections++] = fd;
+		}
+		pthread_mutex_unlock(&serverLock);
+		if (full || connection == NULL) {
+			free(connection);
+			close(fd);
+			continue;
+		}
+		connection->fd = fd;
+		connection->run = run;
+		submitJob(pool, serveConnection, connection);
+	}
+// The open connections end after their running commands
+	int i;
+	pthread_mutex_lock(&serverLock);
+	for (i = 0; i < numOpenConnections; i++) {
+		shutdown(openConnections[i], SHUT_RD);
+	}
+	pthread_mutex_unlock(&serverLock);
+	destroyWorkerPool(&pool);
+	close(listenFd);
+	listenFd = -1;
+	unlink(socketPath);
+	free(openConnections);
+	openConnections = NULL;
+	printf("Success :  %s\t(Stopped after %llu commands)\n", socketPath,
+			commandsServed);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Check whether an argument of a client is a path of a file
+ *
+ *	The server runs in its own directory ,so the relative paths of the client are sent
+ *	as full paths. An argument is a path if it names a file which exists or a new file
+ *	(a name with an extension ,like report.csv) in a directory which exists ,or a track of
+ *	a mixdown whose file exists. The other arguments (numbers ,operations and filters) are
+ *	sent as they are.
+ *
+ * 	@param *argument the argument
+ * 	@return bool true if the argument is a relative path of a file
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE bool isClientPath(char *argument) {
+	struct stat info;
+	char *name, *extension, *c;
+	if (argument[0] == '\0' || argument[0] == PATHSEPERATOR
+			|| argument[0] == '-') {
+		return false;
+	}
+	if (stat(argument, &info) == 0) {
+		return true;
+	}
+	// a track of a mixdown ,file:gain:pan
+	if ((c = strchr(argument, ':')) != NULL) {
+		char *track = strndup(argument, c - argument);
+		bool found = track != NULL && stat(track, &info) == 0;
+		free(track);
+		return found;
+	}
+	name = strrchr(argument, PATHSEPERATOR);
+	name = (name == NULL) ? argument : name + 1;
+	extension = strrchr(name, '.');
+	if (extension == NULL || extension == name || extension[1] == '\0') {
+		return false;
+	}
+	for (c = extension + 1; *c != '\0'; c++) {
+		if (!isalpha((unsigned char) *c)) {
+			return false;
+		}
+	}
+	if (name == argument) { // a new file in the directory of the client
+		return true;
+	}
+	char *directory = strndup(argument, name - 1 - argument);
+	bool found = directory != NULL && stat(directory, &info) == 0
+			&& S_ISDIR(info.st_mode);
+	free(directory);
+	return found;
+}
+
+PUBLIC int client(char *socketPath, int argc, char **argv) {
+	struct sockaddr_un address;
+	int fd = -1, i;
+	if (socketPath == NULL || argv == NULL || argc < 1
+			|| strlen(socketPath) >= sizeof(address.sun_path)) {
+		return EXIT_FAILURE;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0
+			|| connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+		fprintf(stderr, "Fail    :  %s\t(Can't connect to the server)\n",
+				socketPath);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return EXIT_FAILURE;
+	}
+// Send the command ,the files of the client are given to the server by their full paths
+	char *cwd = getcwd(NULL, 0), *path;
+	dword length = argc;
+	int result = writeAll(fd, &length, sizeof(dword));
+	for (i = 0; i < argc && result == EXIT_SUCCESS; i++) {
+		path = NULL;
+		// the patterns of -tree are matched against the names ,not resolved
+		if (cwd != NULL && isClientPath(argv[i])
+				&& (i == 0 || (strcmp(argv[i - 1], "-include") != 0
+						&& strcmp(argv[i - 1], "-exclude") != 0))) {
+			path = (char *) malloc(strlen(cwd) + strlen(argv[i]) + 2);
+			if (path != NULL) {
+				sprintf(path, "%s%c%s", cwd, PATHSEPERATOR, argv[i]);
+			}
+		}
+		length = strlen((path != NULL) ? path : argv[i]);
+		result = writeAll(fd, &length, sizeof(dword));
+		if (result == EXIT_SUCCESS) {
+			result = writeAll(fd, (path != NULL) ? path : argv[i], length);
+		}
+		free(path);
+	}
+	free(cwd);
+// Copy the output until the exit status
+	byte head[1 + sizeof(dword)], buffer[BUFSIZ];
+	dword status = EXIT_FAILURE, count;
+	while (result == EXIT_SUCCESS
+			&& (result = readAll(fd, head, sizeof(head))) == EXIT_SUCCESS) {
+		memcpy(&length, head + 1, sizeof(dword));
+		if (head[0] == FRAME_EXIT) {
+			if (length == sizeof(dword)) {
+				result = readAll(fd, &status, sizeof(dword));
+			}
+			break;
+		}
+		while (length > 0 && result == EXIT_SUCCESS) {
+			count = (length < BUFSIZ) ? length : BUFSIZ;
+			result = readAll(fd, buffer, count);
+			if (result == EXIT_SUCCESS && head[0] == FRAME_OUTPUT) {
+				fwrite(buffer, 1, count, stdout);
+			}
+			length -= count;
+		}
+	}
+	close(fd);
+	if (result == EXIT_FAILURE) {
+		fprintf(stderr, "Fail    :  %s\t(The connection was lost)\n",
+				socketPath);
+		return EXIT_FAILURE;
+	}
+	return (int) status;
+}
@@ -0,0 +1,294 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file shard.c
+ *  @brief Splits a batch in shards and merges the results of the shards
+ *
+ *  Implements the shards of a batch. The shard of a file is its 64 bits FNV-1a hash
+ *  modulo the number of the shards ,so it depends only on the name of the file and the
+ *  number of the shards ,and every process can find its files alone. The blocks of a
+ *  matrix (the pairs of the files of the similarity) are sharded by a hash of their row
+ *  and column.
+ *
+ *  The results of the shards (CSV ,JSON or NDJSON reports) are merged in one report. The
+ *  records are sorted and the records found twice are kept once ,so the merged report
+ *  doesn't depend on the number of the shards. A report of pairs is checked to have all
+ *  the pairs of its files ,so a missing shard of a matrix is found.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include "shard.h"
+#include "wavelib.h"
+
+// The header of a CSV report of the pairs of files
+#define PAIR_CSV_HEADER "file1,file2,"
+// The start of a JSON record of a pair of files
+#define PAIR_JSON_START "{\"file1\":"
+
+PRIVATE unsigned long long shardIndex = 0;
+PRIVATE unsigned long long shardCount = 1;
+
+/**
+ * @brief Hash a text
+ *
+ * 	@param *text the text
+ * 	@return unsigned long long the 64 bits FNV-1a hash
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE unsigned long long hashText(const char *text) {
+	unsigned long long hash = 14695981039346656037ULL;
+	while (*text != '\0') {
+		hash = (hash ^ (byte) *text++) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+PUBLIC int setShard(char *text) {
+	unsigned long long index, count;
+	int length = 0;
+	if (text == NULL
+			|| sscanf(text, "%llu/%llu%n", &index, &count, &length) != 2
+			|| text[length] != '\0' || count == 0 || index >= count) {
+		return EXIT_FAILURE;
+	}
+	shardIndex = index;
+	shardCount = count;
+	return EXIT_SUCCESS;
+}
+
+PUBLIC bool isInShard(const char *key) {
+	return shardCount == 1 || hashText(key) % shardCount == shardIndex;
+}
+
+PUBLIC bool isBlockInShard(long row, long column) {
+	char key[48];
+	sprintf(key, "%ld:%ld", row, column);
+	return isInShard(key);
+}
+
+PUBLIC int shardFiles(char **fileNames, int count) {
+	int i, kept = 0;
+	for (i = 0; i < count; i++) {
+		if (isInShard(fileNames[i])) {
+			fileNames[kept++] = fileNames[i];
+		}
+	}
+	return kept;
+}
+
+PRIVATE int compareRecords(const void *a, const void *b) {
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/**
+ * @brief Find the end of a quoted name of a record
+ *
+ * 	@param *start the opening quote
+ * 	@param json true for a JSON string ,false for a CSV field
+ * 	@return const char* the character after the closing quote or NULL
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE const char *skipQuoted(const char *start, bool json) {
+	const char *c;
+	if (start == NULL || *start != '"') {
+		return NULL;
+	}
+	for (c = start + 1; *c != '\0'; c++) {
+		if (json && *c == '\\' && c[1] != '\0') {
+			c++;
+		} else if (!json && *c == '"' && c[1] == '"') {
+			c++;
+		} else if (*c == '"') {
+			return c + 1;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Count the missing pairs of a report of pairs of files
+ *
+ *	The files of the report are the names found in its records. A complete report has a
+ *	record for every pair of two different files.
+ *
+ * 	@param **records the sorted records without duplicates
+ * 	@param count the number of the records
+ * 	@param json true for JSON records ,false for CSV records
+ * 	@return long the number of the missing pairs or -1 if a record isn't a pair
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long missingPairs(char **records, long count, bool json) {
+	char **names = (char **) malloc(sizeof(char *) * (2 * count + 1));
+	const char *first, *end;
+	long i, k, numberOfNames = 0, files = 0;
+	if (names == NULL) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		first = records[i] + (json ? strlen(PAIR_JSON_START) : 0);
+		for (k = 0; k < 2; k++) {
+			end = skipQuoted(first, json);
+			if (end == NULL) {
+				break;
+			}
+			names[numberOfNames] = strndup(first, end - first);
+			if (names[numberOfNames] != NULL) {
+				numberOfNames++;
+			}
+			// the second name follows a comma (and its key in JSON)
+			first = json ? strchr(end, ':') : end;
+			first = (first == NULL || *first == '\0') ? NULL : first + 1;
+		}
+		if (k < 2) {
+			break;
+		}
+	}
+	qsort(names, numberOfNames, sizeof(char *), compareRecords);
+	for (k = 0; k < numberOfNames; k++) {
+		files += (k == 0 || strcmp(names[k], names[k - 1]) != 0);
+	}
+	for (k = 0; k < numberOfNames; k++) {
+		free(names[k]);
+	}
+	free(names);
+	if (i < count) {
+		return -1;
+	}
+	return files * (files - 1) / 2 - count;
+}
+
+PUBLIC int mergeResults(FILE *out, char *format, char **inputFiles, int count) {
+	bool csv, json;
+	if (out == NULL || format == NULL || inputFiles == NULL || count < 1) {
+		return EXIT_FAILURE;
+	}
+	csv = strcmp(format, "csv") == 0;
+	json = strcmp(format, "json") == 0;
+	if (!csv && !json && strcmp(format, "ndjson") != 0) {
+		fprintf(stderr, "Fail    :  %s\t(Unknown format)\n", format);
+		return EXIT_FAILURE;
+	}
+// Read the records of all the reports
+	char **records = NULL, **temp, *line = NULL, *header = NULL, *record;
+	long numberOfRecords = 0, capacity = 0, length, i;
+	size_t size = 0;
+	int result = EXIT_SUCCESS, f;
+	for (f = 0; f < count && result == EXIT_SUCCESS; f++) {
+		FILE *fp = fopen(inputFiles[f], "r");
+		bool first = true;
+		if (fp == NULL) {
+			fprintf(stderr, "Fail    :  %s\t(Can't open the report)\n",
+					inputFiles[f]);
+			result = EXIT_FAILURE;
+			break;
+		}
+		while ((length = getline(&line, &size, fp)) >= 0) {
+			while (length > 0
+					&& (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+				line[--length] = '\0';
+			}
+			record = line;
+			if (csv && first) { // the header of the CSV
+				first = false;
+				if (header == NULL) {
+					header = strdup(line);
+				} else if (strcmp(header, line) != 0) {
+					fprintf(stderr, "Fail    :  %s\t(Another header)\n",
+							inputFiles[f]);
+					result = EXIT_FAILURE;
+					break;
+				}
+				continue;
+			}
+			if (json) { // one record in every line of the array
+				if (*record == '[') {
+					record++;
+					length--;
+				}
+				if (length > 0
+						&& (record[length - 1] == ']'
+								|| record[length - 1] == ',')) {
+					record[--length] = '\0';
+				}
+			}
+			if (length == 0) {
+				continue;
+			}
+			if (numberOfRecords == capacity) {
+				capacity = (capacity == 0) ? 1024 : capacity << 1;
+				temp = (char **) realloc(records, sizeof(char *) * capacity);
+				if (temp == NULL) {
+					result = EXIT_FAILURE;
+					break;
+				}
+				records = temp;
+			}
+			if ((records[numberOfRecords] = strdup(record)) == NULL) {
+				result = EXIT_FAILURE;
+				break;
+			}
+			numberOfRecords++;
+		}
+		fclose(fp);
+	}
+	free(line);
+	if (result == EXIT_SUCCESS && numberOfRecords > 0) {
+		// sorted and once ,for the same report from any number of shards
+		qsort(records, numberOfRecords, sizeof(char *), compareRecords);
+		long kept = 1;
+		for (i = 1; i < numberOfRecords; i++) {
+			if (strcmp(records[i], records[kept - 1]) == 0) {
+				free(records[i]);
+			} else {
+				records[kept++] = records[i];
+			}
+		}
+		numberOfRecords = kept;
+	}
+// Write the merged report
+	if (result == EXIT_SUCCESS) {
+		if (csv) {
+			fprintf(out, "%s\n", (header != NULL) ? header : "");
+		} else if (json) {
+			fprintf(out, "[");
+		}
+		for (i = 0; i < numberOfRecords; i++) {
+			fprintf(out, (json && i > 0) ? ",\n%s" : "%s", records[i]);
+			if (!json) {
+				fprintf(out, "\n");
+			}
+		}
+		if (json) {
+			fprintf(out, "]\n");
+		}
+		fflush(out);
+	}
+// A report of pairs must have all the pairs of its files
+	bool pairs = (csv && header != NULL
+			&& strncmp(header, PAIR_CSV_HEADER, strlen(PAIR_CSV_HEADER)) == 0)
+			|| (!csv && numberOfRecords > 0
+					&& strncmp(records[0], PAIR_JSON_START,
+							strlen(PAIR_JSON_START)) == 0);
+	if (result == EXIT_SUCCESS && pairs) {
+		long missing = missingPairs(records, numberOfRecords, !csv);
+		if (missing != 0) {
+			fprintf(stderr, "Fail    :  %s\t(%ld pairs are missing)\n",
+					format, missing);
+			result = EXIT_FAILURE;
+		}
+	}
+	for (i = 0; i < numberOfRecords; i++) {
+		free(records[i]);
+	}
+	free(records);
+	free(header);
+	return result;
+}
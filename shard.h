@@ -0,0 +1,60 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the shards of a batch. A
+ *  batch is split in N shards which are run by N processes ,on one machine or
+ *  on many. A file belongs to the shard given by a hash of its name ,so every
+ *  process finds its files from the same input alone and the shards never
+ *  change between runs. The sharding is off until setShard is called ,then
+ *  every file belongs to the only shard.
+ */
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "utilities.h"
+
+/**
+ * @brief Select the shard of this process
+ *
+ * 	@param *text the shard as i/N ,where i is from 0 to N-1
+ * 	@return int Success or Failure if the text isn't a shard
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int setShard(char *text);
+/**
+ * @brief Check whether a file belongs to the shard of this process
+ *
+ * 	@param *key the name of the file ,as all the processes see it
+ * 	@return bool true if the file belongs to the shard
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC bool isInShard(const char *key);
+/**
+ * @brief Check whether a block of a matrix belongs to the shard of this process
+ *
+ * 	@param row the row of the block
+ * 	@param column the column of the block
+ * 	@return bool true if the block belongs to the shard
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC bool isBlockInShard(long row, long column);
+/**
+ * @brief Keep only the files of a list which belong to the shard of this process
+ *
+ *	The files are kept in their order at the start of the list.
+ *
+ * 	@param **fileNames the list of the files
+ * 	@param count the number of the files
+ * 	@return int the number of the files kept
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int shardFiles(char **fileNames, int count);
+
+#endif
@@ -12,12 +12,18 @@
  *  LCSS Distance, a more accurate version but very slow. It works properly but it takes a lot of time.
  *  There are other solving methods such as the LCSS which is using recursion but this one is even
  *  more slow. FInally, at the end the method represents the Euclidean Distance and the LCSS Distance.
+ *  The distances of two files are kept in the cache of the features when the caches are enabled.
  *
  *  @version 1.0
  *  @author Marios Pafitis
  *  @bugs No known bugs
  */
 #include "utilities.h"
+#include "planar.h"
+#include "resample.h"
+#include "workerPool.h"
+#include "cache.h"
+#include "shard.h"
 #ifdef DEBUG_SIMILARITY
 #include <limits.h>
 #endif
@@ -26,154 +32,424 @@
  *
  *  Calculates Euclidean Distance Between two audio files. A really fast method to check
  *  if two audio files are the same, but you can't really trust it because it is inaccurate.
- *  As they say in my village "The good thing, always is late."
+ *  As they say in my village "The good thing, always is late." The samples are compared
+ *  channel by channel as planar samples (from -1 to 1) ,the longer sound is compared with
+ *  silence after the end of the shorter one.
  *
- * 	@param *wav1 the input1 WAV struct
- * 	@param *wav2 the input2 WAV struct
+ * 	@param *planar1 the planar samples of the input1
+ * 	@param *planar2 the planar samples of the input2
  * 	@return double the Euclidean Distance
  *	@author Marios Pafitis
  * 	@bug No known bugs.
  */
-PRIVATE double euclideanDistance(WAV *, WAV *);
+PRIVATE double euclideanDistance(PLANAR *, PLANAR *);
 /**
  * @brief Calculate LCSS Distance
  *
  *  Calculates LCSS Distance Between two audio files. It uses a non recursive method.
- *  This method uses a two dimensional array and it is very slow and very memory demanding
- *  so be patient.
+ *  This method is very slow so be patient ,but it keeps only two rows of the table of the
+ *  common subsequences. Two frames are common when all their samples are equal.
+ *
+ * 	@param *planar1 the planar samples of the input1
+ * 	@param *planar2 the planar samples of the input2
+ * 	@return double the LCSS Distance or -1 if there isn't enough memory
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE double LCSSDistance(PLANAR *, PLANAR *);
+
+// The number of the files of the side of a block of the matrix of similarity
+#define SIMILARITY_BLOCK_FILES 16
+
+/**
+ * A block of the matrix of similarity ,the pairs of a range of files (its rows)
+ * with a range of files (its columns)
+ */
+typedef struct {
+	char **fileNames;
+	int count;
+	long row, column; // the indexes of the block
+	double distances[SIMILARITY_BLOCK_FILES][SIMILARITY_BLOCK_FILES][2];
+	bool computed[SIMILARITY_BLOCK_FILES][SIMILARITY_BLOCK_FILES];
+} SIMILARITY_BLOCK;
+
+/**
+ * @brief Check whether two audio files can be compared
+ *
+ *	The samples are compared as planar samples ,so the sample formats of the files can
+ *	be different ,and at the lower sample rate of the two ,so the rates can be different.
  *
  * 	@param *wav1 the input1 WAV struct
  * 	@param *wav2 the input2 WAV struct
- * 	@return double the LCSS Distance
+ * 	@return bool true if the two files are aligned
  *	@author Marios Pafitis
  * 	@bug No known bugs.
  */
-PRIVATE double LCSSDistance(WAV *, WAV *);
+PRIVATE bool isAligned(WAV *wav1, WAV *wav2) {
+	return wav1->header->NumChannels == wav2->header->NumChannels;
+}
 
-PUBLIC int similarity(char *filename1, char* filename2) {
+/**
+ * @brief Bring the planar samples of two files to the lower of their sample rates
+ *
+ *	The samples of the higher rate are resampled to a temporary and their pointer is moved
+ *	to it. The temporary is freed with freePlanar.
+ *
+ * 	@param **first the pointer of the samples of the first file
+ * 	@param **second the pointer of the samples of the second file
+ * 	@param rate1 the sample rate of the first file
+ * 	@param rate2 the sample rate of the second file
+ * 	@param *temporary the temporary samples
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int alignRates(PLANAR **first, PLANAR **second, dword rate1,
+		dword rate2, PLANAR *temporary) {
+	temporary->samples = NULL;
+	if (rate1 == rate2) {
+		return EXIT_SUCCESS;
+	}
+	PLANAR **higher = (rate1 > rate2) ? first : second;
+	if (resamplePlanar(*higher, (rate1 > rate2) ? rate1 : rate2,
+			(rate1 > rate2) ? rate2 : rate1, temporary) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	*higher = temporary;
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int similarity(FILE *out, char *filename1, char* filename2) {
+	double distances[FEATURE_VALUES] = { 0 };
+	if (out == NULL) {
+		return EXIT_FAILURE;
+	}
+// The distances of files which didn't change are in the cache
+	if (cachedFeature("similarity", filename1, filename2, distances)) {
+		fprintf(out, "\nCompare:\n%s\nwith:\n%s\n\n", filename1, filename2);
+		fprintf(out, "Euclidean distance: %.3f\n", distances[0]);
+		fprintf(out, "LCSS distance: %.3f\n\n", distances[1]);
+		return EXIT_SUCCESS;
+	}
 // Read WAV 1
 	WAV *wav1 = NULL;
 	if (readWAV(filename1, &wav1) == EXIT_FAILURE) {
-		printf("Fail    :  %s\t(Can't read WAV file)\n", filename1);
+		fprintf(out, "Fail    :  %s\t(Can't read WAV file)\n", filename1);
 		return EXIT_FAILURE;
 	}
 // Read WAV 2
 	WAV *wav2 = NULL;
 	if (readWAV(filename2, &wav2) == EXIT_FAILURE) {
-		printf("Fail    :  %s\t(Can't read WAV file)\n", filename2);
+		fprintf(out, "Fail    :  %s\t(Can't read WAV file)\n", filename2);
+		deleteWAV(&wav1);
 		return EXIT_FAILURE;
 	}
 // Check if there are aligned
-	if (wav1->header->AudioFormat != wav2->header->AudioFormat
-			|| wav1->header->NumChannels != wav2->header->NumChannels
-			|| wav1->header->SampleRate != wav2->header->SampleRate
-			|| wav1->header->ByteRate != wav2->header->ByteRate
-			|| wav1->header->BlockAlign != wav2->header->BlockAlign
-			|| wav1->header->BitsPerSample != wav2->header->BitsPerSample) {
-		printf("Fail    :  %s $ %s\t(The two audio files are not align)\n",
+	if (!isAligned(wav1, wav2)) {
+		fprintf(out,
+				"Fail    :  %s $ %s\t(The two audio files are not align)\n",
 				filename1, filename2);
 		deleteWAV(&wav1);
 		deleteWAV(&wav2);
 		return EXIT_FAILURE;
 	}
-	printf("\nCompare:\n%s\nwith:\n%s\n\n", filename1, filename2);
-// Calculate Euclidean Distance
-	printf("Euclidean distance: ");
-	printf("%.3f\n", euclideanDistance(wav1, wav2));
-	printf("LCSS distance: ");
-	double LCSS = LCSSDistance(wav1, wav2);
-	if (LCSS == -1) {
+// Decode the samples of the two files to planar samples at the same rate
+	PLANAR planar1, planar2, resampled;
+	PLANAR *samples1 = &planar1, *samples2 = &planar2;
+	planar1.samples = planar2.samples = NULL;
+	if (decodePlanar(wav1, &planar1) == EXIT_FAILURE
+			|| decodePlanar(wav2, &planar2) == EXIT_FAILURE
+			|| alignRates(&samples1, &samples2, wav1->header->SampleRate,
+					wav2->header->SampleRate, &resampled) == EXIT_FAILURE) {
+		fprintf(out, "Fail    :  %s $ %s\t(Not enough memory)\n", filename1,
+				filename2);
+		freePlanar(&planar1);
+		freePlanar(&planar2);
 		deleteWAV(&wav1);
 		deleteWAV(&wav2);
-		printf("\nFail    :  %s $ %s\t(Can't Calculate LCSS Distance)\n",
-				filename1, filename2);
 		return EXIT_FAILURE;
 	}
-	printf("%.3f\n", LCSS);
-	printf("\n");
 	deleteWAV(&wav1);
 	deleteWAV(&wav2);
+	fprintf(out, "\nCompare:\n%s\nwith:\n%s\n\n", filename1, filename2);
+// Calculate Euclidean Distance
+	distances[0] = euclideanDistance(samples1, samples2);
+	fprintf(out, "Euclidean distance: ");
+	fprintf(out, "%.3f\n", distances[0]);
+	fprintf(out, "LCSS distance: ");
+	distances[1] = LCSSDistance(samples1, samples2);
+	freePlanar(&planar1);
+	freePlanar(&planar2);
+	freePlanar(&resampled);
+	if (distances[1] == -1) {
+		fprintf(out,
+				"\nFail    :  %s $ %s\t(Can't Calculate LCSS Distance)\n",
+				filename1, filename2);
+		return EXIT_FAILURE;
+	}
+	fprintf(out, "%.3f\n", distances[1]);
+	fprintf(out, "\n");
+	storeFeature("similarity", filename1, filename2, distances);
 	return EXIT_SUCCESS;
 }
 
-PRIVATE double euclideanDistance(WAV *wav1, WAV *wav2) {
-	WAV *min = NULL;
-	long int sum = 0, i;
-	if (wav1->header->Subchunk2Size <= wav2->header->Subchunk2Size) {
-		min = wav1;
-	} else {
-		min = wav2;
-	}
-	for (i = 0; i < min->header->Subchunk2Size; i++) {
-		sum += pow(wav1->data->channel[i] - wav2->data->channel[i], 2);
-	}
-	if (wav1->header->Subchunk2Size > i) {
-		for (; i < wav1->header->Subchunk2Size; i++) {
-			sum += pow(wav1->data->channel[i], 2);
+/**
+ * @brief Calculate the distances of the pairs of a block of the matrix
+ *
+ *  A job of the worker pool ,its argument is a SIMILARITY_BLOCK. Every file of the block
+ *  is read and decoded to planar samples once for all its pairs in the block. Only the pairs of two different files
+ *  ,with the first before the second in the list ,are calculated.
+ *
+ * 	@param *argument the SIMILARITY_BLOCK
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE void similarityBlock(void *argument) {
+	SIMILARITY_BLOCK *block = (SIMILARITY_BLOCK *) argument;
+	WAV *rows[SIMILARITY_BLOCK_FILES] = { NULL }, *columns[SIMILARITY_BLOCK_FILES] =
+			{ NULL };
+	PLANAR rowSamples[SIMILARITY_BLOCK_FILES], columnSamples[SIMILARITY_BLOCK_FILES];
+	PLANAR *samples1, *samples2, resampled;
+	double distances[FEATURE_VALUES] = { 0 };
+	long first = block->row * SIMILARITY_BLOCK_FILES, i, j;
+	long firstColumn = block->column * SIMILARITY_BLOCK_FILES;
+	for (i = 0; i < SIMILARITY_BLOCK_FILES; i++) {
+		rowSamples[i].samples = columnSamples[i].samples = NULL;
+	}
+	for (i = 0; i < SIMILARITY_BLOCK_FILES; i++) {
+		for (j = 0; j < SIMILARITY_BLOCK_FILES; j++) {
+			if (first + i >= block->count || firstColumn + j >= block->count
+					|| first + i >= firstColumn + j) {
+				continue;
+			}
+			char *name1 = block->fileNames[first + i];
+			char *name2 = block->fileNames[firstColumn + j];
+			// the distances of files which didn't change are in the cache
+			if (cachedFeature("similarity", name1, name2, distances)) {
+				block->distances[i][j][0] = distances[0];
+				block->distances[i][j][1] = distances[1];
+				block->computed[i][j] = true;
+				continue;
+			}
+			if (rows[i] == NULL && readWAV(name1, &rows[i]) == EXIT_FAILURE) {
+				rows[i] = NULL;
+			}
+			if (columns[j] == NULL
+					&& readWAV(name2, &columns[j]) == EXIT_FAILURE) {
+				columns[j] = NULL;
+			}
+			if (rows[i] == NULL || columns[j] == NULL
+					|| !isAligned(rows[i], columns[j])) {
+				continue;
+			}
+			if ((rowSamples[i].samples == NULL
+					&& decodePlanar(rows[i], &rowSamples[i]) == EXIT_FAILURE)
+					|| (columnSamples[j].samples == NULL
+							&& decodePlanar(columns[j], &columnSamples[j])
+									== EXIT_FAILURE)) {
+				continue;
+			}
+			samples1 = &rowSamples[i];
+			samples2 = &columnSamples[j];
+			// the samples of a higher rate are resampled for this pair only
+			if (alignRates(&samples1, &samples2, rows[i]->header->SampleRate,
+					columns[j]->header->SampleRate, &resampled) == EXIT_FAILURE) {
+				continue;
+			}
+			distances[0] = euclideanDistance(samples1, samples2);
+			distances[1] = LCSSDistance(samples1, samples2);
+			freePlanar(&resampled);
+			if (distances[1] != -1) {
+				block->distances[i][j][0] = distances[0];
+				block->distances[i][j][1] = distances[1];
+				block->computed[i][j] = true;
+				storeFeature("similarity", name1, name2, distances);
+			}
 		}
-	} else if (wav2->header->Subchunk2Size >= i) {
-		for (; i < wav2->header->Subchunk2Size; i++) {
-			sum += pow(wav2->data->channel[i], 2);
+	}
+	for (i = 0; i < SIMILARITY_BLOCK_FILES; i++) {
+		if (rows[i] != NULL) {
+			deleteWAV(&rows[i]);
+		}
+		if (columns[i] != NULL) {
+			deleteWAV(&columns[i]);
 		}
+		freePlanar(&rowSamples[i]);
+		freePlanar(&columnSamples[i]);
 	}
-	return sqrt(sum);
 }
 
-PRIVATE double LCSSDistance(WAV *wav1, WAV *wav2) {
-	long int i, j, wav1Size = wav1->header->Subchunk2Size, wav2Size =
-			wav2->header->Subchunk2Size;
-	unsigned short**C = (unsigned short **) malloc(
-			sizeof(unsigned short *) * (wav1Size + 1));
-	if (C == NULL) {
-		printf("Not enough memory.\n");
-		return -1;
+PUBLIC int similarityMatrix(FILE *out, char **fileNames, int count,
+		char *format) {
+	long blocks = (count + SIMILARITY_BLOCK_FILES - 1) / SIMILARITY_BLOCK_FILES;
+	long row, column, numberOfBlocks = 0, b, i, j, records = 0;
+	bool csv, json;
+	if (out == NULL || fileNames == NULL || count < 0 || format == NULL) {
+		return EXIT_FAILURE;
 	}
-	for (i = 0; i <= wav1Size; i++) {
-		C[i] = (unsigned short *) malloc(
-				sizeof(unsigned short) * (wav2Size + 1));
-		if (C[i] == NULL) {
-			printf("Not enough memory.\n");
-			return -1;
+	csv = strcmp(format, "csv") == 0;
+	json = strcmp(format, "json") == 0;
+	if (!csv && !json && strcmp(format, "ndjson") != 0) {
+		fprintf(out, "Fail    :  %s\t(Unknown format)\n", format);
+		return EXIT_FAILURE;
+	}
+// The blocks on and above the diagonal which belong to the shard
+	SIMILARITY_BLOCK **shardBlocks = (SIMILARITY_BLOCK **) malloc(
+			sizeof(SIMILARITY_BLOCK *) * (blocks * (blocks + 1) / 2 + 1));
+	int threads = defaultWorkerCount();
+	WORKER_POOL *pool = createWorkerPool(threads, threads << 1);
+	int result = (shardBlocks == NULL || pool == NULL) ?
+			EXIT_FAILURE : EXIT_SUCCESS;
+	for (row = 0; row < blocks && result == EXIT_SUCCESS; row++) {
+		for (column = row; column < blocks && result == EXIT_SUCCESS;
+				column++) {
+			if (!isBlockInShard(row, column)) {
+				continue;
+			}
+			SIMILARITY_BLOCK *block = (SIMILARITY_BLOCK *) calloc(1,
+					sizeof(SIMILARITY_BLOCK));
+			if (block == NULL) {
+				result = EXIT_FAILURE;
+				break;
+			}
+			block->fileNames = fileNames;
+			block->count = count;
+			block->row = row;
+			block->column = column;
+			shardBlocks[numberOfBlocks++] = block;
+			submitJob(pool, similarityBlock, block);
 		}
 	}
-	for (i = 0; i <= wav1Size; i++) {
-		C[i][0] = 0;
+	destroyWorkerPool(&pool);
+// Write a record for every pair ,in the order of the blocks
+	if (result == EXIT_SUCCESS) {
+		if (csv) {
+			fprintf(out, "file1,file2,euclidean,lcss\n");
+		} else if (json) {
+			fprintf(out, "[");
+		}
 	}
-	for (i = 0; i <= wav2Size; i++) {
-		C[0][i] = 0;
+	for (b = 0; b < numberOfBlocks; b++) {
+		SIMILARITY_BLOCK *block = shardBlocks[b];
+		long first = block->row * SIMILARITY_BLOCK_FILES;
+		long firstColumn = block->column * SIMILARITY_BLOCK_FILES;
+		for (i = 0; i < SIMILARITY_BLOCK_FILES && result == EXIT_SUCCESS;
+				i++) {
+			for (j = 0; j < SIMILARITY_BLOCK_FILES; j++) {
+				if (first + i >= count || firstColumn + j >= count
+						|| first + i >= firstColumn + j) {
+					continue;
+				}
+				if (json && records > 0) {
+					fprintf(out, ",\n");
+				}
+				records++;
+				if (!csv) {
+					fprintf(out, "{\"file1\":");
+				}
+				printQuotedName(out, fileNames[first + i], !csv);
+				fprintf(out, csv ? "," : ",\"file2\":");
+				printQuotedName(out, fileNames[firstColumn + j], !csv);
+				if (!block->computed[i][j]) {
+					fprintf(out, csv ? ",,\n" : ",\"euclidean\":null,"
+							"\"lcss\":null}");
+				} else {
+					fprintf(out, csv ? ",%.3f,%.3f\n" : ",\"euclidean\":%.3f,"
+							"\"lcss\":%.3f}", block->distances[i][j][0],
+							block->distances[i][j][1]);
+				}
+				if (!csv && !json) {
+					fprintf(out, "\n");
+				}
+			}
+		}
+		free(block);
+	}
+	if (result == EXIT_SUCCESS && json) {
+		fprintf(out, "]\n");
+	}
+	fflush(out);
+	free(shardBlocks);
+	return result;
+}
+
+PRIVATE double euclideanDistance(PLANAR *planar1, PLANAR *planar2) {
+	PLANAR *longer = (planar1->frames >= planar2->frames) ? planar1 : planar2;
+	long common = (planar1->frames < planar2->frames) ?
+			planar1->frames : planar2->frames;
+	double sum = 0;
+	int c;
+	for (c = 0; c < planar1->channels; c++) {
+		sum += sumSquaredDifferences(planarChannel(planar1, c),
+				planarChannel(planar2, c), common);
+		sum += sumSquares(planarChannel(longer, c) + common,
+				longer->frames - common);
+	}
+	return sqrt(sum);
+}
+
+/**
+ * @brief Check whether two frames of planar samples are equal
+ *
+ * 	@param *planar1 the planar samples of the input1
+ * 	@param i the frame of the input1
+ * 	@param *planar2 the planar samples of the input2
+ * 	@param j the frame of the input2
+ * 	@return bool true if all the samples of the frames are equal
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE bool equalFrames(PLANAR *planar1, long i, PLANAR *planar2, long j) {
+	int c;
+	for (c = 1; c < planar1->channels; c++) {
+		if (planarChannel(planar1, c)[i] != planarChannel(planar2, c)[j]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+PRIVATE double LCSSDistance(PLANAR *planar1, PLANAR *planar2) {
+	long int i, j, wav1Size = planar1->frames, wav2Size = planar2->frames;
+	const float *first = planarChannel(planar1, 0);
+	const float *second = planarChannel(planar2, 0);
+	// the row of the table before the current one and the current one
+	unsigned int *previous = (unsigned int *) calloc(wav2Size + 1,
+			sizeof(unsigned int));
+	unsigned int *current = (unsigned int *) calloc(wav2Size + 1,
+			sizeof(unsigned int));
+	unsigned int *swap;
+	if (previous == NULL || current == NULL) {
+		free(previous);
+		free(current);
+		return -1;
 	}
-#ifdef DEBUG_SIMILARITY
-	unsigned long int max = 0;
-#endif
 	for (i = 1; i <= wav1Size; i++) {
 		for (j = 1; j <= wav2Size; j++) {
-			if (wav1->data->channel[i - 1] == wav2->data->channel[j - 1]) {
-				C[i][j] = C[i - 1][j - 1] + 1;
+			if (first[i - 1] == second[j - 1]
+					&& equalFrames(planar1, i - 1, planar2, j - 1)) {
+				current[j] = previous[j - 1] + 1;
 			} else {
-				C[i][j] =
-						(C[i][j - 1] > C[i - 1][j]) ? C[i][j - 1] : C[i - 1][j];
+				current[j] =
+						(current[j - 1] > previous[j]) ?
+								current[j - 1] : previous[j];
 			}
-#ifdef DEBUG_SIMILARITY
-			if (C[i][j] > max) {
-				max = C[i][j];
-			}
-#endif
 		}
+		swap = previous;
+		previous = current;
+		current = swap;
 	}
-
 #ifdef DEBUG_SIMILARITY
-	printf("\n\nmax = %lu\n", max);
-	printf("\nUSHRT_MAX = %u\n", USHRT_MAX);
 	printf("\nWAV 1 Size: = %lu\n", wav1Size);
 	printf("\nWAV 2 Size: = %lu\n\n", wav2Size);
 #endif
 	long int minimum = (wav1Size < wav2Size) ? wav1Size : wav2Size;
-	double result = 1 - (double) C[wav1Size][wav2Size] / (double) minimum;
-	// Free some space
-	for (i = 0; i < wav1Size + 1; i++) {
-		free(C[i]);
-	}
-	free(C);
+	// an empty sound has nothing in common with another one
+	double result = (minimum == 0) ? (wav1Size != wav2Size) :
+			1 - (double) previous[wav2Size] / (double) minimum;
+	free(previous);
+	free(current);
 	return result;
 }
 #ifdef DEBUG_SIMILARITY
@@ -181,7 +457,7 @@ PRIVATE double LCSSDistance(WAV *wav1, WAV *wav2) {
 int main(int argc,char* argv[]) {
 	if (strcmp(argv[1], "-similarity") == 0) {
 		for (i = 3; i < argc; i++) {
-			if (similarity(argv[2], argv[i]) == EXIT_FAILURE) {
+			if (similarity(stdout, argv[2], argv[i]) == EXIT_FAILURE) {
 				printf("This is not a compatible .wav audio file.\n");
 				return EXIT_FAILURE;
 			}
@@ -0,0 +1,1631 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file stream.c
+ *  @brief Streams of frames of .wav files
+ *
+ *  Implements the streams of frames which are chained by the pipelines. Every stream
+ *  pulls blocks of frames from its upstream into its own block and produces its frames
+ *  from them ,so a chain keeps one block for each stream in memory.
+ *
+ *  The streams which can be read map a range of their frames to the range of their
+ *  upstream which gives them: chop moves the range by its first frame ,reverse mirrors
+ *  it and mono ,gain ,convert and the channel maps keep it. These streams are pulled by reading
+ *  their next range.
+ *  A resampled stream is only pulled ,since its frames depend on the frames around them.
+ *
+ *  @version 1.0
+ *  @author Marios Pafitis
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "channelMap.h"
+#include "resample.h"
+#include "ringBuffer.h"
+#include "stream.h"
+
+// The maximum number of chunks skipped before the data chunk of a pipe
+#define MAX_PIPE_CHUNKS 64
+// The maximum length of the name of a stage
+#define STAGE_NAME_LENGTH 16
+
+/**
+ * The state of a stream of a .wav file
+ */
+typedef struct {
+	int fd;
+	long dataOffset;
+	long position; // the next frame of a pipe
+	long nextFrame; // the frame after the last frame read
+	ASYNC_FILE *ahead; // the reads ahead of the sequential reads or NULL
+	byte *block; // the block read ahead which is copied
+	long blockBytes;
+	long blockUsed;
+} FILE_STATE;
+
+/**
+ * The state of a stream of a range of frames
+ */
+typedef struct {
+	long first;
+	long last;
+	long position; // the next frame of the upstream
+} CHOP_STATE;
+
+/**
+ * The state of a stream of two upstreams mixed
+ */
+typedef struct {
+	byte *block; // a block of frames of the second upstream
+} MIX_STATE;
+
+/**
+ * The state of a stream of many tracks mixed down to stereo
+ */
+typedef struct {
+	int count;
+	STREAM **tracks;
+	CHANNEL_MAP *maps; // the gain and the pan of every track
+	bool *ended;
+	SAMPLE_FORMAT format;
+	PLANAR input; // the samples of a block of a track
+	PLANAR sum; // the sums of the two channels
+} MIXDOWN_STATE;
+
+/**
+ * The state of a stage
+ */
+typedef struct {
+	RING_BUFFER *ring;
+	pthread_t thread;
+	char name[STAGE_NAME_LENGTH];
+	byte *slot; // the block taken out of the ring or NULL
+	long length;
+	long used;
+	bool failed;
+	unsigned long long frames;
+	double busySeconds; // the time the thread spent pulling the upstream
+} STAGE_STATE;
+
+/**
+ * The state of a stream with a gain
+ */
+typedef struct {
+	double factor;
+} GAIN_STATE;
+
+/**
+ * The state of a stream in another sample format
+ */
+typedef struct {
+	CONVERTER converter;
+} CONVERT_STATE;
+
+/**
+ * The state of a stream of mapped channels
+ */
+typedef struct {
+	CHANNEL_MAP map;
+	SAMPLE_FORMAT format;
+	PLANAR input; // the samples of a block of the upstream ,if it isn't a permutation
+	PLANAR output; // the samples of the mapped channels
+} MAP_STATE;
+
+/**
+ * The state of a stream at another sample rate
+ */
+typedef struct {
+	RESAMPLER *resampler; // NULL if the rates are equal
+	SAMPLE_FORMAT format;
+	PLANAR input; // the samples of a block of the upstream
+	PLANAR output; // the samples produced by the resampler
+	long produced; // the number of the frames of the output
+	long used; // the number of the frames of the output already pulled
+	bool finished;
+} RESAMPLE_STATE;
+
+/**
+ * The state of a reversed stream
+ */
+typedef struct {
+	byte *frames; // all the frames of the upstream
+	long count;
+	long position; // the number of the frames produced
+	bool loaded;
+} REVERSE_STATE;
+
+PUBLIC void initHeader(HEADER *header, word channels, dword sampleRate,
+		word bitsPerSample, dword dataSize) {
+	memcpy(header->ChunkID, "RIFF", 4);
+	header->ChunkSize = 36 + dataSize;
+	memcpy(header->Format, "WAVE", 4);
+	memcpy(header->Subchunk1ID, "fmt ", 4);
+	header->Subchunk1Size = 16;
+	header->AudioFormat = 1;
+	header->NumChannels = channels;
+	header->SampleRate = sampleRate;
+	header->BlockAlign = channels * (bitsPerSample >> 3);
+	header->ByteRate = sampleRate * header->BlockAlign;
+	header->BitsPerSample = bitsPerSample;
+	memcpy(header->Subchunk2ID, "data", 4);
+	header->Subchunk2Size = dataSize;
+}
+
+/**
+ * @brief Create a stream after an upstream
+ *
+ *	The stream gets the format and the number of the frames of the upstream and a block for
+ *	the frames of the upstream.
+ *
+ * 	@param *upstream the upstream or NULL
+ * 	@param stateSize the size of the state of the stream
+ * 	@return STREAM* the stream or NULL if there isn't enough memory
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE STREAM *createStream(STREAM *upstream, size_t stateSize) {
+	STREAM *stream = (STREAM *) calloc(1, sizeof(STREAM));
+	if (stream == NULL) {
+		return NULL;
+	}
+	stream->state = calloc(1, stateSize);
+	if (upstream != NULL) {
+		stream->upstream = upstream;
+		stream->header = upstream->header;
+		stream->frames = upstream->frames;
+		stream->channelMask = upstream->channelMask;
+		stream->block = (byte *) malloc(
+				(size_t) STREAM_BLOCK_FRAMES * upstream->header.BlockAlign);
+	}
+	if (stream->state == NULL || (upstream != NULL && stream->block == NULL)) {
+		free(stream->state);
+		free(stream->block);
+		free(stream);
+		return NULL;
+	}
+	return stream;
+}
+
+/**
+ * @brief Set the number of the frames of a stream and the sizes of its header
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE void setFrames(STREAM *stream, long frames) {
+	word audioFormat = stream->header.AudioFormat;
+	stream->frames = frames;
+	initHeader(&stream->header, stream->header.NumChannels,
+			stream->header.SampleRate, stream->header.BitsPerSample,
+			(frames < 0) ? 0 : (dword) (frames * stream->header.NumChannels
+							* (stream->header.BitsPerSample >> 3)));
+	stream->header.AudioFormat = audioFormat;
+}
+
+/**
+ * @brief Pull the next frames of a stream which can be read
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long pullRange(STREAM *stream, byte *frames, long count) {
+	if (count > stream->frames - stream->position) {
+		count = stream->frames - stream->position;
+	}
+	if (count <= 0) {
+		return 0;
+	}
+	count = stream->read(stream, stream->position, frames, count);
+	if (count > 0) {
+		stream->position += count;
+	}
+	return count;
+}
+
+/**
+ * @brief Copy the next bytes of the blocks read ahead of a file
+ *
+ * 	@param *state the state of the stream of the file
+ * 	@param *bytes where the bytes are copied
+ * 	@param count the number of the bytes
+ * 	@return long the number of the bytes copied ,fewer at the end of the file
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long copyAhead(FILE_STATE *state, byte *bytes, long count) {
+	long total = 0, length;
+	while (total < count) {
+		if (state->blockUsed == state->blockBytes) {
+			state->blockBytes = readAsyncBlock(state->ahead, &state->block);
+			state->blockUsed = 0;
+			if (state->blockBytes <= 0) {
+				state->blockBytes = 0;
+				break;
+			}
+		}
+		length = state->blockBytes - state->blockUsed;
+		if (length > count - total) {
+			length = count - total;
+		}
+		memcpy(bytes + total, state->block + state->blockUsed, length);
+		state->blockUsed += length;
+		total += length;
+	}
+	return total;
+}
+
+/**
+ * @brief Read a range of the frames of a .wav file
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long readFile(STREAM *stream, long first, byte *frames, long count) {
+	FILE_STATE *state = (FILE_STATE *) stream->state;
+	long blockAlign = stream->header.BlockAlign;
+	if (first < 0 || first + count > stream->frames) {
+		return -1;
+	}
+	// the sequential reads are read ahead ,a jump reads with pread again
+	bool sequential = first == state->nextFrame;
+	long remaining = (stream->frames - first) * blockAlign;
+	if (!sequential && state->ahead != NULL) {
+		closeAsyncFile(&state->ahead);
+	}
+	if (sequential && state->ahead == NULL && remaining > ASYNC_BLOCK_BYTES) {
+		state->ahead = openAsyncFile(state->fd, false,
+				state->dataOffset + first * blockAlign, remaining,
+				ASYNC_BLOCK_BYTES);
+		state->blockBytes = state->blockUsed = 0;
+	}
+	state->nextFrame = first + count;
+	if (state->ahead != NULL) {
+		return (copyAhead(state, frames, count * blockAlign)
+				== count * blockAlign) ? count : -1;
+	}
+	ssize_t bytesRead = pread(state->fd, frames, count * blockAlign,
+			state->dataOffset + first * blockAlign);
+	return (bytesRead == count * blockAlign) ? count : -1;
+}
+
+/**
+ * @brief Close the file of a stream of a .wav file
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE void closeFile(STREAM *stream) {
+	FILE_STATE *state = (FILE_STATE *) stream->state;
+	if (state->ahead != NULL) {
+		closeAsyncFile(&state->ahead);
+	}
+	close(state->fd);
+}
+
+/**
+ * @brief Read bytes from a file until all of them are read or the file ends
+ *
+ * 	@param fd the file descriptor
+ * 	@param *bytes where the bytes are placed
+ * 	@param count the number of the bytes
+ * 	@return long the number of the bytes read
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE long readFully(int fd, byte *bytes, long count) {
+	long total = 0;
+	ssize_t bytesRead;
+	while (total < count) {
+		bytesRead = read(fd, bytes + total, count - total);
+		if (bytesRead <= 0) {
+			break;
+		}
+		total += bytesRead;
+	}
+	return total;
+}
+
+/**
+ * @brief Skip bytes of a file which can't be seeked
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE int skipBytes(int fd, long count) {
+	byte bytes[512];
+	long length;
+	while (count > 0) {
+		length = (count < (long) sizeof(bytes)) ? count : (long) sizeof(bytes);
+		if (readFully(fd, bytes, length) != length) {
+			return EXIT_FAILURE;
+		}
+		count -= length;
+	}
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int readHeaderPipe(int fd, HEADER *header, FORMAT_EXTENSION *extension) {
+	byte chunk[8 + EXTENSIBLE_FMT_SIZE];
+	dword size, length;
+	bool foundFormat = false;
+	int i;
+	memset(header, 0, sizeof(HEADER));
+	if (readFully(fd, chunk, 12) != 12) {
+		return EXIT_FAILURE;
+	}
+	memcpy(header->ChunkID, chunk, 4);
+	memcpy(&header->ChunkSize, chunk + 4, 4);
+	memcpy(header->Format, chunk + 8, 4);
+	for (i = 0; i < MAX_PIPE_CHUNKS; i++) {
+		if (readFully(fd, chunk, 8) != 8) {
+			return EXIT_FAILURE;
+		}
+		memcpy(&size, chunk + 4, 4);
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			length = (size < EXTENSIBLE_FMT_SIZE) ? size : EXTENSIBLE_FMT_SIZE;
+			if (size < 16 || readFully(fd, chunk + 8, length) != length) {
+				return EXIT_FAILURE;
+			}
+			memcpy(header->Subchunk1ID, chunk, 8);
+			parseFormatChunk(chunk + 8, length, header, extension);
+			foundFormat = true;
+			size -= length;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			memcpy(header->Subchunk2ID, chunk, 4);
+			header->Subchunk2Size = size;
+			return foundFormat ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		if (skipBytes(fd, (long) size + (size & 1)) == EXIT_FAILURE) {
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_FAILURE;
+}
+
+/**
+ * @brief Pull the next frames of a .wav file from a pipe
+ *
+ *	A partial frame at the end of the pipe is dropped.
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long pullPipe(STREAM *stream, byte *frames, long count) {
+	FILE_STATE *state = (FILE_STATE *) stream->state;
+	long blockAlign = stream->header.BlockAlign;
+	if (stream->frames >= 0 && count > stream->frames - state->position) {
+		count = stream->frames - state->position;
+	}
+	if (count <= 0) {
+		return 0;
+	}
+	count = ((state->ahead != NULL) ?
+			copyAhead(state, frames, count * blockAlign) :
+			readFully(state->fd, frames, count * blockAlign)) / blockAlign;
+	state->position += count;
+	return count;
+}
+
+/**
+ * @brief Open a stream of a .wav file from a pipe
+ *
+ *	If the size of the data isn't known (a streaming header) the frames are pulled until
+ *	the end of the pipe.
+ *
+ * 	@param fd the file descriptor of the pipe
+ * 	@return STREAM* the stream or NULL if the file isn't a correct .wav
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE STREAM *openPipeStream(int fd) {
+	HEADER header;
+	FORMAT_EXTENSION extension;
+	if (readHeaderPipe(fd, &header, &extension) == EXIT_FAILURE) {
+		close(fd);
+		return NULL;
+	}
+	bool unknownSize = header.Subchunk2Size == STREAMING_SIZE
+			|| header.Subchunk2Size == 0 || header.ChunkSize == STREAMING_SIZE;
+	if (unknownSize) {
+		header.Subchunk2Size = 0;
+	}
+	STREAM *stream =
+			isCorrectFormatHeader(&header) ?
+					createStream(NULL, sizeof(FILE_STATE)) : NULL;
+	if (stream == NULL) {
+		close(fd);
+		return NULL;
+	}
+	FILE_STATE *state = (FILE_STATE *) stream->state;
+	state->fd = fd;
+	initHeader(&stream->header, header.NumChannels, header.SampleRate,
+			header.BitsPerSample, 0);
+	stream->header.AudioFormat = header.AudioFormat;
+	stream->channelMask = extension.ChannelMask;
+	setFrames(stream,
+			unknownSize ?
+					-1 : (long) (header.Subchunk2Size / stream->header.BlockAlign));
+	// the pipe is read ahead from the data on ,the next block while a block is used
+	long length = unknownSize ? -1 : (long) header.Subchunk2Size;
+	if (length < 0 || length > ASYNC_BLOCK_BYTES) {
+		state->ahead = openAsyncFile(fd, false, -1, length, ASYNC_BLOCK_BYTES);
+	}
+	stream->pull = pullPipe;
+	stream->close = closeFile;
+	return stream;
+}
+
+PUBLIC STREAM *openFileStream(char *filename) {
+	HEADER header;
+	FORMAT_EXTENSION extension;
+	long dataOffset = 0;
+	if (filename == NULL) {
+		return NULL;
+	}
+	int fd =
+			(strcmp(filename, "-") == 0) ?
+					dup(STDIN_FILENO) : open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (lseek(fd, 0, SEEK_CUR) < 0) {
+		return openPipeStream(fd);
+	}
+	if (readHeaderExtensionFd(fd, &header, &extension, &dataOffset)
+			== EXIT_FAILURE || !isCorrectFormatHeader(&header)) {
+		close(fd);
+		return NULL;
+	}
+	STREAM *stream = createStream(NULL, sizeof(FILE_STATE));
+	if (stream == NULL) {
+		close(fd);
+		return NULL;
+	}
+	FILE_STATE *state = (FILE_STATE *) stream->state;
+	state->fd = fd;
+	state->dataOffset = dataOffset;
+	initHeader(&stream->header, header.NumChannels, header.SampleRate,
+			header.BitsPerSample, 0);
+	stream->header.AudioFormat = header.AudioFormat;
+	stream->channelMask = extension.ChannelMask;
+	setFrames(stream, (long) (header.Subchunk2Size / stream->header.BlockAlign));
+	stream->read = readFile;
+	stream->pull = pullRange;
+	stream->close = closeFile;
+	return stream;
+}
+
+/**
+ * @brief Pull the next frames of a range of an upstream
+ *
+ *	The frames before the range are pulled and dropped.
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long pullChop(STREAM *stream, byte *frames, long count) {
+	CHOP_STATE *state = (CHOP_STATE *) stream->state;
+	long pulled;
+	while (state->position < state->first) {
+		long skip = state->first - state->position;
+		pulled = stream->upstream->pull(stream->upstream, stream->block,
+				(skip < STREAM_BLOCK_FRAMES) ? skip : STREAM_BLOCK_FRAMES);
+		if (pulled <= 0) {
+			return pulled;
+		}
+		state->position += pulled;
+	}
+	if (count > state->last - state->position) {
+		count = state->last - state->position;
+	}
+	if (count <= 0) {
+		return 0;
+	}
+	pulled = stream->upstream->pull(stream->upstream, frames, count);
+	if (pulled > 0) {
+		state->position += pulled;
+	}
+	return pulled;
+}
+
+/**
+ * @brief Read a range of the frames of a range of an upstream
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long readChop(STREAM *stream, long first, byte *frames, long count) {
+	CHOP_STATE *state = (CHOP_STATE *) stream->state;
+	return stream->upstream->read(stream->upstream, state->first + first,
+			frames, count);
+}
+
+PUBLIC STREAM *chopStream(STREAM *upstream, long first, long last) {
+	if (upstream == NULL || first < 0 || last <= first
+			|| (upstream->frames >= 0 && last > upstream->frames)) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, sizeof(CHOP_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	CHOP_STATE *state = (CHOP_STATE *) stream->state;
+	state->first = first;
+	state->last = last;
+	setFrames(stream, last - first);
+	if (upstream->read != NULL) {
+		stream->read = readChop;
+		stream->pull = pullRange;
+	} else {
+		stream->pull = pullChop;
+	}
+	return stream;
+}
+
+/**
+ * @brief Keep the left channel of the frames of a block of an upstream
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE void keepLeft(STREAM *stream, byte *frames, long count) {
+	int bytesPerSample = stream->header.BlockAlign;
+	long i;
+	for (i = 0; i < count; i++) {
+		memcpy(frames + i * bytesPerSample,
+				stream->block + i * stream->upstream->header.BlockAlign,
+				bytesPerSample);
+	}
+}
+
+/**
+ * @brief Pull the next frames of the left channel of an upstream
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long pullMono(STREAM *stream, byte *frames, long count) {
+	long pulled = stream->upstream->pull(stream->upstream, stream->block,
+			count);
+	keepLeft(stream, frames, pulled);
+	return pulled;
+}
+
+/**
+ * @brief Read a range of the frames of the left channel of an upstream
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long readMono(STREAM *stream, long first, byte *frames, long count) {
+	long read = stream->upstream->read(stream->upstream, first, stream->block,
+			count);
+	keepLeft(stream, frames, read);
+	return read;
+}
+
+PUBLIC STREAM *monoStream(STREAM *upstream) {
+	if (upstream == NULL || upstream->header.NumChannels < 2) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, 1);
+	if (stream == NULL) {
+		return NULL;
+	}
+	stream->header.NumChannels = 1;
+	// the position of the first channel is the lowest bit of the mask
+	stream->channelMask = upstream->channelMask & (~upstream->channelMask + 1);
+	setFrames(stream, upstream->frames);
+	if (upstream->read != NULL) {
+		stream->read = readMono;
+		stream->pull = pullRange;
+	} else {
+		stream->pull = pullMono;
+	}
+	return stream;
+}
+
+PUBLIC void gainSamples(byte *samples, long count, SAMPLE_FORMAT format,
+		double factor) {
+	int bytesPerSample = sampleFormatBytes(format);
+	long long maximum = (1LL << (bytesPerSample * 8 - 1)) - 1;
+	long long minimum = -maximum - 1, value;
+	double scaled;
+	byte *sample = samples;
+	float real;
+	long i;
+	int j;
+	if (format == SAMPLE_F32) {
+		for (i = 0; i < count; i++, sample += sizeof(float)) {
+			memcpy(&real, sample, sizeof(float));
+			real = (float) (real * factor);
+			memcpy(sample, &real, sizeof(float));
+		}
+		return;
+	}
+	for (i = 0; i < count; i++, sample += bytesPerSample) {
+		if (bytesPerSample == 1) {
+			value = (long long) sample[0] - 128;
+		} else {
+			value = (signed char) sample[bytesPerSample - 1];
+			for (j = bytesPerSample - 2; j >= 0; j--) {
+				value = value * 256 + sample[j];
+			}
+		}
+		scaled = floor(value * factor + 0.5);
+		value = (scaled > maximum) ? maximum :
+				(scaled < minimum) ? minimum : (long long) scaled;
+		if (bytesPerSample == 1) {
+			sample[0] = (byte) (value + 128);
+		} else {
+			for (j = 0; j < bytesPerSample; j++) {
+				sample[j] = (byte) ((unsigned long long) value >> (j * 8));
+			}
+		}
+	}
+}
+
+/**
+ * @brief Multiply the samples of a block by the gain of a stream
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE void applyGain(STREAM *stream, byte *frames, long count) {
+	gainSamples(frames, count * stream->header.NumChannels,
+			sampleFormatOf(&stream->header),
+			((GAIN_STATE *) stream->state)->factor);
+}
+
+/**
+ * @brief Pull the next frames of an upstream with a gain
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long pullGain(STREAM *stream, byte *frames, long count) {
+	long pulled = stream->upstream->pull(stream->upstream, frames, count);
+	applyGain(stream, frames, pulled);
+	return pulled;
+}
+
+/**
+ * @brief Read a range of the frames of an upstream with a gain
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE long readGain(STREAM *stream, long first, byte *frames, long count) {
+	long read = stream->upstream->read(stream->upstream, first, frames, count);
+	applyGain(stream, frames, read);
+	return read;
+}
+
+PUBLIC STREAM *gainStream(STREAM *upstream, double decibels) {
+	if (upstream == NULL) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, sizeof(GAIN_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	((GAIN_STATE *) stream->state)->factor = pow(10, decibels / 20);
+	if (upstream->read != NULL) {
+		stream->read = readGain;
+		stream->pull = pullRange;
+	} else {
+		stream->pull = pullGain;
+	}
+	return stream;
+}
+
+/**
+ * @brief Pull the next frames of an upstream in another sample format
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long pullConvert(STREAM *stream, byte *frames, long count) {
+	long pulled = stream->upstream->pull(stream->upstream, stream->block,
+			count);
+	if (pulled > 0) {
+		convertFrames(&((CONVERT_STATE *) stream->state)->converter,
+				stream->block, frames, pulled);
+	}
+	return pulled;
+}
+
+/**
+ * @brief Read a range of the frames of an upstream in another sample format
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long readConvert(STREAM *stream, long first, byte *frames, long count) {
+	long read = stream->upstream->read(stream->upstream, first, stream->block,
+			count);
+	if (read > 0) {
+		convertFrames(&((CONVERT_STATE *) stream->state)->converter,
+				stream->block, frames, read);
+	}
+	return read;
+}
+
+/**
+ * @brief Free the block of the converter of a stream
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void closeConvert(STREAM *stream) {
+	freeConverter(&((CONVERT_STATE *) stream->state)->converter);
+}
+
+PUBLIC STREAM *convertStream(STREAM *upstream, SAMPLE_FORMAT format,
+		bool dither) {
+	if (upstream == NULL || format == SAMPLE_UNKNOWN
+			|| sampleFormatOf(&upstream->header) == SAMPLE_UNKNOWN) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, sizeof(CONVERT_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	CONVERT_STATE *state = (CONVERT_STATE *) stream->state;
+	if (createConverter(&state->converter, sampleFormatOf(&upstream->header),
+			format, upstream->header.NumChannels, dither) == EXIT_FAILURE) {
+		stream->upstream = NULL; // the upstream is kept by the caller
+		closeStream(&stream);
+		return NULL;
+	}
+	stream->close = closeConvert;
+	setSampleFormat(&stream->header, format);
+	setFrames(stream, upstream->frames);
+	if (upstream->read != NULL) {
+		stream->read = readConvert;
+		stream->pull = pullRange;
+	} else {
+		stream->pull = pullConvert;
+	}
+	return stream;
+}
+
+/**
+ * @brief Map the channels of a block of frames of the upstream
+ *
+ *	A permutation copies the samples ,any other map decodes the block to planar samples
+ *	,maps them and encodes them again.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void mapBlock(STREAM *stream, byte *frames, long count) {
+	MAP_STATE *state = (MAP_STATE *) stream->state;
+	float *in[MAX_CHANNELS], *out[MAX_CHANNELS];
+	int c;
+	if (count <= 0) {
+		return;
+	}
+	if (state->map.permutation) {
+		mapFrames(&state->map, stream->block, count,
+				sampleFormatBytes(state->format), frames);
+		return;
+	}
+	for (c = 0; c < state->map.inChannels; c++) {
+		in[c] = planarChannel(&state->input, c);
+	}
+	for (c = 0; c < state->map.outChannels; c++) {
+		out[c] = planarChannel(&state->output, c);
+	}
+	decodeSamples(stream->block, count, state->map.inChannels, state->format,
+			in);
+	mapChannels(&state->map, in, count, out);
+	encodeSamples(out, count, state->map.outChannels, state->format, frames);
+}
+
+/**
+ * @brief Pull the next frames of an upstream with mapped channels
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long pullMap(STREAM *stream, byte *frames, long count) {
+	long pulled = stream->upstream->pull(stream->upstream, stream->block,
+			count);
+	mapBlock(stream, frames, pulled);
+	return pulled;
+}
+
+/**
+ * @brief Read a range of the frames of an upstream with mapped channels
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long readMap(STREAM *stream, long first, byte *frames, long count) {
+	long read = stream->upstream->read(stream->upstream, first, stream->block,
+			count);
+	mapBlock(stream, frames, read);
+	return read;
+}
+
+/**
+ * @brief Free the samples of a stream of mapped channels
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void closeMap(STREAM *stream) {
+	MAP_STATE *state = (MAP_STATE *) stream->state;
+	freePlanar(&state->input);
+	freePlanar(&state->output);
+}
+
+PUBLIC STREAM *channelMapStream(STREAM *upstream, const CHANNEL_MAP *map) {
+	if (upstream == NULL || map == NULL
+			|| map->inChannels != upstream->header.NumChannels
+			|| sampleFormatOf(&upstream->header) == SAMPLE_UNKNOWN) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, sizeof(MAP_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	MAP_STATE *state = (MAP_STATE *) stream->state;
+	state->map = *map;
+	state->format = sampleFormatOf(&upstream->header);
+	stream->close = closeMap;
+	if (!map->permutation
+			&& (createPlanar(&state->input, map->inChannels,
+					STREAM_BLOCK_FRAMES) == EXIT_FAILURE
+					|| createPlanar(&state->output, map->outChannels,
+							STREAM_BLOCK_FRAMES) == EXIT_FAILURE)) {
+		stream->upstream = NULL; // the upstream is kept by the caller
+		closeStream(&stream);
+		return NULL;
+	}
+	stream->header.NumChannels = (word) map->outChannels;
+	stream->channelMask = map->outMask;
+	setFrames(stream, upstream->frames);
+	if (upstream->read != NULL) {
+		stream->read = readMap;
+		stream->pull = pullRange;
+	} else {
+		stream->pull = pullMap;
+	}
+	return stream;
+}
+
+/**
+ * @brief Pull the next frames of an upstream at another sample rate
+ *
+ *	The blocks of the upstream are resampled until the resampler produces frames ,the last
+ *	frames are taken from the resampler at the end of the upstream.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long pullResample(STREAM *stream, byte *frames, long count) {
+	RESAMPLE_STATE *state = (RESAMPLE_STATE *) stream->state;
+	int channels = stream->header.NumChannels, c;
+	float *in[channels], *out[channels];
+	long pulled;
+	if (state->resampler == NULL) {
+		return stream->upstream->pull(stream->upstream, frames, count);
+	}
+	for (c = 0; c < channels; c++) {
+		in[c] = planarChannel(&state->input, c);
+		out[c] = planarChannel(&state->output, c);
+	}
+	while (state->used == state->produced) {
+		if (state->finished) {
+			return 0;
+		}
+		pulled = stream->upstream->pull(stream->upstream, stream->block,
+				STREAM_BLOCK_FRAMES);
+		if (pulled < 0) {
+			return -1;
+		}
+		if (pulled == 0) {
+			state->produced = finishResampler(state->resampler, out);
+			state->finished = true;
+		} else {
+			decodeSamples(stream->block, pulled, channels, state->format, in);
+			state->produced = resampleFrames(state->resampler, in, pulled, out);
+		}
+		state->used = 0;
+	}
+	if (count > state->produced - state->used) {
+		count = state->produced - state->used;
+	}
+	for (c = 0; c < channels; c++) {
+		out[c] += state->used;
+	}
+	encodeSamples(out, count, channels, state->format, frames);
+	state->used += count;
+	return count;
+}
+
+/**
+ * @brief Free the resampler and the samples of a resampled stream
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void closeResample(STREAM *stream) {
+	RESAMPLE_STATE *state = (RESAMPLE_STATE *) stream->state;
+	freeResampler(&state->resampler);
+	freePlanar(&state->input);
+	freePlanar(&state->output);
+}
+
+PUBLIC STREAM *resampleStream(STREAM *upstream, dword rate) {
+	if (upstream == NULL || rate == 0
+			|| sampleFormatOf(&upstream->header) == SAMPLE_UNKNOWN) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, sizeof(RESAMPLE_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	RESAMPLE_STATE *state = (RESAMPLE_STATE *) stream->state;
+	int channels = upstream->header.NumChannels;
+	stream->pull = pullResample;
+	stream->close = closeResample;
+	if (rate == upstream->header.SampleRate) {
+		return stream;
+	}
+	state->format = sampleFormatOf(&upstream->header);
+	state->resampler = createResampler(channels, upstream->header.SampleRate,
+			rate);
+	if (state->resampler == NULL
+			|| createPlanar(&state->input, channels, STREAM_BLOCK_FRAMES)
+					== EXIT_FAILURE
+			|| createPlanar(&state->output, channels,
+					resampleCapacity(state->resampler)) == EXIT_FAILURE) {
+		stream->upstream = NULL; // the upstream is kept by the caller
+		closeStream(&stream);
+		return NULL;
+	}
+	stream->header.SampleRate = rate;
+	setFrames(stream,
+			(upstream->frames < 0) ?
+					-1 : resampledFrames(state->resampler, upstream->frames));
+	return stream;
+}
+
+/**
+ * @brief Pull the next frames of a reversed upstream
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long pullReverse(STREAM *stream, byte *frames, long count) {
+	REVERSE_STATE *state = (REVERSE_STATE *) stream->state;
+	long blockAlign = stream->header.BlockAlign;
+	long capacity = 0, pulled, i;
+	if (!state->loaded) {
+		// keep all the frames of the upstream ,the last one is produced first
+		while (true) {
+			if (state->count + STREAM_BLOCK_FRAMES > capacity) {
+				capacity = (capacity == 0 && stream->frames > 0) ?
+						stream->frames + STREAM_BLOCK_FRAMES :
+						(capacity + STREAM_BLOCK_FRAMES) << 1;
+				byte *temp = (byte *) realloc(state->frames,
+						capacity * blockAlign);
+				if (temp == NULL) {
+					return -1;
+				}
+				state->frames = temp;
+			}
+			pulled = stream->upstream->pull(stream->upstream,
+					state->frames + state->count * blockAlign,
+					STREAM_BLOCK_FRAMES);
+			if (pulled < 0) {
+				return -1;
+			}
+			if (pulled == 0) {
+				break;
+			}
+			state->count += pulled;
+		}
+		state->loaded = true;
+	}
+	if (count > state->count - state->position) {
+		count = state->count - state->position;
+	}
+	for (i = 0; i < count; i++) {
+		memcpy(frames + i * blockAlign,
+				state->frames
+						+ (state->count - 1 - state->position - i) * blockAlign,
+				blockAlign);
+	}
+	state->position += count;
+	return count;
+}
+
+/**
+ * @brief Free the frames of a reversed stream
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void closeReverse(STREAM *stream) {
+	free(((REVERSE_STATE *) stream->state)->frames);
+}
+
+/**
+ * @brief Pull frames from a stream until all of them are pulled or the stream ends
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long pullFully(STREAM *stream, byte *frames, long count) {
+	long total = 0, pulled;
+	while (total < count) {
+		pulled = stream->pull(stream, frames + total * stream->header.BlockAlign,
+				count - total);
+		if (pulled < 0) {
+			return -1;
+		}
+		if (pulled == 0) {
+			break;
+		}
+		total += pulled;
+	}
+	return total;
+}
+
+/**
+ * @brief Interleave the right channel of the first and the left channel of the second
+ *
+ *	The left (first) channel of the second upstream is the left channel of the output and
+ *	the right (second) or only channel of the first upstream is the right channel ,like mix.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void interleave(STREAM *stream, byte *frames, long count) {
+	byte *first = stream->block, *second = ((MIX_STATE *) stream->state)->block;
+	int bytesPerSample = stream->header.BitsPerSample >> 3;
+	int blockAlign1 = stream->upstream->header.BlockAlign;
+	int blockAlign2 = stream->other->header.BlockAlign;
+	long i;
+	if (stream->upstream->header.NumChannels >= 2) {
+		first += bytesPerSample;
+	}
+	for (i = 0; i < count; i++) {
+		memcpy(frames, second, bytesPerSample);
+		memcpy(frames + bytesPerSample, first, bytesPerSample);
+		frames += bytesPerSample << 1;
+		first += blockAlign1;
+		second += blockAlign2;
+	}
+}
+
+/**
+ * @brief Pull the next frames of two upstreams mixed
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long pullMix(STREAM *stream, byte *frames, long count) {
+	long pulled1 = pullFully(stream->upstream, stream->block, count);
+	long pulled2 = pullFully(stream->other,
+			((MIX_STATE *) stream->state)->block, count);
+	if (pulled1 < 0 || pulled2 < 0) {
+		return -1;
+	}
+	count = (pulled1 < pulled2) ? pulled1 : pulled2;
+	interleave(stream, frames, count);
+	return count;
+}
+
+/**
+ * @brief Read a range of the frames of two upstreams mixed
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long readMix(STREAM *stream, long first, byte *frames, long count) {
+	if (stream->upstream->read(stream->upstream, first, stream->block, count)
+			!= count
+			|| stream->other->read(stream->other, first,
+					((MIX_STATE *) stream->state)->block, count) != count) {
+		return -1;
+	}
+	interleave(stream, frames, count);
+	return count;
+}
+
+/**
+ * @brief Free the block of the second upstream of a mixed stream
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void closeMix(STREAM *stream) {
+	free(((MIX_STATE *) stream->state)->block);
+}
+
+PUBLIC STREAM *mixStream(STREAM *first, STREAM *second) {
+	if (first == NULL || second == NULL
+			|| sampleFormatOf(&first->header) != sampleFormatOf(&second->header)
+			|| first->header.SampleRate != second->header.SampleRate) {
+		return NULL;
+	}
+	STREAM *stream = createStream(first, sizeof(MIX_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	MIX_STATE *state = (MIX_STATE *) stream->state;
+	state->block = (byte *) malloc(
+			(size_t) STREAM_BLOCK_FRAMES * second->header.BlockAlign);
+	stream->other = second;
+	stream->close = closeMix;
+	stream->header.NumChannels = 2;
+	stream->channelMask = defaultChannelMask(2);
+	if (first->frames < 0 || second->frames < 0) {
+		setFrames(stream, -1);
+	} else {
+		setFrames(stream,
+				(first->frames < second->frames) ?
+						first->frames : second->frames);
+	}
+	if (first->read != NULL && second->read != NULL) {
+		stream->read = readMix;
+		stream->pull = pullRange;
+	} else {
+		stream->pull = pullMix;
+	}
+	if (state->block == NULL) {
+		// the upstreams are kept by the caller
+		stream->upstream = NULL;
+		stream->other = NULL;
+		closeStream(&stream);
+	}
+	return stream;
+}
+
+/**
+ * @brief Pull the next frames of many tracks mixed down
+ *
+ *	A block of every track is decoded and added to the sums with its gain and pan. The
+ *	sums are limited to full scale and encoded once ,the output ends with the longest
+ *	track.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long pullMixdown(STREAM *stream, byte *frames, long count) {
+	MIXDOWN_STATE *state = (MIXDOWN_STATE *) stream->state;
+	float *in[MAX_CHANNELS], *sums[2];
+	long produced = 0, pulled;
+	int t, c;
+	for (c = 0; c < 2; c++) {
+		sums[c] = planarChannel(&state->sum, c);
+		memset(sums[c], 0, sizeof(float) * count);
+	}
+	for (t = 0; t < state->count; t++) {
+		STREAM *track = state->tracks[t];
+		if (state->ended[t]) {
+			continue;
+		}
+		if ((pulled = pullFully(track, stream->block, count)) < 0) {
+			return -1;
+		}
+		state->ended[t] = (pulled < count);
+		for (c = 0; c < track->header.NumChannels; c++) {
+			in[c] = planarChannel(&state->input, c);
+		}
+		decodeSamples(stream->block, pulled, track->header.NumChannels,
+				sampleFormatOf(&track->header), in);
+		accumulateChannels(&state->maps[t], in, pulled, sums);
+		if (pulled > produced) {
+			produced = pulled;
+		}
+	}
+	for (c = 0; c < 2; c++) {
+		saturateSamples(sums[c], produced);
+	}
+	encodeSamples(sums, produced, 2, state->format, frames);
+	return produced;
+}
+
+/**
+ * @brief Close the tracks of a stream mixed down
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void closeMixdown(STREAM *stream) {
+	MIXDOWN_STATE *state = (MIXDOWN_STATE *) stream->state;
+	int t;
+	for (t = 0; t < state->count; t++) {
+		closeStream(&state->tracks[t]);
+	}
+	free(state->tracks);
+	free(state->maps);
+	free(state->ended);
+	freePlanar(&state->input);
+	freePlanar(&state->sum);
+}
+
+PUBLIC STREAM *mixdownStream(STREAM **tracks, const CHANNEL_MAP *maps,
+		int count) {
+	SAMPLE_FORMAT format = SAMPLE_UNKNOWN;
+	long frames = 0, blockAlign = 0;
+	int channels = 0, t;
+	if (tracks == NULL || maps == NULL || count < 1) {
+		return NULL;
+	}
+	for (t = 0; t < count; t++) {
+		if (tracks[t] == NULL || maps[t].outChannels != 2
+				|| maps[t].inChannels != tracks[t]->header.NumChannels
+				|| sampleFormatOf(&tracks[t]->header) == SAMPLE_UNKNOWN
+				|| tracks[t]->header.SampleRate
+						!= tracks[0]->header.SampleRate) {
+			return NULL;
+		}
+		// the output has the widest sample format of the tracks
+		format = (t == 0) ?
+				sampleFormatOf(&tracks[t]->header) :
+				widerSampleFormat(format, sampleFormatOf(&tracks[t]->header));
+		if (tracks[t]->header.BlockAlign > blockAlign) {
+			blockAlign = tracks[t]->header.BlockAlign;
+		}
+		if (tracks[t]->header.NumChannels > channels) {
+			channels = tracks[t]->header.NumChannels;
+		}
+		if (frames >= 0) {
+			frames = (tracks[t]->frames < 0) ? -1 :
+						(tracks[t]->frames > frames) ? tracks[t]->frames : frames;
+		}
+	}
+	STREAM *stream = createStream(NULL, sizeof(MIXDOWN_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	MIXDOWN_STATE *state = (MIXDOWN_STATE *) stream->state;
+	stream->close = closeMixdown;
+	state->tracks = (STREAM **) malloc(sizeof(STREAM *) * count);
+	state->maps = (CHANNEL_MAP *) malloc(sizeof(CHANNEL_MAP) * count);
+	state->ended = (bool *) calloc(count, sizeof(bool));
+	stream->block = (byte *) malloc((size_t) STREAM_BLOCK_FRAMES * blockAlign);
+	if (state->tracks == NULL || state->maps == NULL || state->ended == NULL
+			|| stream->block == NULL
+			|| createPlanar(&state->input, channels, STREAM_BLOCK_FRAMES)
+					== EXIT_FAILURE
+			|| createPlanar(&state->sum, 2, STREAM_BLOCK_FRAMES)
+					== EXIT_FAILURE) {
+		// the tracks are kept by the caller
+		closeStream(&stream);
+		return NULL;
+	}
+	memcpy(state->tracks, tracks, sizeof(STREAM *) * count);
+	memcpy(state->maps, maps, sizeof(CHANNEL_MAP) * count);
+	state->count = count;
+	state->format = format;
+	initHeader(&stream->header, 2, tracks[0]->header.SampleRate,
+			(word) (sampleFormatBytes(format) << 3), 0);
+	setSampleFormat(&stream->header, format);
+	stream->channelMask = defaultChannelMask(2);
+	setFrames(stream, frames);
+	stream->pull = pullMixdown;
+	return stream;
+}
+
+/**
+ * @brief Reverse the order of the frames of a block
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void reverseFrames(byte *frames, long count, long blockAlign) {
+	byte temp[blockAlign];
+	byte *front = frames, *back = frames + (count - 1) * blockAlign;
+	while (front < back) {
+		memcpy(temp, front, blockAlign);
+		memcpy(front, back, blockAlign);
+		memcpy(back, temp, blockAlign);
+		front += blockAlign;
+		back -= blockAlign;
+	}
+}
+
+/**
+ * @brief Read a range of the frames of a reversed upstream
+ *
+ *	The frames are the mirrored range of the upstream in the reverse order.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE long readReverse(STREAM *stream, long first, byte *frames, long count) {
+	long read = stream->upstream->read(stream->upstream,
+			stream->frames - first - count, frames, count);
+	if (read > 0) {
+		reverseFrames(frames, read, stream->header.BlockAlign);
+	}
+	return read;
+}
+
+PUBLIC STREAM *reverseStream(STREAM *upstream) {
+	if (upstream == NULL) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, sizeof(REVERSE_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	if (upstream->read != NULL && upstream->frames >= 0) {
+		stream->read = readReverse;
+		stream->pull = pullRange;
+	} else {
+		stream->pull = pullReverse;
+		stream->close = closeReverse;
+	}
+	return stream;
+}
+
+/**
+ * @brief The thread of a stage ,it pulls the upstream into the ring
+ *
+ *	An error of the upstream is passed as a block of length -1.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void *runStage(void *argument) {
+	STREAM *stream = (STREAM *) argument;
+	STAGE_STATE *state = (STAGE_STATE *) stream->state;
+	struct timespec start, end;
+	long pulled = 1;
+	byte *slot;
+	while (pulled > 0 && (slot = acquireWriteSlot(state->ring)) != NULL) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		pulled = stream->upstream->pull(stream->upstream, slot,
+				STREAM_BLOCK_FRAMES);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		state->busySeconds += (end.tv_sec - start.tv_sec)
+				+ (end.tv_nsec - start.tv_nsec) / 1e9;
+		if (pulled != 0) {
+			commitWriteSlot(state->ring, pulled);
+		}
+	}
+	finishRingBuffer(state->ring);
+	return NULL;
+}
+
+/**
+ * @brief Pull the next frames of a stage from the blocks of its ring buffer
+ *
+ *	The frames are copied from the block taken out of the ring ,the block is given
+ *	back to the thread of the stage when all of its frames are pulled.
+ *
+ * 	@param *stream the stream of the stage
+ * 	@param *frames where the frames are placed
+ * 	@param count the number of the frames
+ * 	@return long the number of the frames ,0 at the end or -1 on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long pullStage(STREAM *stream, byte *frames, long count) {
+	STAGE_STATE *state = (STAGE_STATE *) stream->state;
+	long blockAlign = stream->header.BlockAlign, total = 0, length;
+	while (total < count && !state->failed) {
+		if (state->slot == NULL) {
+			state->slot = acquireReadSlot(state->ring, &state->length);
+			state->used = 0;
+			if (state->slot == NULL) {
+				break;
+			}
+			if (state->length < 0) {
+				state->failed = true;
+				break;
+			}
+		}
+		length = state->length - state->used;
+		if (length > count - total) {
+			length = count - total;
+		}
+		memcpy(frames + total * blockAlign,
+				state->slot + state->used * blockAlign, length * blockAlign);
+		state->used += length;
+		total += length;
+		if (state->used == state->length) {
+			releaseReadSlot(state->ring);
+			state->slot = NULL;
+		}
+	}
+	state->frames += total;
+	return state->failed ? -1 : total;
+}
+
+/**
+ * @brief Stop the thread of a stage and free its ring buffer
+ *
+ * 	@param *stream the stream of the stage
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void closeStage(STREAM *stream) {
+	STAGE_STATE *state = (STAGE_STATE *) stream->state;
+	// the thread stops at its next slot ,it may be pulling a block
+	closeRingBuffer(state->ring);
+	pthread_join(state->thread, NULL);
+	freeRingBuffer(&state->ring);
+}
+
+PUBLIC STREAM *stageStream(STREAM *upstream, const char *name) {
+	if (upstream == NULL) {
+		return NULL;
+	}
+	STREAM *stream = createStream(upstream, sizeof(STAGE_STATE));
+	if (stream == NULL) {
+		return NULL;
+	}
+	STAGE_STATE *state = (STAGE_STATE *) stream->state;
+	snprintf(state->name, STAGE_NAME_LENGTH, "%s", (name == NULL) ? "" : name);
+	state->ring = createRingBuffer(STAGE_SLOTS,
+			(size_t) STREAM_BLOCK_FRAMES * upstream->header.BlockAlign);
+	if (state->ring == NULL
+			|| pthread_create(&state->thread, NULL, runStage, stream) != 0) {
+		// the upstream stays with the caller
+		freeRingBuffer(&state->ring);
+		free(stream->state);
+		free(stream->block);
+		free(stream);
+		return NULL;
+	}
+	stream->pull = pullStage;
+	stream->close = closeStage;
+	return stream;
+}
+
+PUBLIC void printStageStatistics(STREAM *stream, FILE *out) {
+	RING_STATISTICS ring;
+	if (stream == NULL) {
+		return;
+	}
+	// the stages before this one first
+	printStageStatistics(stream->upstream, out);
+	if (stream->pull != pullStage) {
+		return;
+	}
+	STAGE_STATE *state = (STAGE_STATE *) stream->state;
+	getRingStatistics(state->ring, &ring);
+	fprintf(out, "Stage   :  %s\t(%llu blocks ,%llu frames ,%.3f s busy ,%llu "
+			"waits full ,%llu waits empty)\n", state->name, ring.read,
+			state->frames, state->busySeconds, ring.fullWaits, ring.emptyWaits);
+}
+
+/**
+ * @brief Write all the bytes to a file descriptor
+ *
+ * 	@param fd the file descriptor
+ * 	@param *bytes the bytes
+ * 	@param count the number of the bytes
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int writeFully(int fd, const void *bytes, long count) {
+	long total = 0;
+	ssize_t written;
+	while (total < count) {
+		written = write(fd, (const byte *) bytes + total, count - total);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return EXIT_FAILURE;
+		}
+		total += written;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Write a full block of writeStream
+ *
+ *	A block written behind gives its other buffer to be filled next.
+ *
+ * 	@param fd the file descriptor
+ * 	@param *behind the writes behind or NULL to write the block at once
+ * 	@param **block the block ,it becomes the next block to fill
+ * 	@param bytes the number of the bytes of the block
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int writeBlock(int fd, ASYNC_FILE *behind, byte **block, long bytes) {
+	if (behind == NULL) {
+		return writeFully(fd, *block, bytes);
+	}
+	if (writeAsyncBlock(behind, bytes) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	*block = asyncWriteBuffer(behind);
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int writeStream(STREAM *stream, char *filename) {
+	if (stream == NULL || filename == NULL) {
+		return EXIT_FAILURE;
+	}
+	bool standardOutput = strcmp(filename, "-") == 0;
+	if (standardOutput) {
+		// the text printed before goes before the frames written to the descriptor
+		fflush(stdout);
+	}
+	int fd = standardOutput ?
+			STDOUT_FILENO : open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		return EXIT_FAILURE;
+	}
+	off_t start = lseek(fd, 0, SEEK_CUR); // -1 for a pipe
+	HEADER header = stream->header;
+	FORMAT_EXTENSION extension = { header.BitsPerSample, stream->channelMask };
+	byte fileHeader[EXTENSIBLE_HEADER_SIZE];
+	size_t headerSize;
+	long blockAlign = header.BlockAlign, frames = 0, pulled, used = 0;
+	long capacity = STREAM_BLOCK_FRAMES;
+	int result = EXIT_SUCCESS;
+	if (stream->frames < 0) {
+		// a streaming header ,its sizes are written at the end if the file can be seeked
+		header.ChunkSize = STREAMING_SIZE;
+		header.Subchunk2Size = STREAMING_SIZE;
+	}
+	// a big stream is written behind ,a block is written while the next is pulled
+	ASYNC_FILE *behind = NULL;
+	byte *block = NULL;
+	if (stream->frames < 0 || stream->frames * blockAlign > ASYNC_BLOCK_BYTES) {
+		behind = openAsyncFile(fd, true, -1, -1, ASYNC_BLOCK_BYTES);
+	}
+	if (behind != NULL) {
+		capacity = ASYNC_BLOCK_BYTES / blockAlign;
+		block = asyncWriteBuffer(behind);
+	} else {
+		block = (byte *) malloc((size_t) capacity * blockAlign);
+	}
+	headerSize = formatHeader(&header, &extension, fileHeader);
+	if (block == NULL
+			|| writeFully(fd, fileHeader, headerSize) == EXIT_FAILURE) {
+		result = EXIT_FAILURE;
+	}
+	while (result == EXIT_SUCCESS
+			&& (pulled = stream->pull(stream, block + used * blockAlign,
+					(capacity - used < STREAM_BLOCK_FRAMES) ?
+							capacity - used : STREAM_BLOCK_FRAMES)) != 0) {
+		if (pulled < 0) {
+			result = EXIT_FAILURE;
+			break;
+		}
+		used += pulled;
+		frames += pulled;
+		if (used == capacity) {
+			result = writeBlock(fd, behind, &block, used * blockAlign);
+			used = 0;
+		}
+	}
+	if (result == EXIT_SUCCESS && used > 0) {
+		result = writeBlock(fd, behind, &block, used * blockAlign);
+	}
+	if (behind != NULL) {
+		if (closeAsyncFile(&behind) == EXIT_FAILURE) {
+			result = EXIT_FAILURE;
+		}
+	} else {
+		free(block);
+	}
+	// the sizes of the header are written again if they weren't right
+	if (result == EXIT_SUCCESS && frames != stream->frames) {
+		initHeader(&header, header.NumChannels, header.SampleRate,
+				header.BitsPerSample, (dword) (frames * blockAlign));
+		header.AudioFormat = stream->header.AudioFormat;
+		formatHeader(&header, &extension, fileHeader);
+		if (start < 0) {
+			// the standard output may be a pipe ,then the streaming header stays
+			result = standardOutput ? EXIT_SUCCESS : EXIT_FAILURE;
+		} else if (pwrite(fd, fileHeader, headerSize, start)
+				!= (ssize_t) headerSize) {
+			result = EXIT_FAILURE;
+		}
+	}
+	if (!standardOutput && close(fd) != 0) {
+		result = EXIT_FAILURE;
+	}
+	return result;
+}
+
+PUBLIC void closeStream(STREAM **stream) {
+	STREAM *current = (stream == NULL) ? NULL : *stream, *upstream;
+	while (current != NULL) {
+		upstream = current->upstream;
+		closeStream(&current->other);
+		if (current->close != NULL) {
+			current->close(current);
+		}
+		free(current->state);
+		free(current->block);
+		free(current);
+		current = upstream;
+	}
+	if (stream != NULL) {
+		*stream = NULL;
+	}
+}
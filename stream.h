@@ -0,0 +1,304 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the streams of frames. A
+ *  stream produces the frames of a sound in blocks ,pulling the frames it
+ *  needs from the stream before it (its upstream). The first stream of a
+ *  chain reads a .wav file and the last one is written to a .wav file ,so an
+ *  operation chain never keeps more than a few blocks in memory and never
+ *  writes intermediate files.
+ *
+ *  Most streams can also read any range of their frames. Such a stream
+ *  reads a range by reading the range of its upstream which gives these
+ *  frames ,so the range goes back through the chain down to the .wav file
+ *  and only the frames which are in the output are read from the file.
+ */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "utilities.h"
+#include "planar.h"
+#include "channelMap.h"
+
+// The maximum number of frames pulled from a stream at once
+#define STREAM_BLOCK_FRAMES 4096
+// The number of the blocks of the ring buffer of a stage
+#define STAGE_SLOTS 8
+
+typedef struct STREAM STREAM;
+
+/**
+ * Produces at most count (up to STREAM_BLOCK_FRAMES) next frames of a stream
+ * and returns their number ,0 at the end of the stream or -1 on an error
+ */
+typedef long (*PULL_FUNCTION)(STREAM *stream, byte *frames, long count);
+
+/**
+ * Reads count (up to STREAM_BLOCK_FRAMES) frames of a stream from the frame
+ * first and returns their number or -1 on an error
+ */
+typedef long (*READ_FUNCTION)(STREAM *stream, long first, byte *frames,
+		long count);
+
+/**
+ * Frees the state of a stream
+ */
+typedef void (*CLOSE_FUNCTION)(STREAM *stream);
+
+struct STREAM {
+	HEADER header; // the format of the frames of the stream
+	long frames; // the number of the frames of the stream or -1 if unknown
+	PULL_FUNCTION pull;
+	READ_FUNCTION read; // NULL if the stream can only be pulled
+	long position; // the next frame pulled from a stream which can be read
+	CLOSE_FUNCTION close;
+	STREAM *upstream;
+	STREAM *other; // the second upstream of a stream of two upstreams
+	dword channelMask; // the positions of the channels (see FORMAT_EXTENSION) or 0
+	byte *block; // a block of frames of the upstream
+	void *state;
+};
+
+/**
+ * @brief Fill a canonical header
+ *
+ *	This function fills all the fields of a canonical 44 bytes header for PCM data
+ *	of a format and a size.
+ *
+ * 	@param *header the header to fill
+ * 	@param channels the number of the channels
+ * 	@param sampleRate the sample rate
+ * 	@param bitsPerSample the bits per sample
+ * 	@param dataSize the size of the data in bytes
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC void initHeader(HEADER *header, word channels, dword sampleRate,
+		word bitsPerSample, dword dataSize);
+/**
+ * @brief Multiply samples by a gain
+ *
+ *	The samples of 8 bits are unsigned ,all the others are signed. The integer results
+ *	are rounded and clipped ,the float results are kept.
+ *
+ * 	@param *samples the samples
+ * 	@param count the number of the samples
+ * 	@param format the format of the samples
+ * 	@param factor the gain as a factor
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC void gainSamples(byte *samples, long count, SAMPLE_FORMAT format,
+		double factor);
+/**
+ * @brief Open a stream of the frames of a .wav file
+ *
+ *	The frames are read with pread ,a block at a time. The filename "-" is the standard
+ *	input. A file which can't be seeked (a pipe) is read in order and its stream can only be
+ *	pulled. If its header has no size (a streaming header) it is read until its end.
+ *
+ * 	@param *filename the filename of the WAV or "-"
+ * 	@return STREAM* the stream or NULL if the file isn't a correct .wav
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *openFileStream(char *filename);
+/**
+ * @brief Read the header of a .wav file from a pipe
+ *
+ *	The chunks are read in order until the data chunk ,so the pipe is left at the first
+ *	frame.
+ *
+ * 	@param fd the file descriptor of the pipe
+ * 	@param *header the header to fill
+ * 	@param *extension the format extension to fill or NULL
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC int readHeaderPipe(int fd, HEADER *header, FORMAT_EXTENSION *extension);
+/**
+ * @brief Create a stream of a range of the frames of a stream
+ *
+ * 	@param *upstream the stream
+ * 	@param first the first frame of the range
+ * 	@param last the frame after the last frame of the range
+ * 	@return STREAM* the stream or NULL on an error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *chopStream(STREAM *upstream, long first, long last);
+/**
+ * @brief Create a stream of the left channel of a stereo stream
+ *
+ *	The left channel of a stream of more channels is its first channel (the front left of
+ *	the usual layouts).
+ *
+ * 	@param *upstream the stream
+ * 	@return STREAM* the stream or NULL if the upstream has a single channel
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *monoStream(STREAM *upstream);
+/**
+ * @brief Create a stream of two streams mixed like mix
+ *
+ *	The left channel of the output is the left channel of the second stream and the right
+ *	channel is the right (or only) channel of the first stream. The output ends with the
+ *	shorter stream.
+ *
+ * 	@param *first the first stream
+ * 	@param *second the second stream
+ * 	@return STREAM* the stream or NULL if the streams aren't compatible
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *mixStream(STREAM *first, STREAM *second);
+/**
+ * @brief Create a stream of many streams mixed down to stereo
+ *
+ *	The samples of every track are mapped to the two channels with its gain and pan
+ *	(see panChannelMap) and summed in float ,a block at a time ,so the memory doesn't
+ *	depend on the length of the tracks. The sums are limited to full scale and written in
+ *	the widest sample format of the tracks. The output ends with the longest track. The
+ *	tracks must have the same sample rate and are closed with the stream.
+ *
+ * 	@param **tracks the array of the streams of the tracks
+ * 	@param *maps the array of the maps of the tracks to stereo
+ * 	@param count the number of the tracks
+ * 	@return STREAM* the stream or NULL if the tracks aren't compatible
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *mixdownStream(STREAM **tracks, const CHANNEL_MAP *maps,
+		int count);
+/**
+ * @brief Create a stream of the samples of a stream multiplied by a gain
+ *
+ *	The samples are clipped to the range of their bits per sample.
+ *
+ * 	@param *upstream the stream
+ * 	@param decibels the gain in dB
+ * 	@return STREAM* the stream or NULL on an error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *gainStream(STREAM *upstream, double decibels);
+/**
+ * @brief Create a stream of the samples of a stream in another sample format
+ *
+ *	The integer samples are rounded and clipped to the range of the new format. With
+ *	dither the samples which lose bits get TPDF dither first.
+ *
+ * 	@param *upstream the stream
+ * 	@param format the new sample format
+ * 	@param dither true to dither the samples which lose bits
+ * 	@return STREAM* the stream or NULL on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *convertStream(STREAM *upstream, SAMPLE_FORMAT format,
+		bool dither);
+/**
+ * @brief Create a stream of the channels of a stream mapped by a channel map
+ *
+ *	A permutation keeps the samples ,any other map is computed on float samples which
+ *	are rounded and clipped to the sample format of the upstream.
+ *
+ * 	@param *upstream the stream
+ * 	@param *map the channel map of the channels of the upstream
+ * 	@return STREAM* the stream or NULL on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *channelMapStream(STREAM *upstream, const CHANNEL_MAP *map);
+/**
+ * @brief Create a stream of the frames of a stream at another sample rate
+ *
+ *	The frames are resampled by a polyphase windowed sinc filter in the sample format of
+ *	the upstream. The stream can only be pulled ,since an output frame depends on the input
+ *	frames around it. If the rates are equal the frames of the upstream are passed.
+ *
+ * 	@param *upstream the stream
+ * 	@param rate the new sample rate
+ * 	@return STREAM* the stream or NULL on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *resampleStream(STREAM *upstream, dword rate);
+/**
+ * @brief Create a stream of the frames of a stream in the reverse order
+ *
+ *	If the upstream can be read ,its frames are read from the end backwards. Otherwise the
+ *	whole upstream is pulled at the first pull of this stream.
+ *
+ * 	@param *upstream the stream
+ * 	@return STREAM* the stream or NULL on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *reverseStream(STREAM *upstream);
+/**
+ * @brief Create a stream whose upstream is pulled by a thread of its own
+ *
+ *	The thread pulls the blocks of the upstream into a ring buffer of STAGE_SLOTS
+ *	blocks and this stream takes them out of the ring ,so the streams before the
+ *	stage and the streams after it run on different cores. The thread waits while
+ *	the ring is full. The stage can only be pulled ,so it is placed where nothing
+ *	after it reads the ranges of its upstream.
+ *
+ * 	@param *upstream the stream
+ * 	@param *name the name of the stage in its counters
+ * 	@return STREAM* the stream or NULL on an error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC STREAM *stageStream(STREAM *upstream, const char *name);
+/**
+ * @brief Print the counters of the stages of a chain of streams
+ *
+ *	A line is printed for every stage ,from the first of the chain: the blocks and
+ *	the frames passed ,the seconds its thread spent pulling its upstream and the
+ *	times the thread waited for a free slot (full) and the stream after it waited
+ *	for a block (empty).
+ *
+ * 	@param *stream the last stream of the chain
+ * 	@param *out where the counters are printed
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void printStageStatistics(STREAM *stream, FILE *out);
+/**
+ * @brief Write a stream to a .wav file
+ *
+ *	The frames are pulled a block at a time and written after a canonical header. If the
+ *	number of the frames isn't known a streaming header (sizes 0xFFFFFFFF) is written. The
+ *	header is written again at the end with the right sizes if the file can be seeked. The
+ *	filename "-" is the standard output.
+ *
+ * 	@param *stream the stream
+ * 	@param *filename the filename of the output WAV or "-"
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC int writeStream(STREAM *stream, char *filename);
+/**
+ * @brief Close a chain of streams
+ *
+ *	This function closes a stream and all the streams before it and sets the pointer to NULL.
+ *
+ * 	@param **stream the last stream of the chain
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC void closeStream(STREAM **stream);
+
+#endif
@@ -5,7 +5,27 @@
  *  conditions;
  *
  */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
 #include "utilities.h"
+#include "cache.h"
+#include "wavbuffer.h"
+#include "bufferPool.h"
+
+// The number of bytes read at once from the start of a file for its chunks
+#define HEADER_PROBE_BYTES 4096
+// The maximum number of chunks skipped before the data chunk
+#define MAX_CHUNKS 64
+#define CANONICAL_FMT_SIZE 16
 
 #define CHUNKID_PREDEFINED_VALUE "RIFF"
 #define FORMAT_PREDEFINED_VALUE "WAVE"
@@ -13,6 +33,20 @@
 #define SUBCHUCK2ID_PREDEFINED_VALUE "data"
 #define BIG_ENDIAN_FIELDS_BYTES 4
 
+// The mark of a WAV_BLOCK ,a WAV of other allocations doesn't have it
+#define WAV_BLOCK_MAGIC 0x4B4C4257
+
+/**
+ * A WAV with its header and its data in one allocation
+ */
+typedef struct {
+	WAV wav;
+	HEADER header;
+	DATA data;
+	FORMAT_EXTENSION extension; // the ValidBitsPerSample is 0 until it is set
+	dword magic;
+} WAV_BLOCK;
+
 PUBLIC void printGPL() {
 	char c;
 	printf(
@@ -50,125 +84,489 @@ PUBLIC void printGPL() {
 	}
 }
 
-PUBLIC int readWAV(char *filename, WAV **wav) { // Used for wav reading
-	if (filename == NULL) {
-		printf("Wrong input.\n");
-		return EXIT_FAILURE;
+/**
+ * @brief Find the block of the header of a WAV
+ *
+ *	The DATA struct of a block follows its header ,which separate allocations of a
+ *	caller can't do ,so the mark of the block is read only for a block.
+ *
+ *	@return WAV_BLOCK* the block or NULL if the WAV isn't allocated by createWAV
+ *	@author Valentinos Pariza
+ */
+PRIVATE WAV_BLOCK *blockOf(const WAV *wav) {
+	if (wav == NULL || wav->header == NULL) {
+		return NULL;
 	}
-	FILE *fp = fopen(filename, "rb");
-	if (fp == NULL) {
-		printf("Can't open the file\n");
+	WAV_BLOCK *block = (WAV_BLOCK *) ((byte *) wav->header
+			- offsetof(WAV_BLOCK, header));
+	if ((byte *) wav->data != (byte *) block + offsetof(WAV_BLOCK, data)
+			|| block->magic != WAV_BLOCK_MAGIC) {
+		return NULL;
+	}
+	return block;
+}
+
+/**
+ * @brief Read a WAV file from its map in the caches of the files
+ *
+ *	The header and the map of the file are taken from the caches ,so a file read again by a
+ *	long running process isn't opened or read with system calls.
+ *
+ * 	@param *filename the filename of the WAV
+ * 	@param **wav the WAV
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int readWAVCached(char *filename, WAV **wav) {
+	long mapSize = 0;
+	const byte *map = mapFileCached(filename, &mapSize);
+	if (map == NULL) {
+		printOutput("Can't open the file\n");
 		return EXIT_FAILURE;
 	}
-	*wav = (WAV*) malloc(sizeof(WAV));
-	if (*wav == NULL) {
-		printf("Not enough space to allocate memory.\n");
-		fclose(fp);
+	WAV read;
+	WAV_STATUS status = wav_read_memory(map, mapSize, &read);
+	releaseMappedFile(map);
+	if (status != WAV_OK) {
+		printOutput((status == WAV_ERROR_MEMORY) ?
+				"Not enough space to allocate memory.\n" :
+				"Can't read the header of the file\n");
 		return EXIT_FAILURE;
 	}
-	(*wav)->header = (HEADER*) malloc(sizeof(HEADER));
-	if ((*wav)->header == NULL) {
-		printf("Not enough space to allocate memory.\n");
-		free(*wav);
-		fclose(fp);
+	*wav = &blockOf(&read)->wav;
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int readWAV(char *filename, WAV **wav) { // Used for wav reading
+	if (filename == NULL || wav == NULL) {
+		printOutput("Wrong input.\n");
 		return EXIT_FAILURE;
 	}
-	(*wav)->data = (DATA*) malloc(sizeof(DATA));
-	if ((*wav)->data == NULL) {
-		printf("Not enough space to allocate memory.\n");
-		free((*wav)->header);
-		free(*wav);
-		fclose(fp);
+	*wav = NULL;
+	if (isFileCacheEnabled()) {
+		return readWAVCached(filename, wav);
+	}
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		printOutput("Can't open the file\n");
 		return EXIT_FAILURE;
 	}
-	// Read Header
-	fread((*wav)->header, sizeof(HEADER), 1, fp);
-	// Read data
-	(*wav)->data->channel = (byte*) malloc((*wav)->header->Subchunk2Size);
-	if ((*wav)->data->channel == NULL) {
-		printf("Not enough space to allocate memory.\n");
-		free((*wav)->data);
-		free((*wav)->header);
-		free(*wav);
-		fclose(fp);
+	// The header and the data are read with pread ,a short file gives zeros
+	WAV read;
+	WAV_STATUS status = wav_read_fd(fd, &read);
+	close(fd);
+	if (status != WAV_OK) {
+		printOutput((status == WAV_ERROR_MEMORY) ?
+				"Not enough space to allocate memory.\n" :
+				"Can't read the header of the file\n");
 		return EXIT_FAILURE;
 	}
-	fread((*wav)->data->channel, sizeof(byte), (*wav)->header->Subchunk2Size,
-			fp);
-	fclose(fp);
+	*wav = &blockOf(&read)->wav;
 	return EXIT_SUCCESS;
 }
 
 PUBLIC bool isCorrectFormatWAV(WAV *wav) {
-	if (wav == NULL)
+	return wav != NULL && isCorrectFormatHeader(wav->header);
+}
+
+PUBLIC bool isCorrectFormatHeader(HEADER *header) {
+	if (header == NULL)
 		return false;
 
 	// check for the correctness of the big endian fields
 	for (int i = 0; i < BIG_ENDIAN_FIELDS_BYTES; i++) {
 
-		if (CHUNKID_PREDEFINED_VALUE[i] != wav->header->ChunkID[i]
-				|| FORMAT_PREDEFINED_VALUE[i] != wav->header->Format[i]
+		if (CHUNKID_PREDEFINED_VALUE[i] != header->ChunkID[i]
+				|| FORMAT_PREDEFINED_VALUE[i] != header->Format[i]
 				|| SUBCHUNK1ID_PREDEFINED_VALUE[i % 3]
-						!= wav->header->Subchunk1ID[i % 3]
+						!= header->Subchunk1ID[i % 3]
 				|| SUBCHUCK2ID_PREDEFINED_VALUE[i]
-						!= wav->header->Subchunk2ID[i])
+						!= header->Subchunk2ID[i])
 			return false;
 	}
 
 	// Not supported number of channels
-	if (wav->header->NumChannels != 1 && wav->header->NumChannels != 2)
+	if (header->NumChannels < 1 || header->NumChannels > MAX_CHANNELS)
 		return false;
 
 	// Not byte alligned memory for bits per sample .Unsupported number of bits
 	// per sample
-	if ((wav->header->BitsPerSample) % 8 != 0)
-		return EXIT_FAILURE;
+	if ((header->BitsPerSample) % 8 != 0
+			|| header->BitsPerSample == 0)
+		return false;
 
 	// Check for Correctness of  number of bytes for channels and for correct
 	// number of bytes for data field
-	if (((wav->header->Subchunk2Size % wav->header->NumChannels) != 0)
-			|| ((wav->header->Subchunk2Size / wav->header->NumChannels)
-					% (wav->header->BitsPerSample / 8) != 0))
-		return EXIT_FAILURE;
+	if (((header->Subchunk2Size % header->NumChannels) != 0)
+			|| ((header->Subchunk2Size / header->NumChannels)
+					% (header->BitsPerSample / 8) != 0))
+		return false;
 
 	// Not Supported option PCM!=1 --> a Form of compression isn't supported
-	// in this library
-	return wav->header->AudioFormat == 1;
+	// in this library ,only the float samples of 32 bits are
+	return header->AudioFormat == WAVE_FORMAT_PCM
+			|| (header->AudioFormat == WAVE_FORMAT_IEEE_FLOAT
+					&& header->BitsPerSample == 32);
+}
+
+PUBLIC void printQuotedName(FILE *out, char *fileName, bool json) {
+	char *c;
+	fputc('"', out);
+	for (c = fileName; *c != '\0'; c++) {
+		if (*c == '"') {
+			fputs(json ? "\\\"" : "\"\"", out);
+		} else if (json && *c == '\\') {
+			fputs("\\\\", out);
+		} else if (json && (unsigned char) *c < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned char) *c);
+		} else {
+			fputc(*c, out);
+		}
+	}
+	fputc('"', out);
 }
 
 PUBLIC int readHeader(char *filename, HEADER **header) { // Used for list
 	if (filename == NULL) {
-		printf("Wrong input.\n");
+		printOutput("Wrong input.\n");
 		return EXIT_FAILURE;
 	}
 	FILE *fp = fopen(filename, "rb");
 	if (fp == NULL) {
-		printf("Can't open the file\n");
+		printOutput("Can't open the file\n");
 		return EXIT_FAILURE;
 	}
 	*header = (HEADER*) malloc(sizeof(HEADER));
 	if (*header == NULL) {
-		printf("Not enough space to allocate memory.\n");
+		printOutput("Not enough space to allocate memory.\n");
+		fclose(fp);
+		return EXIT_FAILURE;
+	}
+	long dataOffset = 0;
+	if (readHeaderFd(fileno(fp), *header, &dataOffset) == EXIT_FAILURE) {
+		free(*header);
+		*header = NULL;
+		fclose(fp);
 		return EXIT_FAILURE;
 	}
-	fread(*header, sizeof(HEADER), 1, fp);
 	fclose(fp);
 	return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Read a little endian field of 2 bytes
+ *
+ * 	@param *p the first byte of the field
+ * 	@return word the value of the field
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE word readLittleEndian16(const byte *p) {
+	return (word) (p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief Read a little endian field of 4 bytes
+ *
+ * 	@param *p the first byte of the field
+ * 	@return dword the value of the field
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE dword readLittleEndian32(const byte *p) {
+	return (dword) p[0] | ((dword) p[1] << 8) | ((dword) p[2] << 16)
+			| ((dword) p[3] << 24);
+}
+
+/**
+ * @brief Write a little endian field of 2 bytes
+ *
+ * 	@param *p the first byte of the field
+ * 	@param value the value of the field
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void writeLittleEndian16(byte *p, word value) {
+	p[0] = (byte) value;
+	p[1] = (byte) (value >> 8);
+}
+
+/**
+ * @brief Write a little endian field of 4 bytes
+ *
+ * 	@param *p the first byte of the field
+ * 	@param value the value of the field
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void writeLittleEndian32(byte *p, dword value) {
+	writeLittleEndian16(p, (word) value);
+	writeLittleEndian16(p + 2, (word) (value >> 16));
+}
+
+/**
+ * @brief Read bytes of a file from the start of the file already read or with pread
+ *
+ *	Without a file descriptor the file is only the bytes already read.
+ *
+ * 	@param fd the file descriptor or -1
+ * 	@param *probe the bytes of the start of the file already read
+ * 	@param probeSize the number of the bytes already read
+ * 	@param *out where the bytes are placed
+ * 	@param count the number of the bytes to read
+ * 	@param offset the offset of the bytes in the file
+ * 	@return long the number of the bytes read
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE long readBytesAt(int fd, const byte *probe, long probeSize, byte *out,
+		long count, long offset) {
+	if (offset + count <= probeSize) {
+		memcpy(out, probe + offset, count);
+		return count;
+	}
+	if (fd < 0) {
+		if (offset >= probeSize) {
+			return 0;
+		}
+		memcpy(out, probe + offset, probeSize - offset);
+		return probeSize - offset;
+	}
+	ssize_t bytesRead = pread(fd, out, count, offset);
+	return (bytesRead < 0) ? 0 : (long) bytesRead;
+}
+
+/**
+ * @brief Walk the chunks of a file from the bytes of its start
+ *
+ * 	@param fd the file descriptor for the chunks after the probe or -1
+ * 	@param *probe the bytes of the start of the file
+ * 	@param probeSize the number of the bytes of the probe
+ * 	@param *header the HEADER struct to fill
+ * 	@param *dataOffset where the offset of the data in the file is placed
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int parseHeader(int fd, const byte *probe, long probeSize,
+		HEADER *header, FORMAT_EXTENSION *extension, long *dataOffset) {
+	byte chunk[8 + EXTENSIBLE_FMT_SIZE];
+	if (probeSize < (long) sizeof(HEADER)) {
+		return EXIT_FAILURE;
+	}
+	memset(header, 0, sizeof(HEADER));
+	memcpy(header->ChunkID, probe, 4);
+	header->ChunkSize = readLittleEndian32(probe + 4);
+	memcpy(header->Format, probe + 8, 4);
+	// Walk the chunks of the RIFF file until the data chunk
+	long offset = 12, length = 0;
+	dword size = 0;
+	bool foundFormat = false;
+	int i;
+	for (i = 0; i < MAX_CHUNKS; i++) {
+		length = readBytesAt(fd, probe, probeSize, chunk, sizeof(chunk),
+				offset);
+		if (length < 8) {
+			break;
+		}
+		size = readLittleEndian32(chunk + 4);
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			if (size < CANONICAL_FMT_SIZE
+					|| length < 8 + CANONICAL_FMT_SIZE) {
+				break;
+			}
+			memcpy(header->Subchunk1ID, chunk, 4);
+			header->Subchunk1Size = size;
+			parseFormatChunk(chunk + 8,
+					(length - 8 < (long) size) ? length - 8 : (long) size,
+					header, extension);
+			foundFormat = true;
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			if (!foundFormat) {
+				break;
+			}
+			memcpy(header->Subchunk2ID, chunk, 4);
+			header->Subchunk2Size = size;
+			*dataOffset = offset + 8;
+			return EXIT_SUCCESS;
+		}
+		offset += 8 + (long) size + (size & 1); // chunks are word aligned
+	}
+	// Not a chunk table that we know, keep the bytes as a canonical header
+	memcpy(header, probe, sizeof(HEADER));
+	*dataOffset = sizeof(HEADER);
+	if (extension != NULL) {
+		extension->ValidBitsPerSample = header->BitsPerSample;
+		extension->ChannelMask = defaultChannelMask(header->NumChannels);
+	}
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int readHeaderFd(int fd, HEADER *header, long *dataOffset) {
+	return readHeaderExtensionFd(fd, header, NULL, dataOffset);
+}
+
+PUBLIC int readHeaderExtensionFd(int fd, HEADER *header,
+		FORMAT_EXTENSION *extension, long *dataOffset) {
+	if (fd < 0 || header == NULL || dataOffset == NULL) {
+		return EXIT_FAILURE;
+	}
+	byte probe[HEADER_PROBE_BYTES];
+	ssize_t probeSize = pread(fd, probe, HEADER_PROBE_BYTES, 0);
+	struct stat info;
+	if (parseHeader(fd, probe, (long) probeSize, header, extension, dataOffset)
+			== EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+	// A streaming header was written before the sizes were known ,its data goes to
+	// the end of the file
+	bool unknownData = header->Subchunk2Size == STREAMING_SIZE
+			|| header->Subchunk2Size == 0;
+	if ((unknownData || header->ChunkSize == STREAMING_SIZE)
+			&& fstat(fd, &info) == 0 && S_ISREG(info.st_mode)
+			&& (long) info.st_size >= *dataOffset) {
+		if (unknownData) {
+			long length = (long) info.st_size - *dataOffset;
+			if (length > (long) STREAMING_SIZE - 1 - *dataOffset) {
+				length = (long) STREAMING_SIZE - 1 - *dataOffset;
+			}
+			if (header->BlockAlign > 0) {
+				length -= length % header->BlockAlign;
+			}
+			header->Subchunk2Size = (dword) length;
+		}
+		header->ChunkSize = (dword) (*dataOffset - 8 + header->Subchunk2Size);
+	}
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int readHeaderMemory(const byte *buffer, long size, HEADER *header,
+		long *dataOffset) {
+	return readHeaderExtensionMemory(buffer, size, header, NULL, dataOffset);
+}
+
+PUBLIC int readHeaderExtensionMemory(const byte *buffer, long size,
+		HEADER *header, FORMAT_EXTENSION *extension, long *dataOffset) {
+	if (buffer == NULL || header == NULL || dataOffset == NULL) {
+		return EXIT_FAILURE;
+	}
+	return parseHeader(-1, buffer, size, header, extension, dataOffset);
+}
+
+// The bytes of the GUID of a SubFormat after its format
+PRIVATE const byte subFormatTail[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+		0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+PUBLIC void parseFormatChunk(const byte *body, long size, HEADER *header,
+		FORMAT_EXTENSION *extension) {
+	word validBits;
+	header->AudioFormat = readLittleEndian16(body);
+	header->NumChannels = readLittleEndian16(body + 2);
+	header->SampleRate = readLittleEndian32(body + 4);
+	header->ByteRate = readLittleEndian32(body + 8);
+	header->BlockAlign = readLittleEndian16(body + 12);
+	header->BitsPerSample = readLittleEndian16(body + 14);
+	if (extension != NULL) {
+		extension->ValidBitsPerSample = header->BitsPerSample;
+		extension->ChannelMask = defaultChannelMask(header->NumChannels);
+	}
+	if (header->AudioFormat != WAVE_FORMAT_EXTENSIBLE
+			|| size < EXTENSIBLE_FMT_SIZE
+			|| readLittleEndian16(body + 16) < EXTENSIBLE_FMT_SIZE - 18
+			|| memcmp(body + 26, subFormatTail, sizeof(subFormatTail)) != 0) {
+		return;
+	}
+	// The valid bits are the highest bits of a sample ,the others are zero
+	validBits = readLittleEndian16(body + 18);
+	if (validBits > header->BitsPerSample) {
+		return;
+	}
+	header->AudioFormat = readLittleEndian16(body + 24);
+	if (extension != NULL) {
+		extension->ValidBitsPerSample =
+				(validBits == 0) ? header->BitsPerSample : validBits;
+		extension->ChannelMask = readLittleEndian32(body + 20);
+	}
+}
+
+PUBLIC dword defaultChannelMask(int channels) {
+	static const dword masks[] = { 0, 0x4, 0x3, 0x7, 0x33, 0x37, 0x3F, 0x13F,
+			0x63F };
+	return (channels >= 1 && channels <= 8) ? masks[channels] : 0;
+}
+
+PUBLIC bool isExtensibleFormat(const HEADER *header,
+		const FORMAT_EXTENSION *extension) {
+	if (header->NumChannels > 2 || header->BitsPerSample > 16) {
+		return true;
+	}
+	return extension != NULL
+			&& (extension->ChannelMask != defaultChannelMask(header->NumChannels)
+					|| extension->ValidBitsPerSample != header->BitsPerSample);
+}
+
+PUBLIC size_t headerBytes(const HEADER *header,
+		const FORMAT_EXTENSION *extension) {
+	return isExtensibleFormat(header, extension) ?
+			EXTENSIBLE_HEADER_SIZE : sizeof(HEADER);
+}
+
+PUBLIC size_t formatHeader(const HEADER *header,
+		const FORMAT_EXTENSION *extension, byte *bytes) {
+	if (!isExtensibleFormat(header, extension)) {
+		memcpy(bytes, header, sizeof(HEADER));
+		writeLittleEndian32(bytes + 16, CANONICAL_FMT_SIZE);
+		return sizeof(HEADER);
+	}
+	// The fmt chunk grows by the fields of the extension ,the sizes of a streaming
+	// header stay unknown
+	dword extra = EXTENSIBLE_FMT_SIZE - CANONICAL_FMT_SIZE;
+	memcpy(bytes, "RIFF", 4);
+	writeLittleEndian32(bytes + 4,
+			(header->ChunkSize == STREAMING_SIZE) ?
+					STREAMING_SIZE : header->ChunkSize + extra);
+	memcpy(bytes + 8, "WAVEfmt ", 8);
+	writeLittleEndian32(bytes + 16, EXTENSIBLE_FMT_SIZE);
+	writeLittleEndian16(bytes + 20, WAVE_FORMAT_EXTENSIBLE);
+	writeLittleEndian16(bytes + 22, header->NumChannels);
+	writeLittleEndian32(bytes + 24, header->SampleRate);
+	writeLittleEndian32(bytes + 28, header->ByteRate);
+	writeLittleEndian16(bytes + 32, header->BlockAlign);
+	writeLittleEndian16(bytes + 34, header->BitsPerSample);
+	writeLittleEndian16(bytes + 36, EXTENSIBLE_FMT_SIZE - 18);
+	writeLittleEndian16(bytes + 38,
+			(extension != NULL) ?
+					extension->ValidBitsPerSample : header->BitsPerSample);
+	writeLittleEndian32(bytes + 40,
+			(extension != NULL) ?
+					extension->ChannelMask :
+					defaultChannelMask(header->NumChannels));
+	writeLittleEndian16(bytes + 44, header->AudioFormat);
+	memcpy(bytes + 46, subFormatTail, sizeof(subFormatTail));
+	memcpy(bytes + 60, "data", 4);
+	writeLittleEndian32(bytes + 64, header->Subchunk2Size);
+	return EXTENSIBLE_HEADER_SIZE;
+}
+
 PUBLIC int writeWAV(char *filename, WAV *wav) {
 	if (filename == NULL || wav == NULL) {
-		printf("Wrong input.\n");
+		printOutput("Wrong input.\n");
 		return EXIT_FAILURE;
 	}
-	FILE *fp = fopen(filename, "wb");
-	if (fp == NULL) {
-		printf("Can't create the file\n");
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		printOutput("Can't create the file\n");
+		return EXIT_FAILURE;
+	}
+	// A big data chunk is written behind while the next block is copied
+	WAV_STATUS status = wav_write_fd(fd, wav);
+	if (close(fd) != 0 || status != WAV_OK) {
+		printOutput("Can't write the file\n");
 		return EXIT_FAILURE;
 	}
-	fwrite(wav->header, sizeof(HEADER), 1, fp);
-	fwrite(wav->data->channel, sizeof(byte), wav->header->Subchunk2Size, fp);
-	fclose(fp);
 	return EXIT_SUCCESS;
 }
 
@@ -177,17 +575,21 @@ PUBLIC int createOutputFilename(char *inFilename, char *index,
 	if (inFilename == NULL || index == NULL) {
 		return EXIT_FAILURE;
 	}
-	char *str = (char *) malloc(sizeof(char) * 512);
+	// The path ,the separator ,the index ,the name and a .wav extension
+	size_t length = strlen(inFilename) + strlen(index) + 5;
+	char *str = (char *) malloc(sizeof(char) * length);
+	*outFilename = (char *) malloc(sizeof(char) * length);
+	if (str == NULL || *outFilename == NULL) {
+		printOutput("Not enough space to allocate memory.\n");
+		free(str);
+		free(*outFilename);
+		*outFilename = NULL;
+		return EXIT_FAILURE;
+	}
 	// Copy the path
 	strcpy(str, inFilename);
 	// Get the name
 	char *name = strrchr(str, PATHSEPERATOR);
-	*outFilename = (char *) malloc(sizeof(char) * 512);
-	if (outFilename == NULL) {
-		printf("Not enough space to allocate memory.\n");
-		free(str);
-		return EXIT_FAILURE;
-	}
 	if (name != NULL) {
 		str[strlen(str) - strlen(name)] = '\0';
 		strcpy(*outFilename, str);
@@ -212,14 +614,17 @@ PUBLIC int createOutputFilename(char *inFilename, char *index,
 
 PUBLIC int createOutputFilenameTwoFiles(char *inFilename1, char *inFilename2,
 		char *index, char **outFilename) {
-	char * temp1a = (char *) malloc(sizeof(char) * 512);
+	if (inFilename1 == NULL || inFilename2 == NULL || index == NULL) {
+		return EXIT_FAILURE;
+	}
+	char * temp1a = (char *) malloc(sizeof(char) * (strlen(inFilename1) + 1));
 	if (temp1a == NULL) {
-		printf("Not enough space to allocate memory.\n");
+		printOutput("Not enough space to allocate memory.\n");
 		return EXIT_FAILURE;
 	}
-	char * temp2a = (char *) malloc(sizeof(char) * 512);
+	char * temp2a = (char *) malloc(sizeof(char) * (strlen(inFilename2) + 1));
 	if (temp2a == NULL) {
-		printf("Not enough space to allocate memory.\n");
+		printOutput("Not enough space to allocate memory.\n");
 		free(temp1a);
 		return EXIT_FAILURE;
 	}
@@ -227,9 +632,12 @@ PUBLIC int createOutputFilenameTwoFiles(char *inFilename1, char *inFilename2,
 	strcpy(temp2a, inFilename2);
 	char * temp1 = strrchr(temp1a, PATHSEPERATOR);
 	char * temp2 = strrchr(temp2a, PATHSEPERATOR);
-	*outFilename = (char *) malloc(sizeof(char) * 512);
-	if (outFilename == NULL) {
-		printf("Not enough space to allocate memory.\n");
+	// Both the paths ,the separator ,the index ,the dash and a .wav extension
+	*outFilename = (char *) calloc(
+			strlen(inFilename1) + strlen(inFilename2) + strlen(index) + 7,
+			sizeof(char));
+	if (*outFilename == NULL) {
+		printOutput("Not enough space to allocate memory.\n");
 		free(temp1a);
 		free(temp2a);
 		return EXIT_FAILURE;
@@ -265,26 +673,520 @@ PUBLIC int createOutputFilenameTwoFiles(char *inFilename1, char *inFilename2,
 	return EXIT_SUCCESS;
 }
 
+/**
+ * The key of the output of the messages of the commands of every thread
+ */
+PRIVATE pthread_key_t outputKey;
+PRIVATE pthread_once_t outputKeyOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Create the key of the outputs of the threads (once)
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void createOutputKey() {
+	pthread_key_create(&outputKey, NULL);
+}
+
+PUBLIC FILE *commandOutput() {
+	pthread_once(&outputKeyOnce, createOutputKey);
+	FILE *out = (FILE *) pthread_getspecific(outputKey);
+	return (out == NULL) ? stdout : out;
+}
+
+PUBLIC void setCommandOutput(FILE *out) {
+	pthread_once(&outputKeyOnce, createOutputKey);
+	pthread_setspecific(outputKey, out);
+}
+
+PUBLIC int printOutput(const char *format, ...) {
+	va_list arguments;
+	va_start(arguments, format);
+	int printed = vfprintf(commandOutput(), format, arguments);
+	va_end(arguments);
+	return printed;
+}
+
+PUBLIC WAV *createWAV(dword dataSize) {
+	WAV_BLOCK *block = (WAV_BLOCK *) calloc(1, sizeof(WAV_BLOCK));
+	if (block == NULL) {
+		return NULL;
+	}
+	block->data.channel = allocateBuffer(dataSize > 0 ? dataSize : 1);
+	if (block->data.channel == NULL) {
+		free(block);
+		return NULL;
+	}
+	block->header.Subchunk2Size = dataSize;
+	block->wav.header = &block->header;
+	block->wav.data = &block->data;
+	block->magic = WAV_BLOCK_MAGIC;
+	return &block->wav;
+}
+
+PUBLIC const FORMAT_EXTENSION *extensionOfWAV(const WAV *wav) {
+	const WAV_BLOCK *block = blockOf(wav);
+	return (block == NULL || block->extension.ValidBitsPerSample == 0) ?
+			NULL : &block->extension;
+}
+
+PUBLIC void setExtensionOfWAV(WAV *wav, const FORMAT_EXTENSION *extension) {
+	WAV_BLOCK *block = blockOf(wav);
+	if (block == NULL) {
+		return;
+	} else if (extension != NULL) {
+		block->extension = *extension;
+	} else {
+		block->extension.ValidBitsPerSample = wav->header->BitsPerSample;
+		block->extension.ChannelMask = defaultChannelMask(
+				wav->header->NumChannels);
+	}
+}
+
+PUBLIC void releaseWAV(WAV *wav) {
+	if (wav == NULL) {
+		return;
+	}
+	WAV_BLOCK *block = blockOf(wav);
+	if (block == NULL) {
+		// the header ,the DATA struct and the samples are allocations of the caller
+		if (wav->data != NULL) {
+			free(wav->data->channel);
+			free(wav->data);
+		}
+		free(wav->header);
+		wav->header = NULL;
+		wav->data = NULL;
+		return;
+	}
+	releaseBuffer(wav->data->channel);
+	if (wav != &block->wav) { // the struct of the caller stays
+		wav->header = NULL;
+		wav->data = NULL;
+	}
+	block->magic = 0;
+	free(block);
+}
+
 PUBLIC int deleteWAV(WAV** wav) {
-	if (*wav == NULL)
+	if (wav == NULL || *wav == NULL)
 		return EXIT_FAILURE;
 
-	if ((*wav)->header != NULL)
-		free((*wav)->header);
+	// the struct is freed with its block ,unless it is another struct
+	WAV_BLOCK *block = blockOf(*wav);
+	bool inBlock = block != NULL && *wav == &block->wav;
+
+	releaseWAV(*wav);
+
+	if (!inBlock)
+		free(*wav);
+
+	*wav = NULL;
 
-	if ((*wav)->data != NULL) {
-		if ((*wav)->data->channel != NULL)
-			free((*wav)->data->channel);
+	return EXIT_SUCCESS;
+}
 
-		free((*wav)->data);
+/**
+ * A read or a write of an ASYNC_FILE
+ */
+typedef struct {
+	byte *buffer;
+	size_t bytes;
+	long offset; // -1 for the position of the file descriptor
+	bool pending;
+	long result; // the bytes read or written or -1
+} ASYNC_REQUEST;
+
+struct ASYNC_FILE {
+	int fd;
+	bool writer;
+	long offset; // the offset of the next read or write or -1
+	long remaining; // the bytes left to read or -1
+	size_t blockBytes;
+	byte *buffers[2];
+	int current; // the buffer of the caller
+	ASYNC_REQUEST request; // the read or the write of the other buffer
+	bool failed;
+	// io_uring
+	int ringFd;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sqRing, *cqRing;
+	size_t sqRingSize, cqRingSize, sqesSize;
+	// the thread when there is no io_uring
+	pthread_t thread;
+	bool hasThread;
+	bool stopping;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+};
 
+/**
+ * @brief Read or write all the bytes of a request with system calls
+ *
+ *	A read stops at the end of the file and a pipe gives the bytes it has.
+ *
+ * 	@param *file the ASYNC_FILE
+ * 	@param *request the request
+ * 	@param done the bytes of the request already read or written
+ * 	@return long the bytes read or written or -1
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long transferFully(ASYNC_FILE *file, ASYNC_REQUEST *request,
+		size_t done) {
+	ssize_t bytes;
+	while (done < request->bytes) {
+		if (file->writer) {
+			bytes = (request->offset < 0) ?
+					write(file->fd, request->buffer + done,
+							request->bytes - done) :
+					pwrite(file->fd, request->buffer + done,
+							request->bytes - done, request->offset + done);
+		} else {
+			bytes = (request->offset < 0) ?
+					read(file->fd, request->buffer + done,
+							request->bytes - done) :
+					pread(file->fd, request->buffer + done,
+							request->bytes - done, request->offset + done);
+		}
+		if (bytes < 0 && errno == EINTR) {
+			continue;
+		}
+		if (bytes < 0 || (bytes == 0 && file->writer)) {
+			return -1;
+		}
+		done += bytes;
+		if (bytes == 0 || (!file->writer && request->offset < 0)) {
+			break;
+		}
 	}
+	return (long) done;
+}
 
-	free(*wav);
+/**
+ * @brief The thread of an ASYNC_FILE without io_uring ,it runs the requests
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void *asyncThread(void *argument) {
+	ASYNC_FILE *file = (ASYNC_FILE *) argument;
+	pthread_mutex_lock(&file->lock);
+	while (true) {
+		while (!file->request.pending && !file->stopping) {
+			pthread_cond_wait(&file->changed, &file->lock);
+		}
+		if (file->stopping) {
+			break;
+		}
+		pthread_mutex_unlock(&file->lock);
+		long result = transferFully(file, &file->request, 0);
+		pthread_mutex_lock(&file->lock);
+		file->request.result = result;
+		file->request.pending = false;
+		pthread_cond_broadcast(&file->changed);
+	}
+	pthread_mutex_unlock(&file->lock);
+	return NULL;
+}
 
-	*wav = NULL;
+/**
+ * @brief Set up the io_uring of an ASYNC_FILE with system calls
+ *
+ * 	@param *file the ASYNC_FILE
+ * 	@return int Success or Failure if io_uring can't be used
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int setupRing(ASYNC_FILE *file) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	file->ringFd = (int) syscall(__NR_io_uring_setup, 2, &params);
+	if (file->ringFd < 0) {
+		return EXIT_FAILURE;
+	}
+	// the offset -1 (the position of the file) needs IORING_FEAT_RW_CUR_POS
+	if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+		close(file->ringFd);
+		file->ringFd = -1;
+		return EXIT_FAILURE;
+	}
+	file->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	file->cqRingSize = params.cq_off.cqes
+			+ params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (file->cqRingSize > file->sqRingSize) {
+			file->sqRingSize = file->cqRingSize;
+		}
+		file->cqRingSize = 0;
+	}
+	file->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	file->sqRing = mmap(NULL, file->sqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, file->ringFd, IORING_OFF_SQ_RING);
+	file->cqRing = (file->cqRingSize == 0) ? file->sqRing :
+			mmap(NULL, file->cqRingSize, PROT_READ | PROT_WRITE,
+					MAP_SHARED | MAP_POPULATE, file->ringFd, IORING_OFF_CQ_RING);
+	file->sqes = (struct io_uring_sqe *) mmap(NULL, file->sqesSize,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, file->ringFd,
+			IORING_OFF_SQES);
+	if (file->sqRing == MAP_FAILED || file->cqRing == MAP_FAILED
+			|| file->sqes == MAP_FAILED) {
+		if (file->sqes != MAP_FAILED) {
+			munmap(file->sqes, file->sqesSize);
+		}
+		if (file->cqRingSize != 0 && file->cqRing != MAP_FAILED) {
+			munmap(file->cqRing, file->cqRingSize);
+		}
+		if (file->sqRing != MAP_FAILED) {
+			munmap(file->sqRing, file->sqRingSize);
+		}
+		close(file->ringFd);
+		file->ringFd = -1;
+		return EXIT_FAILURE;
+	}
+	byte *sq = (byte *) file->sqRing, *cq = (byte *) file->cqRing;
+	file->sqHead = (unsigned *) (sq + params.sq_off.head);
+	file->sqTail = (unsigned *) (sq + params.sq_off.tail);
+	file->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+	file->sqArray = (unsigned *) (sq + params.sq_off.array);
+	file->cqHead = (unsigned *) (cq + params.cq_off.head);
+	file->cqTail = (unsigned *) (cq + params.cq_off.tail);
+	file->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+	file->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Start the request of an ASYNC_FILE
+ *
+ * 	@param *file the ASYNC_FILE
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int startRequest(ASYNC_FILE *file) {
+	ASYNC_REQUEST *request = &file->request;
+	if (file->ringFd < 0) {
+		pthread_mutex_lock(&file->lock);
+		request->pending = true;
+		request->result = -1;
+		pthread_cond_broadcast(&file->changed);
+		pthread_mutex_unlock(&file->lock);
+		return EXIT_SUCCESS;
+	}
+	request->pending = true;
+	request->result = -1;
+	unsigned tail = *file->sqTail, index = tail & *file->sqMask;
+	struct io_uring_sqe *sqe = &file->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = file->writer ? IORING_OP_WRITE : IORING_OP_READ;
+	sqe->fd = file->fd;
+	sqe->addr = (unsigned long) request->buffer;
+	sqe->len = (unsigned) request->bytes;
+	sqe->off = (request->offset < 0) ? (unsigned long long) -1 :
+			(unsigned long long) request->offset;
+	file->sqArray[index] = index;
+	__atomic_store_n(file->sqTail, tail + 1, __ATOMIC_RELEASE);
+	if (syscall(__NR_io_uring_enter, file->ringFd, 1, 0, 0, NULL, 0) < 0) {
+		request->pending = false;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Wait for the request of an ASYNC_FILE
+ *
+ *	A short write of io_uring is finished with system calls.
+ *
+ * 	@param *file the ASYNC_FILE
+ * 	@return long the bytes read or written or -1
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE long waitRequest(ASYNC_FILE *file) {
+	ASYNC_REQUEST *request = &file->request;
+	if (file->ringFd < 0) {
+		pthread_mutex_lock(&file->lock);
+		while (request->pending) {
+			pthread_cond_wait(&file->changed, &file->lock);
+		}
+		pthread_mutex_unlock(&file->lock);
+		return request->result;
+	}
+	if (request->pending) {
+		unsigned head = *file->cqHead;
+		while (head == __atomic_load_n(file->cqTail, __ATOMIC_ACQUIRE)) {
+			if (syscall(__NR_io_uring_enter, file->ringFd, 0, 1,
+					IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+				request->pending = false;
+				return -1;
+			}
+		}
+		int result = file->cqes[head & *file->cqMask].res;
+		__atomic_store_n(file->cqHead, head + 1, __ATOMIC_RELEASE);
+		request->pending = false;
+		if (result == -EINTR || result == -EAGAIN) {
+			result = 0; // done again by the system calls
+		} else if (result < 0) {
+			request->result = -1;
+			return -1;
+		}
+		request->result = result;
+		if ((size_t) result < request->bytes
+				&& (file->writer || result == 0)) {
+			request->result = transferFully(file, request, result);
+		}
+	}
+	return request->result;
+}
+
+/**
+ * @brief Start the read of the next block of a reader in the other buffer
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE void readAhead(ASYNC_FILE *file) {
+	size_t bytes = file->blockBytes;
+	if (file->remaining >= 0 && (long) bytes > file->remaining) {
+		bytes = file->remaining;
+	}
+	file->request.buffer = file->buffers[1 - file->current];
+	file->request.bytes = bytes;
+	file->request.offset = file->offset;
+	file->request.result = 0;
+	if (bytes > 0 && startRequest(file) == EXIT_FAILURE) {
+		file->failed = true;
+	}
+}
+
+PUBLIC ASYNC_FILE *openAsyncFile(int fd, bool writer, long offset, long length,
+		size_t blockBytes) {
+	if (fd < 0 || blockBytes == 0) {
+		return NULL;
+	}
+	ASYNC_FILE *file = (ASYNC_FILE *) calloc(1, sizeof(ASYNC_FILE));
+	if (file == NULL) {
+		return NULL;
+	}
+	file->fd = fd;
+	file->writer = writer;
+	file->offset = offset;
+	file->remaining = writer ? -1 : length;
+	file->blockBytes = blockBytes;
+	file->ringFd = -1;
+	file->buffers[0] = allocateBuffer(blockBytes);
+	file->buffers[1] = allocateBuffer(blockBytes);
+	pthread_mutex_init(&file->lock, NULL);
+	pthread_cond_init(&file->changed, NULL);
+	char *value = getenv("WAVENGINE_IO");
+	bool ring = value == NULL || strcmp(value, "threads") != 0;
+	if (file->buffers[0] == NULL || file->buffers[1] == NULL) {
+		closeAsyncFile(&file);
+		return NULL;
+	}
+	// a thread does the reads and the writes when there is no io_uring
+	if (!ring || setupRing(file) == EXIT_FAILURE) {
+		file->hasThread = pthread_create(&file->thread, NULL, asyncThread,
+				file) == 0;
+		if (!file->hasThread) {
+			closeAsyncFile(&file);
+			return NULL;
+		}
+	}
+	if (!writer) {
+		readAhead(file);
+	}
+	return file;
+}
+
+PUBLIC long readAsyncBlock(ASYNC_FILE *file, byte **block) {
+	if (file == NULL || file->writer || file->failed) {
+		return -1;
+	}
+	long bytes = waitRequest(file);
+	if (bytes < 0) {
+		file->failed = true;
+		return -1;
+	}
+	// the block read becomes the block of the caller
+	file->current = 1 - file->current;
+	*block = file->buffers[file->current];
+	if (file->offset >= 0) {
+		file->offset += bytes;
+	}
+	if (file->remaining >= 0) {
+		file->remaining -= bytes;
+	}
+	if (bytes > 0) {
+		readAhead(file);
+	}
+	return bytes;
+}
+
+PUBLIC byte *asyncWriteBuffer(ASYNC_FILE *file) {
+	return (file == NULL) ? NULL : file->buffers[file->current];
+}
 
-	return EXIT_FAILURE;
+PUBLIC int writeAsyncBlock(ASYNC_FILE *file, size_t bytes) {
+	if (file == NULL || !file->writer || bytes > file->blockBytes
+			|| file->failed || waitRequest(file) < 0) {
+		if (file != NULL) {
+			file->failed = true;
+		}
+		return EXIT_FAILURE;
+	}
+	if (bytes == 0) {
+		return EXIT_SUCCESS;
+	}
+	file->request.buffer = file->buffers[file->current];
+	file->request.bytes = bytes;
+	file->request.offset = file->offset;
+	if (file->offset >= 0) {
+		file->offset += bytes;
+	}
+	// the caller fills the other buffer while this one is written
+	file->current = 1 - file->current;
+	if (startRequest(file) == EXIT_FAILURE) {
+		file->failed = true;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+PUBLIC int closeAsyncFile(ASYNC_FILE **file) {
+	if (file == NULL || *file == NULL) {
+		return EXIT_FAILURE;
+	}
+	ASYNC_FILE *f = *file;
+	if (waitRequest(f) < 0 && f->writer) {
+		f->failed = true;
+	}
+	if (f->hasThread) {
+		pthread_mutex_lock(&f->lock);
+		f->stopping = true;
+		pthread_cond_broadcast(&f->changed);
+		pthread_mutex_unlock(&f->lock);
+		pthread_join(f->thread, NULL);
+	}
+	if (f->ringFd >= 0) {
+		munmap(f->sqes, f->sqesSize);
+		if (f->cqRingSize != 0) {
+			munmap(f->cqRing, f->cqRingSize);
+		}
+		munmap(f->sqRing, f->sqRingSize);
+		close(f->ringFd);
+	}
+	pthread_mutex_destroy(&f->lock);
+	pthread_cond_destroy(&f->changed);
+	releaseBuffer(f->buffers[0]);
+	releaseBuffer(f->buffers[1]);
+	int result = f->failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	free(f);
+	*file = NULL;
+	return result;
 }
 
 #ifdef DEBUG
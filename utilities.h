@@ -29,11 +29,25 @@
 #define SUBCHUNK1ID_PREDEFINED_VALUE "fmt"
 #define SUBCHUCK2ID_PREDEFINED_VALUE "data"
 #define BIG_ENDIAN_FIELDS_BYTES 4
+// The values of AudioFormat which are supported
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+// The AudioFormat of a fmt chunk whose real format is in its SubFormat
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+// The size of the fmt chunk of WAVE_FORMAT_EXTENSIBLE
+#define EXTENSIBLE_FMT_SIZE 40
+// The size of a header with a fmt chunk of WAVE_FORMAT_EXTENSIBLE
+#define EXTENSIBLE_HEADER_SIZE 68
+// The maximum number of the channels of a .wav
+#define MAX_CHANNELS 32
+// The size of the data of a header written before the size is known
+#define STREAMING_SIZE 0xFFFFFFFFU
 
 
 typedef unsigned char byte; // 1B
 typedef unsigned short int word; // 2B
 typedef unsigned int dword; // 4B
+typedef unsigned long long qword; // 8B
 
 typedef struct {
 	byte ChunkID[4];
@@ -51,6 +65,15 @@ typedef struct {
 	dword Subchunk2Size;
 }__attribute__((packed)) HEADER;
 
+/**
+ * The fields of a fmt chunk of WAVE_FORMAT_EXTENSIBLE which aren't in a HEADER. For a
+ * canonical fmt chunk they are all the bits and the default mask of the channels.
+ */
+typedef struct {
+	word ValidBitsPerSample; // the bits of a sample which are used ,from the highest
+	dword ChannelMask; // a bit for the position of every channel ,in their order
+} FORMAT_EXTENSION;
+
 typedef struct {
 	byte *channel;
 }__attribute__((packed)) DATA;
@@ -101,6 +124,145 @@ PUBLIC int writeWAV(char *filename, WAV *wav);
  * 	@bug No known bugs.
  */
 PUBLIC int readHeader(char *filename, HEADER **header);
+/**
+ * @brief Read WAV file Header from a file descriptor
+ *
+ *	This function reads the header of an opened .wav file with pread ,so the position of
+ *	the file is not changed and many threads can use it. It walks the RIFF chunk table
+ *	(skipping chunks like LIST) until the data chunk and fills the HEADER struct with the
+ *	fields of the fmt and data chunks. The chunks are found in the first 4KB of the file
+ *	with a single read for most files. If the file doesn't have a chunk table that it can
+ *	walk, its first bytes are kept as a canonical header. The data of a streaming header
+ *	(a size of STREAMING_SIZE or 0) of a file goes to the end of the file.
+ *
+ * 	@param fd the file descriptor of the WAV
+ * 	@param *header the HEADER struct to fill
+ * 	@param *dataOffset where the offset of the data in the file is placed
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC int readHeaderFd(int fd, HEADER *header, long *dataOffset);
+/**
+ * @brief Read WAV file Header from the bytes of the file in memory
+ *
+ *	This function walks the chunks like readHeaderFd ,but on the bytes of a .wav file
+ *	which are already in memory ,so it makes no system call.
+ *
+ * 	@param *buffer the bytes of the WAV
+ * 	@param size the number of the bytes
+ * 	@param *header the HEADER struct to fill
+ * 	@param *dataOffset where the offset of the data in the bytes is placed
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC int readHeaderMemory(const byte *buffer, long size, HEADER *header,
+		long *dataOffset);
+/**
+ * @brief Read WAV file Header and its format extension from a file descriptor
+ *
+ *	This function reads the header like readHeaderFd and the valid bits and the channel
+ *	mask of a fmt chunk of WAVE_FORMAT_EXTENSIBLE ,or their defaults for a canonical one.
+ *
+ * 	@param fd the file descriptor of the WAV
+ * 	@param *header the HEADER struct to fill
+ * 	@param *extension the FORMAT_EXTENSION struct to fill
+ * 	@param *dataOffset where the offset of the data in the file is placed
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int readHeaderExtensionFd(int fd, HEADER *header,
+		FORMAT_EXTENSION *extension, long *dataOffset);
+/**
+ * @brief Read WAV file Header and its format extension from the bytes of the file in memory
+ *
+ *	Like readHeaderExtensionFd ,but on the bytes of a .wav file which are in memory.
+ *
+ * 	@param *buffer the bytes of the WAV
+ * 	@param size the number of the bytes
+ * 	@param *header the HEADER struct to fill
+ * 	@param *extension the FORMAT_EXTENSION struct to fill
+ * 	@param *dataOffset where the offset of the data in the bytes is placed
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int readHeaderExtensionMemory(const byte *buffer, long size,
+		HEADER *header, FORMAT_EXTENSION *extension, long *dataOffset);
+/**
+ * @brief Fill a header from the body of a fmt chunk
+ *
+ *	The AudioFormat of WAVE_FORMAT_EXTENSIBLE is replaced by the format of its SubFormat
+ *	(PCM or IEEE float) ,so the header is the canonical header of the same samples. An
+ *	extensible chunk which is too short or has another SubFormat keeps
+ *	WAVE_FORMAT_EXTENSIBLE ,which isn't a correct format.
+ *
+ * 	@param *body the bytes of the fmt chunk after its id and size
+ * 	@param size the number of the bytes of the body (at least 16)
+ * 	@param *header the HEADER struct whose format fields are filled
+ * 	@param *extension the FORMAT_EXTENSION struct to fill or NULL
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void parseFormatChunk(const byte *body, long size, HEADER *header,
+		FORMAT_EXTENSION *extension);
+/**
+ * @brief The channel mask of the usual layout of a number of channels
+ *
+ *	Mono is the front center ,stereo the front left and right ,3 channels add the
+ *	center ,4 are the quad ,5 and 6 the 5.0 and 5.1 ,7 the 6.1 and 8 the 7.1 layout.
+ *
+ * 	@param channels the number of the channels
+ * 	@return dword the mask or 0 if there isn't a usual layout
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC dword defaultChannelMask(int channels);
+/**
+ * @brief Check if a header is written with a fmt chunk of WAVE_FORMAT_EXTENSIBLE
+ *
+ *	A header of more than 2 channels or more than 16 bits ,or whose valid bits or
+ *	channel mask aren't the defaults ,can't be described by a canonical fmt chunk.
+ *
+ * 	@param *header the canonical header
+ * 	@param *extension the valid bits and the channel mask or NULL for the defaults
+ * 	@return bool true if the fmt chunk is extensible
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC bool isExtensibleFormat(const HEADER *header,
+		const FORMAT_EXTENSION *extension);
+/**
+ * @brief The number of the bytes which formatHeader writes for a header
+ *
+ * 	@param *header the canonical header
+ * 	@param *extension the valid bits and the channel mask or NULL for the defaults
+ * 	@return size_t sizeof(HEADER) or EXTENSIBLE_HEADER_SIZE
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC size_t headerBytes(const HEADER *header,
+		const FORMAT_EXTENSION *extension);
+/**
+ * @brief Write the bytes of the header of a .wav file
+ *
+ *	A canonical header is written as it is with a fmt chunk of 16 bytes. Otherwise
+ *	(see isExtensibleFormat) the fmt chunk is of WAVE_FORMAT_EXTENSIBLE with the valid
+ *	bits ,the channel mask and the AudioFormat of the header in its SubFormat ,and the
+ *	ChunkSize grows with it. The fields are written in little endian.
+ *
+ * 	@param *header the canonical header
+ * 	@param *extension the valid bits and the channel mask or NULL for the defaults
+ * 	@param *bytes where the header is written ,at least EXTENSIBLE_HEADER_SIZE bytes
+ * 	@return size_t the number of the bytes written
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC size_t formatHeader(const HEADER *header,
+		const FORMAT_EXTENSION *extension, byte *bytes);
 /**
  * @brief Create Output Filename
  *
@@ -164,6 +326,133 @@ PUBLIC int createOutputFilenameTwoFiles(char *inFilename1, char *inFilename2,
 */
 PUBLIC bool isCorrectFormatWAV(WAV *wav);
 
+/**
+* @brief This method checks whether a header has a correct format of a .wav file
+*
+* This method makes the checks of isCorrectFormatWAV(WAV*) on a header alone
+* ,so a file can be checked from its header without reading its data.
+*
+* @param a pointer to a struct of type HEADER
+*
+* @return true if the header has a correct format , otherwise false
+*
+* @author Valentinos Pariza
+*/
+PUBLIC bool isCorrectFormatHeader(HEADER *header);
+
+/**
+* @brief This method writes a name of a file as a quoted CSV field or JSON string
+*
+* The quotes of the name are doubled for CSV and escaped for JSON ,where the
+* backslashes and the control characters are escaped too.
+*
+* @param a pointer to the FILE where the name is written
+* @param a pointer to the name of the file
+* @param true for a JSON string ,false for a CSV field
+*
+* @return void
+*
+* @author Valentinos Pariza
+*/
+PUBLIC void printQuotedName(FILE *out, char *fileName, bool json);
+
+/**
+* @brief This method returns the output of the messages of the commands of a thread
+*
+* The messages of a command (Success ,Fail and the reports printed by the
+* commands) go to the output given to the thread by setCommandOutput ,or to the
+* standard output if none was given. The threads of a worker pool get the
+* output of the thread which created the pool.
+*
+* @return a pointer to the FILE of the messages
+*
+* @author Valentinos Pariza
+*/
+PUBLIC FILE *commandOutput();
+
+/**
+* @brief This method sets the output of the messages of the commands of a thread
+*
+* @param a pointer to the FILE of the messages ,NULL for the standard output
+*
+* @return void
+*
+* @author Valentinos Pariza
+*/
+PUBLIC void setCommandOutput(FILE *out);
+
+/**
+* @brief This method prints a message of a command to the output of the thread
+*
+* Like printf ,but to the output returned by commandOutput.
+*
+* @param the format of the message and its arguments as for printf
+*
+* @return int the number of the characters printed or a negative number on error
+*
+* @author Valentinos Pariza
+*/
+PUBLIC int printOutput(const char *format, ...);
+
+
+/**
+* @brief This method creates a WAV struct with its header and its data
+*
+* The WAV struct ,its header and its DATA struct are one allocation and the
+* samples are a buffer of the pool of the buffers ,so a batch of files reuses
+* the same memory. The header is zero except its Subchunk2Size. The samples
+* aren't cleared.
+*
+* @param the number of the bytes of the samples
+*
+* @return a pointer to the WAV struct or NULL if there isn't enough memory
+*
+* @author Valentinos Pariza
+*/
+PUBLIC WAV *createWAV(dword dataSize);
+
+/**
+* @brief This method gives the valid bits and the channel mask of a WAV struct
+*
+* They are kept with the header of createWAV(dword) ,so an operation keeps the
+* positions of the channels of its input and the writers write them.
+*
+* @param a pointer to a struct of type WAV
+*
+* @return the FORMAT_EXTENSION or NULL if it isn't set ,then the defaults are used
+*
+* @author Valentinos Pariza
+*/
+PUBLIC const FORMAT_EXTENSION *extensionOfWAV(const WAV *wav);
+
+/**
+* @brief This method sets the valid bits and the channel mask of a WAV struct
+*
+* @param a pointer to a struct of type WAV of createWAV(dword)
+* @param the FORMAT_EXTENSION or NULL for the defaults of the header
+*
+* @return void
+*
+* @author Valentinos Pariza
+*/
+PUBLIC void setExtensionOfWAV(WAV *wav, const FORMAT_EXTENSION *extension);
+
+/**
+* @brief This method frees the header and the data of a WAV struct
+*
+* The header ,the DATA struct and the samples of createWAV(dword) are freed.
+* A WAV struct of the caller which points to them stays ,with NULL header and
+* data ,the WAV struct of createWAV(dword) is freed with them. A WAV whose
+* header ,DATA struct and samples are separate malloc allocations of the caller
+* is freed with free and its header and data become NULL.
+*
+* @param a pointer to a struct of type WAV or NULL
+*
+* @return void
+*
+* @author Valentinos Pariza
+*/
+PUBLIC void releaseWAV(WAV *wav);
 
 /**
 * @brief This method deletes a WAV struct and frees its memory from heap
@@ -173,7 +462,8 @@ PUBLIC bool isCorrectFormatWAV(WAV *wav);
 * also sets the value of the variable which was used , to hold the pointer to a WAV
 * struct,after setting free the memory of the struct, to NULL in order to prevent 
 * and warn anyone who will want to use that variable(warning that the variable 
-* doesn't have an actual pointer inside).
+* doesn't have an actual pointer inside). A WAV of createWAV(dword) is freed
+* like releaseWAV does ,and the WAV struct too if it is another allocation.
 *
 * 
 * @param a pointer to a variable that holds a pointer to a struct of type WAV
@@ -186,4 +476,90 @@ PUBLIC bool isCorrectFormatWAV(WAV *wav);
 */
 PUBLIC int deleteWAV(WAV** wav);
 
+// The bytes of a block read ahead or written behind by an ASYNC_FILE
+#define ASYNC_BLOCK_BYTES (1024L * 1024)
+
+/**
+ * A file read ahead or written behind with two buffers ,the caller uses one
+ * while the other one is read or written. The reads and the writes are made
+ * with io_uring ,or by a thread of the file when io_uring can't be used (or
+ * the environment variable WAVENGINE_IO is "threads").
+ */
+typedef struct ASYNC_FILE ASYNC_FILE;
+
+/**
+* @brief This method opens a file descriptor for reading ahead or writing behind
+*
+* A reader reads the bytes from an offset in blocks and starts the read of the
+* next block before it gives a block ,so the next block is read while the
+* caller processes the block it got. A writer writes a block while the caller
+* fills the next one. The file descriptor isn't closed by the ASYNC_FILE.
+*
+* @param the file descriptor
+* @param true for a writer ,false for a reader
+* @param the offset of the first byte or -1 for the position of the file
+*        descriptor (for a pipe)
+* @param the number of the bytes to read ,or -1 until the end of the file
+*        (ignored by a writer)
+* @param the number of the bytes of a block
+*
+* @return a pointer to the ASYNC_FILE or NULL if there isn't enough memory
+*
+* @author Valentinos Pariza
+*/
+PUBLIC ASYNC_FILE *openAsyncFile(int fd, bool writer, long offset, long length,
+		size_t blockBytes);
+
+/**
+* @brief This method gives the next block of a reader
+*
+* The block is valid until the next call. A block can be shorter than the
+* blocks ,when the file gives fewer bytes (a pipe).
+*
+* @param a pointer to the ASYNC_FILE
+* @param a pointer to a variable where the pointer to the block is placed
+*
+* @return the number of the bytes of the block ,0 at the end or -1 on an error
+*
+* @author Valentinos Pariza
+*/
+PUBLIC long readAsyncBlock(ASYNC_FILE *file, byte **block);
+
+/**
+* @brief This method gives the buffer of a writer which is filled next
+*
+* @param a pointer to the ASYNC_FILE
+*
+* @return a pointer to the buffer of a block
+*
+* @author Valentinos Pariza
+*/
+PUBLIC byte *asyncWriteBuffer(ASYNC_FILE *file);
+
+/**
+* @brief This method starts the write of the buffer of asyncWriteBuffer
+*
+* The write of the block before is waited first ,so the order of the blocks
+* is kept.
+*
+* @param a pointer to the ASYNC_FILE
+* @param the number of the bytes of the buffer to write
+*
+* @return EXIT_SUCCESS or EXIT_FAILURE if a write failed
+*
+* @author Valentinos Pariza
+*/
+PUBLIC int writeAsyncBlock(ASYNC_FILE *file, size_t bytes);
+
+/**
+* @brief This method waits for the last write and frees an ASYNC_FILE
+*
+* @param a pointer to a variable that holds a pointer to an ASYNC_FILE
+*
+* @return EXIT_SUCCESS or EXIT_FAILURE if a read or a write failed
+*
+* @author Valentinos Pariza
+*/
+PUBLIC int closeAsyncFile(ASYNC_FILE **file);
+
 #endif
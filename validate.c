@@ -0,0 +1,156 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file validate.c
+ *  @brief Validates .wav files from their headers
+ *
+ *  Implements the validation of many .wav files without reading their data. The chunks
+ *  of every file are read with pread (or taken from the caches of the files) and the
+ *  fields of its header are checked against each other and against the length of the
+ *  file from fstat. Optionally a few random
+ *  pages of the data of every file are read, to find files which can't be read. The
+ *  files are checked by a pool of worker threads.
+ *
+ *  @version 1.0
+ *  @author Marios Pafitis
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include "utilities.h"
+#include "workerPool.h"
+#include "cache.h"
+
+#define PROBE_PAGE_BYTES 4096
+
+/**
+ * The result of the validation of a file
+ */
+typedef struct {
+	char *fileName;
+	int probePages;
+	const char *problem; // NULL for a valid file
+} VALIDATION;
+
+/**
+ * @brief Read random pages of the data of a file
+ *
+ * 	@param fd the file descriptor
+ * 	@param dataOffset the offset of the data in the file
+ * 	@param dataSize the size of the data
+ * 	@param pages the number of the pages to read
+ * 	@param seed the seed of the random pages
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int probeData(int fd, long dataOffset, long dataSize, int pages,
+		unsigned int seed) {
+	byte page[PROBE_PAGE_BYTES];
+	long numberOfPages = (dataSize + PROBE_PAGE_BYTES - 1) / PROBE_PAGE_BYTES;
+	long offset, length;
+	int i;
+	for (i = 0; i < pages && numberOfPages > 0; i++) {
+		offset = ((long) rand_r(&seed) * (RAND_MAX + 1L) + rand_r(&seed))
+				% numberOfPages * PROBE_PAGE_BYTES;
+		length = dataSize - offset;
+		if (length > PROBE_PAGE_BYTES) {
+			length = PROBE_PAGE_BYTES;
+		}
+		if (pread(fd, page, length, dataOffset + offset) != length) {
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Validate a file
+ *
+ *	A job of the worker pool, its argument is a VALIDATION.
+ *
+ * 	@param *argument the VALIDATION of the file
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE void validateFile(void *argument) {
+	VALIDATION *validation = (VALIDATION *) argument;
+	HEADER h;
+	long dataOffset = 0, fileSize = 0;
+	if (cachedHeader(validation->fileName, &h, &dataOffset,
+			&fileSize) == EXIT_FAILURE) {
+		validation->problem =
+				(access(validation->fileName, R_OK) != 0) ?
+						"Can't open the file" : "Can't read Header";
+	} else if (memcmp(h.ChunkID, "RIFF", 4) != 0
+			|| memcmp(h.Format, "WAVE", 4) != 0) {
+		validation->problem = "Not a RIFF WAVE file";
+	} else if (memcmp(h.Subchunk1ID, "fmt ", 4) != 0
+			|| memcmp(h.Subchunk2ID, "data", 4) != 0) {
+		validation->problem = "Wrong chunk layout";
+	} else if (!isCorrectFormatHeader(&h)) {
+		validation->problem = "Unsupported format";
+	} else if (h.BlockAlign != h.NumChannels * (h.BitsPerSample >> 3)) {
+		validation->problem = "Wrong BlockAlign";
+	} else if (h.SampleRate == 0
+			|| h.ByteRate != (dword) h.SampleRate * h.BlockAlign) {
+		validation->problem = "Wrong ByteRate";
+	} else if (dataOffset + (long) h.Subchunk2Size > fileSize) {
+		validation->problem = "The data is truncated";
+	} else if ((long) h.ChunkSize + 8 > fileSize) {
+		validation->problem = "The RIFF size is larger than the file";
+	} else if ((long) h.ChunkSize + 8 < dataOffset + (long) h.Subchunk2Size) {
+		validation->problem = "The RIFF size is smaller than the data";
+	} else if (validation->probePages > 0) {
+		int fd = open(validation->fileName, O_RDONLY);
+		if (fd < 0
+				|| probeData(fd, dataOffset, h.Subchunk2Size,
+						validation->probePages,
+						(unsigned int) (fileSize ^ time(NULL)))
+						== EXIT_FAILURE) {
+			validation->problem = "The data can't be read";
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+}
+
+PUBLIC int validate(FILE *out, char **fileNames, int count, int probePages) {
+	int i, result = EXIT_SUCCESS;
+	if (out == NULL || fileNames == NULL || count < 0 || probePages < 0) {
+		return EXIT_FAILURE;
+	}
+	VALIDATION *validations = (VALIDATION *) calloc(count + 1,
+			sizeof(VALIDATION));
+	int threads = workerCountFor(count);
+	WORKER_POOL *pool = createWorkerPool(threads, threads << 2);
+	if (validations == NULL || pool == NULL) {
+		free(validations);
+		destroyWorkerPool(&pool);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < count; i++) {
+		validations[i].fileName = fileNames[i];
+		validations[i].probePages = probePages;
+		submitJob(pool, validateFile, &validations[i]);
+	}
+	destroyWorkerPool(&pool);
+// Display the results in the order of the files
+	for (i = 0; i < count; i++) {
+		if (validations[i].problem == NULL) {
+			fprintf(out, "Success :  %s\t(Valid)\n", fileNames[i]);
+		} else {
+			fprintf(out, "Fail    :  %s\t(%s)\n", fileNames[i],
+					validations[i].problem);
+			result = EXIT_FAILURE;
+		}
+	}
+	free(validations);
+	return result;
+}
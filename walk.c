@@ -0,0 +1,621 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file walk.c
+ *  @brief Walks a directory tree in parallel and processes its files
+ *
+ *  Implements the walk of a directory tree. Every walker thread has a deque of the paths
+ *  of the directories it must read. A walker takes its next directory from the end of its
+ *  own deque (the last one it found ,so it goes deep first) and when its deque is empty it
+ *  steals from the start of the deque of another walker (an old directory ,usually a big
+ *  subtree). The directories are opened with openat relative to the root and read with
+ *  getdents64 ,whose records carry the type of every entry ,so most entries are never
+ *  stat'ed.
+ *
+ *  The number of the directories waiting or being read tells when the walk is over. An
+ *  idle walker sleeps until a directory is queued or the walk is over.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "walk.h"
+#include "workerPool.h"
+#include "wavelib.h"
+#include "shard.h"
+
+// The size of the buffer of getdents64
+#define WALK_BUFFER_BYTES (32 * 1024)
+// The maximum number of walker threads
+#define MAX_WALKERS 8
+// The include pattern of a walk without includes
+#define WALK_DEFAULT_INCLUDE "*.wav"
+
+/**
+ * A record of getdents64
+ */
+typedef struct {
+	unsigned long long d_ino;
+	long long d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+} LINUX_DIRENT64;
+
+/**
+ * The deque of the directories of a walker
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	char **paths; // the paths relative to the root
+	int first; // the first path (stolen from here)
+	int count; // the end of the paths (taken by the owner from here)
+	int capacity;
+} DEQUE;
+
+/**
+ * The state of a walk ,shared by the walkers
+ */
+typedef struct {
+	char *root;
+	int rootFd;
+	WALK_FILTER *filter;
+	FILE_FUNCTION function;
+	void *context;
+	WORKER_POOL *pool;
+	DEQUE deques[MAX_WALKERS];
+	int numberOfWalkers;
+	long pending; // the directories queued or being read
+	long queued; // the directories queued
+	long idle; // the walkers which sleep
+	long files;
+	int result;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+} WALK;
+
+/**
+ * A walker thread
+ */
+typedef struct {
+	WALK *walk;
+	int index;
+} WALKER;
+
+/**
+ * A file given to the workers
+ */
+typedef struct {
+	WALK *walk;
+	char path[];
+} WALK_JOB;
+
+/**
+ * A command run for every file of a walk
+ */
+typedef struct {
+	COMMAND_FUNCTION run;
+	int argc;
+	char **argv; // the command starting from its option
+} WALK_COMMAND;
+
+/**
+ * The paths of the files of a walk collected for a report
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	char **paths;
+	long count;
+	long capacity;
+	bool failed;
+} WALK_REPORT;
+
+/**
+ * @brief Check whether a name or a path matches any of a list of patterns
+ *
+ * 	@param **patterns the patterns
+ * 	@param count the number of the patterns
+ * 	@param *name the name of the entry
+ * 	@param *path the path of the entry in the tree
+ * 	@return bool true if a pattern matches
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE bool matchesAny(char **patterns, int count, const char *name,
+		const char *path) {
+	int i;
+	for (i = 0; i < count; i++) {
+		if (fnmatch(patterns[i],
+				(strchr(patterns[i], '/') != NULL) ? path : name, 0) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Queue a directory in the deque of a walker
+ *
+ * 	@param *walk the walk
+ * 	@param index the walker
+ * 	@param *path the path of the directory relative to the root ,taken by the deque
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int pushDirectory(WALK *walk, int index, char *path) {
+	DEQUE *deque = &walk->deques[index];
+	pthread_mutex_lock(&deque->lock);
+	if (deque->first > 0 && deque->count == deque->capacity) {
+		// move the paths to the start before the array grows
+		memmove(deque->paths, deque->paths + deque->first,
+				sizeof(char *) * (deque->count - deque->first));
+		deque->count -= deque->first;
+		deque->first = 0;
+	}
+	if (deque->count == deque->capacity) {
+		int capacity = (deque->capacity == 0) ? 64 : deque->capacity << 1;
+		char **paths = (char **) realloc(deque->paths,
+				sizeof(char *) * capacity);
+		if (paths == NULL) {
+			pthread_mutex_unlock(&deque->lock);
+			return EXIT_FAILURE;
+		}
+		deque->paths = paths;
+		deque->capacity = capacity;
+	}
+	deque->paths[deque->count++] = path;
+	pthread_mutex_unlock(&deque->lock);
+	__atomic_add_fetch(&walk->pending, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&walk->queued, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&walk->idle, __ATOMIC_SEQ_CST) > 0) {
+		pthread_mutex_lock(&walk->lock);
+		pthread_cond_broadcast(&walk->changed);
+		pthread_mutex_unlock(&walk->lock);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Take a directory from a deque
+ *
+ * 	@param *deque the deque
+ * 	@param stealing true to take the first directory ,false to take the last one
+ * 	@return char* the path of the directory or NULL if the deque is empty
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE char *takeDirectory(DEQUE *deque, bool stealing) {
+	char *path = NULL;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->first < deque->count) {
+		path = stealing ?
+				deque->paths[deque->first++] : deque->paths[--deque->count];
+		if (deque->first == deque->count) {
+			deque->first = deque->count = 0;
+		}
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return path;
+}
+
+/**
+ * @brief Process a file
+ *
+ *	A job of the worker pool ,its argument is a WALK_JOB.
+ *
+ * 	@param *argument the WALK_JOB
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void processFile(void *argument) {
+	WALK_JOB *job = (WALK_JOB *) argument;
+	job->walk->function(job->path, job->walk->context);
+	free(job);
+}
+
+/**
+ * @brief Read a directory of the tree
+ *
+ *	The files of the directory which pass the filter are given to the workers and its
+ *	directories which aren't excluded are queued in the deque of the walker.
+ *
+ * 	@param *walk the walk
+ * 	@param index the walker
+ * 	@param *path the path of the directory relative to the root ("" for the root)
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int readDirectory(WALK *walk, int index, char *path) {
+	int fd = openat(walk->rootFd, (*path == '\0') ? "." : path,
+			O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		return EXIT_FAILURE;
+	}
+	char *buffer = (char *) malloc(WALK_BUFFER_BYTES);
+	size_t pathLength = strlen(path), nameLength;
+	WALK_FILTER *filter = walk->filter;
+	char *defaultInclude = WALK_DEFAULT_INCLUDE;
+	char **includes = (filter->numberOfIncludes > 0) ?
+			filter->includes : &defaultInclude;
+	int numberOfIncludes =
+			(filter->numberOfIncludes > 0) ? filter->numberOfIncludes : 1;
+	int result = (buffer == NULL) ? EXIT_FAILURE : EXIT_SUCCESS;
+	long length, offset;
+	LINUX_DIRENT64 *entry;
+	struct stat info;
+	unsigned char type;
+	while (result == EXIT_SUCCESS
+			&& (length = syscall(SYS_getdents64, fd, buffer,
+					WALK_BUFFER_BYTES)) > 0) {
+		for (offset = 0; offset < length && result == EXIT_SUCCESS;
+				offset += entry->d_reclen) {
+			entry = (LINUX_DIRENT64 *) (buffer + offset);
+			if (strcmp(entry->d_name, ".") == 0
+					|| strcmp(entry->d_name, "..") == 0) {
+				continue;
+			}
+			type = entry->d_type;
+			// some file systems don't give the types of the entries
+			if (type == DT_UNKNOWN) {
+				if (fstatat(fd, entry->d_name, &info, AT_SYMLINK_NOFOLLOW) != 0) {
+					continue;
+				}
+				type = S_ISDIR(info.st_mode) ? DT_DIR :
+						S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+			}
+			if (type != DT_DIR && type != DT_REG) {
+				continue;
+			}
+			// the path of the entry in the tree
+			nameLength = strlen(entry->d_name);
+			char *child = (char *) malloc(pathLength + nameLength + 2);
+			if (child == NULL) {
+				result = EXIT_FAILURE;
+				break;
+			}
+			if (pathLength > 0) {
+				sprintf(child, "%s%c%s", path, PATHSEPERATOR, entry->d_name);
+			} else {
+				strcpy(child, entry->d_name);
+			}
+			if (matchesAny(filter->excludes, filter->numberOfExcludes,
+					entry->d_name, child)) {
+				free(child);
+			} else if (type == DT_DIR) {
+				if (pushDirectory(walk, index, child) == EXIT_FAILURE) {
+					free(child);
+					result = EXIT_FAILURE;
+				}
+			} else if (!matchesAny(includes, numberOfIncludes, entry->d_name,
+					child) || (!filter->allShards && !isInShard(child))) {
+				free(child);
+			} else {
+				WALK_JOB *job = (WALK_JOB *) malloc(
+						sizeof(WALK_JOB) + strlen(walk->root) + strlen(child)
+								+ 2);
+				if (job != NULL) {
+					job->walk = walk;
+					sprintf(job->path, "%s%c%s", walk->root, PATHSEPERATOR,
+							child);
+					__atomic_add_fetch(&walk->files, 1, __ATOMIC_SEQ_CST);
+					// waits while the queue of the workers is full
+					submitJob(walk->pool, processFile, job);
+				}
+				free(child);
+			}
+		}
+	}
+	free(buffer);
+	close(fd);
+	return result;
+}
+
+/**
+ * @brief Read directories until the walk is over
+ *
+ * 	@param *argument the WALKER
+ * 	@return void* NULL
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void *walkerLoop(void *argument) {
+	WALKER *walker = (WALKER *) argument;
+	WALK *walk = walker->walk;
+	char *path;
+	int i;
+	while (true) {
+		path = takeDirectory(&walk->deques[walker->index], false);
+		for (i = 1; path == NULL && i < walk->numberOfWalkers; i++) {
+			path = takeDirectory(
+					&walk->deques[(walker->index + i) % walk->numberOfWalkers],
+					true);
+		}
+		if (path != NULL) {
+			__atomic_sub_fetch(&walk->queued, 1, __ATOMIC_SEQ_CST);
+			if (readDirectory(walk, walker->index, path) == EXIT_FAILURE) {
+				__atomic_store_n(&walk->result, EXIT_FAILURE, __ATOMIC_SEQ_CST);
+			}
+			free(path);
+			if (__atomic_sub_fetch(&walk->pending, 1, __ATOMIC_SEQ_CST) == 0) {
+				pthread_mutex_lock(&walk->lock);
+				pthread_cond_broadcast(&walk->changed); // the walk is over
+				pthread_mutex_unlock(&walk->lock);
+			}
+			continue;
+		}
+		// Sleep until a directory is queued or the walk is over
+		pthread_mutex_lock(&walk->lock);
+		__atomic_add_fetch(&walk->idle, 1, __ATOMIC_SEQ_CST);
+		while (__atomic_load_n(&walk->queued, __ATOMIC_SEQ_CST) == 0
+				&& __atomic_load_n(&walk->pending, __ATOMIC_SEQ_CST) > 0) {
+			pthread_cond_wait(&walk->changed, &walk->lock);
+		}
+		__atomic_sub_fetch(&walk->idle, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&walk->lock);
+		if (__atomic_load_n(&walk->pending, __ATOMIC_SEQ_CST) == 0) {
+			return NULL;
+		}
+	}
+}
+
+/**
+ * @brief Walk a directory tree and process its files in parallel (see walk.h)
+ *
+ *	@author Valentinos Pariza
+ */
+PUBLIC int walkTree(char *root, WALK_FILTER *filter, FILE_FUNCTION function,
+		void *context, long *numberOfFiles) {
+	WALK_FILTER noFilter = { NULL, 0, NULL, 0 };
+	WALK walk;
+	WALKER walkers[MAX_WALKERS];
+	pthread_t threads[MAX_WALKERS];
+	int i, started;
+	if (root == NULL || function == NULL) {
+		return EXIT_FAILURE;
+	}
+	memset(&walk, 0, sizeof(walk));
+	walk.root = root;
+	walk.filter = (filter != NULL) ? filter : &noFilter;
+	walk.function = function;
+	walk.context = context;
+	walk.result = EXIT_SUCCESS;
+	walk.rootFd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	int workers = defaultWorkerCount();
+	walk.pool = createWorkerPool(workers, workers << 2);
+	char *rootPath = strdup("");
+	if (walk.rootFd < 0 || walk.pool == NULL || rootPath == NULL) {
+		if (walk.rootFd >= 0) {
+			close(walk.rootFd);
+		}
+		destroyWorkerPool(&walk.pool);
+		free(rootPath);
+		return EXIT_FAILURE;
+	}
+	walk.numberOfWalkers = (workers < MAX_WALKERS) ? workers : MAX_WALKERS;
+	pthread_mutex_init(&walk.lock, NULL);
+	pthread_cond_init(&walk.changed, NULL);
+	for (i = 0; i < walk.numberOfWalkers; i++) {
+		pthread_mutex_init(&walk.deques[i].lock, NULL);
+	}
+	pushDirectory(&walk, 0, rootPath);
+// Start the walkers ,this thread is the first one
+	for (started = 1; started < walk.numberOfWalkers; started++) {
+		walkers[started].walk = &walk;
+		walkers[started].index = started;
+		if (pthread_create(&threads[started], NULL, walkerLoop,
+				&walkers[started]) != 0) {
+			break; // walk with the walkers started until now
+		}
+	}
+	walkers[0].walk = &walk;
+	walkers[0].index = 0;
+	walkerLoop(&walkers[0]);
+	for (i = 1; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+// Wait for the files of the walk
+	destroyWorkerPool(&walk.pool);
+	for (i = 0; i < walk.numberOfWalkers; i++) {
+		free(walk.deques[i].paths);
+		pthread_mutex_destroy(&walk.deques[i].lock);
+	}
+	pthread_mutex_destroy(&walk.lock);
+	pthread_cond_destroy(&walk.changed);
+	close(walk.rootFd);
+	if (numberOfFiles != NULL) {
+		*numberOfFiles = walk.files;
+	}
+	return walk.result;
+}
+
+/**
+ * @brief Run a command on a file
+ *
+ *	A FILE_FUNCTION of a walk ,its context is a WALK_COMMAND. Every argument {} of the
+ *	command is replaced by the path of the file ,or the path is added after the last
+ *	argument if there isn't any {}.
+ *
+ * 	@param *path the path of the file
+ * 	@param *context the WALK_COMMAND
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void runOnFile(char *path, void *context) {
+	WALK_COMMAND *command = (WALK_COMMAND *) context;
+	char **argv = (char **) malloc(sizeof(char *) * (command->argc + 3));
+	int i, argc = 1;
+	bool placed = false;
+	if (argv == NULL) {
+		return;
+	}
+	argv[0] = "wavengine";
+	for (i = 0; i < command->argc; i++) {
+		if (strcmp(command->argv[i], "{}") == 0) {
+			argv[argc++] = path;
+			placed = true;
+		} else {
+			argv[argc++] = command->argv[i];
+		}
+	}
+	if (!placed) {
+		argv[argc++] = path;
+	}
+	argv[argc] = NULL;
+	command->run(commandOutput(), argc, argv);
+	free(argv);
+}
+
+/**
+ * @brief Collect the path of a file for a report
+ *
+ *	A FILE_FUNCTION of a walk ,its context is a WALK_REPORT.
+ *
+ * 	@param *path the path of the file
+ * 	@param *context the WALK_REPORT
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void collectFile(char *path, void *context) {
+	WALK_REPORT *report = (WALK_REPORT *) context;
+	char *copy = strdup(path), **paths;
+	pthread_mutex_lock(&report->lock);
+	if (copy != NULL && report->count == report->capacity) {
+		paths = (char **) realloc(report->paths,
+				sizeof(char *) * (report->capacity * 2 + 16));
+		if (paths == NULL) {
+			free(copy);
+			copy = NULL;
+		} else {
+			report->paths = paths;
+			report->capacity = report->capacity * 2 + 16;
+		}
+	}
+	if (copy == NULL) {
+		report->failed = true;
+	} else {
+		report->paths[report->count++] = copy;
+	}
+	pthread_mutex_unlock(&report->lock);
+}
+
+/**
+ * @brief Compare two paths (for qsort)
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE int comparePaths(const void *a, const void *b) {
+	return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/**
+ * @brief Check whether a command writes one report of all its files
+ *
+ *	The reports are -list and -similarity with -csv ,-json or -ndjson.
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE bool isReportCommand(int argc, char **argv) {
+	return argc >= 2
+			&& (strcmp(argv[0], "-list") == 0
+					|| strcmp(argv[0], "-similarity") == 0)
+			&& (strcmp(argv[1], "-csv") == 0 || strcmp(argv[1], "-json") == 0
+					|| strcmp(argv[1], "-ndjson") == 0);
+}
+
+/**
+ * @brief Run a report command once on all the files collected by a walk
+ *
+ *	The files are sorted ,the argument {} of the command is replaced by all of them or
+ *	they are added after the last argument.
+ *
+ * 	@param *command the command
+ * 	@param *report the files collected
+ * 	@return int the exit status of the command
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int runReport(WALK_COMMAND *command, WALK_REPORT *report) {
+	char **argv = (char **) malloc(
+			sizeof(char *) * (command->argc + report->count + 3));
+	int i, argc = 1, result;
+	long k;
+	bool placed = false;
+	if (argv == NULL) {
+		return EXIT_FAILURE;
+	}
+	qsort(report->paths, report->count, sizeof(char *), comparePaths);
+	argv[0] = "wavengine";
+	for (i = 0; i < command->argc; i++) {
+		if (strcmp(command->argv[i], "{}") == 0 && !placed) {
+			for (k = 0; k < report->count; k++) {
+				argv[argc++] = report->paths[k];
+			}
+			placed = true;
+		} else if (strcmp(command->argv[i], "{}") != 0) {
+			argv[argc++] = command->argv[i];
+		}
+	}
+	for (k = 0; !placed && k < report->count; k++) {
+		argv[argc++] = report->paths[k];
+	}
+	argv[argc] = NULL;
+	result = command->run(commandOutput(), argc, argv);
+	free(argv);
+	return result;
+}
+
+/**
+ * @brief Run a command on every file of a directory tree (see wavelib.h)
+ *
+ *	A report command runs once on all the files ,so its output is one report.
+ *
+ *	@author Valentinos Pariza
+ */
+PUBLIC int forEachFile(char *directory, char **includes, int numberOfIncludes,
+		char **excludes, int numberOfExcludes, COMMAND_FUNCTION run, int argc,
+		char **argv) {
+	WALK_FILTER filter = { includes, numberOfIncludes, excludes,
+			numberOfExcludes };
+	WALK_COMMAND command = { run, argc, argv };
+	WALK_REPORT report = { PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, false };
+	long files = 0, k;
+	int result;
+	if (directory == NULL || run == NULL || argc < 1) {
+		return EXIT_FAILURE;
+	}
+	if (isReportCommand(argc, argv)) {
+		// the pairs of a matrix are sharded by blocks ,not by files
+		filter.allShards = strcmp(argv[0], "-similarity") == 0;
+		result = walkTree(directory, &filter, collectFile, &report, &files);
+	} else {
+		result = walkTree(directory, &filter, runOnFile, &command, &files);
+	}
+	if (result == EXIT_FAILURE || report.failed) {
+		printOutput("Fail    :  %s\t(Can't read the whole tree ,%ld files found)\n",
+				directory, files);
+		result = EXIT_FAILURE;
+	} else if (isReportCommand(argc, argv)) {
+		result = runReport(&command, &report);
+	}
+	for (k = 0; k < report.count; k++) {
+		free(report.paths[k]);
+	}
+	free(report.paths);
+	pthread_mutex_destroy(&report.lock);
+	return result;
+}
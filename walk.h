@@ -0,0 +1,59 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the parallel walk of a
+ *  directory tree. The directories are read by a few walker threads ,each
+ *  with its own queue of directories ,and a walker without directories takes
+ *  them from the queues of the others (work stealing). Every file found is
+ *  given at once to a pool of worker threads ,so the files are processed
+ *  while the tree is still being read.
+ */
+#ifndef WALK_H
+#define WALK_H
+
+#include "utilities.h"
+
+/**
+ * A function called for every file of a walk with its path
+ */
+typedef void (*FILE_FUNCTION)(char *path, void *context);
+
+/**
+ * The patterns which select the files of a walk. A pattern with a '/' is
+ * matched against the path of a file in the tree ,any other pattern against
+ * its name (see fnmatch).
+ */
+typedef struct {
+	char **includes; // the files processed ,all the .wav files if there are none
+	int numberOfIncludes;
+	char **excludes; // the files and the directories skipped
+	int numberOfExcludes;
+	bool allShards; // true to process the files of all the shards
+} WALK_FILTER;
+
+/**
+ * @brief Walk a directory tree and process its files in parallel
+ *
+ *	This function reads the directories with openat and getdents ,without
+ *	following symbolic links. The function is called by the workers of a pool
+ *	with a bounded queue ,so a walk which finds files faster than they are
+ *	processed waits. It returns when all the files were processed. Only the
+ *	files whose path in the tree belongs to the shard of the process are
+ *	processed ,unless the filter takes the files of all the shards.
+ *
+ * 	@param *root the directory at the root of the tree
+ * 	@param *filter the patterns of the files or NULL for all the .wav files
+ * 	@param function the function called for every file
+ * 	@param *context the second argument of the function
+ * 	@param *numberOfFiles where the number of the files found is placed or NULL
+ * 	@return int Success or Failure (also if a directory couldn't be read)
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int walkTree(char *root, WALK_FILTER *filter, FILE_FUNCTION function,
+		void *context, long *numberOfFiles);
+
+#endif
@@ -0,0 +1,416 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file watch.c
+ *  @brief Runs a pipeline on every .wav file which arrives in a directory
+ *
+ *  Implements the watch of a drop folder. The directory is watched with inotify for
+ *  files which are closed after they were written (IN_CLOSE_WRITE) or moved in
+ *  (IN_MOVED_TO) ,so the process sleeps until a file arrives. Every file is given to a
+ *  pool of worker threads ,whose queue is bounded: when the workers are behind ,the
+ *  events wait in the queue of inotify (backpressure). If that queue overflows the
+ *  directory is scanned again.
+ *
+ *  Every finished file is appended to a journal with its size and its modification
+ *  time. At the start the journal is read and the files of the directory which aren't
+ *  in it (or changed after it) are processed ,so nothing is processed twice and nothing
+ *  which arrived while the watch wasn't running is lost.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+#include "wavelib.h"
+#include "workerPool.h"
+
+// The number of the buckets of the table of the files
+#define WATCH_BUCKETS 4096
+// The size of the buffer of the events of inotify
+#define WATCH_EVENT_BYTES (64 * 1024)
+// The prefix of the outputs of the pipeline ,which aren't processed again
+#define WATCH_OUTPUT_PREFIX "pipe-"
+// The name of the default journal in the watched directory
+#define WATCH_JOURNAL ".wavengine-journal"
+
+/**
+ * A file of the watched directory
+ */
+typedef struct WATCH_ENTRY {
+	char *name; // the filename in the directory
+	long size; // the size when it was processed
+	long long modified; // the modification time in ns when it was processed
+	bool done; // it was processed
+	bool running; // a worker processes it
+	bool again; // it changed while a worker processed it
+	struct WATCH_ENTRY *next;
+} WATCH_ENTRY;
+
+/**
+ * The state of the watch ,shared by the workers
+ */
+typedef struct {
+	char *directory;
+	char *operations;
+	FILE *journal;
+	pthread_mutex_t lock;
+	WATCH_ENTRY *buckets[WATCH_BUCKETS];
+	WORKER_POOL *pool;
+	unsigned long long processed;
+	unsigned long long failed;
+} WATCHER;
+
+PRIVATE WATCHER watcher;
+PRIVATE volatile sig_atomic_t stopping = 0;
+
+/**
+ * @brief Hash a filename
+ *
+ * 	@param *name the filename
+ * 	@return unsigned long the hash (FNV-1a)
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE unsigned long hashName(const char *name) {
+	unsigned long hash = 2166136261UL;
+	while (*name != '\0') {
+		hash = (hash ^ (byte) *name++) * 16777619UL;
+	}
+	return hash;
+}
+
+/**
+ * @brief Find the entry of a file ,or create it
+ *
+ *	The lock of the watcher must be held.
+ *
+ * 	@param *name the filename in the directory
+ * 	@return WATCH_ENTRY* the entry or NULL if there isn't enough memory
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE WATCH_ENTRY *findEntry(const char *name) {
+	WATCH_ENTRY **bucket = &watcher.buckets[hashName(name) % WATCH_BUCKETS];
+	WATCH_ENTRY *entry;
+	for (entry = *bucket; entry != NULL; entry = entry->next) {
+		if (strcmp(entry->name, name) == 0) {
+			return entry;
+		}
+	}
+	entry = (WATCH_ENTRY *) calloc(1, sizeof(WATCH_ENTRY));
+	if (entry == NULL || (entry->name = strdup(name)) == NULL) {
+		free(entry);
+		return NULL;
+	}
+	entry->next = *bucket;
+	*bucket = entry;
+	return entry;
+}
+
+/**
+ * @brief Check whether a file of the directory is an input of the watch
+ *
+ * 	@param *name the filename in the directory
+ * 	@return bool true for a .wav file which isn't an output
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE bool isWatchedName(const char *name) {
+	size_t length = strlen(name);
+	return length >= 4 && strcmp(name + length - 4, ".wav") == 0
+			&& strncmp(name, WATCH_OUTPUT_PREFIX, strlen(WATCH_OUTPUT_PREFIX))
+					!= 0;
+}
+
+/**
+ * @brief Read the journal of the finished files
+ *
+ *	Every line is the size ,the modification time ,the status and the name of a file. A
+ *	later line of a file replaces an earlier one.
+ *
+ * 	@param *fp the journal
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void readJournal(FILE *fp) {
+	char line[4096], status[8];
+	long size;
+	long long modified;
+	int length;
+	WATCH_ENTRY *entry;
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\n")] = '\0';
+		if (sscanf(line, "%ld %lld %7s %n", &size, &modified, status,
+				&length) != 3 || line[length] == '\0') {
+			continue;
+		}
+		entry = findEntry(line + length);
+		if (entry != NULL) {
+			entry->size = size;
+			entry->modified = modified;
+			entry->done = true;
+		}
+	}
+}
+
+/**
+ * @brief Run the pipeline on a file
+ *
+ *	A job of the worker pool ,its argument is the WATCH_ENTRY of the file. If the file
+ *	changes while it is processed ,it is processed again.
+ *
+ * 	@param *argument the WATCH_ENTRY
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void processFile(void *argument) {
+	WATCH_ENTRY *entry = (WATCH_ENTRY *) argument;
+	char *path = (char *) malloc(
+			strlen(watcher.directory) + strlen(entry->name) + 2);
+	struct stat info;
+	bool again = true;
+	int result;
+	while (again) {
+		pthread_mutex_lock(&watcher.lock);
+		entry->again = false;
+		pthread_mutex_unlock(&watcher.lock);
+		result = EXIT_FAILURE;
+		if (path != NULL) {
+			sprintf(path, "%s%c%s", watcher.directory, PATHSEPERATOR,
+					entry->name);
+			if (stat(path, &info) != 0) {
+				pthread_mutex_lock(&watcher.lock);
+				entry->running = false; // it was removed
+				pthread_mutex_unlock(&watcher.lock);
+				break;
+			}
+			result = pipeline(path, watcher.operations, NULL);
+		}
+		pthread_mutex_lock(&watcher.lock);
+		if (path != NULL) {
+			entry->size = info.st_size;
+			entry->modified = info.st_mtim.tv_sec * 1000000000LL
+					+ info.st_mtim.tv_nsec;
+			entry->done = true;
+			fprintf(watcher.journal, "%ld %lld %s %s\n", entry->size,
+					entry->modified, (result == EXIT_SUCCESS) ? "ok" : "fail",
+					entry->name);
+			fflush(watcher.journal);
+		}
+		watcher.processed++;
+		watcher.failed += (result == EXIT_FAILURE);
+		again = entry->again && path != NULL;
+		entry->running = again;
+		pthread_mutex_unlock(&watcher.lock);
+	}
+	free(path);
+}
+
+/**
+ * @brief Give a file of the directory to the workers if it wasn't processed
+ *
+ *	If the queue of the workers is full this function waits.
+ *
+ * 	@param *name the filename in the directory
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void noteFile(const char *name) {
+	struct stat info;
+	if (!isWatchedName(name)) {
+		return;
+	}
+	char *path = (char *) malloc(strlen(watcher.directory) + strlen(name) + 2);
+	if (path == NULL) {
+		return;
+	}
+	sprintf(path, "%s%c%s", watcher.directory, PATHSEPERATOR, name);
+	int found = stat(path, &info);
+	free(path);
+	if (found != 0 || !S_ISREG(info.st_mode)) {
+		return;
+	}
+	long long modified = info.st_mtim.tv_sec * 1000000000LL
+			+ info.st_mtim.tv_nsec;
+	pthread_mutex_lock(&watcher.lock);
+	WATCH_ENTRY *entry = findEntry(name);
+	if (entry == NULL || entry->running
+			|| (entry->done && entry->size == info.st_size
+					&& entry->modified == modified)) {
+		if (entry != NULL && entry->running) {
+			entry->again = true;
+		}
+		pthread_mutex_unlock(&watcher.lock);
+		return;
+	}
+	entry->running = true;
+	pthread_mutex_unlock(&watcher.lock);
+	submitJob(watcher.pool, processFile, entry);
+}
+
+/**
+ * @brief Give all the unprocessed files of the directory to the workers
+ *
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int scanDirectory() {
+	DIR *dir = opendir(watcher.directory);
+	struct dirent *entry;
+	if (dir == NULL) {
+		return EXIT_FAILURE;
+	}
+	while (!stopping && (entry = readdir(dir)) != NULL) {
+		noteFile(entry->d_name);
+	}
+	closedir(dir);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Stop the watch at SIGINT or SIGTERM
+ *
+ * 	@param signal the signal
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void stopWatch(int signal) {
+	(void) signal;
+	stopping = 1;
+}
+
+/**
+ * @brief Free the table of the files
+ *
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void freeEntries() {
+	WATCH_ENTRY *entry, *next;
+	int i;
+	for (i = 0; i < WATCH_BUCKETS; i++) {
+		for (entry = watcher.buckets[i]; entry != NULL; entry = next) {
+			next = entry->next;
+			free(entry->name);
+			free(entry);
+		}
+		watcher.buckets[i] = NULL;
+	}
+}
+
+PUBLIC int watch(char *directory, char *operations, char *journalFile) {
+	if (directory == NULL || operations == NULL) {
+		return EXIT_FAILURE;
+	}
+	memset(&watcher, 0, sizeof(watcher));
+	watcher.directory = directory;
+	watcher.operations = operations;
+	pthread_mutex_init(&watcher.lock, NULL);
+// Open the journal ,the files in it aren't processed again
+	char *defaultJournal = NULL;
+	if (journalFile == NULL) {
+		defaultJournal = (char *) malloc(
+				strlen(directory) + strlen(WATCH_JOURNAL) + 2);
+		if (defaultJournal == NULL) {
+			return EXIT_FAILURE;
+		}
+		sprintf(defaultJournal, "%s%c%s", directory, PATHSEPERATOR,
+				WATCH_JOURNAL);
+		journalFile = defaultJournal;
+	}
+	watcher.journal = fopen(journalFile, "a+");
+	if (watcher.journal == NULL) {
+		printf("Fail    :  %s\t(Can't open the journal)\n", journalFile);
+		free(defaultJournal);
+		return EXIT_FAILURE;
+	}
+	rewind(watcher.journal);
+	readJournal(watcher.journal);
+// Watch the directory before it is scanned ,so no file is missed
+	int fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0
+			|| inotify_add_watch(fd, directory,
+					IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF
+							| IN_ONLYDIR) < 0) {
+		printf("Fail    :  %s\t(Can't watch the directory)\n", directory);
+		if (fd >= 0) {
+			close(fd);
+		}
+		fclose(watcher.journal);
+		freeEntries();
+		free(defaultJournal);
+		return EXIT_FAILURE;
+	}
+	// only the thread of the watch takes the signals which stop it
+	sigset_t signals, old;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, &old);
+	int threads = defaultWorkerCount();
+	watcher.pool = createWorkerPool(threads, threads << 1);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopWatch; // without SA_RESTART read is interrupted
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	printf("Success :  %s\t(Watching)\n", directory);
+	int result = (watcher.pool == NULL) ? EXIT_FAILURE : scanDirectory();
+// Process the files as they arrive ,the process sleeps in read between them
+	char *buffer = (char *) malloc(WATCH_EVENT_BYTES);
+	const struct inotify_event *event;
+	ssize_t length;
+	char *p;
+	while (!stopping && result == EXIT_SUCCESS && buffer != NULL) {
+		length = read(fd, buffer, WATCH_EVENT_BYTES);
+		if (length < 0 && errno == EINTR) {
+			continue;
+		}
+		if (length <= 0) {
+			result = EXIT_FAILURE;
+			break;
+		}
+		for (p = buffer; p < buffer + length && !stopping;
+				p += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *) p;
+			if (event->mask & IN_Q_OVERFLOW) {
+				// events were lost ,the journal tells which files are new
+				scanDirectory();
+			} else if (event->mask
+					& (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+				printf("Fail    :  %s\t(The directory was removed)\n",
+						directory);
+				result = EXIT_FAILURE;
+			} else if (event->len > 0) {
+				noteFile(event->name);
+			}
+		}
+	}
+	free(buffer);
+	close(fd);
+	destroyWorkerPool(&watcher.pool);
+	printf("Success :  %s\t(%llu files processed ,%llu failed)\n", directory,
+			watcher.processed, watcher.failed);
+	fclose(watcher.journal);
+	freeEntries();
+	pthread_mutex_destroy(&watcher.lock);
+	free(defaultJournal);
+	return result;
+}
@@ -0,0 +1,711 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file wavbuffer.c
+ *  @brief The operations of wavelib on WAV structs in memory
+ *
+ *  Implements the operations of the commands on WAV structs ,and the reading and the
+ *  writing of WAV structs from and to memory and file descriptors. Nothing here prints
+ *  or opens a file ,every function returns a WAV_STATUS. The operations allocate their
+ *  output and never change their input.
+ *
+ *  @version 1.0
+ *  @author Marios Pafitis
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <unistd.h>
+#include "resample.h"
+#include "wavbuffer.h"
+#include "stream.h"
+
+// The largest data of a .wav ,its size is a field of 4 bytes
+#define MAX_DATA_SIZE 0xFFFFFFFFUL
+#define CANONICAL_FMT_SIZE 16
+
+PUBLIC const char *wav_strerror(WAV_STATUS status) {
+	switch (status) {
+	case WAV_OK:
+		return "Success";
+	case WAV_ERROR_ARGUMENT:
+		return "Wrong input";
+	case WAV_ERROR_MEMORY:
+		return "Not enough space to allocate memory";
+	case WAV_ERROR_FORMAT:
+		return "This is not a correct .wav";
+	case WAV_ERROR_CHANNELS:
+		return "Wrong number of channels";
+	case WAV_ERROR_RANGE:
+		return "Invalid time input";
+	case WAV_ERROR_MISMATCH:
+		return "The two audio files are not align";
+	case WAV_ERROR_SPACE:
+		return "The output doesn't fit";
+	case WAV_ERROR_IO:
+		return "Can't read or write the file";
+	}
+	return "Unknown error";
+}
+
+PUBLIC void wav_free(WAV *wav) {
+	releaseWAV(wav);
+}
+
+PUBLIC size_t wav_size(const WAV *wav) {
+	if (wav == NULL || wav->header == NULL) {
+		return 0;
+	}
+	return headerBytes(wav->header, extensionOfWAV(wav))
+			+ wav->header->Subchunk2Size;
+}
+
+/**
+ * @brief Allocate the header and the data of an output WAV
+ *
+ *	The header is a copy of a format with the size of the data. The WAV points to the
+ *	block of createWAV ,so wav_free and deleteWAV free it.
+ *
+ * 	@param *wav the output WAV
+ * 	@param *format the header whose format is copied
+ * 	@param *extension the valid bits and the channel mask or NULL for the defaults
+ * 	@param dataSize the size of the data in bytes
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE WAV_STATUS allocateWAV(WAV *wav, const HEADER *format,
+		const FORMAT_EXTENSION *extension, unsigned long dataSize) {
+	if (dataSize > MAX_DATA_SIZE) {
+		return WAV_ERROR_SPACE;
+	}
+	WAV *block = createWAV(dataSize);
+	if (block == NULL) {
+		return WAV_ERROR_MEMORY;
+	}
+	wav->header = block->header;
+	wav->data = block->data;
+	memcpy(wav->header, format, sizeof(HEADER));
+	wav->header->Subchunk2Size = dataSize;
+	wav->header->ChunkSize = sizeof(HEADER) - 8 + dataSize;
+	setExtensionOfWAV(wav, extension);
+	return WAV_OK;
+}
+
+/**
+ * @brief The valid bits and the channel mask of a WAV ,or the defaults of its header
+ *
+ *	@author Valentinos Pariza
+ */
+PRIVATE FORMAT_EXTENSION extensionOf(const WAV *wav) {
+	const FORMAT_EXTENSION *extension = extensionOfWAV(wav);
+	FORMAT_EXTENSION defaults = { wav->header->BitsPerSample, defaultChannelMask(
+			wav->header->NumChannels) };
+	return (extension != NULL) ? *extension : defaults;
+}
+
+/**
+ * @brief Set the number of the channels of a header and the fields which depend on it
+ *
+ * 	@param *header the header
+ * 	@param channels the number of the channels
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE void setChannels(HEADER *header, word channels) {
+	header->NumChannels = channels;
+	header->BlockAlign = channels * (header->BitsPerSample >> 3);
+	header->ByteRate = header->SampleRate * header->BlockAlign;
+}
+
+/**
+ * @brief The number of the bytes of a frame of a header
+ *
+ *	It is found from the channels and the bits per sample ,which are checked ,and not
+ *	from the BlockAlign field.
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE unsigned long frameBytes(const HEADER *header) {
+	return (unsigned long) header->NumChannels * (header->BitsPerSample >> 3);
+}
+
+/**
+ * @brief Check an input WAV of an operation
+ *
+ * 	@param *wav the WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE WAV_STATUS checkWAV(const WAV *wav) {
+	if (wav == NULL || wav->header == NULL || wav->data == NULL
+			|| wav->data->channel == NULL) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	if (!isCorrectFormatHeader((HEADER *) wav->header)) {
+		return WAV_ERROR_FORMAT;
+	}
+	return WAV_OK;
+}
+
+/**
+ * @brief Check the output WAV of an operation and empty it
+ *
+ * 	@param *out the output WAV
+ * 	@param *in an input WAV ,which can't be the output
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE WAV_STATUS prepareOutput(WAV *out, const WAV *in) {
+	if (out == NULL || out == in) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	out->header = NULL;
+	out->data = NULL;
+	return WAV_OK;
+}
+
+/**
+ * @brief Bring two input WAVs to the wider of their sample formats and the higher rate
+ *
+ *	A WAV whose format isn't the wider one is converted to a temporary WAV and the
+ *	pointer of the input is moved to it ,then the WAV of the lower sample rate is
+ *	resampled to the higher one. The temporaries are freed with wav_free.
+ *
+ * 	@param **first the pointer of the first WAV
+ * 	@param **second the pointer of the second WAV
+ * 	@param *temporary1 the temporary of the first WAV
+ * 	@param *temporary2 the temporary of the second WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE WAV_STATUS alignFormats(const WAV **first, const WAV **second,
+		WAV *temporary1, WAV *temporary2) {
+	SAMPLE_FORMAT format1 = sampleFormatOf((*first)->header);
+	SAMPLE_FORMAT format2 = sampleFormatOf((*second)->header);
+	SAMPLE_FORMAT format = widerSampleFormat(format1, format2);
+	WAV_STATUS status = WAV_OK;
+	temporary1->header = temporary2->header = NULL;
+	temporary1->data = temporary2->data = NULL;
+	if (format1 != format
+			&& (status = wav_convert(*first, format, false, temporary1))
+					== WAV_OK) {
+		*first = temporary1;
+	}
+	if (status == WAV_OK && format2 != format
+			&& (status = wav_convert(*second, format, false, temporary2))
+					== WAV_OK) {
+		*second = temporary2;
+	}
+	dword rate1 = (*first)->header->SampleRate;
+	dword rate2 = (*second)->header->SampleRate;
+	if (status == WAV_OK && rate1 != rate2) {
+		const WAV **lower = (rate1 < rate2) ? first : second;
+		WAV *temporary = (rate1 < rate2) ? temporary1 : temporary2, resampled;
+		if ((status = wav_resample(*lower, (rate1 < rate2) ? rate2 : rate1,
+				&resampled)) == WAV_OK) {
+			// the converted samples are replaced by the resampled ones
+			wav_free(temporary);
+			*temporary = resampled;
+			*lower = temporary;
+		}
+	}
+	return status;
+}
+
+/**
+ * @brief Fill the data of a WAV read from a file ,with zeros after a short file
+ *
+ * 	@param *wav the WAV
+ * 	@param available the number of the bytes of the data in the file
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE void zeroMissingData(WAV *wav, unsigned long available) {
+	if (available < wav->header->Subchunk2Size) {
+		memset(wav->data->channel + available, 0,
+				wav->header->Subchunk2Size - available);
+	}
+}
+
+/**
+ * @brief Keep the canonical form of a header in memory ,the writers add its extension
+ *
+ *	@author Marios Pafitis
+ */
+PRIVATE void canonicalHeader(HEADER *header) {
+	header->Subchunk1Size = CANONICAL_FMT_SIZE;
+	header->ChunkSize = sizeof(HEADER) - 8 + header->Subchunk2Size;
+}
+
+PUBLIC WAV_STATUS wav_read_memory(const byte *buffer, size_t size, WAV *wav) {
+	HEADER header;
+	FORMAT_EXTENSION extension;
+	long dataOffset = 0;
+	if (buffer == NULL || wav == NULL) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	wav->header = NULL;
+	wav->data = NULL;
+	if (readHeaderExtensionMemory(buffer, (long) size, &header, &extension,
+			&dataOffset) == EXIT_FAILURE) {
+		return WAV_ERROR_FORMAT;
+	}
+	canonicalHeader(&header);
+	WAV_STATUS status = allocateWAV(wav, &header, &extension,
+			header.Subchunk2Size);
+	if (status != WAV_OK) {
+		return status;
+	}
+	unsigned long available =
+			((size_t) dataOffset < size) ? size - dataOffset : 0;
+	if (available > header.Subchunk2Size) {
+		available = header.Subchunk2Size;
+	}
+	memcpy(wav->data->channel, buffer + dataOffset, available);
+	zeroMissingData(wav, available);
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_write_memory(const WAV *wav, byte *buffer, size_t size,
+		size_t *written) {
+	if (wav == NULL || wav->header == NULL || wav->data == NULL
+			|| buffer == NULL) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	size_t needed = wav_size(wav);
+	if (written != NULL) {
+		*written = needed;
+	}
+	if (size < needed) {
+		return WAV_ERROR_SPACE;
+	}
+	size_t headerSize = formatHeader(wav->header, extensionOfWAV(wav), buffer);
+	memcpy(buffer + headerSize, wav->data->channel, wav->header->Subchunk2Size);
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_read_fd(int fd, WAV *wav) {
+	HEADER header;
+	FORMAT_EXTENSION extension;
+	long dataOffset = 0;
+	if (fd < 0 || wav == NULL) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	wav->header = NULL;
+	wav->data = NULL;
+	if (readHeaderExtensionFd(fd, &header, &extension, &dataOffset)
+			== EXIT_FAILURE) {
+		return WAV_ERROR_FORMAT;
+	}
+	canonicalHeader(&header);
+	WAV_STATUS status = allocateWAV(wav, &header, &extension,
+			header.Subchunk2Size);
+	if (status != WAV_OK) {
+		return status;
+	}
+	unsigned long available = 0;
+	ssize_t bytesRead;
+	// a big data chunk is read ahead ,the next block is read while a block is copied
+	ASYNC_FILE *ahead = (header.Subchunk2Size > ASYNC_BLOCK_BYTES) ?
+			openAsyncFile(fd, false, dataOffset, header.Subchunk2Size,
+					ASYNC_BLOCK_BYTES) : NULL;
+	byte *block;
+	while (ahead != NULL && available < header.Subchunk2Size) {
+		if ((bytesRead = readAsyncBlock(ahead, &block)) < 0) {
+			closeAsyncFile(&ahead);
+			wav_free(wav);
+			return WAV_ERROR_IO;
+		}
+		if (bytesRead == 0) { // a short file
+			break;
+		}
+		memcpy(wav->data->channel + available, block, bytesRead);
+		available += bytesRead;
+	}
+	if (ahead != NULL) {
+		closeAsyncFile(&ahead);
+		zeroMissingData(wav, available);
+		return WAV_OK;
+	}
+	while (available < header.Subchunk2Size) {
+		bytesRead = pread(fd, wav->data->channel + available,
+				header.Subchunk2Size - available, dataOffset + available);
+		if (bytesRead < 0 && errno == EINTR) {
+			continue;
+		}
+		if (bytesRead < 0) {
+			wav_free(wav);
+			return WAV_ERROR_IO;
+		}
+		if (bytesRead == 0) { // a short file
+			break;
+		}
+		available += bytesRead;
+	}
+	zeroMissingData(wav, available);
+	return WAV_OK;
+}
+
+/**
+ * @brief Write all the bytes of a buffer to a file descriptor
+ *
+ * 	@param fd the file descriptor
+ * 	@param *bytes the bytes
+ * 	@param count the number of the bytes
+ * 	@return WAV_STATUS WAV_OK or WAV_ERROR_IO
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE WAV_STATUS writeFully(int fd, const byte *bytes, size_t count) {
+	ssize_t bytesWritten;
+	while (count > 0) {
+		bytesWritten = write(fd, bytes, count);
+		if (bytesWritten < 0 && errno == EINTR) {
+			continue;
+		}
+		if (bytesWritten <= 0) {
+			return WAV_ERROR_IO;
+		}
+		bytes += bytesWritten;
+		count -= bytesWritten;
+	}
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_write_fd(int fd, const WAV *wav) {
+	if (fd < 0 || wav == NULL || wav->header == NULL || wav->data == NULL) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	byte header[EXTENSIBLE_HEADER_SIZE];
+	if (writeFully(fd, header,
+			formatHeader(wav->header, extensionOfWAV(wav), header)) != WAV_OK) {
+		return WAV_ERROR_IO;
+	}
+	size_t size = wav->header->Subchunk2Size, written = 0, bytes;
+	// a big data chunk is written behind ,a block is written while the next is copied
+	ASYNC_FILE *behind = (size > ASYNC_BLOCK_BYTES) ?
+			openAsyncFile(fd, true, -1, -1, ASYNC_BLOCK_BYTES) : NULL;
+	if (behind == NULL) {
+		return writeFully(fd, wav->data->channel, size);
+	}
+	int result = EXIT_SUCCESS;
+	while (result == EXIT_SUCCESS && written < size) {
+		bytes = (size - written < ASYNC_BLOCK_BYTES) ?
+				size - written : ASYNC_BLOCK_BYTES;
+		memcpy(asyncWriteBuffer(behind), wav->data->channel + written, bytes);
+		result = writeAsyncBlock(behind, bytes);
+		written += bytes;
+	}
+	if (closeAsyncFile(&behind) == EXIT_FAILURE) {
+		result = EXIT_FAILURE;
+	}
+	return (result == EXIT_SUCCESS) ? WAV_OK : WAV_ERROR_IO;
+}
+
+PUBLIC WAV_STATUS wav_mono(const WAV *in, WAV *out) {
+	WAV_STATUS status = prepareOutput(out, in);
+	if (status != WAV_OK || (status = checkWAV(in)) != WAV_OK) {
+		return status;
+	}
+	if (in->header->NumChannels < 2) {
+		return WAV_ERROR_CHANNELS;
+	}
+	int bytesPerSample = in->header->BitsPerSample >> 3;
+	unsigned long blockAlign = frameBytes(in->header);
+	unsigned long frames = in->header->Subchunk2Size / blockAlign;
+	// the mono sound is at the position of the left channel
+	FORMAT_EXTENSION extension = extensionOf(in);
+	extension.ChannelMask &= ~extension.ChannelMask + 1;
+	if ((status = allocateWAV(out, in->header, &extension,
+			frames * bytesPerSample)) != WAV_OK) {
+		return status;
+	}
+	setChannels(out->header, 1);
+// Keep the left channel
+	const byte *left = in->data->channel;
+	byte *sample = out->data->channel;
+	unsigned long i;
+	for (i = 0; i < frames; i++) {
+		memcpy(sample, left, bytesPerSample);
+		sample += bytesPerSample;
+		left += blockAlign;
+	}
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_mix(const WAV *first, const WAV *second, WAV *out) {
+	WAV_STATUS status = prepareOutput(out, first);
+	if (status != WAV_OK || (status = prepareOutput(out, second)) != WAV_OK
+			|| (status = checkWAV(first)) != WAV_OK
+			|| (status = checkWAV(second)) != WAV_OK) {
+		return status;
+	}
+	WAV temporary1, temporary2;
+	if ((status = alignFormats(&first, &second, &temporary1, &temporary2))
+			!= WAV_OK) {
+		wav_free(&temporary1);
+		wav_free(&temporary2);
+		return status;
+	}
+	// The bytes of a frame of each track and of a single unit of sample
+	unsigned long blockAlign1 = frameBytes(first->header);
+	unsigned long blockAlign2 = frameBytes(second->header);
+	int bytesSingleUnitSample = first->header->BitsPerSample >> 3;
+	unsigned long frames1 = first->header->Subchunk2Size / blockAlign1;
+	unsigned long frames2 = second->header->Subchunk2Size / blockAlign2;
+	unsigned long frames = (frames1 < frames2) ? frames1 : frames2;
+	FORMAT_EXTENSION extension = extensionOf(first);
+	extension.ChannelMask = defaultChannelMask(2);
+	if ((status = allocateWAV(out, first->header, &extension,
+			frames * 2 * bytesSingleUnitSample)) != WAV_OK) {
+		wav_free(&temporary1);
+		wav_free(&temporary2);
+		return status;
+	}
+	setChannels(out->header, 2);
+	// the right channel of the first track (or its single unit) goes to the
+	// right and the left channel of the second track goes to the left
+	const byte *pter1 = first->data->channel
+			+ ((first->header->NumChannels >= 2) ? bytesSingleUnitSample : 0);
+	const byte *pter2 = second->data->channel;
+	byte *pointerToNewData = out->data->channel;
+	unsigned long i;
+	for (i = 0; i < frames; i++) {
+		memcpy(pointerToNewData, pter2, bytesSingleUnitSample);
+		pointerToNewData += bytesSingleUnitSample;
+		memcpy(pointerToNewData, pter1, bytesSingleUnitSample);
+		pointerToNewData += bytesSingleUnitSample;
+		pter1 += blockAlign1;
+		pter2 += blockAlign2;
+	}
+	wav_free(&temporary1);
+	wav_free(&temporary2);
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_chop(const WAV *in, int left, int right, WAV *out) {
+	WAV_STATUS status = prepareOutput(out, in);
+	if (status != WAV_OK || (status = checkWAV(in)) != WAV_OK) {
+		return status;
+	}
+	if (right <= left || left < 0) {
+		return WAV_ERROR_RANGE;
+	}
+	// The times are whole frames ,so a part of any format starts at a frame
+	unsigned long bytesPerSecond = (unsigned long) in->header->SampleRate
+			* frameBytes(in->header);
+	unsigned long first = left * bytesPerSecond;
+	unsigned long last = right * bytesPerSecond;
+	if (last > in->header->Subchunk2Size) {
+		return WAV_ERROR_RANGE;
+	}
+	if ((status = allocateWAV(out, in->header, extensionOfWAV(in),
+			last - first)) != WAV_OK) {
+		return status;
+	}
+	memcpy(out->data->channel, in->data->channel + first, last - first);
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_reverse(const WAV *in, WAV *out) {
+	WAV_STATUS status = prepareOutput(out, in);
+	if (status != WAV_OK || (status = checkWAV(in)) != WAV_OK) {
+		return status;
+	}
+	unsigned long sampleBlockBytes = frameBytes(in->header);
+	unsigned long frames = in->header->Subchunk2Size / sampleBlockBytes;
+	if ((status = allocateWAV(out, in->header, extensionOfWAV(in),
+			frames * sampleBlockBytes))
+			!= WAV_OK) {
+		return status;
+	}
+	const byte *pointerSrc = in->data->channel + frames * sampleBlockBytes;
+	byte *pointerDest = out->data->channel;
+	unsigned long i;
+	for (i = 0; i < frames; i++) {
+		pointerSrc -= sampleBlockBytes;
+		memcpy(pointerDest, pointerSrc, sampleBlockBytes);
+		pointerDest += sampleBlockBytes;
+	}
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_merge(const WAV *first, const WAV *second, WAV *out) {
+	WAV_STATUS status = prepareOutput(out, first);
+	if (status != WAV_OK || (status = prepareOutput(out, second)) != WAV_OK
+			|| (status = checkWAV(first)) != WAV_OK
+			|| (status = checkWAV(second)) != WAV_OK) {
+		return status;
+	}
+	if (first->header->NumChannels != second->header->NumChannels) {
+		return WAV_ERROR_MISMATCH;
+	}
+	WAV temporary1, temporary2;
+	if ((status = alignFormats(&first, &second, &temporary1, &temporary2))
+			!= WAV_OK) {
+		wav_free(&temporary1);
+		wav_free(&temporary2);
+		return status;
+	}
+	const HEADER *header1 = first->header, *header2 = second->header;
+	if (header1->ByteRate != header2->ByteRate
+			|| header1->BlockAlign != header2->BlockAlign) {
+		status = WAV_ERROR_MISMATCH;
+	} else if ((status = allocateWAV(out, header1, extensionOfWAV(first),
+			(unsigned long) header1->Subchunk2Size + header2->Subchunk2Size))
+			== WAV_OK) {
+		memcpy(out->data->channel, first->data->channel,
+				header1->Subchunk2Size);
+		memcpy(out->data->channel + header1->Subchunk2Size,
+				second->data->channel, header2->Subchunk2Size);
+	}
+	wav_free(&temporary1);
+	wav_free(&temporary2);
+	return status;
+}
+
+PUBLIC WAV_STATUS wav_gain(const WAV *in, double decibels, WAV *out) {
+	WAV_STATUS status = prepareOutput(out, in);
+	if (status != WAV_OK || (status = checkWAV(in)) != WAV_OK) {
+		return status;
+	}
+	if ((status = allocateWAV(out, in->header, extensionOfWAV(in),
+			in->header->Subchunk2Size))
+			!= WAV_OK) {
+		return status;
+	}
+	int bytesPerSample = in->header->BitsPerSample >> 3;
+	memcpy(out->data->channel, in->data->channel, in->header->Subchunk2Size);
+	gainSamples(out->data->channel,
+			in->header->Subchunk2Size / bytesPerSample,
+			sampleFormatOf(in->header), pow(10, decibels / 20));
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_convert(const WAV *in, SAMPLE_FORMAT format, bool dither,
+		WAV *out) {
+	WAV_STATUS status = prepareOutput(out, in);
+	if (status != WAV_OK || (status = checkWAV(in)) != WAV_OK) {
+		return status;
+	}
+	if (format == SAMPLE_UNKNOWN) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	HEADER header = *in->header;
+	unsigned long frames = in->header->Subchunk2Size / frameBytes(in->header);
+	setSampleFormat(&header, format);
+	FORMAT_EXTENSION extension = extensionOf(in);
+	extension.ValidBitsPerSample = header.BitsPerSample;
+	if ((status = allocateWAV(out, &header, &extension,
+			frames * header.BlockAlign)) != WAV_OK) {
+		return status;
+	}
+	CONVERTER converter;
+	if (createConverter(&converter, sampleFormatOf(in->header), format,
+			header.NumChannels, dither) == EXIT_FAILURE) {
+		wav_free(out);
+		return WAV_ERROR_MEMORY;
+	}
+	convertFrames(&converter, in->data->channel, out->data->channel,
+			(long) frames);
+	freeConverter(&converter);
+	return WAV_OK;
+}
+
+PUBLIC WAV_STATUS wav_resample(const WAV *in, dword rate, WAV *out) {
+	WAV_STATUS status = prepareOutput(out, in);
+	if (status != WAV_OK || (status = checkWAV(in)) != WAV_OK) {
+		return status;
+	}
+	if (rate == 0 || rate > MAX_SAMPLE_RATE
+			|| in->header->SampleRate / rate >= MAX_RESAMPLE_RATIO) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	PLANAR samples, resampled;
+	if (decodePlanar(in, &samples) == EXIT_FAILURE) {
+		return WAV_ERROR_MEMORY;
+	}
+	int result = resamplePlanar(&samples, in->header->SampleRate, rate,
+			&resampled);
+	freePlanar(&samples);
+	if (result == EXIT_FAILURE) {
+		return WAV_ERROR_MEMORY;
+	}
+	HEADER header = *in->header;
+	header.SampleRate = rate;
+	header.ByteRate = rate * header.BlockAlign;
+	if ((status = allocateWAV(out, &header, extensionOfWAV(in),
+			(unsigned long) resampled.frames * frameBytes(&header))) == WAV_OK) {
+		int channels = header.NumChannels, c;
+		float *planes[channels];
+		for (c = 0; c < channels; c++) {
+			planes[c] = planarChannel(&resampled, c);
+		}
+		encodeSamples(planes, resampled.frames, channels,
+				sampleFormatOf(&header), out->data->channel);
+	}
+	freePlanar(&resampled);
+	return status;
+}
+
+PUBLIC WAV_STATUS wav_channel_map(const WAV *in, const CHANNEL_MAP *map,
+		WAV *out) {
+	WAV_STATUS status = prepareOutput(out, in);
+	if (status != WAV_OK || (status = checkWAV(in)) != WAV_OK) {
+		return status;
+	}
+	if (map == NULL || map->inChannels != in->header->NumChannels) {
+		return WAV_ERROR_ARGUMENT;
+	}
+	HEADER header = *in->header;
+	int bytesPerSample = header.BlockAlign / header.NumChannels;
+	unsigned long frames = in->header->Subchunk2Size / frameBytes(in->header);
+	header.NumChannels = map->outChannels;
+	header.BlockAlign = map->outChannels * bytesPerSample;
+	header.ByteRate = header.SampleRate * header.BlockAlign;
+	FORMAT_EXTENSION extension = extensionOf(in);
+	extension.ChannelMask = map->outMask;
+	if (map->permutation) {
+		if ((status = allocateWAV(out, &header, &extension,
+				frames * header.BlockAlign))
+				== WAV_OK) {
+			mapFrames(map, in->data->channel, frames, bytesPerSample,
+					out->data->channel);
+		}
+		return status;
+	}
+	PLANAR samples, mapped;
+	if (decodePlanar(in, &samples) == EXIT_FAILURE) {
+		return WAV_ERROR_MEMORY;
+	}
+	if (createPlanar(&mapped, map->outChannels, samples.frames)
+			== EXIT_FAILURE) {
+		freePlanar(&samples);
+		return WAV_ERROR_MEMORY;
+	}
+	int c;
+	float *inPlanes[map->inChannels], *outPlanes[map->outChannels];
+	for (c = 0; c < map->inChannels; c++) {
+		inPlanes[c] = planarChannel(&samples, c);
+	}
+	for (c = 0; c < map->outChannels; c++) {
+		outPlanes[c] = planarChannel(&mapped, c);
+	}
+	mapChannels(map, inPlanes, samples.frames, outPlanes);
+	freePlanar(&samples);
+	if ((status = allocateWAV(out, &header, &extension,
+			(unsigned long) mapped.frames * header.BlockAlign)) == WAV_OK) {
+		encodeSamples(outPlanes, mapped.frames, map->outChannels,
+				sampleFormatOf(&header), out->data->channel);
+	}
+	freePlanar(&mapped);
+	return status;
+}
@@ -0,0 +1,256 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of the operations of wavelib on
+ *  WAV structs in memory. They are the operations of the commands without the
+ *  files: they don't print ,don't open files and don't make system calls ,and
+ *  they return a status which tells what went wrong. A program which embeds
+ *  the library reads a sound from its own memory or file descriptor ,runs the
+ *  operations on it and writes the result where it wants. The commands which
+ *  take filenames (mono ,mix ,chop ,reverse and merge) read the files ,call
+ *  these operations and write the output files.
+ *
+ *  An output WAV is a struct of the caller (on the stack too) ,whose header and
+ *  data are allocated by the operation. They are freed with wav_free. The
+ *  output is left empty (NULL header and data) when an operation fails.
+ */
+#ifndef WAVBUFFER_H
+#define WAVBUFFER_H
+
+#include "utilities.h"
+#include "planar.h"
+#include "channelMap.h"
+
+/**
+ * The status of an operation on WAV structs in memory
+ */
+typedef enum {
+	WAV_OK = 0,
+	WAV_ERROR_ARGUMENT, // a NULL pointer or an invalid argument
+	WAV_ERROR_MEMORY, // not enough memory
+	WAV_ERROR_FORMAT, // not a correct .wav
+	WAV_ERROR_CHANNELS, // the number of the channels isn't the one needed
+	WAV_ERROR_RANGE, // a time outside the sound
+	WAV_ERROR_MISMATCH, // two sounds with different formats
+	WAV_ERROR_SPACE, // an output too big for the buffer or for a .wav
+	WAV_ERROR_IO // a read or a write of a file descriptor failed
+} WAV_STATUS;
+
+/**
+ * @brief Describe a status of an operation
+ *
+ * 	@param status the status
+ * 	@return const char* a short description of the status
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC const char *wav_strerror(WAV_STATUS status);
+/**
+ * @brief Free the header and the data of a WAV
+ *
+ *	The WAV struct itself isn't freed ,its header and data become NULL. The
+ *	samples go back to the pool of the buffers for the next WAV.
+ *
+ * 	@param *wav the WAV or NULL
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC void wav_free(WAV *wav);
+/**
+ * @brief The number of the bytes of a WAV as a .wav file
+ *
+ * 	@param *wav the WAV
+ * 	@return size_t the size of the header and the data or 0 if there is no WAV
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC size_t wav_size(const WAV *wav);
+/**
+ * @brief Read a WAV from the bytes of a .wav file in memory
+ *
+ *	The chunks of the file are walked like readHeaderFd does. The data is copied ,so
+ *	the buffer can be freed after the call. Data missing at the end of a short
+ *	buffer is zero ,like the data missing from a short file.
+ *
+ * 	@param *buffer the bytes of the .wav file
+ * 	@param size the number of the bytes
+ * 	@param *wav the WAV to fill
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_read_memory(const byte *buffer, size_t size, WAV *wav);
+/**
+ * @brief Write a WAV as the bytes of a .wav file to memory
+ *
+ *	The header is written by formatHeader ,with the channel mask and the valid bits of
+ *	the WAV (see extensionOfWAV).
+ *
+ * 	@param *wav the WAV
+ * 	@param *buffer where the bytes are written
+ * 	@param size the number of the bytes of the buffer
+ * 	@param *written where the number of the bytes written (or needed ,if the
+ * 	       buffer is too small) is placed or NULL
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_write_memory(const WAV *wav, byte *buffer, size_t size,
+		size_t *written);
+/**
+ * @brief Read a WAV from a .wav file opened by the caller
+ *
+ *	The file is read with pread from its start ,so its position isn't changed and it
+ *	must be a file that can be read at any offset (not a pipe).
+ *
+ * 	@param fd the file descriptor
+ * 	@param *wav the WAV to fill
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_read_fd(int fd, WAV *wav);
+/**
+ * @brief Write a WAV as a .wav file to a file descriptor opened by the caller
+ *
+ *	The bytes are written at the position of the file descriptor ,so it can be a
+ *	pipe or a socket too. The header is written like wav_write_memory does.
+ *
+ * 	@param fd the file descriptor
+ * 	@param *wav the WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_write_fd(int fd, const WAV *wav);
+/**
+ * @brief Convert a stereo WAV to mono
+ *
+ *	The mono sound is the left channel of the stereo sound ,or the first channel of a
+ *	sound of more channels.
+ *
+ * 	@param *in the stereo WAV
+ * 	@param *out the mono WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_mono(const WAV *in, WAV *out);
+/**
+ * @brief Mix two WAVs in a stereo WAV
+ *
+ *	The left channel of the output is the left (or only) channel of the second
+ *	sound and its right channel is the right (or only) channel of the first
+ *	sound. The output is as long as the shorter sound. Two sounds of different
+ *	sample formats are mixed in the wider one (see widerSampleFormat) and two sounds
+ *	of different sample rates in the higher one ,the other sound is resampled.
+ *
+ * 	@param *first the first WAV
+ * 	@param *second the second WAV
+ * 	@param *out the mixed WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_mix(const WAV *first, const WAV *second, WAV *out);
+/**
+ * @brief Keep the part of a WAV between two times
+ *
+ * 	@param *in the WAV
+ * 	@param left the start of the part in seconds
+ * 	@param right the end of the part in seconds
+ * 	@param *out the part of the WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_chop(const WAV *in, int left, int right, WAV *out);
+/**
+ * @brief Reverse the frames of a WAV
+ *
+ * 	@param *in the WAV
+ * 	@param *out the reversed WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_reverse(const WAV *in, WAV *out);
+/**
+ * @brief Append a WAV to another one of the same channels
+ *
+ *	Two sounds of different sample formats are merged in the wider one (see
+ *	widerSampleFormat) and two sounds of different sample rates in the higher one
+ *	,the other sound is resampled.
+ *
+ * 	@param *first the first WAV
+ * 	@param *second the WAV appended
+ * 	@param *out the merged WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_merge(const WAV *first, const WAV *second, WAV *out);
+/**
+ * @brief Multiply the samples of a WAV by a gain
+ *
+ *	The samples are rounded and clipped like the gain of a pipeline.
+ *
+ * 	@param *in the WAV
+ * 	@param decibels the gain in dB
+ * 	@param *out the WAV with the gain
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_gain(const WAV *in, double decibels, WAV *out);
+/**
+ * @brief Convert the samples of a WAV to another sample format
+ *
+ *	The integer samples are rounded and clipped. With dither the samples which lose
+ *	bits get TPDF dither first.
+ *
+ * 	@param *in the WAV
+ * 	@param format the new sample format
+ * 	@param dither true to dither the samples which lose bits
+ * 	@param *out the converted WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_convert(const WAV *in, SAMPLE_FORMAT format, bool dither,
+		WAV *out);
+/**
+ * @brief Resample a WAV to another sample rate
+ *
+ *	The samples are filtered by a polyphase windowed sinc filter and kept in their
+ *	sample format.
+ *
+ * 	@param *in the WAV
+ * 	@param rate the new sample rate
+ * 	@param *out the resampled WAV
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_resample(const WAV *in, dword rate, WAV *out);
+/**
+ * @brief Map the channels of a WAV to new channels
+ *
+ *	A permutation copies the samples ,any other map is computed in float and the
+ *	samples are kept in their sample format.
+ *
+ * 	@param *in the WAV
+ * 	@param *map the channel map ,parsed for the channels of the WAV
+ * 	@param *out the WAV of the output channels
+ * 	@return WAV_STATUS WAV_OK or the error
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC WAV_STATUS wav_channel_map(const WAV *in, const CHANNEL_MAP *map,
+		WAV *out);
+
+#endif
@@ -25,16 +25,201 @@
  */
 int list(char *inFilename);
 
+/**
+ * @brief Displays one compact record for each of many .wav files
+ *
+ *  Implements the survey of many .wav files. The headers of the files are read with
+ *  pread on their RIFF chunk tables by a pool of worker threads and for each file one
+ *  record is written in the output ,in the order of the files. A record has
+ *  the name of the file ,its validity ,the audio format ,the number of channels ,the
+ *  sample rate ,the bits per sample ,the number of frames and the duration in seconds.
+ *
+ * 	@param *out where the records are written
+ * 	@param **fileNames the input filenames of the WAVs
+ * 	@param count the number of the filenames
+ * 	@param *format the format of the records: "csv", "json" or "ndjson"
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int survey(FILE *out, char **fileNames, int count, char *format);
+
+/**
+ * @brief Builds or refreshes the catalog of the .wav files of a directory tree
+ *
+ *  The catalog keeps the header fields ,the frames and the duration of every .wav
+ *  file of the tree in columns. A catalog of the same directory is refreshed: the
+ *  directories whose times didn't change are not read again and only the files whose
+ *  size ,times or inode changed are opened.
+ *
+ * 	@param *directory the root directory of the tree
+ * 	@param *catalogFile the filename of the catalog
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int buildCatalog(char *directory, char *catalogFile);
+
+/**
+ * @brief Validates many .wav files without reading their data
+ *
+ *  Reads the chunks of every file with pread and checks the chunk layout ,the format,
+ *  the BlockAlign and the ByteRate ,and the sizes of the RIFF and data chunks against
+ *  the length of the file. If probePages is not zero ,that many random pages of the
+ *  data of every file are also read. The files are checked by a pool of worker threads
+ *  and a line is written in the output for every file ,in the order of the files.
+ *
+ * 	@param *out where the lines are written
+ * 	@param **fileNames the input filenames of the WAVs
+ * 	@param count the number of the filenames
+ * 	@param probePages the number of the pages of the data to read from every file
+ * 	@return int Success if all the files are valid ,otherwise Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int validate(FILE *out, char **fileNames, int count, int probePages);
+
+/**
+ * @brief Runs a pipeline of operations on a .wav file
+ *
+ *  The operations are separated by '|' ,for example "chop 10 70 | mono | reverse". They
+ *  are chop l r (a range in seconds) ,mono (the left channel) ,gain db (a gain in dB)
+ *  ,reverse ,convert format [dither] (a sample format: u8 ,s16 ,s24 ,s32 or f32 ,with
+ *  TPDF dither if the samples lose bits) ,resample rate (a sample rate in Hz) and channels
+ *  map (a channel map ,see channelMap). The frames go through all the operations a block at
+ *  a time and only the output of the last one is written ,to the output file or to a file
+ *  named pipe-[sound].wav. Only the frames of the input which are in the output are read. The
+ *  filename "-" is the standard input or output ,which can be a pipe.
+ *
+ * 	@param *inFilename the input filename of the WAV
+ * 	@param *operations the pipeline of operations
+ * 	@param *outFilename the output filename ,"-" or NULL for pipe-[sound].wav (the standard
+ * 	output if the input is the standard input)
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int pipeline(char *inFilename, char *operations, char *outFilename);
+
+/**
+ * @brief Multiplies the samples of a .wav file by a gain
+ *
+ *  The samples are rounded and clipped. The output file is named gain-[sound].wav. The
+ *  filename "-" streams the standard input to the standard output.
+ *
+ * 	@param *inFilename the input filename of the WAV or "-"
+ * 	@param decibels the gain in dB
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int gain(char *inFilename, double decibels);
+
+/**
+ * @brief Converts the samples of a .wav file to another sample format
+ *
+ *  The formats are u8 ,s16 ,s24 (packed in 3 bytes) ,s32 and f32 (IEEE float). The integer
+ *  samples are rounded and clipped to the range of the new format. With dither the samples
+ *  which lose bits (to a narrower integer format or from float) get TPDF dither first. The
+ *  output file is named converted-[sound].wav. The filename "-" streams the standard input
+ *  to the standard output.
+ *
+ * 	@param *inFilename the input filename of the WAV or "-"
+ * 	@param *format the name of the new sample format
+ * 	@param dither true to dither the samples which lose bits
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int convert(char *inFilename, char *format, bool dither);
+
+/**
+ * @brief Resamples a .wav file to another sample rate
+ *
+ *  Every output sample is computed by a polyphase windowed sinc filter from the input
+ *  samples around its time ,so the sound keeps its duration and pitch. The sample format
+ *  is kept. The rate can be lowered by less than MAX_RESAMPLE_RATIO (256) times. The output
+ *  file is named resampled-[sound].wav. The filename "-" streams the standard input to the
+ *  standard output.
+ *
+ * 	@param *inFilename the input filename of the WAV or "-"
+ * 	@param rate the new sample rate in Hz
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int resample(char *inFilename, int rate);
+
+/**
+ * @brief Maps the channels of a .wav file to new channels
+ *
+ *  The output channels are separated by ',' and every one is an input channel or a sum of
+ *  them with gains: "2" extracts the third channel ,"1,0" swaps two channels and
+ *  "FL+0.707*FC,FR+0.707*FC" downmixes by the positions of the channels (FL ,FR ,FC ,LFE
+ *  ,BL ,BR ,SL ,SR ...) in the channel mask of the file. The presets "stereo" and "mono"
+ *  downmix any usual layout. A map which only picks channels copies the samples ,any other
+ *  is computed in float and rounded and clipped to the sample format. The output file is
+ *  named channels-[sound].wav. The filename "-" streams the standard input to the
+ *  standard output.
+ *
+ * 	@param *inFilename the input filename of the WAV or "-"
+ * 	@param *map the channel map
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int channelMap(char *inFilename, char *map);
+
+/**
+ * @brief Runs mono ,gain and mark operations on a live sound in fixed periods
+ *
+ *  The sound is read from the standard input a period of frames at a time ,as a streaming
+ *  .wav or as raw PCM of a given format ,and every period goes through the operations and
+ *  is written to the standard output before the next one is read (a .wav for a .wav input
+ *  ,raw PCM for a raw input). The operations are separated by '|': mono ,gain db and
+ *  mark text ,which hides the text in the lowest bits of the first channel in every period.
+ *  No memory is allocated after the first period. At the end the periods ,the xruns (the
+ *  periods processed and written slower than real time) ,the processing times and the
+ *  bound of the added latency are written to the standard error.
+ *
+ * 	@param *operations the operations
+ * 	@param periodFrames the number of the frames of a period
+ * 	@param rate the sample rate of a raw input or 0 for a .wav input
+ * 	@param channels the channels of a raw input
+ * 	@param bits the bits per sample of a raw input
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int live(char *operations, int periodFrames, int rate, int channels, int bits);
+
+/**
+ * @brief Writes the files of a catalog which pass a filter
+ *
+ *  The filter is a list of key=value separated by commas. The keys are rate, channels,
+ *  bits, format, valid (1 by default), mindur, maxdur (in seconds) and name (a shell
+ *  pattern on the path of the file in the tree).
+ *
+ * 	@param *out where the files are written
+ * 	@param *catalogFile the filename of the catalog
+ * 	@param *filter the filter or NULL for all the valid files
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int queryCatalog(FILE *out, char *catalogFile, char *filter);
+
 /**
  * @brief Convert a stereo to mono .wav file
  *
  *  Implements the mono method in .wav files that it receives as input. It takes as input a
  *  .wav file and checks if the file is a stereo audio file. Then it converts the stereo
- *  to mono by keeping only the left channel of the audio. It reduces the size of
- *  the audio file by half. It creates an output file that it has the form of
+ *  to mono by keeping only the left channel of the audio (the first channel of a file of
+ *  more channels). It reduces the size of the audio file by half. It creates an output file that it has the form of
  *  "new-" + filename + ".wav" and it saves it in the path folder of the input filename.
  *
- * 	@param *inFilename the input filename of the WAV
+ * 	@param *inFilename the input filename of the WAV or "-" to stream the standard input to
+ * 	the standard output
  * 	@return int Success or Failure
  *	@author Marios Pafitis
  * 	@bug No known bugs.
@@ -61,7 +246,12 @@ int mono(char *inFilename);
  * mix-<filename1>-<filename2>.wav
  * Also uses the method @see writeWAV(char*, WAV*) for writing the the sound tract
  * as a struct to a file and the method @see readWAV(char*, WAV**) for reading
- * the .wav files which their names where passed as arguments
+ * the .wav files which their names where passed as arguments.
+ * If one of the names is "-" ,the mix is streamed from the standard input to
+ * the standard output a block of samples at a time. Two soundtracks of different
+ * sample formats are mixed in the wider format ,the other one is converted on
+ * the fly ,and two soundtracks of different sample rates are mixed at the higher
+ * rate ,the other one is resampled.
  *
  * @param a pointer to a sequence of characters that is the name of the first
  *        .wav file to mix
@@ -75,6 +265,27 @@ int mono(char *inFilename);
  */
 int mix(char*, char*);
 
+/**
+ * @brief Mixes many .wav files down to a stereo .wav file
+ *
+ *  Every track is given as filename[:gain[:pan]] ,with the gain in dB and the pan
+ *  from -1 (left) to 1 (right). A mono track is panned with the constant power law
+ *  ,a stereo track is balanced and a track of more channels is downmixed to stereo
+ *  first. The tracks are summed in float a block at a time with SSE2 ,so the memory
+ *  doesn't depend on their length ,and the sums are limited to full scale. The
+ *  output has the widest sample format and the highest sample rate of the tracks
+ *  (the other ones are resampled) ,ends with the longest track and is named
+ *  mixdown-[first track].wav. If a track is "-" the standard input is mixed and the
+ *  mixdown is written to the standard output.
+ *
+ * 	@param **tracks the array of the tracks
+ * 	@param count the number of the tracks
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int mixdown(char **tracks, int count);
+
 /**
  * @brief Chops a .wav audio file
  *
@@ -86,7 +297,8 @@ int mix(char*, char*);
  *  It create an output file that it has the form of "chopped-" + filename + ".wav"
  *  and it saves it in the path folder of the input filename.
  *
- * 	@param *inFilename the input filename of the WAV
+ * 	@param *inFilename the input filename of the WAV or "-" to stream the standard input to
+ * 	the standard output
  * 	@param *l the starting second
  * 	@param *r the ending second
  * 	@return int Success or Failure
@@ -126,28 +338,74 @@ int reverse(char*);
  *  Implements the mono method in .wav files that it receives as input. It takes as input two
  *  .wav audio files. It checks the similarity between the two files based two methods. THe first
  *  method is the Euclidean Distance a method really fast but inaccurate. The other method is the
- *  LCSS Distance, a more accurate version but very slow. It works properly but it takes a lot of time.
+ *  LCSS Distance, a more accurate version but very slow. The files may have different
+ *  sample formats and sample rates ,they are compared at the lower rate. It works properly
+ *  but it takes a lot of time.
  *  There are other solving methods such as the LCSS which is using recursion but this one is even
  *  more slow. FInally, at the end the method represents the Euclidean Distance and the LCSS Distance.
+ *  In a long running process the distances of two files which didn't change are kept.
  *
+ * 	@param *out where the distances are written
  * 	@param *filename1 the input filename1 of the WAV
  * 	@param *filename2 the input filename2 of the WAV
  * 	@return int Success or Failure
  *	@author Marios Pafitis
  * 	@bug No known bugs.
  */
-int similarity(char *filename1, char* filename2);
+int similarity(FILE *out, char *filename1, char* filename2);
+
+/**
+ * @brief Calculates the similarity of all the pairs of many audio files
+ *
+ *  The distances (Euclidean and LCSS ,like similarity) of every pair of two files of the
+ *  list are written as one record for each pair in CSV ,JSON or NDJSON. The pairs are
+ *  calculated in square blocks of files by a pool of worker threads ,so every file is read
+ *  once for a block. With --shard i/N only the blocks of the shard are calculated ,and
+ *  the reports of the N shards are merged with mergeResults. A pair of files which can't
+ *  be compared has empty distances.
+ *
+ * 	@param *out where the records are written
+ * 	@param **fileNames the input filenames of the WAVs
+ * 	@param count the number of the filenames
+ * 	@param *format the format of the records: "csv", "json" or "ndjson"
+ * 	@return int Success or Failure
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+int similarityMatrix(FILE *out, char **fileNames, int count, char *format);
+
+/**
+ * @brief Merges the reports of the shards of a batch
+ *
+ *  The reports (of -list ,-similarity or any CSV ,JSON or NDJSON report with one record
+ *  in every line) are merged in one report. The records are sorted and a record found
+ *  twice is written once ,so the merged report doesn't depend on the number of the shards.
+ *  A report of pairs of files (of similarityMatrix) must have all the pairs of its files
+ *  ,otherwise the number of the missing pairs is displayed in the standard error.
+ *
+ * 	@param *out where the merged report is written
+ * 	@param *format the format of the reports: "csv", "json" or "ndjson"
+ * 	@param **inputFiles the filenames of the reports of the shards
+ * 	@param count the number of the reports
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int mergeResults(FILE *out, char *format, char **inputFiles, int count);
 
 /**
  * @brief This method encodes a message in soundtrack and saves it as a new soundtrack
  *
  * This method reads a soundtrack from a .wav file which its filename is passed
- * as an argument and also reads a sequence of characters(pointer to characters)
- * which indicates the content of the message.After these the message is
- * encrypted inside the soundtrack based on an algorythm and also on a secret
- * key ,which key is encapsulated inside the code.  After creating the
- * sountrack with the encoded message inside , the new soundtrack (struct) is
- * stored to a file .wav with a new file name.
+ * as an argument and also reads the file which contains the message to hide.
+ * The message can be any sequence of bytes (text or binary) and it is read and
+ * hidden block by block. After these the message is encrypted inside the
+ * soundtrack based on an algorythm and also on a secret key ,which key is
+ * encapsulated inside the code. A small header with the length of the message
+ * and its CRC-32 is hidden in front of it ,so the message can be decoded
+ * without knowing its length. After creating the sountrack with the encoded
+ * message inside , the new soundtrack (struct) is stored to a file .wav with a
+ * new file name.
  *
  * This method uses @see createOutputFilename(char*, char*,char**)
  * for creating the output fileName .It creates the new .wav file with name
@@ -159,8 +417,8 @@ int similarity(char *filename1, char* filename2);
  * @param a pointer to a sequence of characters that is the name of the
  *        .wav file to encode inside a message
  *
- * @param a pointer to a sequence of characters that is the message to be encoded
- *        -stored inside the soundtrack
+ * @param a pointer to a sequence of characters that is the name of the file
+ *        which contains the message to be encoded-stored inside the soundtrack
  *
  * @return EXIT_SUCCESSif the encoding was executed succesfully or EXIT_FAILURE if
  *         there was a problem during the execution of the method
@@ -170,35 +428,114 @@ int similarity(char *filename1, char* filename2);
 int encodeText(char*, char*);
 
 /**
- * @brief This method decodes a message from a soundtrack and saves it in a text file
+ * @brief This method encodes a message in soundtrack using k least significant
+ *        bits per sample and saves it as a new soundtrack
+ *
+ * This method is the same as @see encodeText(char*, char*) but it hides k
+ * bits of the message in every sample it touches instead of one ,so the
+ * soundtrack can keep a message k times longer and k times fewer samples are
+ * touched for every byte of the message. The more bits per sample the louder
+ * the noise added to the soundtrack. The number k is hidden in the header of
+ * the message ,so @see decodeText(char*, char*) finds it by itself.
+ *
+ * @param a pointer to a sequence of characters that is the name of the
+ *        .wav file to encode inside a message
+ *
+ * @param a pointer to a sequence of characters that is the name of the file
+ *        which contains the message to be encoded-stored inside the soundtrack
+ *
+ * @param the number of least significant bits per sample used (1 to 4)
+ *
+ * @return EXIT_SUCCESSif the encoding was executed succesfully or EXIT_FAILURE if
+ *         there was a problem during the execution of the method
+ *
+ * @author Valentinos Pariza
+ */
+int encodeTextBits(char*, char*, int);
+
+/**
+ * @brief This method encodes one message in many soundtracks
+ *
+ * This method gives the same new-<filename>.wav files as calling
+ * @see encodeTextBits(char*, char*, int) for every soundtrack ,but the
+ * message is read once ,and the bytes to change are computed once for every
+ * shape of soundtrack (size of data and bits per sample) and shared by a
+ * pool of worker threads. Every soundtrack is copied with copy_file_range and
+ * only the bytes which hide the message are changed in the copy ,so the cost
+ * of a soundtrack is little more than the cost of a copy of its file.
+ *
+ * @param a pointer to a sequence of names of .wav files to encode inside the
+ *        message
+ *
+ * @param the number of the .wav files
+ *
+ * @param a pointer to a sequence of characters that is the name of the file
+ *        which contains the message to be encoded-stored inside the soundtracks
+ *
+ * @param the number of least significant bits per sample used (1 to 4)
+ *
+ * @return EXIT_SUCCESS if all the soundtracks were encoded succesfully or
+ *         EXIT_FAILURE if there was a problem with any of them
+ *
+ * @author Valentinos Pariza
+ */
+int encodeTextBatch(char**, int, char*, int);
+
+/**
+ * @brief This method decodes a message from a soundtrack and saves it in a file
  *
  * This method reads a sound track from a .wav file which its filename is passed
- * as an argument and also reads an integer which is the length of the string to
- * decode and also a pointer to characters which is the name of the text file to
- * write inside the decoded string.It reads the .wav file ,applies an algorithm
- * for decoding ,based on a secret key (which is encapsulated inside the code)
- * and after gaining the message from the sound track , it writes the message to
- * a text file , which name is passed as an argument.
- *
- * Also uses the method @see writeWAV(char*, WAV*) for writing the  sound tract
- * as a struct to a file and the method @see readWAV(char*, WAV**) for reading
+ * as an argument and also a pointer to characters which is the name of the
+ * file to write inside the decoded message.It reads the .wav file ,applies an
+ * algorithm for decoding ,based on a secret key (which is encapsulated inside
+ * the code). It first decodes the header hidden by
+ * @see encodeText(char*, char*) ,which tells the length of the message ,and
+ * then decodes exactly that many bytes, writing them to the file which name is
+ * passed as an argument. The CRC-32 of the message is checked against the one
+ * of the header ,and the file is removed if the message isn't found or is
+ * corrupted.
+ *
+ * Also uses the method @see readWAV(char*, WAV**) for reading
  * the .wav file which its name is passed as an argument
  *
  * @param a pointer to a sequence of characters that is the name of the
  *        .wav file , which contains an encoded message
  *
- * @param an integer which is the length of the string to be decoded from the
- *        sound tract ,without including the NUL (='\0') character
- *
- * @param a pointer to a sequence of characters that is the name of the text file
+ * @param a pointer to a sequence of characters that is the name of the file
  *        to be written inside the message which is derived from the sound track
  *
  * @return EXIT_SUCCESS if the decoding was executed successfully or EXIT_FAILURE if
- *         there was a problem during the execution of the method
+ *         there was a problem during the execution of the method (no message
+ *         found or the message is corrupted)
  *
  * @author Valentinos Pariza
  */
-int decodeText(char*, int, char*);
+int decodeText(char*, char*);
+
+/**
+ * @brief This method checks all the soundtracks of a directory for hidden
+ *        messages and writes a CSV report
+ *
+ * This method finds the .wav files of a directory and checks them with a pool
+ * of worker threads. From every file it reads ,with pread ,only the pages
+ * which contain the samples of the header of a message hidden by
+ * @see encodeText(char*, char*) and then the pages of the message itself.
+ * For every file it writes a line with the name of the file ,the status of
+ * the check (ok ,crc-mismatch ,no-payload ,invalid-wav or unreadable) ,the
+ * bits per sample ,the length ,the CRC-32 and the message.
+ *
+ * @param a pointer to a sequence of characters that is the name of the
+ *        directory to check
+ *
+ * @param a pointer to a sequence of characters that is the name of the CSV
+ *        file to write ,or NULL or "-" for the standard output
+ *
+ * @return EXIT_SUCCESS if the directory was checked or EXIT_FAILURE if there
+ *         was a problem with the directory or the CSV file
+ *
+ * @author Valentinos Pariza
+ */
+int scanText(char*, char*);
 
 /**
  * @brief Merge two .wav audio files
@@ -206,7 +543,9 @@ int decodeText(char*, int, char*);
  *  Implements the merge method in .wav files that it receives as input. It takes as input two
  *  .wav files and merge the second one at the end of the first one. It create an
  *  output file that it has the form of "merge-" + filename1 "-" filename2 ".wav"
- *  and it saves it in the path folder of the first input file.
+ *  and it saves it in the path folder of the first input file. Two files of different
+ *  sample formats are merged in the wider format and two files of different sample rates
+ *  at the higher rate.
  *
  * 	@param *filename1 the input filename1 of the WAV
  * 	@param *filename2 the input filename2 of the WAV
@@ -216,6 +555,96 @@ int decodeText(char*, int, char*);
  */
 int merge(char*filename1, char*filename2);
 
+/**
+ * @brief Runs a pipeline on every .wav file which arrives in a directory
+ *
+ *  The directory is watched with inotify for files closed after writing or moved in ,and
+ *  every new or changed .wav file is given to a bounded pool of worker threads which runs
+ *  the pipeline on it (see pipeline) ,creating pipe-[sound].wav. Every finished file is
+ *  appended to a journal ,so the files which were processed (even before a restart) aren't
+ *  processed again. At the start the files which arrived while nothing watched are
+ *  processed. The watch runs until SIGINT or SIGTERM.
+ *
+ * 	@param *directory the watched directory
+ * 	@param *operations the pipeline of operations
+ * 	@param *journalFile the filename of the journal or NULL for .wavengine-journal in the
+ * 	directory
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int watch(char *directory, char *operations, char *journalFile);
+
+/**
+ * A function which runs a command of wavengine ,given like the arguments of main ,and writes
+ * its report to out. It returns the exit status of the command.
+ */
+typedef int (*COMMAND_FUNCTION)(FILE *out, int argc, char **argv);
+
+/**
+ * @brief Runs a command on every file of a directory tree
+ *
+ *  The tree is walked in parallel without following symbolic links and every file found
+ *  is given at once to a pool of worker threads which runs the command on it ,so the files
+ *  are processed while the tree is still being read. Every argument {} of the command is
+ *  replaced by the path of the file ,or the path is added at the end of the command. A
+ *  pattern with a '/' is matched against the path of a file in the tree ,any other pattern
+ *  against its name. An excluded directory isn't read. A report (-list or -similarity with
+ *  -csv ,-json or -ndjson) runs once on all the files of the tree ,sorted ,so it writes one
+ *  report.
+ *
+ * 	@param *directory the directory at the root of the tree
+ * 	@param **includes the patterns of the files processed ,all the .wav files if there are
+ * 	none
+ * 	@param numberOfIncludes the number of the include patterns
+ * 	@param **excludes the patterns of the files and the directories skipped
+ * 	@param numberOfExcludes the number of the exclude patterns
+ * 	@param run the function which runs the command
+ * 	@param argc the number of the arguments of the command
+ * 	@param **argv the arguments of the command ,starting from its option
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int forEachFile(char *directory, char **includes, int numberOfIncludes,
+		char **excludes, int numberOfExcludes, COMMAND_FUNCTION run, int argc,
+		char **argv);
+
+/**
+ * @brief Runs a server of the commands of wavengine on a Unix domain socket
+ *
+ *  The server starts once and serves the commands of its clients with a pool of worker
+ *  threads ,keeping the headers ,the mapped files and the features (the distances of
+ *  similarity) of the files in caches between the commands. An entry of a cache is used
+ *  only while its file is unchanged. The reports and the messages of the commands are sent
+ *  to the client with their exit status. The commands -stats (the statistics of the caches)
+ *  and -shutdown (stop the server) are answered by the server itself. The commands which
+ *  need the standard input ,the signals or the process of the server (-live ,-watch ,-serve
+ *  ,-client ,-gpl and the filename -) are refused. SIGINT and SIGTERM stop the server too.
+ *
+ * 	@param *socketPath the filename of the socket
+ * 	@param run the function which runs the commands
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int serve(char *socketPath, COMMAND_FUNCTION run);
+
+/**
+ * @brief Runs a command on a server started by serve
+ *
+ *  The arguments which are files of the client ,or new files in its directories ,are sent
+ *  with their full paths. The output of the command is written to the standard output.
+ *
+ * 	@param *socketPath the filename of the socket of the server
+ * 	@param argc the number of the arguments of the command
+ * 	@param **argv the arguments of the command ,starting from its option
+ * 	@return int the exit status of the command ,or Failure if the server can't be reached
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+int client(char *socketPath, int argc, char **argv);
+
 /**
  * @brief prints the GPL
  *
@@ -14,7 +14,9 @@
  *
  *  The option could be:
  *  1.	-list :
- *  	Displays the Header segment for each sound.wav file
+ *  	Displays the Header segment for each sound.wav file. With -list -csv, -list -json or
+ *  	-list -ndjson it displays one compact record for each file (duration, frames, format and
+ *  	validity), reading the headers of the files in parallel.
  *  2.	-mono :
  *  	Converts a Stereo sound.wav into Mono. It keeps only the left channel of the original sound.
  *  	It creates an output file named new-[sound].wav.
@@ -31,13 +33,84 @@
  *		the Euclidean Distance method and the LCSS Distance method. It displays the two distances.
  *	7.	-encodeText
  *		Encodes a text into a sound.wav in a way that you will not spot any difference and creates an
- *		output file named new-[sound].wav.
+ *		output file named new-[sound].wav. With -encodeText -bits k ... it hides k (1 to 4) bits in
+ *		every sample it touches ,for k times more capacity.
  *	8.	-decodeText
  *		Decodes a sound.wav that it has been encoded by using the method encodeText and recovers the
- *		text to the output file.
+ *		text to the output file. The length of the text is found from the header hidden with it.
  *	9.	-merge
  *		Merges two sound.wav audio files. It adds the second audio file at the end of the first one
  *		and creates an output file named merge-[sound1]-[sound2].wav.
+ *	10.	-scanText
+ *		Checks every sound.wav of a directory for a text hidden by encodeText and writes a CSV report
+ *		(./wavengine -scanText directory [report.csv]).
+ *	11.	-catalog
+ *		Builds or refreshes the catalog of the .wav files of a directory tree
+ *		(./wavengine -catalog directory catalog.wvc) and displays the files of a catalog which pass a
+ *		filter (./wavengine -query catalog.wvc "rate=48000,channels=2,mindur=3600").
+ *	12.	-validate
+ *		Checks the headers of sound.wav files against each other and the length of the files without
+ *		reading their data. With -validate -probe n ... it also reads n random pages of every data.
+ *	13.	-pipe
+ *		Runs a pipeline of operations on sound.wav files in a single pass without intermediate files
+ *		(./wavengine -pipe "chop 10 70 | mono | reverse" sound.wav) and creates an output file named
+ *		pipe-[sound].wav. With a last argument - the output is written to the standard output.
+ *	14.	-gain
+ *		Multiplies the samples of sound.wav files by a gain in dB (./wavengine -gain -6 sound.wav)
+ *		and creates an output file named gain-[sound].wav.
+ *	15.	-serve
+ *		Runs a server on a Unix domain socket (./wavengine -serve /tmp/wavengine.sock) which keeps
+ *		the headers ,the mapped files and the distances of the files in caches between commands.
+ *	16.	-client
+ *		Runs a command on a server and displays its output (./wavengine -client /tmp/wavengine.sock
+ *		-list -csv sound.wav). The commands -stats and -shutdown display the statistics of the
+ *		caches and stop the server.
+ *	17.	-watch
+ *		Runs a pipeline on every sound.wav which arrives in a directory until it is stopped
+ *		(./wavengine -watch directory "mono" [journal]) and creates pipe-[sound].wav files. The
+ *		finished files are kept in a journal and aren't processed again.
+ *	18.	-tree
+ *		Runs a command on every sound.wav of a directory tree ,walking the tree in parallel and
+ *		processing the files while it is walked (./wavengine -tree directory -exclude "pipe-*"
+ *		-mono {}). The options -include pattern and -exclude pattern select the files ,{} is
+ *		replaced by the path of every file. A report (-list or -similarity with -csv ,-json or
+ *		-ndjson) runs once on all the files ,so it writes one report.
+ *	19.	-mergeResults
+ *		Merges the CSV ,JSON or NDJSON reports of the shards of a batch in one sorted report
+ *		(./wavengine -mergeResults csv shard0.csv shard1.csv > all.csv).
+ *	20.	-live
+ *		Runs mono ,gain and mark operations on a live sound from the standard input to the standard
+ *		output in fixed periods (./wavengine -live "mono | gain -3 | mark station" [-period 256]
+ *		[-raw 48000 2 16] < feed.wav > out.wav) and reports the xruns and the processing times.
+ *	21.	-convert
+ *		Converts the samples of sound.wav files to another sample format (u8 ,s16 ,s24 ,s32 or f32)
+ *		(./wavengine -convert s16 -dither sound.wav) and creates an output file named
+ *		converted-[sound].wav. With -dither the samples which lose bits get TPDF dither.
+ *	22.	-resample
+ *		Resamples sound.wav files to another sample rate with a polyphase windowed sinc filter
+ *		(./wavengine -resample 48000 sound.wav) and creates an output file named
+ *		resampled-[sound].wav.
+ *	23.	-channels
+ *		Maps the channels of sound.wav files to new channels ,extracting ,reordering or
+ *		downmixing them (./wavengine -channels "FL+0.707*FC,FR+0.707*FC" sound.wav or
+ *		./wavengine -channels stereo sound.wav) and creates an output file named
+ *		channels-[sound].wav.
+ *	24.	-mixdown
+ *		Mixes many sound.wav files down to a stereo file ,summing them with a gain in dB and a
+ *		pan from -1 to 1 for every track (./wavengine -mixdown drums.wav bass.wav:-3
+ *		vocals.wav:-6:0.2) and creates an output file named mixdown-[sound].wav ,named after
+ *		the first track. The tracks are streamed ,so the memory doesn't depend on their length.
+ *
+ *	With --shard i/N before the option only the files of the shard i of N are processed ,so N
+ *	processes (./wavengine --shard 0/2 ... and ./wavengine --shard 1/2 ...) split a batch
+ *	without a list of the files of each one. A file belongs to a shard by a hash of its name
+ *	(its path in the tree for -tree). With -similarity -csv|-json|-ndjson sound.wav ... the
+ *	similarity of all the pairs of the files is calculated ,sharded by blocks of pairs.
+ *
+ *	The filename - is the standard input for -mono ,-mix ,-mixdown ,-chop ,-gain ,-convert
+ *	,-resample ,-channels and -pipe ,and then the output is written to the standard output
+ *	(./wavengine -mono - < in.wav > out.wav). If the length of the input isn't known the output has a
+ *	streaming header ,which is corrected at the end if the output can be seeked.
  *
  *	This system supports options for multiple input files. If you give the string *.wav as input
  *	filename for the option -list, -mono, -chop, -reverse, -endoceText and -merge it will execute
@@ -48,6 +121,7 @@
  *  @bugs No known bugs
  */
 #include "wavelib.h"
+#include "shard.h"
 
 #include <sys/types.h>
 #include <dirent.h>
@@ -59,7 +133,14 @@
 #define PATHSEPERATOR '/'
 #endif
 
-int main(int argc, char** argv) {
+/**
+ * @brief Prints the short GPL notice of the program
+ *
+ * 	@return void
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE void printBanner() {
 	printf(
 			"\nProgram: wavengine Copyright (C) 2018 Marios Pafitis & Valentinos Pariza\n");
 	printf("This program comes with ABSOLUTELY NO WARRANTY;\n");
@@ -69,30 +150,163 @@ int main(int argc, char** argv) {
 	printf(
 			"If you want to see more information about the Copyrights of this program\n");
 	printf("Run it again with the option command ./wavengine -gpl\n\n");
+}
+
+/**
+ * @brief Checks whether a command writes a machine-readable report to the standard output
+ *
+ * 	@param argc the number of the arguments
+ * 	@param **argv the arguments
+ * 	@return bool true if the notice must not be printed
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE bool isMachineReadable(int argc, char** argv) {
+	if (argc >= 3 && strcmp(argv[1], "-list") == 0
+			&& (strcmp(argv[2], "-csv") == 0 || strcmp(argv[2], "-json") == 0
+					|| strcmp(argv[2], "-ndjson") == 0)) {
+		return true;
+	}
+	if (argc == 3 && strcmp(argv[1], "-scanText") == 0) {
+		return true;
+	}
+	if (argc >= 3 && strcmp(argv[1], "-similarity") == 0
+			&& (strcmp(argv[2], "-csv") == 0 || strcmp(argv[2], "-json") == 0
+					|| strcmp(argv[2], "-ndjson") == 0)) {
+		return true;
+	}
+	if (argc >= 3 && strcmp(argv[1], "-mergeResults") == 0) {
+		return true;
+	}
+	if (argc >= 3 && strcmp(argv[1], "-live") == 0) {
+		return true;
+	}
+	if (argc >= 3 && strcmp(argv[1], "-query") == 0) {
+		return true;
+	}
+	if (argc >= 4 && strcmp(argv[1], "-client") == 0) {
+		return true;
+	}
+	if (argc >= 4 && strcmp(argv[1], "-tree") == 0) {
+		// the command after the patterns ,its argv[0] is the last pattern
+		int first = 3;
+		while (first + 1 < argc
+				&& (strcmp(argv[first], "-include") == 0
+						|| strcmp(argv[first], "-exclude") == 0)) {
+			first += 2;
+		}
+		return isMachineReadable(argc - first + 1, &argv[first - 1]);
+	}
+	// a .wav or a report written to the standard output
 	int i;
+	for (i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "-") == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Keeps only the files of a command which belong to the shard of the process
+ *
+ *	The files of the commands which process a list of files are sharded by their names. The
+ *	other arguments stay in their places.
+ *
+ * 	@param argc the number of the arguments
+ * 	@param **argv the arguments
+ * 	@return int the number of the arguments kept
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE int shardCommand(int argc, char** argv) {
+	int first = 2, last = argc; // the files are from first to last - 1
+	if (argc < 3) {
+		return argc;
+	}
+	if (strcmp(argv[1], "-list") == 0 && argv[2][0] == '-'
+			&& argv[2][1] != '\0') {
+		first = 3;
+	} else if (strcmp(argv[1], "-list") == 0 || strcmp(argv[1], "-mono") == 0
+			|| strcmp(argv[1], "-reverse") == 0) {
+		first = 2;
+	} else if (strcmp(argv[1], "-chop") == 0) {
+		last = argc - 2;
+	} else if (strcmp(argv[1], "-validate") == 0) {
+		first = (argc > 4 && strcmp(argv[2], "-probe") == 0) ? 4 : 2;
+	} else if ((strcmp(argv[1], "-pipe") == 0
+			&& !(argc == 5 && strcmp(argv[4], "-") == 0))
+			|| strcmp(argv[1], "-gain") == 0
+			|| strcmp(argv[1], "-resample") == 0
+			|| strcmp(argv[1], "-channels") == 0) {
+		first = 3;
+	} else if (strcmp(argv[1], "-convert") == 0) {
+		first = (argc > 3 && strcmp(argv[3], "-dither") == 0) ? 4 : 3;
+	} else {
+		return argc;
+	}
+	if (last <= first) {
+		return argc;
+	}
+	int kept = shardFiles(&argv[first], last - first);
+	// the arguments after the files and the NULL at the end
+	memmove(&argv[first + kept], &argv[last],
+			sizeof(char *) * (argc - last + 1));
+	return argc - (last - first - kept);
+}
+
+/**
+ * @brief Runs a command of wavengine
+ *
+ *	The reports and the messages of the commands are written to out. This function runs the
+ *	commands of the command line and the commands of the clients of a server.
+ *
+ * 	@param *out where the reports are written
+ * 	@param argc the number of the arguments
+ * 	@param **argv the arguments
+ * 	@return int the exit status of the command
+ *	@author Marios Pafitis
+ * 	@bug No known bugs.
+ */
+PRIVATE int runCommand(FILE *out, int argc, char** argv) {
+	int i, result = EXIT_SUCCESS;
+	// the messages of the functions of the commands go to out too
+	FILE *previous = commandOutput();
+	setCommandOutput(out);
 	if (argc == 2 && strcmp(argv[1], "-gpl") == 0) {
 		printGPL();
 	} else if (argc < 3) {
-		printf("\nWrong command format.\n\n");
+		fprintf(out, "\nWrong command format.\n\n");
+		result = EXIT_FAILURE;
 	} else {
-		if (strcmp(argv[1], "-list") == 0) { // 1: -list
+		if (strcmp(argv[1], "-list") == 0 && argv[2][0] == '-'
+				&& argv[2][1] != '\0') { // 1: -list -csv|-json|-ndjson
+			if (survey(out, &argv[3], argc - 3, &argv[2][1]) == EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+				//printf("\nWrong format.\n\n");
+			}
+		} else if (strcmp(argv[1], "-list") == 0) { // 1: -list
 			for (i = 2; i < argc; i++) {
 				if (list(argv[i]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					//printf("\nThis is not a compatible .wav audio file.\n\n");
 				}
 			}
 		} else if (strcmp(argv[1], "-mono") == 0) { // 2: -mono
 			for (i = 2; i < argc; i++) {
 				if (mono(argv[i]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					// printf("\nThis is not a compatible .wav audio file.\n\n");
 				}
 			}
 		} else if (strcmp(argv[1], "-mix") == 0) { // 3: -mix
 			if (argc != 4) {
-				printf(
+				fprintf(out,
 						"\nWrong command format. Give two audio files as input\n\n");
+				result = EXIT_FAILURE;
 			} else {
 				if (mix(argv[2], argv[3]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					//printf("\nThis is not a compatible .wav audio file.\n\n");
 				}
 			}
@@ -101,54 +315,277 @@ int main(int argc, char** argv) {
 			int r = atoi(argv[argc - 1]);
 			for (i = 2; i < argc - 2; i++) {
 				if (chop(argv[i], l, r) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					//printf("\nThis is not a compatible .wav audio file.\n\n");
 				}
 			}
 		} else if (strcmp(argv[1], "-reverse") == 0) { // 5: -reverse
 			for (i = 2; i < argc; i++) {
 				if (reverse(argv[i]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					//("\nThis is not a compatible .wav audio file.\n\n");
 				}
 			}
+		} else if (strcmp(argv[1], "-similarity") == 0 && argv[2][0] == '-'
+				&& argv[2][1] != '\0') { // 6: -similarity -csv|-json|-ndjson
+			if (similarityMatrix(out, &argv[3], argc - 3,
+					&argv[2][1]) == EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+				//printf("\nWrong format.\n\n");
+			}
 		} else if (strcmp(argv[1], "-similarity") == 0) { // 6: -similarity
 			if (argc != 4) {
-				printf(
+				fprintf(out,
 						"\nWrong command format. Give two audio files as input\n\n");
+				result = EXIT_FAILURE;
 			} else {
-				if (similarity(argv[2], argv[3]) == EXIT_FAILURE) {
+				if (similarity(out, argv[2], argv[3]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					//printf("\nThis is not a compatible .wav audio file.\n\n");
 				}
 			}
 		} else if (strcmp(argv[1], "-encodeText") == 0) { // 7: -encodeText
-			for (i = 2; i < argc; i++) {
-				if (encodeText(argv[i], argv[argc - 1]) == EXIT_FAILURE) {
+			int first = 2;
+			long bits = 1;
+			char *end = "";
+			if (argc > 3 && strcmp(argv[2], "-bits") == 0) {
+				bits = strtol(argv[3], &end, 10);
+				first = 4;
+			}
+			// the last argument is the message ,all the others are audio files
+			if (*end != '\0' || bits < 1 || bits > 4 || argc - 1 - first < 1) {
+				fprintf(out,
+						"\nWrong command format. Give -bits 1 to 4 ,audio files and a message as input\n\n");
+				result = EXIT_FAILURE;
+			} else if (encodeTextBatch(&argv[first], argc - 1 - first,
+					argv[argc - 1], (int) bits) == EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+				//printf("\nThis is not a compatible .wav audio file.\n\n");
+			}
+		} else if (strcmp(argv[1], "-decodeText") == 0) { // 8: -decodeText
+			if (argc != 4 && argc != 5) {
+				fprintf(out,
+						"\nWrong command format. Give an audio file and an output.txt as input\n\n");
+				result = EXIT_FAILURE;
+			} else {
+				// the old form with the length of the message is still accepted
+				// ,the length is read from the header hidden in the audio file
+				if (decodeText(argv[2], argv[argc - 1]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					fprintf(out, "\nThis is not a compatible .wav audio file.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-scanText") == 0) { // 10: -scanText
+			if (argc != 3 && argc != 4) {
+				fprintf(out,
+						"\nWrong command format. Give a directory and optionally a report.csv as input\n\n");
+				result = EXIT_FAILURE;
+			} else {
+				if (scanText(argv[2], (argc == 4) ? argv[3] : NULL) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a directory.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-catalog") == 0) { // 11: -catalog
+			if (argc != 4) {
+				fprintf(out,
+						"\nWrong command format. Give a directory and a catalog file as input\n\n");
+				result = EXIT_FAILURE;
+			} else {
+				if (buildCatalog(argv[2], argv[3]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a directory.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-query") == 0) { // 11: -query
+			if (argc != 3 && argc != 4) {
+				fprintf(out,
+						"\nWrong command format. Give a catalog file and optionally a filter as input\n\n");
+				result = EXIT_FAILURE;
+			} else {
+				if (queryCatalog(out, argv[2], (argc == 4) ? argv[3] : NULL)
+						== EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a catalog.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-validate") == 0) { // 12: -validate
+			int first = 2, pages = 0;
+			if (argc > 4 && strcmp(argv[2], "-probe") == 0) {
+				pages = atoi(argv[3]);
+				first = 4;
+			}
+			if (validate(out, &argv[first], argc - first, pages) == EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+				//printf("\nThis is not a compatible .wav audio file.\n\n");
+			}
+		} else if (strcmp(argv[1], "-pipe") == 0) { // 13: -pipe
+			if (argc < 4) {
+				fprintf(out,
+						"\nWrong command format. Give a pipeline and audio files as input\n\n");
+				result = EXIT_FAILURE;
+			}
+			if (argc == 5 && strcmp(argv[4], "-") == 0) {
+				// a single input written to the standard output
+				if (pipeline(argv[3], argv[2], "-") == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					//printf("\nThis is not a compatible .wav audio file.\n\n");
 				}
+			} else {
+				for (i = 3; i < argc; i++) {
+					if (pipeline(argv[i], argv[2], NULL) == EXIT_FAILURE) {
+						result = EXIT_FAILURE;
+						//printf("\nThis is not a compatible .wav audio file.\n\n");
+					}
+				}
 			}
-		} else if (strcmp(argv[1], "-decodeText") == 0) { // 8: -decodeText
-			if (argc != 5) {
-				printf(
-						"\nWrong command format. Give an audio file a message length and an output.txt as input\n\n");
+		} else if (strcmp(argv[1], "-gain") == 0) { // 14: -gain
+			double decibels = atof(argv[2]);
+			for (i = 3; i < argc; i++) {
+				if (gain(argv[i], decibels) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a compatible .wav audio file.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-convert") == 0) { // 21: -convert
+			bool dither = argc > 3 && strcmp(argv[3], "-dither") == 0;
+			for (i = dither ? 4 : 3; i < argc; i++) {
+				if (convert(argv[i], argv[2], dither) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a compatible .wav audio file.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-resample") == 0) { // 22: -resample
+			int rate = atoi(argv[2]);
+			for (i = 3; i < argc; i++) {
+				if (resample(argv[i], rate) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a compatible .wav audio file.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-channels") == 0) { // 23: -channels
+			for (i = 3; i < argc; i++) {
+				if (channelMap(argv[i], argv[2]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a compatible .wav audio file.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-watch") == 0) { // 17: -watch
+			if (argc != 4 && argc != 5) {
+				fprintf(out,
+						"\nWrong command format. Give a directory ,a pipeline and optionally a journal as input\n\n");
+				result = EXIT_FAILURE;
 			} else {
-				int msgLength = atoi(argv[3]);
-				if (decodeText(argv[2], msgLength, argv[4]) == EXIT_FAILURE) {
-					printf("\nThis is not a compatible .wav audio file.\n\n");
+				if (watch(argv[2], argv[3], (argc == 5) ? argv[4] : NULL)
+						== EXIT_FAILURE) {
+					result = EXIT_FAILURE;
+					//printf("\nThis is not a directory.\n\n");
+				}
+			}
+		} else if (strcmp(argv[1], "-tree") == 0) { // 18: -tree
+			char **includes = (char **) malloc(sizeof(char *) * argc);
+			char **excludes = (char **) malloc(sizeof(char *) * argc);
+			int numberOfIncludes = 0, numberOfExcludes = 0;
+			for (i = 3; includes != NULL && excludes != NULL && i + 1 < argc;
+					i += 2) {
+				if (strcmp(argv[i], "-include") == 0) {
+					includes[numberOfIncludes++] = argv[i + 1];
+				} else if (strcmp(argv[i], "-exclude") == 0) {
+					excludes[numberOfExcludes++] = argv[i + 1];
+				} else {
+					break;
+				}
+			}
+			if (includes == NULL || excludes == NULL || i >= argc) {
+				fprintf(out,
+						"\nWrong command format. Give a directory ,the patterns and a command as input\n\n");
+				result = EXIT_FAILURE;
+			} else if (forEachFile(argv[2], includes, numberOfIncludes, excludes,
+					numberOfExcludes, runCommand, argc - i, &argv[i])
+					== EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+				//printf("\nThis is not a directory.\n\n");
+			}
+			free(includes);
+			free(excludes);
+		} else if (strcmp(argv[1], "-mergeResults") == 0) { // 19: -mergeResults
+			if (argc < 4) {
+				fprintf(out,
+						"\nWrong command format. Give a format and the reports of the shards as input\n\n");
+				result = EXIT_FAILURE;
+			} else if (mergeResults(out, argv[2], &argv[3], argc - 3)
+					== EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+				//printf("\nThese are not reports.\n\n");
+			}
+		} else if (strcmp(argv[1], "-live") == 0) { // 20: -live
+			int periodFrames = 256, rate = 0, channels = 0, bits = 0;
+			bool correct = true;
+			for (i = 3; correct && i < argc; i++) {
+				if (strcmp(argv[i], "-period") == 0 && i + 1 < argc) {
+					periodFrames = atoi(argv[++i]);
+				} else if (strcmp(argv[i], "-raw") == 0 && i + 3 < argc) {
+					rate = atoi(argv[i + 1]);
+					channels = atoi(argv[i + 2]);
+					bits = atoi(argv[i + 3]);
+					correct = rate > 0;
+					i += 3;
+				} else {
+					correct = false;
 				}
 			}
+			if (!correct || periodFrames <= 0) {
+				fprintf(stderr,
+						"\nWrong command format. Give the operations ,-period frames and -raw rate channels bits as input\n\n");
+				result = EXIT_FAILURE;
+			} else if (live(argv[2], periodFrames, rate, channels, bits)
+					== EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+			}
+		} else if (strcmp(argv[1], "-mixdown") == 0) { // 24: -mixdown
+			if (mixdown(argv + 2, argc - 2) == EXIT_FAILURE) {
+				result = EXIT_FAILURE;
+			}
 		} else if (strcmp(argv[1], "-merge") == 0) { // Extra: -merge
 			if (argc != 4) {
-				printf(
+				fprintf(out,
 						"\nWrong command format. Give two audio files as input\n\n");
+				result = EXIT_FAILURE;
 			} else {
 				if (merge(argv[2], argv[3]) == EXIT_FAILURE) {
+					result = EXIT_FAILURE;
 					//printf("\nThis is not a compatible .wav audio file.\n\n");
 				}
 			}
 		} else {
-			printf("\nWrong command format.\n\n");
+			fprintf(out, "\nWrong command format.\n\n");
+			result = EXIT_FAILURE;
+		}
+	}
+	setCommandOutput(previous);
+	return result;
+}
 
+int main(int argc, char** argv) {
+	if (argc >= 3 && strcmp(argv[1], "--shard") == 0) {
+		if (setShard(argv[2]) == EXIT_FAILURE) {
+			fprintf(stderr,
+					"\nWrong shard. Give --shard i/N with i from 0 to N-1\n\n");
+			return EXIT_FAILURE;
 		}
+		// the command follows the shard
+		argv[2] = argv[0];
+		argv += 2;
+		argc = shardCommand(argc - 2, argv);
+	}
+	if (!isMachineReadable(argc, argv)) {
+		printBanner();
+	}
+	if (argc == 3 && strcmp(argv[1], "-serve") == 0) { // 15: -serve
+		return serve(argv[2], runCommand);
+	} else if (argc >= 4 && strcmp(argv[1], "-client") == 0) { // 16: -client
+		return client(argv[2], argc - 3, &argv[3]);
 	}
-	return 0;
+	return runCommand(stdout, argc, argv);
 }
 
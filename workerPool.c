@@ -0,0 +1,185 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *  @file workerPool.c
+ *  @brief A pool of worker threads with a bounded queue of jobs
+ *
+ *  The jobs are kept in a circular array. A mutex protects the queue ,one
+ *  condition wakes up the workers when a job arrives and another one wakes up
+ *  the producers and the waiters when a job leaves the queue or finishes.
+ *
+ *  @version 1.0
+ *  @author Valentinos Pariza
+ *  @bugs No known bugs
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <unistd.h>
+#include "workerPool.h"
+
+typedef struct {
+	JOB_FUNCTION function;
+	void *argument;
+} JOB;
+
+struct WORKER_POOL {
+	pthread_mutex_t lock;
+	pthread_cond_t notEmpty;
+	pthread_cond_t changed;
+	pthread_t *threads;
+	int numThreads;
+	JOB *queue;
+	int capacity;
+	int head;
+	int count;
+	int running;
+	bool stopping;
+	FILE *output; // the output of the messages of the thread which created it
+};
+
+/**
+ * @brief The loop of a worker thread
+ *
+ *	Takes the jobs out of the queue and runs them until the pool is stopping
+ *	and the queue is empty. The messages of the jobs go to the output of the
+ *	thread which created the pool.
+ *
+ * 	@param *argument the pool
+ * 	@return void* NULL
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PRIVATE void *workerLoop(void *argument) {
+	WORKER_POOL *pool = (WORKER_POOL *) argument;
+	JOB job;
+	setCommandOutput(pool->output);
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (pool->count == 0 && !pool->stopping) {
+			pthread_cond_wait(&pool->notEmpty, &pool->lock);
+		}
+		if (pool->count == 0) { // stopping and nothing left
+			break;
+		}
+		job = pool->queue[pool->head];
+		pool->head = (pool->head + 1) % pool->capacity;
+		pool->count--;
+		pool->running++;
+		pthread_cond_broadcast(&pool->changed);
+		pthread_mutex_unlock(&pool->lock);
+		job.function(job.argument);
+		pthread_mutex_lock(&pool->lock);
+		pool->running--;
+		pthread_cond_broadcast(&pool->changed);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+PUBLIC WORKER_POOL *createWorkerPool(int threads, int capacity) {
+	if (threads < 0) {
+		return NULL;
+	}
+	if (capacity < 1) {
+		capacity = 1;
+	}
+	WORKER_POOL *pool = (WORKER_POOL *) calloc(1, sizeof(WORKER_POOL));
+	if (pool == NULL) {
+		return NULL;
+	}
+	pool->queue = (JOB *) malloc(sizeof(JOB) * capacity);
+	pool->threads = (pthread_t *) malloc(sizeof(pthread_t) * (threads + 1));
+	if (pool->queue == NULL || pool->threads == NULL) {
+		free(pool->queue);
+		free(pool->threads);
+		free(pool);
+		return NULL;
+	}
+	pool->capacity = capacity;
+	pool->output = commandOutput();
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->notEmpty, NULL);
+	pthread_cond_init(&pool->changed, NULL);
+	for (pool->numThreads = 0; pool->numThreads < threads; pool->numThreads++) {
+		if (pthread_create(&pool->threads[pool->numThreads], NULL, workerLoop,
+				pool) != 0) {
+			break; // run with the threads created until now
+		}
+	}
+	return pool;
+}
+
+PUBLIC int submitJob(WORKER_POOL *pool, JOB_FUNCTION function, void *argument) {
+	if (pool == NULL || function == NULL) {
+		return EXIT_FAILURE;
+	}
+	if (pool->numThreads == 0) { // No workers, run it here
+		function(argument);
+		return EXIT_SUCCESS;
+	}
+	pthread_mutex_lock(&pool->lock);
+	while (pool->count == pool->capacity) {
+		pthread_cond_wait(&pool->changed, &pool->lock);
+	}
+	pool->queue[(pool->head + pool->count) % pool->capacity].function =
+			function;
+	pool->queue[(pool->head + pool->count) % pool->capacity].argument =
+			argument;
+	pool->count++;
+	pthread_cond_signal(&pool->notEmpty);
+	pthread_mutex_unlock(&pool->lock);
+	return EXIT_SUCCESS;
+}
+
+PUBLIC void waitWorkerPool(WORKER_POOL *pool) {
+	if (pool == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	while (pool->count > 0 || pool->running > 0) {
+		pthread_cond_wait(&pool->changed, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+PUBLIC void destroyWorkerPool(WORKER_POOL **pool) {
+	if (pool == NULL || *pool == NULL) {
+		return;
+	}
+	int i;
+	pthread_mutex_lock(&(*pool)->lock);
+	(*pool)->stopping = true;
+	pthread_cond_broadcast(&(*pool)->notEmpty);
+	pthread_mutex_unlock(&(*pool)->lock);
+	for (i = 0; i < (*pool)->numThreads; i++) {
+		pthread_join((*pool)->threads[i], NULL);
+	}
+	pthread_mutex_destroy(&(*pool)->lock);
+	pthread_cond_destroy(&(*pool)->notEmpty);
+	pthread_cond_destroy(&(*pool)->changed);
+	free((*pool)->queue);
+	free((*pool)->threads);
+	free(*pool);
+	*pool = NULL;
+}
+
+PUBLIC int defaultWorkerCount() {
+	char *value = getenv("WAVENGINE_THREADS");
+	long count = 0;
+	if (value != NULL) {
+		count = atol(value);
+	} else {
+		count = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	return (count < 1) ? 1 : (int) count;
+}
+
+PUBLIC int workerCountFor(int jobs) {
+	int threads = defaultWorkerCount();
+	if (jobs < JOBS_PER_WORKER) {
+		return 0;
+	}
+	return (threads > jobs / JOBS_PER_WORKER) ? jobs / JOBS_PER_WORKER : threads;
+}
@@ -0,0 +1,104 @@
+/**
+ *  Program: wavengine  Copyright (C) 2018  Marios Pafitis & Valentinos Pariza
+ *  This program comes with ABSOLUTELY NO WARRANTY;
+ *  This is free software, and you are welcome to redistribute it under certain
+ *  conditions;
+ *
+ *  This file contains the function prototypes of a pool of worker threads
+ *  ,which run jobs from a bounded queue. It is used by the operations which
+ *  process many files at once.
+ */
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "utilities.h"
+
+/**
+ * A job of the pool is a function called with a single argument
+ */
+typedef void (*JOB_FUNCTION)(void *argument);
+
+// The least number of short jobs for which a worker thread is started
+#define JOBS_PER_WORKER 8
+
+typedef struct WORKER_POOL WORKER_POOL;
+
+/**
+ * @brief Create a pool of worker threads
+ *
+ *	This function starts a number of threads which wait for jobs submitted with
+ *	submitJob. The queue of the jobs keeps at most capacity jobs ,so a producer
+ *	faster than the workers is blocked until a job is finished (backpressure).
+ *	If the number of threads is 0 the jobs are run by the thread which submits
+ *	them.
+ *
+ * 	@param threads the number of worker threads (0 or more)
+ * 	@param capacity the maximum number of jobs waiting in the queue
+ * 	@return WORKER_POOL* the pool or NULL if it couldn't be created
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC WORKER_POOL *createWorkerPool(int threads, int capacity);
+/**
+ * @brief Submit a job to a pool of worker threads
+ *
+ *	This function places a job in the queue of the pool. If the queue is full it
+ *	waits until a worker takes a job out of it.
+ *
+ * 	@param *pool the pool
+ * 	@param function the function of the job
+ * 	@param *argument the argument passed to the function
+ * 	@return int Success or Failure
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int submitJob(WORKER_POOL *pool, JOB_FUNCTION function, void *argument);
+/**
+ * @brief Wait for all the jobs of a pool of worker threads
+ *
+ *	This function returns when the queue is empty and no worker is running a job.
+ *
+ * 	@param *pool the pool
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void waitWorkerPool(WORKER_POOL *pool);
+/**
+ * @brief Destroy a pool of worker threads
+ *
+ *	This function waits for all the submitted jobs ,stops the threads and frees
+ *	the pool. The variable which holds the pool is set to NULL.
+ *
+ * 	@param **pool the pointer of the variable which holds the pool
+ * 	@return void
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC void destroyWorkerPool(WORKER_POOL **pool);
+/**
+ * @brief The default number of worker threads
+ *
+ *	The number of the online processors ,or the value of the environment variable
+ *	WAVENGINE_THREADS if it is set.
+ *
+ * 	@return int the number of threads (at least 1)
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int defaultWorkerCount();
+/**
+ * @brief The number of worker threads for a number of short jobs
+ *
+ *	The default number of worker threads ,but no more than one for every
+ *	JOBS_PER_WORKER jobs. A few jobs are run by the thread which submits them
+ *	(0 threads) ,because starting the threads would take longer than the jobs.
+ *
+ * 	@param jobs the number of the jobs
+ * 	@return int the number of threads (0 or more)
+ *	@author Valentinos Pariza
+ * 	@bug No known bugs.
+ */
+PUBLIC int workerCountFor(int jobs);
+
+#endif